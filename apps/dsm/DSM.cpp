@@ -38,6 +38,7 @@
 #include "AmSipHeaders.h"
 #include "AmEventDispatcher.h"
 #include "SystemDSM.h"
+#include "DSMAsync.h"
 
 #include <string>
 #include <fstream>
@@ -111,6 +112,8 @@ DSMFactory::~DSMFactory() {
     delete *it;
 
   delete MainScriptConfig.diags;
+
+  DSMAsyncPool::dispose();
 }
 
 int DSMFactory::onLoad()
@@ -127,6 +130,8 @@ int DSMFactory::onLoad()
 
   DebugDSM = cfg.getParameter("debug_raw_dsm") == "yes";
   CheckDSM = cfg.getParameter("dsm_consistency_check", "yes") == "yes";
+
+  DSMAsyncPool::instance()->configure(cfg);
  
   if (!loadPrompts(cfg))
     return -1;
@@ -578,7 +583,7 @@ void DSMFactory::runMonitorAppSelect(const AmSipRequest& req, string& start_diag
 	  from_parser.uri = req.from_uri;
 	else {
 	  size_t end;
-	  string pai = getHeader(req.hdrs, SIP_HDR_P_ASSERTED_IDENTITY, true);
+	  string pai = req.getHeader(SIP_HDR_P_ASSERTED_IDENTITY, true);
 	  if (!from_parser.parse_contact(pai, 0, end)) {
 	    WARN("Failed to parse " SIP_HDR_P_ASSERTED_IDENTITY " '%s'\n",
 		  pai.c_str());
@@ -623,7 +628,7 @@ void DSMFactory::runMonitorAppSelect(const AmSipRequest& req, string& start_diag
       }
       // apply additional filters
       if (MonSelectFilters.size()) {
-	string app_params = getHeader(req.hdrs, PARAM_HDR);
+	string app_params = req.getHeader(PARAM_HDR);
 	for (vector<string>::iterator it = 
 	       MonSelectFilters.begin(); it != MonSelectFilters.end(); it++) {
 	  AmArg filter;
@@ -1198,6 +1203,8 @@ void DSMFactory::invoke(const string& method, const AmArg& args,
       ret.push(500);
       ret.push(status);
     }
+  } else if (method == "getAsyncStats"){
+    DSMAsyncPool::instance()->getStats(ret);
   } else if(method == "_list"){ 
     ret.push(AmArg("postDSMEvent"));
     ret.push(AmArg("reloadDSMs"));
@@ -1210,6 +1217,7 @@ void DSMFactory::invoke(const string& method, const AmArg& args,
     ret.push(AmArg("listDSMs"));
     ret.push(AmArg("registerApplication"));
     ret.push(AmArg("createSystemDSM"));
+    ret.push(AmArg("getAsyncStats"));
   }  else
     throw AmDynInvoke::NotImplemented(method);
 }
@@ -0,0 +1,551 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "DSMAsync.h"
+#include "AmEventDispatcher.h"
+#include "AmPlaylist.h"
+#include "AmSession.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <algorithm>
+#include <string.h>
+
+using std::chrono::steady_clock;
+
+static unsigned long elapsed_ms(steady_clock::time_point from,
+				steady_clock::time_point to)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+/** AmArg has no operator== */
+static bool equalArgs(const AmArg& a, const AmArg& b)
+{
+  if (a.getType() != b.getType())
+    return false;
+
+  switch (a.getType()) {
+  case AmArg::Undef: return true;
+  case AmArg::Int: return a.asInt() == b.asInt();
+  case AmArg::LongLong: return a.asLongLong() == b.asLongLong();
+  case AmArg::Bool: return a.asBool() == b.asBool();
+  case AmArg::Double: return a.asDouble() == b.asDouble();
+  case AmArg::CStr: return !strcmp(a.asCStr(), b.asCStr());
+  case AmArg::AObject:
+  case AmArg::AObjectShared: return a.asObject() == b.asObject();
+  case AmArg::ADynInv: return a.asDynInv() == b.asDynInv();
+  case AmArg::Blob:
+    return a.asBlob().len == b.asBlob().len &&
+      !memcmp(a.asBlob().data, b.asBlob().data, a.asBlob().len);
+
+  case AmArg::Array:
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); i++)
+      if (!equalArgs(a.get(i), b.get(i)))
+	return false;
+    return true;
+
+  case AmArg::Struct: {
+    if (a.size() != b.size())
+      return false;
+    for (AmArg::ValueStruct::const_iterator it = a.asStruct().begin();
+	 it != a.asStruct().end(); it++) {
+      if (!b.hasMember(it->first) || !equalArgs(it->second, b[it->first]))
+	return false;
+    }
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+// ------------------------------------------------------------
+
+void DSMAsyncSession::notAvailable(const char* func)
+{
+  WARN("%s is not available in async action '%s'\n", func, action_name.c_str());
+  SET_ERRNO(DSM_ERRNO_SCRIPT);
+  SET_STRERROR(string(func) + " is not available in async actions");
+}
+
+void DSMAsyncSession::playPrompt(const string&, bool, bool) { notAvailable("playPrompt"); }
+void DSMAsyncSession::playFile(const string&, bool, bool) { notAvailable("playFile"); }
+void DSMAsyncSession::playSilence(unsigned int, bool) { notAvailable("playSilence"); }
+void DSMAsyncSession::playRingtone(int, int, int, int, int, bool) { notAvailable("playRingtone"); }
+void DSMAsyncSession::recordFile(const string&) { notAvailable("recordFile"); }
+unsigned int DSMAsyncSession::getRecordLength() { notAvailable("getRecordLength"); return 0; }
+unsigned int DSMAsyncSession::getRecordDataSize() { notAvailable("getRecordDataSize"); return 0; }
+void DSMAsyncSession::stopRecord() { notAvailable("stopRecord"); }
+void DSMAsyncSession::setInOutPlaylist() { notAvailable("setInOutPlaylist"); }
+void DSMAsyncSession::setInputPlaylist() { notAvailable("setInputPlaylist"); }
+void DSMAsyncSession::setOutputPlaylist() { notAvailable("setOutputPlaylist"); }
+
+void DSMAsyncSession::addToPlaylist(AmPlaylistItem* item, bool)
+{
+  notAvailable("addToPlaylist");
+  delete item;
+}
+
+void DSMAsyncSession::flushPlaylist() { notAvailable("flushPlaylist"); }
+void DSMAsyncSession::setPromptSet(const string&) { notAvailable("setPromptSet"); }
+void DSMAsyncSession::addSeparator(const string&, bool) { notAvailable("addSeparator"); }
+void DSMAsyncSession::connectMedia() { notAvailable("connectMedia"); }
+void DSMAsyncSession::disconnectMedia() { notAvailable("disconnectMedia"); }
+void DSMAsyncSession::mute() { notAvailable("mute"); }
+void DSMAsyncSession::unmute() { notAvailable("unmute"); }
+
+void DSMAsyncSession::B2BconnectCallee(const string&, const string&, bool)
+{
+  notAvailable("B2BconnectCallee");
+}
+
+void DSMAsyncSession::B2BterminateOtherLeg() { notAvailable("B2BterminateOtherLeg"); }
+void DSMAsyncSession::B2BaddReceivedRequest(const AmSipRequest&) { notAvailable("B2BaddReceivedRequest"); }
+void DSMAsyncSession::B2BsetRelayEarlyMediaSDP(bool) { notAvailable("B2BsetRelayEarlyMediaSDP"); }
+
+void DSMAsyncSession::replaceHdrsCRLF(string& hdrs)
+{
+  size_t p = hdrs.find("\\r\\n");
+  while (p != string::npos) {
+    hdrs.replace(p, 4, "\r\n");
+    p = hdrs.find("\\r\\n");
+  }
+}
+
+void DSMAsyncSession::B2BsetHeaders(const string&, bool) { notAvailable("B2BsetHeaders"); }
+void DSMAsyncSession::B2BclearHeaders() { notAvailable("B2BclearHeaders"); }
+void DSMAsyncSession::B2BaddHeader(const string&) { notAvailable("B2BaddHeader"); }
+void DSMAsyncSession::B2BremoveHeader(const string&) { notAvailable("B2BremoveHeader"); }
+
+void DSMAsyncSession::transferOwnership(DSMDisposable* d)
+{
+  if (d == NULL)
+    return;
+  owned.push_back(d);
+}
+
+void DSMAsyncSession::releaseOwnership(DSMDisposable* d)
+{
+  if (d == NULL)
+    return;
+
+  vector<DSMDisposable*>::iterator it = std::find(owned.begin(), owned.end(), d);
+  if (it != owned.end())
+    owned.erase(it);
+  else
+    released.push_back(d);
+}
+
+void DSMAsyncSession::B2BgetHeaderRequest(const string&, string&) { notAvailable("B2BgetHeaderRequest"); }
+void DSMAsyncSession::B2BgetHeaderReply(const string&, string&) { notAvailable("B2BgetHeaderReply"); }
+
+void DSMAsyncSession::B2BgetHeaderParamRequest(const string&, const string&, string&)
+{
+  notAvailable("B2BgetHeaderParamRequest");
+}
+
+void DSMAsyncSession::B2BgetHeaderParamReply(const string&, const string&, string&)
+{
+  notAvailable("B2BgetHeaderParamReply");
+}
+
+// ------------------------------------------------------------
+
+DSMAsyncJob::DSMAsyncJob(DSMAction* action, const string& module, unsigned long id,
+			 AmSession* sess, DSMSession* from_sess,
+			 DSMCondition::EventType event,
+			 map<string,string>* event_params)
+  : action(action), module(module), id(id),
+    sess_id(sess->getLocalTag()), event(event),
+    var_before(from_sess->var), avar_before(from_sess->avar),
+    queued(steady_clock::now()), result("rejected")
+{
+  if (event_params)
+    this->event_params = *event_params;
+
+  sc_sess.var = from_sess->var;
+  sc_sess.avar = from_sess->avar;
+  sc_sess.setActionName(action->name);
+
+  started = finished = queued;
+}
+
+void DSMAsyncJob::run()
+{
+  started = steady_clock::now();
+
+  sc_sess.CLR_ERRNO;
+  sc_sess.CLR_STRERROR;
+  result = "ok";
+
+  try {
+    // only session_free actions, the session goes on meanwhile
+    if (action->execute(NULL, &sc_sess, event, &event_params)) {
+      WARN("async action '%s' wants to modify the state engine - ignored\n",
+	   action->name.c_str());
+    }
+  } catch (DSMException& e) {
+    DBG("DSMException in async action '%s', type = %s\n",
+	action->name.c_str(), e.params["type"].c_str());
+    sc_sess.SET_ERRNO(e.params["type"]);
+    sc_sess.SET_STRERROR(e.params["text"]);
+  } catch (const std::exception& e) {
+    ERROR("exception in async action '%s': %s\n", action->name.c_str(), e.what());
+    sc_sess.SET_ERRNO(DSM_ERRNO_GENERAL);
+    sc_sess.SET_STRERROR(e.what());
+  } catch (...) {
+    ERROR("unknown exception in async action '%s'\n", action->name.c_str());
+    sc_sess.SET_ERRNO(DSM_ERRNO_GENERAL);
+    sc_sess.SET_STRERROR("unknown exception");
+  }
+
+  if (!sc_sess.var["errno"].empty())
+    result = "error";
+
+  finished = steady_clock::now();
+}
+
+// ------------------------------------------------------------
+
+DSMAsyncResultEvent::~DSMAsyncResultEvent()
+{
+  if (!job)
+    return;
+
+  // never got to the session
+  for (vector<DSMDisposable*>::iterator it = job->sc_sess.owned.begin();
+       it != job->sc_sess.owned.end(); it++)
+    delete *it;
+  delete job;
+}
+
+void DSMAsyncResultEvent::apply(AmSession* sess, DSMSession* sc_sess,
+				map<string,string>& params)
+{
+  if (!job)
+    return;
+
+  // only what the action changed, the session may have gone on meanwhile
+  VarMapT& var = job->sc_sess.var;
+  for (VarMapT::iterator it = var.begin(); it != var.end(); it++) {
+    VarMapT::iterator b = job->var_before.find(it->first);
+    if (b == job->var_before.end() || b->second != it->second)
+      sc_sess->var[it->first] = it->second;
+  }
+  for (VarMapT::iterator it = job->var_before.begin();
+       it != job->var_before.end(); it++) {
+    if (var.find(it->first) == var.end())
+      sc_sess->var.erase(it->first);
+  }
+
+  AVarMapT& avar = job->sc_sess.avar;
+  for (AVarMapT::iterator it = avar.begin(); it != avar.end(); it++) {
+    AVarMapT::iterator b = job->avar_before.find(it->first);
+    if (b == job->avar_before.end() || !equalArgs(b->second, it->second))
+      sc_sess->avar[it->first] = it->second;
+  }
+  for (AVarMapT::iterator it = job->avar_before.begin();
+       it != job->avar_before.end(); it++) {
+    if (avar.find(it->first) == avar.end())
+      sc_sess->avar.erase(it->first);
+  }
+
+  // the outcome of this action, whatever errno was before
+  sc_sess->var["errno"] = var["errno"];
+  sc_sess->var["strerror"] = var["strerror"];
+
+  for (vector<DSMDisposable*>::iterator it = job->sc_sess.owned.begin();
+       it != job->sc_sess.owned.end(); it++)
+    sc_sess->transferOwnership(*it);
+  for (vector<DSMDisposable*>::iterator it = job->sc_sess.released.begin();
+       it != job->sc_sess.released.end(); it++)
+    sc_sess->releaseOwnership(*it);
+
+  sess->dlg->decUsages();
+
+  params["id"] = int2str(job->id);
+  params["action"] = job->action->name;
+  params["module"] = job->module;
+  params["result"] = job->result;
+  params["errno"] = var["errno"];
+  params["strerror"] = var["strerror"];
+  params["queue_ms"] = int2str(elapsed_ms(job->queued, job->started));
+  params["run_ms"] = int2str(elapsed_ms(job->started, job->finished));
+
+  delete job;
+  job = NULL;
+}
+
+// ------------------------------------------------------------
+
+void DSMAsyncWorker::run()
+{
+  DSMAsyncPool* pool = DSMAsyncPool::instance();
+
+  DSMAsyncJob* job;
+  while ((job = pool->next()) != NULL) {
+    job->run();
+    pool->done(job);
+  }
+}
+
+// ------------------------------------------------------------
+
+const unsigned int DSMAsyncPool::hist_bounds_ms[DSM_ASYNC_HIST_BUCKETS - 1] = {
+  1, 5, 10, 50, 100, 500, 1000, 5000
+};
+
+DSMAsyncPool* DSMAsyncPool::_instance = NULL;
+
+DSMAsyncPool::ModuleStats::ModuleStats()
+  : limit(0), running(0), started(0), rejected(0), failed(0), run_max_ms(0)
+{
+  for (int i = 0; i < DSM_ASYNC_HIST_BUCKETS; i++)
+    queue_hist[i] = run_hist[i] = 0;
+}
+
+DSMAsyncPool::DSMAsyncPool()
+  : stopping(false), next_id(1),
+    num_threads(DSM_ASYNC_DEFAULT_THREADS),
+    queue_size(DSM_ASYNC_DEFAULT_QUEUE_SIZE)
+{
+}
+
+DSMAsyncPool::~DSMAsyncPool()
+{
+  vector<DSMAsyncWorker*> stop_workers;
+  std::list<DSMAsyncJob*> dropped;
+  {
+    std::lock_guard<std::mutex> l(mut);
+    stopping = true;
+    stop_workers.swap(workers);
+    dropped.swap(queue);
+  }
+  cond.notify_all();
+
+  for (vector<DSMAsyncWorker*>::iterator it = stop_workers.begin();
+       it != stop_workers.end(); it++) {
+    (*it)->join();
+    delete *it;
+  }
+
+  // let the sessions go
+  for (std::list<DSMAsyncJob*>::iterator it = dropped.begin(); it != dropped.end(); it++) {
+    (*it)->sc_sess.SET_ERRNO(DSM_ERRNO_GENERAL);
+    (*it)->sc_sess.SET_STRERROR("async action pool stopped");
+    post(*it);
+  }
+}
+
+DSMAsyncPool* DSMAsyncPool::instance()
+{
+  return _instance ? _instance : ((_instance = new DSMAsyncPool()));
+}
+
+void DSMAsyncPool::dispose()
+{
+  if (_instance != NULL) {
+    delete _instance;
+    _instance = NULL;
+  }
+}
+
+void DSMAsyncPool::configure(AmConfigReader& cfg)
+{
+  std::lock_guard<std::mutex> l(mut);
+
+  if (cfg.hasParameter("async_threads"))
+    num_threads = cfg.getParameterInt("async_threads", DSM_ASYNC_DEFAULT_THREADS);
+  if (cfg.hasParameter("async_queue_size"))
+    queue_size = cfg.getParameterInt("async_queue_size", DSM_ASYNC_DEFAULT_QUEUE_SIZE);
+
+  vector<string> limits = explode(cfg.getParameter("async_limits"), ",");
+  for (vector<string>::iterator it = limits.begin(); it != limits.end(); it++) {
+    vector<string> l = explode(*it, "=");
+    unsigned int limit;
+    if (l.size() != 2 || str2int(trim(l[1], " "), limit)) {
+      ERROR("async_limits: '%s' not understood (module=max)\n", it->c_str());
+      continue;
+    }
+    modules[trim(l[0], " ")].limit = limit;
+  }
+
+  DBG("async actions: %u threads, queue size %u\n", num_threads, queue_size);
+}
+
+void DSMAsyncPool::startWorkers()
+{
+  while (workers.size() < num_threads) {
+    DSMAsyncWorker* w = new DSMAsyncWorker();
+    workers.push_back(w);
+    w->start();
+  }
+}
+
+void DSMAsyncPool::addHist(unsigned long* hist, unsigned long ms)
+{
+  int i = 0;
+  while (i < DSM_ASYNC_HIST_BUCKETS - 1 && ms > hist_bounds_ms[i])
+    i++;
+  hist[i]++;
+}
+
+void DSMAsyncPool::post(DSMAsyncJob* job)
+{
+  string sess_id = job->sess_id;
+  DSMAsyncResultEvent* ev = new DSMAsyncResultEvent(job);
+  if (!AmEventDispatcher::instance()->post(sess_id, ev)) {
+    DBG("session '%s' of async action %lu is gone\n", sess_id.c_str(), job->id);
+    delete ev;
+  }
+}
+
+unsigned long DSMAsyncPool::dispatch(DSMAction* action, const string& module,
+				     AmSession* sess, DSMSession* sc_sess,
+				     DSMCondition::EventType event,
+				     map<string,string>* event_params)
+{
+  // until the result is applied
+  sess->dlg->incUsages();
+
+  DSMAsyncJob* job = NULL;
+  bool inline_run = false;
+  {
+    std::lock_guard<std::mutex> l(mut);
+
+    job = new DSMAsyncJob(action, module, next_id++, sess, sc_sess,
+			  event, event_params);
+
+    // a stopped session may be gone before a worker is done
+    inline_run = !num_threads || sess->getStopped();
+
+    if (!inline_run && !stopping && queue.size() < queue_size) {
+      startWorkers();
+      queue.push_back(job);
+      cond.notify_one();
+      return job->id;
+    }
+
+    if (!inline_run)
+      modules[module].rejected++;
+  }
+
+  if (inline_run) {
+    job->run();
+    unsigned long id = job->id;
+    post(job);
+    return id;
+  }
+
+  WARN("async action queue full (%u), rejecting '%s'\n", queue_size,
+       action->name.c_str());
+  job->sc_sess.SET_ERRNO(DSM_ERRNO_GENERAL);
+  job->sc_sess.SET_STRERROR("async action queue full");
+  unsigned long id = job->id;
+  post(job);
+  return id;
+}
+
+DSMAsyncJob* DSMAsyncPool::next()
+{
+  std::unique_lock<std::mutex> l(mut);
+
+  while (!stopping) {
+    for (std::list<DSMAsyncJob*>::iterator it = queue.begin(); it != queue.end(); it++) {
+      ModuleStats& m = modules[(*it)->module];
+      if (m.limit && m.running >= m.limit)
+	continue;
+
+      DSMAsyncJob* job = *it;
+      queue.erase(it);
+      m.running++;
+      m.started++;
+      addHist(m.queue_hist, elapsed_ms(job->queued, steady_clock::now()));
+      return job;
+    }
+
+    cond.wait(l);
+  }
+
+  return NULL;
+}
+
+void DSMAsyncPool::done(DSMAsyncJob* job)
+{
+  {
+    std::lock_guard<std::mutex> l(mut);
+
+    ModuleStats& m = modules[job->module];
+    m.running--;
+    if (job->result != "ok")
+      m.failed++;
+
+    unsigned long ms = elapsed_ms(job->started, job->finished);
+    addHist(m.run_hist, ms);
+    if (ms > m.run_max_ms)
+      m.run_max_ms = ms;
+  }
+  // a job of this module may be waiting
+  cond.notify_all();
+
+  post(job);
+}
+
+void DSMAsyncPool::getStats(AmArg& ret)
+{
+  std::lock_guard<std::mutex> l(mut);
+
+  ret["threads"] = (int)workers.size();
+  ret["max_threads"] = (int)num_threads;
+  ret["queued"] = (int)queue.size();
+  ret["queue_size"] = (int)queue_size;
+
+  AmArg& mods = ret["modules"];
+  mods.assertStruct();
+  for (map<string, ModuleStats>::iterator it = modules.begin(); it != modules.end(); it++) {
+    AmArg& m = mods[it->first];
+    m["limit"] = (int)it->second.limit;
+    m["running"] = (int)it->second.running;
+    m["started"] = (long long int)it->second.started;
+    m["rejected"] = (long long int)it->second.rejected;
+    m["failed"] = (long long int)it->second.failed;
+    m["run_max_ms"] = (long long int)it->second.run_max_ms;
+
+    AmArg& qh = m["queue_ms"];
+    AmArg& rh = m["run_ms"];
+    for (int i = 0; i < DSM_ASYNC_HIST_BUCKETS; i++) {
+      string bound = i < DSM_ASYNC_HIST_BUCKETS - 1 ?
+	"le_" + int2str(hist_bounds_ms[i]) : string("inf");
+      qh[bound] = (long long int)it->second.queue_hist[i];
+      rh[bound] = (long long int)it->second.run_hist[i];
+    }
+  }
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef _DSM_ASYNC_H
+#define _DSM_ASYNC_H
+
+#include "DSMSession.h"
+#include "DSMStateEngine.h"
+#include "AmThread.h"
+#include "AmConfigReader.h"
+
+#include <string>
+using std::string;
+#include <map>
+using std::map;
+#include <vector>
+using std::vector;
+#include <list>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#define DSM_ASYNC_RESULT_EVENT_ID -11
+
+#define DSM_ASYNC_HIST_BUCKETS 9
+
+#define DSM_ASYNC_DEFAULT_THREADS    4
+#define DSM_ASYNC_DEFAULT_QUEUE_SIZE 1000
+
+/**
+ * DSMSession an async action runs on in a worker thread: works on a
+ * copy of the session's variables, records the objects handed over
+ * with transferOwnership/releaseOwnership; media and B2B functions
+ * are not available.
+ */
+class DSMAsyncSession
+  : public DSMSession
+{
+  string action_name;
+
+  void notAvailable(const char* func);
+
+ public:
+  DSMAsyncSession() { }
+  ~DSMAsyncSession() { }
+
+  /** owned by the session once the result is applied */
+  vector<DSMDisposable*> owned;
+  /** released by the action, to be released by the session */
+  vector<DSMDisposable*> released;
+
+  void setActionName(const string& name) { action_name = name; }
+
+  void playPrompt(const string& name, bool loop = false, bool front = false);
+  void playFile(const string& name, bool loop, bool front = false);
+  void playSilence(unsigned int length, bool front = false);
+  void playRingtone(int length, int on, int off, int f, int f2, bool front);
+  void recordFile(const string& name);
+  unsigned int getRecordLength();
+  unsigned int getRecordDataSize();
+  void stopRecord();
+  void setInOutPlaylist();
+  void setInputPlaylist();
+  void setOutputPlaylist();
+
+  void addToPlaylist(AmPlaylistItem* item, bool front = false);
+  void flushPlaylist();
+  void setPromptSet(const string& name);
+  void addSeparator(const string& name, bool front = false);
+  void connectMedia();
+  void disconnectMedia();
+  void mute();
+  void unmute();
+
+  void B2BconnectCallee(const string& remote_party,
+			const string& remote_uri,
+			bool relayed_invite = false);
+  void B2BterminateOtherLeg();
+  void B2BaddReceivedRequest(const AmSipRequest& req);
+  void B2BsetRelayEarlyMediaSDP(bool enabled);
+  void replaceHdrsCRLF(string& hdrs);
+  void B2BsetHeaders(const string& hdr, bool replaceCRLF);
+  void B2BclearHeaders();
+  void B2BaddHeader(const string& hdr);
+  void B2BremoveHeader(const string& hdr);
+
+  void transferOwnership(DSMDisposable* d);
+  void releaseOwnership(DSMDisposable* d);
+
+  void B2BgetHeaderRequest(const string& hdr, string& out);
+  void B2BgetHeaderReply(const string& hdr, string& out);
+  void B2BgetHeaderParamRequest(const string& hdr, const string& param, string& out);
+  void B2BgetHeaderParamReply(const string& hdr, const string& param, string& out);
+};
+
+/** an action run in the async pool, and its result */
+struct DSMAsyncJob {
+  typedef std::chrono::steady_clock::time_point time_point;
+
+  DSMAction* action;
+  string module;
+  unsigned long id;
+
+  string sess_id;
+  DSMCondition::EventType event;
+  map<string,string> event_params;
+
+  /** the variables when the action was started */
+  VarMapT var_before;
+  AVarMapT avar_before;
+  DSMAsyncSession sc_sess;
+
+  time_point queued;
+  time_point started;
+  time_point finished;
+
+  /** "ok", "error" (action failed, see errno) or "rejected" */
+  string result;
+
+  DSMAsyncJob(DSMAction* action, const string& module, unsigned long id,
+	      AmSession* sess, DSMSession* from_sess,
+	      DSMCondition::EventType event,
+	      map<string,string>* event_params);
+
+  /** run the action on the copy of the variables, without the AmSession */
+  void run();
+};
+
+/** posted to the session when an async action is done */
+struct DSMAsyncResultEvent
+  : public AmEvent
+{
+  DSMAsyncJob* job;
+
+  DSMAsyncResultEvent(DSMAsyncJob* job)
+    : AmEvent(DSM_ASYNC_RESULT_EVENT_ID), job(job) { }
+  /** deletes the objects given to the session if not applied */
+  ~DSMAsyncResultEvent();
+
+  /**
+   * apply the variables changed by the action to sc_sess, hand over
+   * the objects and fill the event parameters for the AsyncResult event
+   */
+  void apply(AmSession* sess, DSMSession* sc_sess, map<string,string>& params);
+};
+
+class DSMAsyncWorker
+  : public AmThread
+{
+ protected:
+  void run();
+};
+
+/**
+ * Bounded pool of worker threads for the blocking actions of DSM
+ * modules (database queries, HTTP requests etc.) started with
+ * async(<action>): the session goes on processing its events, and
+ * gets an AsyncResult event with the changed variables once the
+ * action is done.
+ */
+class DSMAsyncPool
+{
+  static DSMAsyncPool* _instance;
+
+  struct ModuleStats {
+    /** max. actions of the module running at once, 0 for no limit */
+    unsigned int limit;
+    unsigned int running;
+
+    unsigned long started;
+    unsigned long rejected;
+    unsigned long failed;
+    unsigned long queue_hist[DSM_ASYNC_HIST_BUCKETS];
+    unsigned long run_hist[DSM_ASYNC_HIST_BUCKETS];
+    unsigned long run_max_ms;
+
+    ModuleStats();
+  };
+
+  static const unsigned int hist_bounds_ms[DSM_ASYNC_HIST_BUCKETS - 1];
+
+  std::mutex mut;
+  std::condition_variable cond;
+
+  std::list<DSMAsyncJob*> queue;
+  map<string, ModuleStats> modules;
+  vector<DSMAsyncWorker*> workers;
+  bool stopping;
+  unsigned long next_id;
+
+  unsigned int num_threads;
+  unsigned int queue_size;
+
+  DSMAsyncPool();
+  ~DSMAsyncPool();
+
+  static void addHist(unsigned long* hist, unsigned long ms);
+
+  /** mut must be held */
+  void startWorkers();
+  void post(DSMAsyncJob* job);
+
+ public:
+  static DSMAsyncPool* instance();
+  static void dispose();
+
+  /** async_threads, async_queue_size, async_limits from dsm.conf */
+  void configure(AmConfigReader& cfg);
+
+  /** @return the id of the action in the async pool */
+  unsigned long dispatch(DSMAction* action, const string& module,
+			 AmSession* sess, DSMSession* sc_sess,
+			 DSMCondition::EventType event,
+			 map<string,string>* event_params);
+
+  /**
+   * worker: wait for a job whose module is below its limit
+   * @return NULL when stopping
+   */
+  DSMAsyncJob* next();
+  /** worker: the job has been run, post the result */
+  void done(DSMAsyncJob* job);
+
+  void getStats(AmArg& ret);
+};
+
+#endif
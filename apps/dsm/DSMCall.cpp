@@ -30,6 +30,7 @@
 #include "AmUtils.h"
 #include "AmMediaProcessor.h"
 #include "DSM.h"
+#include "DSMAsync.h"
 #include "AmConferenceStatus.h"
 #include "AmAdvancedAudio.h"
 #include "AmRingTone.h"
@@ -509,6 +510,16 @@ void DSMCall::process(AmEvent* event)
     }  
   }
 
+  if (event->event_id == DSM_ASYNC_RESULT_EVENT_ID) {
+    DSMAsyncResultEvent* res_ev = dynamic_cast<DSMAsyncResultEvent*>(event);
+    if (res_ev) {
+      map<string, string> params;
+      res_ev->apply(this, this, params);
+      engine.runEvent(this, this, DSMCondition::AsyncResult, &params);
+      return;
+    }
+  }
+
   AmAudioEvent* audio_event = dynamic_cast<AmAudioEvent*>(event);
   if(audio_event && 
      ((audio_event->event_id == AmAudioEvent::cleared) || 
@@ -646,7 +657,7 @@ void DSMCall::process(AmEvent* event)
 
     /* add P-Asserted-Identity */
     if (!pai_from_hdr.empty() && !reply.hdrs.empty()) {
-      string pai_value = getHeader(reply.hdrs, pai_from_hdr, true);
+      string pai_value = reply.getHeader(pai_from_hdr, true);
 
       DBG("Building '%s' value from header '%s'.\n", SIP_HDR_P_ASSERTED_IDENTITY, pai_from_hdr.c_str());
 
@@ -1001,20 +1012,20 @@ void DSMCall::B2BaddHeader(const string& hdr) {
 }
 
 void DSMCall::B2BgetHeaderRequest(const string& hdr_name, string& out) {
-  out = getHeader(invite_req.hdrs, hdr_name, true);
+  out = invite_req.getHeader(hdr_name, true);
 }
 
 void DSMCall::B2BgetHeaderParamRequest(const string& hdr_name, const string& param_name, string& out) {
-  string hdr_value = getHeader(invite_req.hdrs, hdr_name, true);
+  string hdr_value = invite_req.getHeader(hdr_name, true);
   out = get_header_param(hdr_value, param_name);
 }
 
 void DSMCall::B2BgetHeaderReply(const string& hdr_name, string& out) {
-  out = getHeader(last_200_reply.hdrs, hdr_name, true);
+  out = last_200_reply.getHeader(hdr_name, true);
 }
 
 void DSMCall::B2BgetHeaderParamReply(const string& hdr_name, const string& param_name, string& out) {
-  string hdr_value = getHeader(last_200_reply.hdrs, hdr_name, true);
+  string hdr_value = last_200_reply.getHeader(hdr_name, true);
   out = get_header_param(hdr_value, param_name);
 }
 
@@ -1023,7 +1034,7 @@ void DSMCall::B2BclearHeaders() {
 }
 
 void DSMCall::B2BremoveHeader(const string& hdr) {
-  removeHeader(invite_req.hdrs, hdr);
+  invite_req.removeHeader(hdr);
 }
 
 /* --- B2B second leg -------------------------------------------------- */
@@ -120,6 +120,32 @@ string DSMChartReader::getToken(string str, size_t& pos) {
 
 DSMAction* DSMChartReader::actionFromToken(const string& str) {
 
+  if (str.length() > 7 && str.compare(0, 6, "async(") == 0 &&
+      str[str.length()-1] == ')') {
+    string inner = trim(str.substr(6, str.length()-7), " \t");
+    DSMAction* a = actionFromToken(inner);
+    if (!a)
+      return NULL;
+
+    // runs in a worker thread while the session goes on
+    if (!a->session_free) {
+      ERROR("'%s' uses the session, it can not be run with async()\n",
+	    inner.c_str());
+      delete a;
+      return NULL;
+    }
+
+    // module prefix of the command, e.g. mysql.query -> mysql
+    string module = "core";
+    size_t dot = inner.find('.');
+    if (dot != string::npos && dot < inner.find('('))
+      module = inner.substr(0, dot);
+
+    SCAsyncAction* async = new SCAsyncAction(a, module);
+    async->name = str;
+    return async;
+  }
+
   mods_mutex.lock();
   for (v_modsHdls::iterator it=mods.begin(); it!= mods.end(); it++)
   {
@@ -130,13 +156,17 @@ DSMAction* DSMChartReader::actionFromToken(const string& str) {
     DSMAction* a = mod->getAction(str);
     if (a) {
       mods_mutex.unlock();
+      a->compile();
       return a;
     }
   }
   mods_mutex.unlock();
 
   DSMAction* a = core_mod.getAction(str);
-  if (a) return a;
+  if (a) {
+    a->compile();
+    return a;
+  }
 
   ERROR("could not find action for '%s' (missing import?)\n", str.c_str());
   return NULL;
@@ -223,14 +253,17 @@ DSMCondition* DSMChartReader::conditionFromToken(const string& str, bool invert)
     if (c) {
       c->invert = invert;
       mods_mutex.unlock();
+      c->compile();
       return c;
     }
   }
   mods_mutex.unlock();
 
   DSMCondition* c = core_mod.getCondition(str);
-  if (c) 
+  if (c) {
     c->invert = invert;
+    c->compile();
+  }
 
   if (c)  return c;
   ERROR("could not find condition for '%s' (missing import?)\n", str.c_str());
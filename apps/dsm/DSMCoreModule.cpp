@@ -33,6 +33,7 @@
 #include "AmUtils.h"
 #include "AmEventDispatcher.h"
 #include "DSM.h"
+#include "DSMAsync.h"
 #include "AmB2BSession.h"
 
 #include "jsonArg.h"
@@ -131,12 +132,14 @@ DSMAction* DSMCoreModule::getAction(const string& from_str) {
   if (cmd == "DI") {
     SCDIAction * a = new SCDIAction(params, false);
     a->name = from_str;
+    a->session_free = true;
     return a;
   }  
 
   if (cmd == "DIgetResult") {
     SCDIAction * a = new SCDIAction(params, true);
     a->name = from_str;
+    a->session_free = true;
     return a;
   }  
 
@@ -250,6 +253,9 @@ DSMCondition* DSMCoreModule::getCondition(const string& from_str) {
   if (cmd == "subscription")
     return new TestDSMCondition(params, DSMCondition::SIPSubscription);
 
+  if (cmd == "asyncResult")
+    return new TestDSMCondition(params, DSMCondition::AsyncResult);
+
   if (cmd == "startup")
     return new TestDSMCondition(params, DSMCondition::Startup);
 
@@ -835,6 +841,42 @@ string replaceParams(const string& q, AmSession* sess, DSMSession* sc_sess,
   }
   return res;
 }
+string replaceParams(const DSMParam& q, AmSession* sess, DSMSession* sc_sess,
+		     map<string,string>* event_params) {
+  const vector<DSMParam::Segment>* segs = q.segments();
+  if (!segs)
+    return replaceParams((const string&)q, sess, sc_sess, event_params);
+
+  string res;
+  res.reserve(q.length());
+  for (vector<DSMParam::Segment>::const_iterator it = segs->begin();
+       it != segs->end(); it++) {
+    switch (it->kind) {
+    case DSMParam::Var: {
+      VarMapT::iterator v = sc_sess->var.find(it->text);
+      if (v != sc_sess->var.end())
+	res += v->second;
+    } break;
+    case DSMParam::Param: {
+      if (NULL == event_params) {
+	res += it->raw;
+	break;
+      }
+      map<string,string>::iterator p = event_params->find(it->text);
+      if (p != event_params->end())
+	res += p->second;
+    } break;
+    case DSMParam::Select:
+      res += DSMParam::resolveSelect(it->select, sess);
+      break;
+    default:
+      res += it->text;
+      break;
+    }
+  }
+  return res;
+}
+
 CONST_ACTION_2P(SCSetSAction,'=', false);
 EXEC_ACTION_START(SCSetSAction) {
   if (par1.length() && par1[0] == '#') {
@@ -1803,3 +1845,17 @@ EXEC_ACTION_START(SCFreeObjectAction) {
   delete disp;
   sc_sess->avar.erase(var_name);
 } EXEC_ACTION_END;
+
+SCAsyncAction::SCAsyncAction(DSMAction* action, const string& module)
+  : action(action), module(module) {
+}
+
+SCAsyncAction::~SCAsyncAction() {
+  delete action;
+}
+
+EXEC_ACTION_START(SCAsyncAction) {
+  unsigned long id = DSMAsyncPool::instance()->
+    dispatch(action, module, sess, sc_sess, event, event_params);
+  sc_sess->var["async.id"] = int2str(id);
+} EXEC_ACTION_END;
@@ -160,6 +160,19 @@ class SCDIAction
 	       map<string,string>* event_params);
 };									
 
+/** async(<action>): runs action in the DSMAsyncPool */
+class SCAsyncAction
+: public DSMAction {
+  DSMAction* action;
+  string module;
+ public:
+  SCAsyncAction(DSMAction* action, const string& module);
+  ~SCAsyncAction();
+  bool execute(AmSession* sess, DSMSession* sc_sess,
+	       DSMCondition::EventType event,
+	       map<string,string>* event_params);
+};
+
 // TODO: replace with real expression matching 
 class TestDSMCondition 
 : public DSMCondition {
@@ -171,12 +184,13 @@ class TestDSMCondition
     Less,
     Gt
   };
-  string lhs;
-  string rhs;
+  DSMParam lhs;
+  DSMParam rhs;
   CondType ttype;
 
  public:
   TestDSMCondition(const string& expr, DSMCondition::EventType e);
+  void compile() { lhs.compile(); rhs.compile(); }
   bool match(AmSession* sess, DSMSession* sc_sess, DSMCondition::EventType event,
 	     map<string,string>* event_params);
 };
@@ -185,8 +199,8 @@ class TestDSMCondition
 string replaceParams(const string& q, AmSession* sess, DSMSession* sc_sess,
 		     map<string,string>* event_params);
 
-/** return string q with variables/params/selects replaced */
-string replaceParams(const string& q, AmSession* sess, DSMSession* sc_sess,
+/** replaceParams using the compiled segments of q, if any */
+string replaceParams(const DSMParam& q, AmSession* sess, DSMSession* sc_sess,
 		     map<string,string>* event_params);
 
 #endif
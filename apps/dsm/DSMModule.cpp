@@ -114,6 +114,10 @@ string resolveVars(const string& _s, AmSession* sess,
       if (s.length() < 2)
 	return "@";
 
+      // no session in async actions
+      if (!sess)
+	return string();
+
       string s1 = s.substr(1); 
       if (s1 == "local_tag")
 	return sess->getLocalTag();	
@@ -142,6 +146,268 @@ string resolveVars(const string& _s, AmSession* sess,
   return s;
 }
 
+static const struct {
+  const char* name;
+  DSMParam::SelectType type;
+} dsm_selects[] = {
+  { "local_tag",    DSMParam::SelLocalTag },
+  { "user",         DSMParam::SelUser },
+  { "domain",       DSMParam::SelDomain },
+  { "remote_tag",   DSMParam::SelRemoteTag },
+  { "callid",       DSMParam::SelCallId },
+  { "local_uri",    DSMParam::SelLocalUri },
+  { "local_party",  DSMParam::SelLocalParty },
+  { "remote_uri",   DSMParam::SelRemoteUri },
+  { "remote_party", DSMParam::SelRemoteParty },
+};
+
+DSMParam::Segment DSMParam::compileRef(const string& s) {
+  Segment r;
+  if (s.empty())
+    return r;
+
+  switch (s[0]) {
+  case '$':
+    if (s.length() > 1 && s[1] == '$') {
+      r.text = "$";
+    } else {
+      r.kind = Var;
+      r.text = s.substr(1);
+    }
+    break;
+  case '#':
+    if (s.length() > 1 && s[1] == '#') {
+      r.text = "#";
+    } else {
+      r.kind = Param;
+      r.text = s.substr(1);
+    }
+    break;
+  case '@':
+    if (s.length() < 2 || s[1] == '@') {
+      r.text = "@";
+    } else {
+      for (size_t i = 0; i < sizeof(dsm_selects)/sizeof(dsm_selects[0]); i++) {
+	if (s.compare(1, string::npos, dsm_selects[i].name) == 0) {
+	  r.kind = Select;
+	  r.select = dsm_selects[i].type;
+	  break;
+	}
+      }
+      // unknown select: empty
+    }
+    break;
+  default:
+    r.text = trim(s, "\"");
+  }
+  return r;
+}
+
+const string& DSMParam::resolveSelect(SelectType sel, AmSession* sess) {
+  static const string empty;
+  if (!sess)
+    return empty;
+
+  switch (sel) {
+  case SelLocalTag:    return sess->getLocalTag();
+  case SelUser:        return sess->dlg->getUser();
+  case SelDomain:      return sess->dlg->getDomain();
+  case SelRemoteTag:   return sess->getRemoteTag();
+  case SelCallId:      return sess->getCallID();
+  case SelLocalUri:    return sess->dlg->getLocalUri();
+  case SelLocalParty:  return sess->dlg->getLocalParty();
+  case SelRemoteUri:   return sess->dlg->getRemoteUri();
+  case SelRemoteParty: return sess->dlg->getRemoteParty();
+  default:             return empty;
+  }
+}
+
+static std::shared_ptr<DSMParam::Expr> compileExpr(const string& s) {
+  std::shared_ptr<DSMParam::Expr> e(new DSMParam::Expr());
+  e->whole = DSMParam::compileRef(s);
+
+  // same precedence as resolveVars: first '-', otherwise first '+'
+  size_t p = s.find('-');
+  e->op = '-';
+  if (p == string::npos) {
+    p = s.find('+');
+    e->op = '+';
+  }
+  if (p == string::npos) {
+    e->op = 0;
+    return e;
+  }
+
+  e->lhs = compileExpr(s.substr(0, p));
+  e->rhs = compileExpr(s.substr(p + 1));
+  return e;
+}
+
+#define IS_REPL_CHAR(c) ((c) == '$' || (c) == '#' || (c) == '@')
+
+/**
+ * Splits q into the segments replaceParams() would substitute.
+ * replaceParams() works in place, so what it does with a reference
+ * directly followed by another one depends on the value substituted
+ * for the first (empty, or ending in a backslash): those are left to
+ * the generic path.
+ * @return false if q can not be compiled
+ */
+static bool compileTemplate(const string& q, vector<DSMParam::Segment>& segs) {
+  string lit;
+  size_t pos = 0;
+
+  while (pos < q.length()) {
+    size_t rstart = q.find_first_of("$#@", pos);
+    if (rstart == string::npos) {
+      lit.append(q, pos, string::npos);
+      break;
+    }
+    lit.append(q, pos, rstart - pos);
+
+    // nothing before it in the result
+    bool at_start = lit.empty() && segs.empty();
+
+    if (!at_start && rstart + 1 < q.length() && q[rstart + 1] == q[rstart]) {
+      // "$$" etc.
+      lit += q[rstart];
+      pos = rstart + 2;
+      continue;
+    }
+    if (!lit.empty() && lit[lit.length() - 1] == '\\') {
+      // escaped
+      lit += q[rstart];
+      pos = rstart + 1;
+      continue;
+    }
+
+    size_t rend;
+    if (q.length() > rstart + 1 &&
+	(q[rstart + 1] == '(' || q[rstart + 1] == '"' || q[rstart + 1] == '\''))
+      rend = q.find_first_of(" ,()[]$#@\t;:'\"", rstart + 2);
+    else
+      rend = q.find_first_of(" ,()[]$#@\t;:'\"", rstart + 1);
+    if (rend == string::npos)
+      rend = q.length();
+    string keyname = q.substr(rstart + 1, rend - rstart - 1);
+
+    if (keyname.length() > 2) {
+      char end_c = rend < q.length() ? q[rend] : '\0';
+      if ((keyname[0] == '(' && end_c == ')') ||
+	  (keyname[0] == end_c && (keyname[0] == '"' || keyname[0] == '\''))) {
+	keyname = keyname.substr(1);
+	if (rend != q.length())
+	  rend++;
+      }
+    }
+
+    if (rend < q.length() && IS_REPL_CHAR(q[rend]))
+      return false;
+
+    if (!lit.empty()) {
+      segs.push_back(DSMParam::Segment());
+      segs.back().text.swap(lit);
+    }
+
+    switch (q[rstart]) {
+    case '$':
+      segs.push_back(DSMParam::Segment());
+      segs.back().kind = DSMParam::Var;
+      segs.back().text = keyname;
+      break;
+    case '#':
+      segs.push_back(DSMParam::Segment());
+      segs.back().kind = DSMParam::Param;
+      segs.back().text = keyname;
+      segs.back().raw = q.substr(rstart, rend - rstart);
+      break;
+    default:
+      segs.push_back(DSMParam::compileRef("@" + keyname));
+      break;
+    }
+    pos = rend;
+  }
+
+  if (!lit.empty()) {
+    segs.push_back(DSMParam::Segment());
+    segs.back().text.swap(lit);
+  }
+  return true;
+}
+
+void DSMParam::compile() {
+  ref = compileRef(*this);
+
+  templ.clear();
+  templ_compiled = compileTemplate(*this, templ);
+  if (!templ_compiled)
+    templ.clear();
+
+  expr.reset();
+  if (find_first_of(" +-") != string::npos) {
+    string s = *this;
+    string::size_type p;
+    while ((p = s.find(' ')) != string::npos)
+      s.erase(p, 1);
+    expr = compileExpr(s);
+  }
+
+  compiled = true;
+}
+
+static string resolveExpr(const DSMParam::Expr& e, AmSession* sess,
+			  DSMSession* sc_sess, map<string,string>* event_params);
+
+static string resolveSegment(const DSMParam::Segment& seg, AmSession* sess,
+			     DSMSession* sc_sess, map<string,string>* event_params) {
+  switch (seg.kind) {
+  case DSMParam::Var: {
+    map<string, string>::iterator it = sc_sess->var.find(seg.text);
+    if (it != sc_sess->var.end())
+      return it->second;
+    return string();
+  }
+  case DSMParam::Param: {
+    if (!event_params)
+      return string();
+    map<string, string>::iterator it = event_params->find(seg.text);
+    if (it != event_params->end())
+      return it->second;
+    return string();
+  }
+  case DSMParam::Select:
+    return DSMParam::resolveSelect(seg.select, sess);
+  default:
+    return seg.text;
+  }
+}
+
+static string resolveExpr(const DSMParam::Expr& e, AmSession* sess,
+			  DSMSession* sc_sess, map<string,string>* event_params) {
+  if (e.op) {
+    string a = resolveExpr(*e.lhs, sess, sc_sess, event_params);
+    string b = resolveExpr(*e.rhs, sess, sc_sess, event_params);
+    if (isNumber(a) && isNumber(b)) {
+      if (e.op == '-')
+	return int2str(atoi(a.c_str()) - atoi(b.c_str()));
+      return int2str(atoi(a.c_str()) + atoi(b.c_str()));
+    }
+  }
+  return resolveSegment(e.whole, sess, sc_sess, event_params);
+}
+
+string resolveVars(const DSMParam& p, AmSession* sess,
+		   DSMSession* sc_sess, map<string,string>* event_params,
+		   bool eval_ops) {
+  if (!p.isCompiled())
+    return resolveVars((const string&)p, sess, sc_sess, event_params, eval_ops);
+
+  if (eval_ops && p.expression())
+    return resolveExpr(*p.expression(), sess, sc_sess, event_params);
+
+  return resolveSegment(p.reference(), sess, sc_sess, event_params);
+}
+
 void splitCmd(const string& from_str, 
 			    string& cmd, string& params) {
   size_t b_pos = from_str.find('(');
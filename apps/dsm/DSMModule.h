@@ -36,6 +36,7 @@ class DSMSession;
 #include <string>
 using std::string;
 
+#include <memory>
 #include <typeinfo>
 
 // script modules interface
@@ -83,12 +84,100 @@ typedef void* (*SCFactoryCreate)();
 #define SC_EXPORT(class_name)			\
   EXPORT_SC_FACTORY(SC_FACTORY_EXPORT,class_name)
 
+/**
+ * Action/condition parameter. Keeps the parameter string, and once
+ * compiled (when the chart is read) how it resolves: a literal, a
+ * $var, #param or @select reference, the segments substituted by
+ * replaceParams and the +/- expression evaluated by eval, so that
+ * running the action does not parse the string again.
+ * Assigning a new value drops the compiled form.
+ */
+class DSMParam : public string {
+ public:
+  enum Kind {
+    Literal,
+    Var,
+    Param,
+    Select
+  };
+
+  enum SelectType {
+    SelNone,
+    SelLocalTag,
+    SelUser,
+    SelDomain,
+    SelRemoteTag,
+    SelCallId,
+    SelLocalUri,
+    SelLocalParty,
+    SelRemoteUri,
+    SelRemoteParty
+  };
+
+  struct Segment {
+    Kind kind;
+    SelectType select;
+    /** literal value or var/param name */
+    string text;
+    /** replaceParams: text kept for #param if there are no params */
+    string raw;
+
+    Segment() : kind(Literal), select(SelNone) { }
+  };
+
+  /** eval: lhs op rhs if both are numbers, otherwise whole */
+  struct Expr {
+    Segment whole;
+    char op;
+    std::shared_ptr<Expr> lhs;
+    std::shared_ptr<Expr> rhs;
+
+    Expr() : op(0) { }
+  };
+
+ private:
+  bool compiled;
+  bool templ_compiled;
+  Segment ref;
+  vector<Segment> templ;
+  std::shared_ptr<Expr> expr;
+
+ public:
+  DSMParam() : compiled(false), templ_compiled(false) { }
+  DSMParam(const string& s) : string(s), compiled(false), templ_compiled(false) { }
+
+  DSMParam& operator=(string s) {
+    string::operator=(std::move(s));
+    compiled = templ_compiled = false;
+    templ.clear();
+    expr.reset();
+    return *this;
+  }
+
+  void compile();
+
+  bool isCompiled() const { return compiled; }
+  /** resolveVars form */
+  const Segment& reference() const { return ref; }
+  /** replaceParams form, NULL if that needs the generic path */
+  const vector<Segment>* segments() const {
+    return templ_compiled ? &templ : NULL;
+  }
+  /** eval form, NULL if the same as reference() */
+  const Expr* expression() const { return expr.get(); }
+
+  /** compile s as resolveVars would resolve it */
+  static Segment compileRef(const string& s);
+  static const string& resolveSelect(SelectType sel, AmSession* sess);
+};
+
 class SCStrArgAction   
 : public DSMAction {
  protected:
-  string arg;
+  DSMParam arg;
  public:
   SCStrArgAction(const string& m_arg); 
+  void compile() { arg.compile(); }
 };
 
 #define DEF_ACTION_1P(CL_Name)						\
@@ -121,10 +210,11 @@ class SCStrArgAction
 #define DEF_ACTION_2P(CL_Name)						\
   class CL_Name								\
   : public DSMAction {							\
-    string par1;							\
-    string par2;							\
+    DSMParam par1;							\
+    DSMParam par2;							\
   public:								\
     CL_Name(const string& arg);						\
+    void compile() { par1.compile(); par2.compile(); }			\
     bool execute(AmSession* sess, DSMSession* sc_sess,			\
 		 DSMCondition::EventType event,				\
 		 map<string,string>* event_params);			\
@@ -133,11 +223,12 @@ class SCStrArgAction
 #define DEF_ACTION_3P(CL_Name)						\
   class CL_Name								\
   : public DSMAction {							\
-    string par1;							\
-    string par2;							\
-    string par3;							\
+    DSMParam par1;							\
+    DSMParam par2;							\
+    DSMParam par3;							\
   public:								\
     CL_Name(const string& arg);						\
+    void compile() { par1.compile(); par2.compile(); par3.compile(); } \
     bool execute(AmSession* sess, DSMSession* sc_sess,			\
 		 DSMCondition::EventType event,				\
 		 map<string,string>* event_params);			\
@@ -342,6 +433,11 @@ string resolveVars(const string &s, AmSession* sess,
 		   DSMSession* sc_sess, map<string,string>* event_params,
 		   bool eval_ops = false);
 
+/** resolveVars using the compiled form of the parameter, if any */
+string resolveVars(const DSMParam &p, AmSession* sess,
+		   DSMSession* sc_sess, map<string,string>* event_params,
+		   bool eval_ops = false);
+
 void splitCmd(const string& from_str, 
 		string& cmd, string& params);
 
@@ -355,16 +451,28 @@ void splitCmd(const string& from_str,
     return a;			      \
   }
 
+/** as DEF_CMD, for actions that do not use the AmSession (async) */
+#define DEF_ASYNC_CMD(cmd_name, class_name) \
+				      \
+  if (cmd == cmd_name) {	      \
+    class_name * a =		      \
+      new class_name(params);	      \
+    a->name = from_str;		      \
+    a->session_free = true;	      \
+    return a;			      \
+  }
+
 #define DEF_SCCondition(cond_name)		\
   class cond_name				\
   : public DSMCondition {			\
-    string arg;					\
+    DSMParam arg;				\
     bool inv;					\
     						\
   public:					\
     						\
   cond_name(const string& arg, bool inv)				\
     : arg(arg), inv(inv) { }						\
+    void compile() { arg.compile(); }					\
     bool match(AmSession* sess, DSMSession* sc_sess, DSMCondition::EventType event, \
 	       map<string,string>* event_params);			\
   };
@@ -372,11 +480,12 @@ void splitCmd(const string& from_str,
 #define DEF_CONDITION_2P(cond_name)					\
   class cond_name							\
   : public DSMCondition {						\
-    string par1;							\
-    string par2;							\
+    DSMParam par1;							\
+    DSMParam par2;							\
     bool inv;								\
   public:								\
     cond_name(const string& arg, bool inv);				\
+    void compile() { par1.compile(); par2.compile(); }			\
     bool match(AmSession* sess, DSMSession* sc_sess, DSMCondition::EventType event, \
 	       map<string,string>* event_params);			\
   };
@@ -384,12 +493,13 @@ void splitCmd(const string& from_str,
 #define DEF_CONDITION_3P(cond_name)					\
   class cond_name							\
   : public DSMCondition {						\
-    string par1;							\
-    string par2;							\
-    string par3;							\
+    DSMParam par1;							\
+    DSMParam par2;							\
+    DSMParam par3;							\
     bool inv;								\
   public:								\
     cond_name(const string& arg, bool inv);				\
+    void compile() { par1.compile(); par2.compile(); par3.compile(); } \
     bool match(AmSession* sess, DSMSession* sc_sess, DSMCondition::EventType event, \
 	       map<string,string>* event_params);			\
   };
@@ -85,6 +85,8 @@ const char* DSMCondition::type2str(EventType event) {
 
     rt(SIPSubscription);
 
+    rt(AsyncResult);
+
     rt(RTPTimeout);
 
     // SBC related
@@ -52,6 +52,9 @@ class DSMElement {
   virtual ~DSMElement() { }
   string name; // documentary only
 
+  /** pre-process parameters, called once the chart is read */
+  virtual void compile() { }
+
 };
 
 class DSMCondition
@@ -103,6 +106,8 @@ class DSMCondition
 
     SIPSubscription,
 
+    AsyncResult,
+
     RTPTimeout,
 
     // SBC related
@@ -158,7 +163,10 @@ class DSMAction
     Return  // return from FSM call 
   };
 
-  DSMAction() { /* DBG("const action\n"); */ }
+  /** does not use the AmSession: may be run with async(...) */
+  bool session_free;
+
+  DSMAction() : session_free(false) { /* DBG("const action\n"); */ }
   virtual ~DSMAction() { /* DBG("dest action\n"); */ }
 
   /** @return whether state engine is to be modified (via getSEAction) */
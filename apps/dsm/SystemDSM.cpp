@@ -5,6 +5,7 @@
 #include "AmEventDispatcher.h"
 
 #include "DSMStateDiagramCollection.h"
+#include "DSMAsync.h"
 #include "../apps/jsonrpc/JsonRPCEvents.h" // todo!
 #include "AmSipSubscription.h"
 #include "AmSessionContainer.h"
@@ -81,6 +82,17 @@ void SystemDSM::process(AmEvent* event) {
       return;
     }  
   }
+
+  if (event->event_id == DSM_ASYNC_RESULT_EVENT_ID) {
+    DSMAsyncResultEvent* res_ev = dynamic_cast<DSMAsyncResultEvent*>(event);
+    if (res_ev) {
+      map<string, string> params;
+      res_ev->apply(&dummy_session, this, params);
+      engine.runEvent(&dummy_session, this, DSMCondition::AsyncResult, &params);
+      return;
+    }
+  }
+
   // todo: give modules the possibility to define/process events
   JsonRpcEvent* jsonrpc_ev = dynamic_cast<JsonRpcEvent*>(event);
   if (jsonrpc_ev) { 
@@ -59,6 +59,30 @@ load_prompts=${SEMS_CFG_PREFIX}/etc/sems/etc/dsm_in_prompts.conf,${SEMS_CFG_PREF
 #
 #run_system_dsms=system_dsm1,system_dsm2
 
+# async_threads=<n>
+#
+# worker threads for actions run with async(<action>), e.g. database
+# queries or HTTP requests, started on first use. 0 runs async actions
+# in the session's thread (the result event is still posted).
+# Default: 4
+#
+#async_threads=4
+
+# async_queue_size=<n>
+#
+# max. async actions waiting for a worker thread; further actions
+# are rejected (result=rejected in the asyncResult event).
+# Default: 1000
+#
+#async_queue_size=1000
+
+# async_limits=<module>=<max>[,<module>=<max>...]
+#
+# max. async actions of a module (the command prefix, e.g. mysql for
+# mysql.query, core for core actions) running at once. Default: no limit
+#
+#async_limits=mysql=4,curl=16
+
 # monitoring_full_stategraph=[yes|no]
 #
 # Controls whether to log the full call graph (all states visited)
@@ -43,15 +43,15 @@ ConnectionPool<SQSConnectionPtr>* SCAwsModule::sqsConnectionPool = NULL;
 
 MOD_ACTIONEXPORT_BEGIN(MOD_CLS_NAME) {
 
-  DEF_CMD("aws.s3.put", SCS3PutFileAction);
-  DEF_CMD("aws.s3.putArray", SCS3PutMultiFileAction);
-  DEF_CMD("aws.s3.createBucket", SCS3CreateBucketAction);
-
-  DEF_CMD("aws.sqs.createQueue", SCSQSCreateQueueAction);
-  DEF_CMD("aws.sqs.deleteQueue", SCSQSDeleteQueueAction);
-  DEF_CMD("aws.sqs.sendMessage", SCSQSSendMessageAction);
-  DEF_CMD("aws.sqs.receiveMessage", SCSQSReceiveMessageAction);
-  DEF_CMD("aws.sqs.deleteMessage", SCSQSDeleteMessageAction);
+  DEF_ASYNC_CMD("aws.s3.put", SCS3PutFileAction);
+  DEF_ASYNC_CMD("aws.s3.putArray", SCS3PutMultiFileAction);
+  DEF_ASYNC_CMD("aws.s3.createBucket", SCS3CreateBucketAction);
+
+  DEF_ASYNC_CMD("aws.sqs.createQueue", SCSQSCreateQueueAction);
+  DEF_ASYNC_CMD("aws.sqs.deleteQueue", SCSQSDeleteQueueAction);
+  DEF_ASYNC_CMD("aws.sqs.sendMessage", SCSQSSendMessageAction);
+  DEF_ASYNC_CMD("aws.sqs.receiveMessage", SCSQSReceiveMessageAction);
+  DEF_ASYNC_CMD("aws.sqs.deleteMessage", SCSQSDeleteMessageAction);
 
 } MOD_ACTIONEXPORT_END;
 
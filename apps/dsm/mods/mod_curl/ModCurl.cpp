@@ -72,12 +72,12 @@ DSMAction* CurlModule::getAction(const string& from_str) {
   string params;
   splitCmd(from_str, cmd, params);
 
-  DEF_CMD("curl.get", SCJCurlGetAction);
-  DEF_CMD("curl.getDiscardResult", SCJCurlGetNoresultAction);
-  DEF_CMD("curl.getFile", SCJCurlGetFileAction);
-  DEF_CMD("curl.getForm", SCJCurlGetFormAction);
-  DEF_CMD("curl.post", SCJCurlPOSTGetResultAction);
-  DEF_CMD("curl.postDiscardResult", SCJCurlPOSTAction);
+  DEF_ASYNC_CMD("curl.get", SCJCurlGetAction);
+  DEF_ASYNC_CMD("curl.getDiscardResult", SCJCurlGetNoresultAction);
+  DEF_ASYNC_CMD("curl.getFile", SCJCurlGetFileAction);
+  DEF_ASYNC_CMD("curl.getForm", SCJCurlGetFormAction);
+  DEF_ASYNC_CMD("curl.post", SCJCurlPOSTGetResultAction);
+  DEF_ASYNC_CMD("curl.postDiscardResult", SCJCurlPOSTAction);
 
   return NULL;
 }
@@ -50,22 +50,22 @@ DSMAction* SCMysqlModule::getAction(const string& from_str) {
   string params;
   splitCmd(from_str, cmd, params);
 
-  DEF_CMD("mysql.connect",            SCMyConnectAction);
-  DEF_CMD("mysql.disconnect",         SCMyDisconnectAction);
-  DEF_CMD("mysql.execute",            SCMyExecuteAction);
-  DEF_CMD("mysql.query",              SCMyQueryAction);
-  DEF_CMD("mysql.queryGetResult",     SCMyQueryGetResultAction);
-  DEF_CMD("mysql.getResult",          SCMyGetResultAction);
-  DEF_CMD("mysql.getClientVersion",   SCMyGetClientVersion);
-  DEF_CMD("mysql.resolveQueryParams", SCMyResolveQueryParams);
-  DEF_CMD("mysql.saveResult",         SCMySaveResultAction);
-  DEF_CMD("mysql.useResult",          SCMyUseResultAction);
+  DEF_ASYNC_CMD("mysql.connect",      SCMyConnectAction);
+  DEF_ASYNC_CMD("mysql.disconnect",   SCMyDisconnectAction);
+  DEF_ASYNC_CMD("mysql.execute",      SCMyExecuteAction);
+  DEF_ASYNC_CMD("mysql.query",        SCMyQueryAction);
+  DEF_ASYNC_CMD("mysql.queryGetResult", SCMyQueryGetResultAction);
+  DEF_ASYNC_CMD("mysql.getResult",    SCMyGetResultAction);
+  DEF_ASYNC_CMD("mysql.getClientVersion", SCMyGetClientVersion);
+  DEF_ASYNC_CMD("mysql.resolveQueryParams", SCMyResolveQueryParams);
+  DEF_ASYNC_CMD("mysql.saveResult",   SCMySaveResultAction);
+  DEF_ASYNC_CMD("mysql.useResult",    SCMyUseResultAction);
   DEF_CMD("mysql.playDBAudio",        SCMyPlayDBAudioAction);
   DEF_CMD("mysql.playDBAudioFront",   SCMyPlayDBAudioFrontAction);
   DEF_CMD("mysql.playDBAudioLooped",  SCMyPlayDBAudioLoopedAction);
-  DEF_CMD("mysql.getFileFromDB",      SCMyGetFileFromDBAction);
-  DEF_CMD("mysql.putFileToDB",        SCMyPutFileToDBAction);
-  DEF_CMD("mysql.escape",             SCMyEscapeAction);
+  DEF_ASYNC_CMD("mysql.getFileFromDB", SCMyGetFileFromDBAction);
+  DEF_ASYNC_CMD("mysql.putFileToDB",  SCMyPutFileToDBAction);
+  DEF_ASYNC_CMD("mysql.escape",       SCMyEscapeAction);
   return NULL;
 }
 
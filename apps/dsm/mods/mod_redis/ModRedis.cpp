@@ -51,11 +51,11 @@ DSMAction* DSMRedisModule::getAction(const string& from_str) {
   string params;
   splitCmd(from_str, cmd, params);
 
-  DEF_CMD("redis.connect",            DSMRedisConnectAction);
-  DEF_CMD("redis.disconnect",         DSMRedisDisconnectAction);
-  DEF_CMD("redis.execCommand",        DSMRedisExecCommandAction);
-  DEF_CMD("redis.appendCommand",      DSMRedisAppendCommandAction);
-  DEF_CMD("redis.getReply",           DSMRedisGetReplyAction);
+  DEF_ASYNC_CMD("redis.connect",      DSMRedisConnectAction);
+  DEF_ASYNC_CMD("redis.disconnect",   DSMRedisDisconnectAction);
+  DEF_ASYNC_CMD("redis.execCommand",  DSMRedisExecCommandAction);
+  DEF_ASYNC_CMD("redis.appendCommand", DSMRedisAppendCommandAction);
+  DEF_ASYNC_CMD("redis.getReply",     DSMRedisGetReplyAction);
 
   return NULL;
 }
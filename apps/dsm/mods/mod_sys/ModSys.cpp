@@ -40,16 +40,16 @@ SC_EXPORT(MOD_CLS_NAME);
 
 MOD_ACTIONEXPORT_BEGIN(MOD_CLS_NAME) {
 
-  DEF_CMD("sys.mkdir", SCMkDirAction);
-  DEF_CMD("sys.mkdirRecursive", SCMkDirRecursiveAction);
-  DEF_CMD("sys.rename", SCRenameAction);
-  DEF_CMD("sys.unlink", SCUnlinkAction);
-  DEF_CMD("sys.unlinkArray", SCUnlinkArrayAction);
-  DEF_CMD("sys.tmpnam", SCTmpNamAction);
-  DEF_CMD("sys.popen", SCPopenAction);
-
-  DEF_CMD("sys.getTimestamp", SCSysGetTimestampAction);
-  DEF_CMD("sys.subTimestamp", SCSysSubTimestampAction);
+  DEF_ASYNC_CMD("sys.mkdir", SCMkDirAction);
+  DEF_ASYNC_CMD("sys.mkdirRecursive", SCMkDirRecursiveAction);
+  DEF_ASYNC_CMD("sys.rename", SCRenameAction);
+  DEF_ASYNC_CMD("sys.unlink", SCUnlinkAction);
+  DEF_ASYNC_CMD("sys.unlinkArray", SCUnlinkArrayAction);
+  DEF_ASYNC_CMD("sys.tmpnam", SCTmpNamAction);
+  DEF_ASYNC_CMD("sys.popen", SCPopenAction);
+
+  DEF_ASYNC_CMD("sys.getTimestamp", SCSysGetTimestampAction);
+  DEF_ASYNC_CMD("sys.subTimestamp", SCSysSubTimestampAction);
 
 } MOD_ACTIONEXPORT_END;
 
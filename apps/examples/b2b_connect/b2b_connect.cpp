@@ -115,10 +115,10 @@ void b2b_connectDialog::onInvite(const AmSipRequest& req)
 
   invite_req = req;
   if (b2b_connectFactory::TransparentHeaders) {
-    removeHeader(invite_req.hdrs, PARAM_HDR);
-    removeHeader(invite_req.hdrs, "P-App-Name");
-    removeHeader(invite_req.hdrs, "User-Agent");
-    removeHeader(invite_req.hdrs, "Max-Forwards");
+    invite_req.removeHeader(PARAM_HDR);
+    invite_req.removeHeader("P-App-Name");
+    invite_req.removeHeader("User-Agent");
+    invite_req.removeHeader("Max-Forwards");
   }
 
   recvd_req.insert(std::make_pair(req.cseq,req));
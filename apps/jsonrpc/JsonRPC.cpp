@@ -34,6 +34,8 @@ JsonRPCServerModule* JsonRPCServerModule::_instance = NULL;
 
 int JsonRPCServerModule::port = DEFAULT_JSONRPC_SERVER_PORT;
 int JsonRPCServerModule::threads = DEFAULT_JSONRPC_SERVER_THREADS;
+int JsonRPCServerModule::pipeline_depth = DEFAULT_JSONRPC_PIPELINE_DEPTH;
+int JsonRPCServerModule::max_pending_requests = DEFAULT_JSONRPC_MAX_PENDING;
 
 EXPORT_PLUGIN_CLASS_FACTORY(JsonRPCServerModule, MOD_NAME)
 JsonRPCServerModule* JsonRPCServerModule::instance()
@@ -66,10 +68,25 @@ int JsonRPCServerModule::load() {
   } else {
     port = cfg.getParameterInt("jsonrpc_port", DEFAULT_JSONRPC_SERVER_PORT);
     threads = cfg.getParameterInt("server_threads", DEFAULT_JSONRPC_SERVER_THREADS);
+    pipeline_depth = cfg.getParameterInt("pipeline_depth",
+					 DEFAULT_JSONRPC_PIPELINE_DEPTH);
+    max_pending_requests = cfg.getParameterInt("max_pending_requests",
+					       DEFAULT_JSONRPC_MAX_PENDING);
+  }
+
+  if (pipeline_depth < 1) {
+    WARN("invalid pipeline_depth %d, using 1\n", pipeline_depth);
+    pipeline_depth = 1;
+  }
+  if (max_pending_requests < 1) {
+    WARN("invalid max_pending_requests %d, using 1\n", max_pending_requests);
+    max_pending_requests = 1;
   }
 
   DBG("using server port %d\n", port);
   DBG("using %d server threads\n", threads);
+  DBG("processing up to %d messages per connection, %d in total\n",
+      pipeline_depth, max_pending_requests);
 
   DBG("starting server loop thread\n");
   server_loop = new JsonRPCServerLoop();
@@ -34,6 +34,8 @@
 
 #define DEFAULT_JSONRPC_SERVER_PORT    7080
 #define DEFAULT_JSONRPC_SERVER_THREADS 5
+#define DEFAULT_JSONRPC_PIPELINE_DEPTH 16
+#define DEFAULT_JSONRPC_MAX_PENDING    1000
 
 class JsonRPCServerModule
 : public AmDynInvokeFactory, 
@@ -65,6 +67,8 @@ class JsonRPCServerModule
   // configuration
   static int port;
   static int threads;
+  static int pipeline_depth;
+  static int max_pending_requests;
 };
 
 #endif
@@ -124,7 +124,9 @@ struct JsonServerEvent
 
   enum EventType { 
     StartReadLoop = 0,
-    SendMessage    
+    SendMessage,
+    ProcessMessage,
+    MessageDone
   };
 
   JsonrpcNetstringsConnection* conn;
@@ -162,7 +164,7 @@ struct JsonServerSendMessageEvent
 			     const string& reply_link = "")
     : JsonServerEvent(connection_id, SendMessage),
     is_reply(is_reply), reply_link(reply_link),
-    method(method), id(id), params(params), udata(udata) { }
+    method(method), id(id), params(params), is_error(false), udata(udata) { }
 
  JsonServerSendMessageEvent(const JsonServerSendMessageEvent& e,
 			    JsonrpcNetstringsConnection* conn)
@@ -175,4 +177,29 @@ struct JsonServerSendMessageEvent
 
 };
 
+/** received message, to be processed in a server thread */
+struct JsonServerMessageEvent
+  : public JsonServerEvent {
+
+  string msg;
+
+  JsonServerMessageEvent(JsonrpcNetstringsConnection* c, string& m)
+    : JsonServerEvent(c, ProcessMessage) {
+    msg.swap(m);
+  }
+};
+
+/** back to the server loop: a message has been processed or created */
+struct JsonServerDoneEvent
+  : public JsonServerEvent {
+
+  string msg;              // to be sent, may be empty
+  bool close;              // error - close the connection now
+  bool close_after_write;  // close the connection once msg is sent
+
+  JsonServerDoneEvent(JsonrpcNetstringsConnection* c)
+    : JsonServerEvent(c, MessageDone),
+    close(false), close_after_write(false) { }
+};
+
 #endif // _JsonRPCEvents_h_
@@ -32,6 +32,7 @@
 #include "JsonRPCEvents.h"
 #include "jsonArg.h"
 
+#include "AmEncodedPromptCache.h"
 #include "AmEventDispatcher.h"
 #include "AmPlugIn.h"
 #include "log.h"
@@ -42,12 +43,13 @@
 int JsonRpcServer::createRequest(const string& evq_link, const string& method, 
 				 AmArg& params, JsonrpcNetstringsConnection* peer, 
 				 const AmArg& udata,
-				 bool is_notification) {
+				 bool is_notification, string& msg) {
   AmArg rpc_params;
   rpc_params["jsonrpc"] = "2.0";
   rpc_params["method"] = method;
   rpc_params["params"] = params;
   if (!is_notification) {
+    lock_guard<AmMutex> l(peer->receivers_mut);
     peer->req_id++;
     string req_id = int2str(peer->req_id);
     rpc_params["id"] = req_id;
@@ -59,23 +61,20 @@ int JsonRpcServer::createRequest(const string& evq_link, const string& method,
 
   }
 
-  string rpc_params_json = arg2json(rpc_params);
-  if (rpc_params_json.length() > MAX_RPC_MSG_SIZE) {
+  arg2json(rpc_params, msg);
+  if (msg.length() > MAX_RPC_MSG_SIZE) {
     ERROR("internal error: message exceeded MAX_RPC_MSG_SIZE (%d)\n", 
 	  MAX_RPC_MSG_SIZE);
     return -3;
   }
 
-  DBG("RPC message: >>%.*s<<\n", (int)rpc_params_json.length(), rpc_params_json.c_str());
-  memcpy(peer->msgbuf, rpc_params_json.c_str(), rpc_params_json.length());
-  peer->msg_size = rpc_params_json.length();
-  // set peer connection up for sending
-  peer->msg_recv = false;
+  DBG("RPC message: >>%.*s<<\n", (int)msg.length(), msg.c_str());
   return 0;
 }
 
 int JsonRpcServer::createReply(JsonrpcNetstringsConnection* peer, 
-			       const string& id, AmArg& result, bool is_error) {
+			       const string& id, AmArg& result, bool is_error,
+			       string& msg) {
 
   AmArg rpc_res;
   rpc_res["id"] = id;
@@ -85,31 +84,104 @@ int JsonRpcServer::createReply(JsonrpcNetstringsConnection* peer,
   else
     rpc_res["result"] = result;
 
-  string res_s = arg2json(rpc_res);
-  if (res_s.length() > MAX_RPC_MSG_SIZE) {
+  arg2json(rpc_res, msg);
+  if (msg.length() > MAX_RPC_MSG_SIZE) {
     ERROR("internal error: reply exceeded MAX_RPC_MSG_SIZE (%d)\n", 
 	  MAX_RPC_MSG_SIZE);
     return -3;
   }
 
-  DBG("created RPC reply: >>%.*s<<\n", (int)res_s.length(), res_s.c_str());
-  memcpy(peer->msgbuf, res_s.c_str(), res_s.length());
-  peer->msg_size = res_s.length();
-
+  DBG("created RPC reply: >>%.*s<<\n", (int)msg.length(), msg.c_str());
   return 0;
 }
 
-int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size, 
-				  JsonrpcPeerConnection* peer) {
+static void invalidRequest(AmArg& rpc_res, const AmArg& id = AmArg()) {
+  rpc_res["jsonrpc"] = "2.0";
+  rpc_res["error"]["code"] = -32600;
+  rpc_res["error"]["message"] = "Invalid Request";
+  rpc_res["id"] = id;
+}
+
+int JsonRpcServer::processMessage(const char* msg, size_t len,
+				  JsonrpcPeerConnection* peer, string& reply) {
   DBG("parsing message ...\n");
-  // const char* txt = "{\"jsonrpc\": \"2.0\", \"result\": 19, \"id\": 1}";
   AmArg rpc_params;
-  if (!json2arg(msgbuf, rpc_params)) {
-    INFO("Error parsing message '%.*s'\n", (int)*msg_size, msgbuf);
+  if (!json2arg(msg, len, rpc_params)) {
+    INFO("Error parsing message '%.*s'\n", (int)len, msg);
     return -1;
   }
 
-  if (!rpc_params.hasMember("jsonrpc") || strcmp(rpc_params["jsonrpc"].asCStr(), "2.0")) {
+  if (!isArgArray(rpc_params)) {
+    AmArg rpc_res;
+    int res = processRpc(rpc_params, peer, rpc_res);
+    if (res < 0)
+      return res;
+
+    if (!isArgUndef(rpc_res))
+      arg2json(rpc_res, reply);
+  } else {
+    // batch: one reply with the replies to the requests in it
+    AmArg batch_res;
+    batch_res.assertArray();
+
+    if (!rpc_params.size()) {
+      INFO("received empty batch\n");
+      batch_res.push(AmArg());
+      invalidRequest(batch_res.back());
+    }
+
+    for (size_t i = 0; i < rpc_params.size(); i++) {
+      AmArg& elem = rpc_params.get(i);
+      AmArg rpc_res;
+      if (!isArgStruct(elem) || !elem.hasMember("jsonrpc") ||
+	  !isArgCStr(elem["jsonrpc"]) || strcmp(elem["jsonrpc"].asCStr(), "2.0")) {
+	INFO("invalid request in batch\n");
+	invalidRequest(rpc_res);
+      } else {
+	int res = processRpc(elem, peer, rpc_res);
+	if (res == -1) {
+	  // closed by the connection's flags
+	  return res;
+	}
+
+	bool is_request = elem.hasMember("method") && elem.hasMember("id");
+	if (res < 0) {
+	  // only this one failed, the others are still processed
+	  INFO("failed to process message %zd in batch (%d)\n", i, res);
+	  if (!is_request)
+	    continue; // replies are not answered
+	  rpc_res = AmArg();
+	  invalidRequest(rpc_res, elem["id"]);
+	} else if (!is_request) {
+	  // notifications and replies are not answered in a batch
+	  continue;
+	}
+      }
+
+      if (!isArgUndef(rpc_res))
+	batch_res.push(rpc_res);
+    }
+
+    DBG("processed batch of %zd messages\n", rpc_params.size());
+    if (batch_res.size())
+      arg2json(batch_res, reply);
+  }
+
+  if (reply.length() > MAX_RPC_MSG_SIZE) {
+    ERROR("internal error: reply exceeded MAX_RPC_MSG_SIZE (%d)\n", 
+	  MAX_RPC_MSG_SIZE);
+    return -3;
+  }
+
+  DBG("RPC result: >>%.*s<<\n", (int)reply.length(), reply.c_str());
+  return 0;
+}
+
+int JsonRpcServer::processRpc(AmArg& rpc_params, JsonrpcPeerConnection* peer,
+			      AmArg& rpc_res) {
+  if (!isArgStruct(rpc_params) ||
+      !rpc_params.hasMember("jsonrpc") || !isArgCStr(rpc_params["jsonrpc"]) ||
+      strcmp(rpc_params["jsonrpc"].asCStr(), "2.0")) {
     INFO("wrong json-rpc version received; only 2.0 supported!\n");
     return -2; // todo: check value, reply with error?
   }
@@ -126,29 +198,35 @@ int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size,
     }
     string id = rpc_params["id"].asCStr();
     
-    std::map<std::string, std::pair<std::string, AmArg > >::iterator
-      rep_recv_q = peer->replyReceivers.find(id);
-    if (rep_recv_q == peer->replyReceivers.end()) {
-      DBG("received reply for unknown request");
-      *msg_size = 0;
-
-      if (peer->flags & JsonrpcPeerConnection::FL_CLOSE_WRONG_REPLY) {
-	INFO("closing connection after unknown reply id %s received\n", id.c_str());
-	return -2;
+    if (!rpc_params.hasMember("result") && !rpc_params.hasMember("error")) {
+      INFO("protocol error: reply does not have error nor result!\n");
+      return -2;
+    }
+
+    string event_queue_id;
+    AmArg udata;
+    {
+      lock_guard<AmMutex> l(peer->receivers_mut);
+      std::map<std::string, std::pair<std::string, AmArg > >::iterator
+	rep_recv_q = peer->replyReceivers.find(id);
+      if (rep_recv_q == peer->replyReceivers.end()) {
+	DBG("received reply for unknown request");
+
+	if (peer->flags & JsonrpcPeerConnection::FL_CLOSE_WRONG_REPLY) {
+	  INFO("closing connection after unknown reply id %s received\n", id.c_str());
+	  return -1;
+	}
+	return 0;
       }
-      return 0;
+      event_queue_id = rep_recv_q->second.first;
+      udata = rep_recv_q->second.second;
+      peer->replyReceivers.erase(rep_recv_q);
     }
-    const AmArg& udata = rep_recv_q->second.second;
-    const string& event_queue_id = rep_recv_q->second.first;
 
     JsonRpcResponseEvent* resp_ev = NULL; 
     if (rpc_params.hasMember("result")) {
       resp_ev = new JsonRpcResponseEvent(false, id, rpc_params["result"], udata);
     } else {
-      if (!rpc_params.hasMember("error")) {
-	INFO("protocol error: reply does not have error nor result!\n");
-	return -2;
-      }
       resp_ev = new JsonRpcResponseEvent(true, id, rpc_params["error"], udata);
     }
     resp_ev->connection_id = peer->id;
@@ -157,18 +235,15 @@ int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size,
       post(event_queue_id, resp_ev);
     if (!posted) {
       DBG("receiver event queue does not exist (any more)\n");
-      peer->replyReceivers.erase(rep_recv_q);
-      *msg_size = 0;
+      delete resp_ev;
       if (peer->flags & JsonrpcPeerConnection::FL_CLOSE_NO_REPLYLINK) {
 	INFO("closing connection where reply link missing");
-	return -2;
+	return -1;
       }
       return 0; 
     }	
     DBG("successfully posted reply to event queue\n");
-    peer->replyReceivers.erase(rep_recv_q);
     // don't send a reply
-    *msg_size = 0;
     return 0;
   }
 
@@ -192,8 +267,6 @@ int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size,
   if ((id.empty() && !peer->notificationReceiver.empty()) || 
       (!id.empty() && !peer->requestReceiver.empty())) {
     // don't send a reply
-    *msg_size = 0;
-
     string dst_evqueue = id.empty() ? 
       peer->notificationReceiver.c_str() : peer->requestReceiver.c_str();
 
@@ -236,7 +309,6 @@ int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size,
     return 0;
   }
 
-  AmArg rpc_res;
   int int_id;
 
   execRpc(rpc_params, rpc_res);
@@ -250,17 +322,6 @@ int JsonRpcServer::processMessage(char* msgbuf, unsigned int* msg_size,
     }
   }
 
-  string res_s = arg2json(rpc_res);
-  if (res_s.length() > MAX_RPC_MSG_SIZE) {
-    ERROR("internal error: reply exceeded MAX_RPC_MSG_SIZE (%d)\n", 
-	  MAX_RPC_MSG_SIZE);
-    return -3;
-  }
-
-  DBG("RPC result: >>%.*s<<\n", (int)res_s.length(), res_s.c_str());
-  memcpy(msgbuf, res_s.c_str(), res_s.length());
-  *msg_size = res_s.length();
-
   return 0;
 }
 
@@ -366,6 +427,13 @@ void JsonRpcServer::runCoreMethod(const string& method, const AmArg& params, AmA
   } else if (method == "get_loglevel") {
     res[0] = log_level;
     DBG("get_log_level returns %d\n", log_level);
+  } else if (method == "get_log_stats") {
+    unsigned long long written, dropped;
+    get_async_log_stats(&written, &dropped);
+    res["written"] = (long long int)written;
+    res["dropped"] = (long long int)dropped;
+  } else if (method == "get_prompt_cache_stats") {
+    AmEncodedPromptCache::instance()->getStats(res);
   } else {
     throw JsonRpcError(-32601, "Method not found", 
 		       "function unknown in core");
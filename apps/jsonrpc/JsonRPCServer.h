@@ -53,15 +53,32 @@ class JsonRpcServer {
   static void execRpc(const string& method, const string& id, const AmArg& params, AmArg& rpc_res);
   static void runCoreMethod(const string& method, const AmArg& params, AmArg& res);
  public:
-  static int processMessage(char* msgbuf, unsigned int* msg_size,
-			    JsonrpcPeerConnection* peer);
+  /**
+     process a received message: a request, notification or reply,
+     or a batch (array) of them
+     @param reply set to the message to send back, empty if none
+     @return < 0 if the connection should be closed (an invalid
+             request in a batch is answered with an error instead,
+             an invalid reply in a batch is skipped)
+  */
+  static int processMessage(const char* msg, size_t len,
+			    JsonrpcPeerConnection* peer, string& reply);
+
+  /**
+     process one request, notification or reply
+     @param rpc_res set to the reply object, undefined if none
+     @return -1 if the connection should be closed (its flags),
+             -2 if the message is invalid
+  */
+  static int processRpc(AmArg& rpc_params, JsonrpcPeerConnection* peer,
+			AmArg& rpc_res);
 
   static int createRequest(const string& evq_link, const string& method, AmArg& params, 
 			   JsonrpcNetstringsConnection* peer, const AmArg& udata,
-			   bool is_notification = false);
+			   bool is_notification, string& msg);
 
   static int createReply(JsonrpcNetstringsConnection* peer, const string& id, 
-			 AmArg& result, bool is_error);
+			 AmArg& result, bool is_error, string& msg);
 };
 
 #endif // _JsonRPCServer_h_
@@ -57,6 +57,7 @@ void JsonrpcPeerConnection::notifyDisconnect() {
       post(requestReceiver, 
 	   new JsonRpcConnectionEvent(JsonRpcConnectionEvent::DISCONNECT, id));
   
+  lock_guard<AmMutex> l(receivers_mut);
   for (std::map<std::string, std::pair<std::string, AmArg > > ::iterator it=
 	 replyReceivers.begin(); it != replyReceivers.end(); it++) {
     AmEventDispatcher::instance()->
@@ -67,7 +68,8 @@ void JsonrpcPeerConnection::notifyDisconnect() {
 
 JsonrpcNetstringsConnection::JsonrpcNetstringsConnection(const std::string& id) 
   : JsonrpcPeerConnection(id), 
-    fd(0), msg_size(0), rcvd_size(0), in_msg(false), msg_recv(true)
+    fd(0), rcv_pos(0), snd_pos(0), in_flight(0),
+    close_after_write(false), closed(false), throttled(false)
 {
 }
 
@@ -174,179 +176,121 @@ int JsonrpcNetstringsConnection::connect(const string& host, int port,
 }
 
 
-void JsonrpcNetstringsConnection::resetRead() {
-  in_msg = false;
-  msg_size = 0;
-  rcvd_size = 0;
-  msg_recv = true;
-}
-
 int JsonrpcNetstringsConnection::netstringsRead() {
-  if (!in_msg) {
-    while (true) {
-      if (rcvd_size > MAX_NS_LEN_SIZE) {
-	DBG("closing connection [%p/%d]: oversize length\n", this, fd);
-	close();
-	return REMOVE;
-      }
-      // reading length
-      ssize_t r=read(fd,&msgbuf[rcvd_size],1);
-      if (!r) {
-	DBG("closing connection [%p/%d] on peer hangup\n", this, fd);
-	close();
-	return REMOVE;
-      }
-
-      if ((r<0 && errno == EAGAIN) || 
-	  (r<0 && errno == EWOULDBLOCK))
-	return CONTINUE;
-     
-      if (r != 1) {
-	INFO("socket error on connection [%p/%d]: %s\n",
-	     this, fd, strerror(errno));
-	close();
-	return REMOVE;
-      }
-      
-      DBG("received '%c'\n", msgbuf[rcvd_size]);
-      if (msgbuf[rcvd_size] == ':') {
-	msgbuf[rcvd_size] = '\0';
-	if (str2int(std::string(msgbuf, rcvd_size), msg_size)) {
-	  ERROR("Protocol error decoding size '%s'\n", msgbuf);
-	  close();
-	  return REMOVE;
-	}
-	// received len - switch to receive msg mode
-	in_msg = true;
-	rcvd_size = read(fd,msgbuf,msg_size+1);
-	// DBG("received '%.*s'\n", rcvd_size, msgbuf);
-
-	if (rcvd_size == msg_size+1) { 
-	  if (msgbuf[msg_size] == ',') {
-	    msgbuf[msg_size+1] = '\0';
-	    return DISPATCH;
-	  }
-	  INFO("Protocol error on connection [%p/%d]: netstring not terminated with ','\n",
-	       this, fd);
-	  close();
-	  return REMOVE;
-	}
-
-	if (!rcvd_size) {
-	  DBG("closing connection [%p/%d] on peer hangup\n", this, fd);
-	  close();
-	  return REMOVE;
-	}
-
-	if ((rcvd_size<0 && errno == EAGAIN) || 
-	    (rcvd_size<0 && errno == EWOULDBLOCK))
-	  return CONTINUE; // necessary?
-
-	if (rcvd_size<0) {
-	  INFO("socket error on connection [%p/%d]: %s\n",
-	       this, fd, strerror(errno));
-	  close();
-	  return REMOVE;
-	}
-	       
-	return CONTINUE; 	
-      } 
-
-      if (msgbuf[rcvd_size] < '0' || msgbuf[rcvd_size] > '9') {
-	INFO("Protocol error on connection [%p/%d]: invalid character in size\n",
-	     this, fd);
-	close();
-	return REMOVE;
-      }
-    
-      rcvd_size++;
-    }
-  } else {
-    ssize_t r = read(fd,msgbuf+rcvd_size,msg_size-rcvd_size+1);
-    if (r>0) {
-      rcvd_size += r;
-      DBG("msgbuf='%.*s'\n", msg_size+1,msgbuf);
-      if (rcvd_size == msg_size+1) { 
-	DBG("msg_size = %d, rcvd_size = %d, <%c> \n", msg_size, rcvd_size, msgbuf[msg_size-1]);
-	if (msgbuf[msg_size] == ',')
-	  return DISPATCH;
-	INFO("Protocol error on connection [%p/%d]: netstring not terminated with ','\n",
-	     this, fd);
-	close();
-	return REMOVE;
-      }
-      return CONTINUE;
-    }
+  // drop what has been taken out already
+  if (rcv_pos) {
+    rcvbuf.erase(0, rcv_pos);
+    rcv_pos = 0;
+  }
 
-    if (!r) {
-      DBG("closing connection [%p/%d] on peer hangup\n", this, fd);
-      close();
-      return REMOVE;
-    }
+  size_t have = rcvbuf.size();
+  rcvbuf.resize(have + RPC_READ_SIZE);
+  ssize_t r = read(fd, &rcvbuf[have], RPC_READ_SIZE);
+  rcvbuf.resize(have + (r > 0 ? r : 0));
 
-    if ((r<0 && errno == EAGAIN) || 
-	(r<0 && errno == EWOULDBLOCK))
-      return CONTINUE; // necessary?
+  if (r > 0)
+    return CONTINUE;
 
-    INFO("socket error on connection [%p/%d]: %s\n",
-	 this, fd, strerror(errno));
-    close();
+  if (!r) {
+    DBG("closing connection [%p/%d] on peer hangup\n", this, fd);
     return REMOVE;
   }
+
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    return CONTINUE;
+
+  INFO("socket error on connection [%p/%d]: %s\n",
+       this, fd, strerror(errno));
+  return REMOVE;
 }
 
-int JsonrpcNetstringsConnection::netstringsBlockingWrite() {
-  if (msg_size<0) {
-    close();
+int JsonrpcNetstringsConnection::nextMessage(string& msg) {
+  size_t avail = rcvbuf.size() - rcv_pos;
+  const char* p = rcvbuf.data() + rcv_pos;
+
+  // length
+  size_t len = 0;
+  size_t digits = 0;
+  while (digits < avail && p[digits] != ':') {
+    if (p[digits] < '0' || p[digits] > '9') {
+      INFO("Protocol error on connection [%p/%d]: invalid character in size\n",
+	   this, fd);
+      return REMOVE;
+    }
+    len = len * 10 + (p[digits] - '0');
+    if (++digits > MAX_NS_LEN_SIZE) {
+      DBG("closing connection [%p/%d]: oversize length\n", this, fd);
+      return REMOVE;
+    }
+  }
+
+  if (digits == avail)
+    return CONTINUE;
+
+  if (!digits || len > MAX_RPC_MSG_SIZE) {
+    ERROR("Protocol error decoding size '%.*s'\n", (int)digits, p);
     return REMOVE;
   }
-  if (msg_size==0)
+
+  // <len>:<msg>,
+  if (avail < digits + len + 2)
     return CONTINUE;
 
-  // write size to snd_size
-  string msg_size_s = int2str(msg_size);
-  if (msg_size_s.length()>MAX_NS_LEN_SIZE) {
-    ERROR("too large return message size len\n");
-    close();
+  if (p[digits + 1 + len] != ',') {
+    INFO("Protocol error on connection [%p/%d]: netstring not terminated with ','\n",
+	 this, fd);
     return REMOVE;
   }
-  char* ns_begin = msgbuf-(msg_size_s.length()+1);
-  memcpy(ns_begin, 
-	 msg_size_s.c_str(),
-	 msg_size_s.length());
-  ns_begin[msg_size_s.length()]=':';
-  msgbuf[msg_size]=',';
-  
-  rcvd_size = 0;
-  size_t ns_total_len = msg_size+msg_size_s.length()+2;
-  while (rcvd_size != ns_total_len) {
-    size_t written = send(fd, &ns_begin[rcvd_size], ns_total_len - rcvd_size, 
+
+  msg.assign(p + digits + 1, len);
+  rcv_pos += digits + len + 2;
+  return DISPATCH;
+}
+
+void JsonrpcNetstringsConnection::queueMessage(const string& msg) {
+  if (snd_pos == sndbuf.size()) {
+    sndbuf.clear();
+    snd_pos = 0;
+  }
+
+  sndbuf += int2str((unsigned int)msg.length());
+  sndbuf += ':';
+  sndbuf += msg;
+  sndbuf += ',';
+}
+
+int JsonrpcNetstringsConnection::netstringsWrite() {
+  while (snd_pos < sndbuf.size()) {
+    ssize_t written = send(fd, sndbuf.data() + snd_pos, sndbuf.size() - snd_pos,
 #ifdef MSG_NOSIGNAL
-			  MSG_NOSIGNAL
+			   MSG_NOSIGNAL
 #else
-			  0
+			   0
 #endif
-			  );
-    if ((written<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) ||
-	written==0) {
-	usleep(SEND_SLEEP);
+			   );
+    if (written < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+	break;
+      if (errno == EINTR)
 	continue;
-    }
-    if (written<0) {
-      if (errno == ECONNRESET) {
+      if (errno == ECONNRESET || errno == EPIPE) {
 	DBG("closing connection [%p/%d] on peer hangup\n", this, fd);
-	close();
 	return REMOVE;
       }
       INFO("error on connection [%p/%d]: %s\n", this, fd, strerror(errno));
-      close();
       return REMOVE;
     }
-    rcvd_size+=written;
+    snd_pos += written;
+  }
+
+  if (snd_pos == sndbuf.size()) {
+    sndbuf.clear();
+    snd_pos = 0;
+  } else if (snd_pos > RPC_SEND_QUEUE_HIGH_WATER) {
+    sndbuf.erase(0, snd_pos);
+    snd_pos = 0;
   }
 
-  rcvd_size = 0;
-  msg_size = 0;
   return CONTINUE;
 }
 
@@ -356,11 +300,3 @@ void JsonrpcNetstringsConnection::close() {
     ::close(fd);
   }
 }
-
-bool JsonrpcNetstringsConnection::messagePending() {
-  return msg_size != 0;
-}
-
-bool JsonrpcNetstringsConnection::messageIsRecv() { 
-  return msg_recv; 
-}
@@ -34,10 +34,13 @@
 #include <stdlib.h>
 #include "log.h"
 #include "AmArg.h"
+#include "AmThread.h"
 
 #define MAX_RPC_MSG_SIZE 20*1024*1024 // 20k
 #define MAX_NS_LEN_SIZE 10 
-#define SEND_SLEEP 10000 // 10 ms send retry
+#define RPC_READ_SIZE 64*1024 // read at once
+// stop reading from a connection while that much is waiting to be sent
+#define RPC_SEND_QUEUE_HIGH_WATER 1024*1024
 
 #include <map>
 #include <string>
@@ -49,6 +52,9 @@ struct JsonrpcPeerConnection {
   // to requests sent on that connection
   //        req_id              queue       udata
   std::map<std::string, std::pair<std::string, AmArg > > replyReceivers;
+  // requests and replies of one connection are processed
+  // by several server threads at once
+  AmMutex receivers_mut;
 
   // if present, notifications will be sent 
   // to that event queue directly
@@ -68,14 +74,16 @@ struct JsonrpcPeerConnection {
     FL_CLOSE_NO_NOTIF_RECV   = 16   // close connection if notification queue missing
   }; 
 
-  JsonrpcPeerConnection() { 
+  JsonrpcPeerConnection()
+  : flags(0) { 
     req_id = rand()%1024;
   }
 
   int req_id;
 
   JsonrpcPeerConnection(const std::string& id)
-  : id(id) { 
+  : id(id), flags(0) { 
+    req_id = rand()%1024;
     DBG("created connection '%s'\n", id.c_str());
   }
 
@@ -86,6 +94,11 @@ struct JsonrpcPeerConnection {
   void notifyDisconnect();
 };
 
+/**
+ * netstrings connection; reading, writing and closing is done
+ * by the server loop only, the messages are processed by the
+ * server threads (several at once, see JsonRPCServerLoop)
+ */
 struct JsonrpcNetstringsConnection 
   : public JsonrpcPeerConnection
 {
@@ -93,12 +106,22 @@ struct JsonrpcNetstringsConnection
   ev_io ev_write;
   ev_io ev_read;
 
-  char snd_size[MAX_NS_LEN_SIZE+1];
-  char msgbuf[MAX_RPC_MSG_SIZE];
-  unsigned int msg_size;
-  unsigned int rcvd_size;
-  bool in_msg;
-  bool msg_recv;
+  /** received data, starting with an incomplete netstring */
+  std::string rcvbuf;
+  size_t rcv_pos;
+
+  /** netstrings to be sent */
+  std::string sndbuf;
+  size_t snd_pos;
+
+  /** messages of this connection in the server threads */
+  unsigned int in_flight;
+  /** close once the replies are sent (FL_CLOSE_ALWAYS) */
+  bool close_after_write;
+  /** socket closed, deleted once no message is in flight */
+  bool closed;
+  /** waiting for the server threads to catch up */
+  bool throttled;
 
   JsonrpcNetstringsConnection(const std::string& id); 
   ~JsonrpcNetstringsConnection(); 
@@ -112,20 +135,29 @@ struct JsonrpcNetstringsConnection
     DISPATCH
   } ReadResult;
 
-  /** @returns ReadResult */
+  /**
+     read what is available on the socket
+     @returns ReadResult (CONTINUE or REMOVE)
+  */
   int netstringsRead();
 
-  /** 
-      blocking write: blocks until message in msgbuf 
-      with size msg_size is written
+  /**
+     take the next complete message out of the received data
+     @returns ReadResult: DISPATCH if msg is set
   */
-  int netstringsBlockingWrite();
+  int nextMessage(std::string& msg);
 
-  void resetRead();
+  /** queue msg for sending as netstring */
+  void queueMessage(const std::string& msg);
 
-  bool messagePending();
+  /**
+     non-blocking write of the queued messages
+     @returns ReadResult (CONTINUE or REMOVE)
+  */
+  int netstringsWrite();
 
-  bool messageIsRecv();
+  /** bytes queued for sending */
+  size_t sendQueueSize() { return sndbuf.size() - snd_pos; }
 };
 
 #endif
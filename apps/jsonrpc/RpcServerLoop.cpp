@@ -48,12 +48,19 @@
 #include <unistd.h>
 #include <string.h> 
 #include <fcntl.h>
+#include <netinet/tcp.h>
 #include <errno.h>
 #include <err.h>
 #include <stddef.h>
 
+#include <algorithm>
+
 #include "RpcPeer.h"
 
+// AmSession.h brings libevent's EV_READ/EV_WRITE, which are not libev's
+#undef EV_READ
+#undef EV_WRITE
+
 ev_io ev_accept;
 ev_async JsonRPCServerLoop::async_w;
 struct ev_loop* JsonRPCServerLoop::loop = 0;
@@ -63,8 +70,8 @@ RpcServerThreadpool JsonRPCServerLoop::threadpool;
 std::map<string, JsonrpcPeerConnection*> JsonRPCServerLoop::connections;
 AmMutex JsonRPCServerLoop::connections_mut;
 
-vector<JsonServerEvent*> JsonRPCServerLoop::pending_events;
-AmMutex JsonRPCServerLoop::pending_events_mut;
+unsigned int JsonRPCServerLoop::pending = 0;
+std::deque<JsonrpcNetstringsConnection*> JsonRPCServerLoop::throttled;
 
 JsonRPCServerLoop* JsonRPCServerLoop::instance() {
   if (_instance == NULL) {
@@ -87,22 +94,6 @@ int setnonblock(int fd)
   return 0;
 }
 
-// todo: use write_cb 
-// static void write_cb(struct ev_loop *loop, struct ev_io *w, int revents)
-// { 
-//   struct JsonrpcClientConnection *cli= 
-// ((struct JsonrpcClientConnection*) (((char*)w) - offsetof(struct JsonrpcClientConnection,ev_write)));
-//   if (revents & EV_WRITE){
-//     ssize_t written = write(cli->fd,superjared,strlen(superjared));
-//     if (written != strlen(superjared)) {
-//       ERROR("writing response\n");
-//     }
-//     ev_io_stop(EV_A_ w);
-//   }
-//   close(cli->fd);
-//   delete cli;
-// }
-
 static void read_cb(struct ev_loop *loop, struct ev_io *w, int revents) { 	
 
   struct JsonrpcNetstringsConnection *peer= 
@@ -111,67 +102,178 @@ static void read_cb(struct ev_loop *loop, struct ev_io *w, int revents) {
 
   DBG("read_cb in connection %p\n", peer);
 
-  // int r=0;
-  // char rbuff[1024];
   if (revents & EV_READ){
-    // read message - here in main server thread (more efficient for small messages)
-    int res = peer->netstringsRead();
-    switch (res) {
-    case JsonrpcNetstringsConnection::CONTINUE: 
-      ev_io_start(loop,&peer->ev_read); return;
+    // read messages - here in main server thread, processed in server threads
+    if (peer->netstringsRead() == JsonrpcNetstringsConnection::REMOVE) {
+      JsonRPCServerLoop::closeConnection(peer);
+      return;
+    }
+    JsonRPCServerLoop::dispatchMessages(peer);
+  }
+}
+
+static void write_cb(struct ev_loop *loop, struct ev_io *w, int revents) {
 
-    case JsonrpcNetstringsConnection::REMOVE: {
-      ev_io_stop(EV_A_ w); 
+  struct JsonrpcNetstringsConnection *peer= 
+    ((struct JsonrpcNetstringsConnection*) 
+     (((char*)w) - offsetof(JsonrpcNetstringsConnection,ev_write)));
 
-      peer->notifyDisconnect();
+  if (revents & EV_WRITE)
+    JsonRPCServerLoop::writeMessages(peer);
+}
 
-      JsonRPCServerLoop::instance()->removeConnection(peer->id);
-      delete peer;
+void JsonRPCServerLoop::dispatchServerEvent(AmEvent* ev) {
+  threadpool.dispatch(ev);
+}
+
+bool JsonRPCServerLoop::canDispatch(JsonrpcNetstringsConnection* peer) {
+  return !peer->closed && !peer->close_after_write &&
+    peer->in_flight < (unsigned int)JsonRPCServerModule::pipeline_depth &&
+    pending < (unsigned int)JsonRPCServerModule::max_pending_requests &&
+    peer->sendQueueSize() < RPC_SEND_QUEUE_HIGH_WATER;
+}
+
+void JsonRPCServerLoop::dispatchToThreads(JsonrpcNetstringsConnection* peer,
+					  JsonServerEvent* ev) {
+  peer->in_flight++;
+  pending++;
+  dispatchServerEvent(ev);
+}
+
+void JsonRPCServerLoop::startConnection(JsonrpcNetstringsConnection* peer) {
+  ev_io_init(&peer->ev_read,read_cb,peer->fd,EV_READ);
+  ev_io_init(&peer->ev_write,write_cb,peer->fd,EV_WRITE);
+  ev_io_start(loop,&peer->ev_read);
+}
 
-    } return;
-    case JsonrpcNetstringsConnection::DISPATCH: {
-      ev_io_stop(EV_A_ w); 
-      JsonRPCServerLoop::
-	dispatchServerEvent(new JsonServerEvent(peer, JsonServerEvent::StartReadLoop));
-    } return;
+void JsonRPCServerLoop::dispatchMessages(JsonrpcNetstringsConnection* peer) {
+  while (canDispatch(peer)) {
+    string msg;
+    int res = peer->nextMessage(msg);
+    if (res == JsonrpcNetstringsConnection::REMOVE) {
+      closeConnection(peer);
+      return;
     }
+    if (res != JsonrpcNetstringsConnection::DISPATCH)
+      break;
+
+    dispatchToThreads(peer, new JsonServerMessageEvent(peer, msg));
+  }
+
+  if (canDispatch(peer)) {
+    if (!ev_is_active(&peer->ev_read))
+      ev_io_start(loop,&peer->ev_read);
     return;
   }
-  // put back to read loop
-  // ev_io_start(loop,&cli->ev_read);
 
-  // ev_io_stop(EV_A_ w);
-  // ev_io_init(&cli->ev_write,write_cb,cli->fd,EV_WRITE);
-  // ev_io_start(loop,&cli->ev_write);	
+  // back-pressure: leave it to the socket buffers
+  if (ev_is_active(&peer->ev_read)) {
+    DBG("stop reading from connection '%s' (%u in flight, %u pending)\n",
+	peer->id.c_str(), peer->in_flight, pending);
+    ev_io_stop(loop,&peer->ev_read);
+  }
+  if (!peer->closed && !peer->close_after_write && !peer->throttled &&
+      pending >= (unsigned int)JsonRPCServerModule::max_pending_requests) {
+    peer->throttled = true;
+    throttled.push_back(peer);
+  }
 }
 
-void JsonRPCServerLoop::dispatchServerEvent(AmEvent* ev) {
-  threadpool.dispatch(ev);
+void JsonRPCServerLoop::resumeThrottled() {
+  unsigned int max_pending = JsonRPCServerModule::max_pending_requests;
+  if (throttled.empty() || pending >= max_pending - max_pending / 4)
+    return;
+
+  // round-robin: who is throttled again goes to the end
+  DBG("resuming throttled connections (%zd waiting)\n", throttled.size());
+  while (!throttled.empty() && pending < max_pending) {
+    JsonrpcNetstringsConnection* peer = throttled.front();
+    throttled.pop_front();
+    peer->throttled = false;
+    dispatchMessages(peer);
+  }
 }
 
-static void accept_cb(struct ev_loop *loop, struct ev_io *w, int revents)
-{
-  int client_fd;
-  struct sockaddr_in client_addr;
-  socklen_t client_len = sizeof(client_addr);
-  client_fd = accept(w->fd, (struct sockaddr *)&client_addr, &client_len);
-  if (client_fd == -1) {
+void JsonRPCServerLoop::writeMessages(JsonrpcNetstringsConnection* peer) {
+  if (peer->netstringsWrite() == JsonrpcNetstringsConnection::REMOVE) {
+    closeConnection(peer);
     return;
   }
-   	 
-  string connection_id = JsonRPCServerLoop::newConnectionId();
-  JsonrpcNetstringsConnection* peer = new JsonrpcNetstringsConnection(connection_id);
-  peer->fd=client_fd;
-  if (setnonblock(peer->fd) < 0) {
-    delete peer;
-    ERROR("failed to set client socket to non-blocking");
+
+  if (peer->sendQueueSize()) {
+    if (!ev_is_active(&peer->ev_write))
+      ev_io_start(loop,&peer->ev_write);
+  } else {
+    if (ev_is_active(&peer->ev_write))
+      ev_io_stop(loop,&peer->ev_write);
+
+    if (peer->close_after_write) {
+      closeConnection(peer);
+      return;
+    }
+  }
+
+  // reading might have been stopped for the replies
+  dispatchMessages(peer);
+}
+
+void JsonRPCServerLoop::closeConnection(JsonrpcNetstringsConnection* peer) {
+  if (peer->closed)
     return;
+
+  ev_io_stop(loop,&peer->ev_read);
+  ev_io_stop(loop,&peer->ev_write);
+  peer->close();
+  peer->closed = true;
+  if (peer->throttled) {
+    throttled.erase(std::find(throttled.begin(), throttled.end(), peer));
+    peer->throttled = false;
   }
 
-  JsonRPCServerLoop::registerConnection(peer, connection_id);
+  peer->notifyDisconnect();
+  removeConnection(peer->id);
 
-  ev_io_init(&peer->ev_read,read_cb,peer->fd,EV_READ);
-  ev_io_start(loop,&peer->ev_read);
+  // server threads still working on messages of the connection delete it
+  if (!peer->in_flight)
+    delete peer;
+}
+
+void JsonRPCServerLoop::messageDone(JsonServerDoneEvent* ev) {
+  instance()->postEvent(ev);
+  ev_async_send(loop, &async_w);
+}
+
+static void accept_cb(struct ev_loop *loop, struct ev_io *w, int revents)
+{
+  // take all waiting connections
+  while (true) {
+    int client_fd;
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    client_fd = accept(w->fd, (struct sockaddr *)&client_addr, &client_len);
+    if (client_fd == -1) {
+      return;
+    }
+   	 
+    string connection_id = JsonRPCServerLoop::newConnectionId();
+    JsonrpcNetstringsConnection* peer = new JsonrpcNetstringsConnection(connection_id);
+    peer->fd=client_fd;
+    if (setnonblock(peer->fd) < 0) {
+      peer->close();
+      delete peer;
+      ERROR("failed to set client socket to non-blocking");
+      continue;
+    }
+
+    // replies are sent as soon as they are done
+    int nodelay = 1;
+    if (setsockopt(peer->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
+      WARN("failed to set TCP_NODELAY on client socket: %s\n", strerror(errno));
+    }
+
+    JsonRPCServerLoop::registerConnection(peer, connection_id);
+    JsonRPCServerLoop::startConnection(peer);
+  }
 }
 
 static void async_cb (EV_P_ ev_async *w, int revents)
@@ -193,38 +295,9 @@ void JsonRPCServerLoop::process(AmEvent* ev) {
 
   switch (server_event->event_id) {
   case JsonServerEvent::StartReadLoop: {
-    JsonrpcNetstringsConnection* a_client = server_event->conn;
-
-    DBG("checking for pending events to connection %p/%s\n",
-	a_client, a_client->id.c_str());
-
-    pending_events_mut.lock();
-    // (check whether event for that connection pending)
-    for (vector<JsonServerEvent*>::iterator it=
-	   pending_events.begin(); it != pending_events.end(); it++) {
-      if ((*it)->connection_id == a_client->id) {
-	// stop read loop
-	ev_io_stop(loop,&a_client->ev_read);
-
-	JsonServerEvent* server_event = *it;
-	pending_events.erase(it);
-	pending_events_mut.unlock();
-	
-	DBG("got pending event for connection '%s'\n", a_client->id.c_str());
-	
-	server_event->conn = a_client;
-	dispatchServerEvent(server_event);
-
-	return;
-      }
-    }
-    pending_events_mut.unlock();
-    DBG("no pending events for connection %p/%s, starting read loop\n",
-	a_client, a_client->id.c_str());
-
-    a_client->resetRead();
-    ev_io_init(&a_client->ev_read,read_cb,a_client->fd,EV_READ);
-    ev_io_start(loop,&a_client->ev_read);
+    DBG("starting read loop for connection %p/%s\n",
+	server_event->conn, server_event->conn->id.c_str());
+    startConnection(server_event->conn);
   }; break;
 
   case JsonServerEvent::SendMessage: {
@@ -250,23 +323,37 @@ void JsonRPCServerLoop::process(AmEvent* ev) {
       return;
     }
 
-    if (ev_is_active(&peer->ev_read)) {
-      // ok, peer is in read loop, we can dispatch it to thread for sending
-      ev_io_stop(EV_A_ &peer->ev_read);
-      JsonRPCServerLoop::
-	dispatchServerEvent(new JsonServerSendMessageEvent(*snd_msg_ev, peer));
+    // created in a server thread, sent with the replies
+    dispatchToThreads(peer, new JsonServerSendMessageEvent(*snd_msg_ev, peer));
+  }; break;
+
+  case JsonServerEvent::MessageDone: {
+    JsonServerDoneEvent* done_ev = dynamic_cast<JsonServerDoneEvent*>(server_event);
+    if (done_ev == NULL) {
+      ERROR("invalid MessageDone type event received\n");
+      return;
+    }
+
+    JsonrpcNetstringsConnection* peer = done_ev->conn;
+    peer->in_flight--;
+    pending--;
+
+    if (peer->closed) {
+      if (!peer->in_flight)
+	delete peer;
+    } else if (done_ev->close) {
+      closeConnection(peer);
     } else {
-      // peer is being processed by thread, save event for later sending
-      pending_events_mut.lock();
-      // (need to copy event here: original event is deleted when event processed)
-      pending_events.push_back(new JsonServerSendMessageEvent(*snd_msg_ev));
-      size_t q_size = pending_events.size();
-      pending_events_mut.unlock();
-      DBG("queued event for connection %s (total %zd events pending)\n", 
-	  snd_msg_ev->connection_id.c_str(), q_size);     
+      if (!done_ev->msg.empty())
+	peer->queueMessage(done_ev->msg);
+      if (done_ev->close_after_write)
+	peer->close_after_write = true;
+      writeMessages(peer);
     }
-      
+
+    resumeThrottled();
   }; break;
+
     // todo: process remove connection event 
 
   default: 
@@ -311,7 +398,7 @@ void JsonRPCServerLoop::run() {
     ERROR("bind failed\n");
     return;
   }
-  if (listen(listen_fd,5) < 0) {
+  if (listen(listen_fd,SOMAXCONN) < 0) {
     ERROR("listen failed\n");
     return;
   }
@@ -336,33 +423,6 @@ void JsonRPCServerLoop::on_stop() {
   INFO("todo\n");
 }
 
-void JsonRPCServerLoop::returnConnection(JsonrpcNetstringsConnection* conn) {
-  pending_events_mut.lock();
-  // (check whether event for that connection pending)
-  DBG("checking %zd pending events\n", pending_events.size());
-  for (vector<JsonServerEvent*>::iterator it=
-	 pending_events.begin(); it != pending_events.end(); it++) {
-    DBG("%s vs %s\n", (*it)->connection_id.c_str(),conn->id.c_str());
-    if ((*it)->connection_id == conn->id) {
-      JsonServerEvent* server_event = *it;
-      pending_events.erase(it);
-      pending_events_mut.unlock();
-
-      DBG("got pending event for connection '%s'\n", conn->id.c_str());
-
-      server_event->conn = conn;
-      dispatchServerEvent(server_event);
-      return;
-    }
-  }
-  pending_events_mut.unlock();
-
-  DBG("returning connection %p\n", conn);
-  instance()->postEvent(new JsonServerEvent(conn, JsonServerEvent::StartReadLoop));
-
-  ev_async_send(loop, &async_w);
-}
-
 void JsonRPCServerLoop::execRpc(const string& evq_link, 
 				const string& notificationReceiver,
 				const string& requestReceiver,
@@ -397,15 +457,17 @@ void JsonRPCServerLoop::execRpc(const string& evq_link,
 
   registerConnection(peer, connection_id);
 
-  DBG("dispatching JsonServerSendMessageEvent\n");
+  // replies are read by the server loop
+  instance()->postEvent(new JsonServerEvent(peer, JsonServerEvent::StartReadLoop));
+
+  DBG("posting JsonServerSendMessageEvent\n");
   JsonServerSendMessageEvent* send_message_event = 
     new JsonServerSendMessageEvent(connection_id, false, method, "1" /* id - not empty */, 
 				   params, udata, evq_link);
+  instance()->postEvent(send_message_event);
 
-  JsonRPCServerLoop::dispatchServerEvent(send_message_event);
-
-  // JsonRPCServerLoop::
-  //   dispatchServerEvent(new JsonServerEvent(peer, JsonServerEvent::SendMessage));
+  // wake up event loop to process message
+  ev_async_send(loop, &async_w);
 
   ret.push(200);
   ret.push("OK");
@@ -42,7 +42,17 @@
 #include "AmArg.h"
 
 #include <map>
-
+#include <deque>
+
+/**
+ * libev loop doing all reading and writing on the connections: the
+ * received messages are processed by the server threads, several of
+ * one connection at once (up to pipeline_depth), and the replies are
+ * sent in the order they are done. Reading from a connection stops
+ * while it has pipeline_depth messages in the server threads or its
+ * replies are not taken, reading from all while max_pending_requests
+ * are waiting for the server threads.
+ */
 class JsonRPCServerLoop 
 : public AmEventQueue, public AmThread, public AmEventHandler
 {
@@ -55,8 +65,15 @@ class JsonRPCServerLoop
   static std::map<string, JsonrpcPeerConnection*> connections;
   static AmMutex connections_mut;
 
-  static vector<JsonServerEvent*> pending_events; // todo: use map<set<> > if many pending events
-  static AmMutex pending_events_mut;
+  // server loop only:
+  /** messages in the server threads */
+  static unsigned int pending;
+  /** connections not read from while the server threads are busy, in turn */
+  static std::deque<JsonrpcNetstringsConnection*> throttled;
+
+  static bool canDispatch(JsonrpcNetstringsConnection* peer);
+  static void dispatchToThreads(JsonrpcNetstringsConnection* peer, JsonServerEvent* ev);
+  static void resumeThrottled();
 
  public:
   JsonRPCServerLoop();
@@ -64,10 +81,22 @@ class JsonRPCServerLoop
 
   static JsonRPCServerLoop* instance();
 
-  static void returnConnection(JsonrpcNetstringsConnection* conn);
   static void dispatchServerEvent(AmEvent* ev);
   static void _processEvents();
 
+  // server loop only:
+  /** start reading from a new connection */
+  static void startConnection(JsonrpcNetstringsConnection* peer);
+  /** hand the received messages to the server threads, as far as allowed */
+  static void dispatchMessages(JsonrpcNetstringsConnection* peer);
+  /** write what is queued */
+  static void writeMessages(JsonrpcNetstringsConnection* peer);
+  /** close, deregister and (once nothing is in flight) delete */
+  static void closeConnection(JsonrpcNetstringsConnection* peer);
+
+  /** server thread: a message has been processed */
+  static void messageDone(JsonServerDoneEvent* ev);
+
   static void execRpc(const string& evq_link, 
 		      const string& notificationReceiver,
 		      const string& requestReceiver,
@@ -40,8 +40,8 @@
 
 #include "log.h"
 
-RpcServerThread::RpcServerThread()
-  : AmEventQueue(this) {
+RpcServerThread::RpcServerThread(RpcServerThreadpool* pool)
+  : pool(pool) {
 }
 
 RpcServerThread::~RpcServerThread() {
@@ -49,8 +49,9 @@ RpcServerThread::~RpcServerThread() {
 
 void RpcServerThread::run() {
   while (true) {
-    waitForEvent();
-    processEvents();
+    AmEvent* ev = pool->next();
+    process(ev);
+    delete ev;
   }
 }
 
@@ -60,105 +61,61 @@ void RpcServerThread::on_stop() {
 
 void RpcServerThread::process(AmEvent* event) {
   JsonServerEvent* server_event = dynamic_cast<JsonServerEvent*>(event);
-  if (server_event == NULL) {
+  if (server_event == NULL || server_event->conn == NULL) {
     ERROR("invalid event to process\n");
     return;
   }
   JsonrpcNetstringsConnection* connection = server_event->conn;
 
-  // todo: check event type - for now handle all types equally
+  // the connection stays with the server loop, the result goes back there
+  JsonServerDoneEvent* done_ev = new JsonServerDoneEvent(connection);
 
   if (server_event->event_id == JsonServerEvent::SendMessage) {
     JsonServerSendMessageEvent* snd_msg_ev = 
       dynamic_cast<JsonServerSendMessageEvent*>(server_event);
 
+    int res = -1;
     if (NULL == snd_msg_ev) {
       ERROR("wrong event type received\n");
-      return;
-    }
-
-    if (NULL == connection) {
-      DBG("getting connection for id %s\n", snd_msg_ev->connection_id.c_str());
-      JsonrpcPeerConnection* js_connection = JsonRPCServerLoop::getConnection(snd_msg_ev->connection_id);
-      if ((NULL == js_connection) || 
-	  (NULL == 
-	   (connection = dynamic_cast<JsonrpcNetstringsConnection*>(js_connection))))  {
-	ERROR("getting connection for id %s - message will not be sent\n",
-	      snd_msg_ev->connection_id.c_str());
-	return;
-      }
-    }
-
-    if (!snd_msg_ev->is_reply) {
-      if (JsonRpcServer::createRequest(snd_msg_ev->reply_link, snd_msg_ev->method, 
-				       snd_msg_ev->params, connection,
-				       snd_msg_ev->udata,
-				       snd_msg_ev->id.empty())) {
+    } else if (!snd_msg_ev->is_reply) {
+      res = JsonRpcServer::createRequest(snd_msg_ev->reply_link, snd_msg_ev->method, 
+					 snd_msg_ev->params, connection,
+					 snd_msg_ev->udata,
+					 snd_msg_ev->id.empty(), done_ev->msg);
+      if (res)
 	ERROR("creating request\n");
-	// give back connection into server loop
-	JsonRPCServerLoop::returnConnection(connection);
-	return;
-      }
     } else {
-      if (JsonRpcServer::createReply(connection, snd_msg_ev->id, snd_msg_ev->params,
-				     snd_msg_ev->is_error)) {
-	// give back connection into server loop
-	JsonRPCServerLoop::returnConnection(connection);
-	return;
-      }
+      res = JsonRpcServer::createReply(connection, snd_msg_ev->id, snd_msg_ev->params,
+				       snd_msg_ev->is_error, done_ev->msg);
     }
-    connection->msg_recv = false;
 
-  }
-
-  bool processed_message = false;
-
-  int res = 0;
-  if (connection->messagePending() && connection->messageIsRecv()) {
-    DBG("processing message >%.*s<\n", connection->msg_size, connection->msgbuf);
-    res = JsonRpcServer::processMessage(connection->msgbuf, &connection->msg_size, 
-					connection);
-    if (res<0) {
-      INFO("error processing message - closing connection\n");
-      connection->close();
-      connection->notifyDisconnect();
-      JsonRPCServerLoop::removeConnection(connection->id);
-      delete connection;
-      return;
-    }
+    // nothing to send
+    if (res)
+      done_ev->msg.clear();
 
-    connection->msg_recv = false;
-    processed_message = true;
-  }
-
-  DBG("connection->messagePending() = %s\n", connection->messagePending()?"true":"false");
-
-  if (connection->messagePending() && !connection->messageIsRecv()) {
-    DBG("calling write\n");
-    res = connection->netstringsBlockingWrite();
-    if (res == JsonrpcNetstringsConnection::REMOVE) {
-      connection->notifyDisconnect();
-      JsonRPCServerLoop::removeConnection(connection->id);
-      delete connection;
-      return;
+  } else if (server_event->event_id == JsonServerEvent::ProcessMessage) {
+    JsonServerMessageEvent* msg_ev =
+      dynamic_cast<JsonServerMessageEvent*>(server_event);
+    if (NULL == msg_ev) {
+      ERROR("wrong event type received\n");
+    } else {
+      DBG("processing message >%.*s<\n", (int)msg_ev->msg.length(), msg_ev->msg.c_str());
+      int res = JsonRpcServer::processMessage(msg_ev->msg.data(), msg_ev->msg.length(),
+					      connection, done_ev->msg);
+      if (res<0) {
+	INFO("error processing message - closing connection\n");
+	done_ev->msg.clear();
+	done_ev->close = true;
+      } else if (connection->flags & JsonrpcPeerConnection::FL_CLOSE_ALWAYS) {
+	DBG("closing connection marked as FL_CLOSE_ALWAYS\n");
+	done_ev->close_after_write = true;
+      }
     }
+  } else {
+    ERROR("unknown server event type received\n");
   }
 
-  if (processed_message && 
-      (connection->flags & JsonrpcPeerConnection::FL_CLOSE_ALWAYS)) {
-    DBG("closing connection marked as FL_CLOSE_ALWAYS\n");
-    connection->close();
-    connection->notifyDisconnect(); // ??
-    JsonRPCServerLoop::removeConnection(connection->id);
-    delete connection;
-    return;
-  }
-
-  // give back connection into server loop
-  JsonRPCServerLoop::returnConnection(connection);  
-
-  // ev_io_init(&cli->ev_write,write_cb,cli->fd,EV_WRITE);
-  // ev_io_start(loop,&cli->ev_write);   
+  JsonRPCServerLoop::messageDone(done_ev);
 }
 
 
@@ -173,34 +130,29 @@ RpcServerThreadpool::RpcServerThreadpool() {
 RpcServerThreadpool::~RpcServerThreadpool() {
 }
 
-/** round-robin dispatch to one thread */  
 void RpcServerThreadpool::dispatch(AmEvent* ev) {
-  threads_mut.lock();
-  if (!threads.size()) {
-    ERROR("no threads started for Rpc servers\n");
-    delete ev;
-    threads_mut.unlock();
-    return;
-  }
-
-  (*t_it)->postEvent(ev);
+  std::lock_guard<std::mutex> l(queue_mut);
+  queue.push_back(ev);
+  queue_cond.notify_one();
+}
 
-  t_it++;
-  if (t_it == threads.end())
-    t_it = threads.begin();
+AmEvent* RpcServerThreadpool::next() {
+  std::unique_lock<std::mutex> l(queue_mut);
+  while (queue.empty())
+    queue_cond.wait(l);
 
-  threads_mut.unlock();
+  AmEvent* ev = queue.front();
+  queue.pop_front();
+  return ev;
 }
 
 void RpcServerThreadpool::addThreads(unsigned int cnt) {
   DBG("adding %u RPC server threads\n", cnt);
   threads_mut.lock();
   for (unsigned int i=0;i<cnt;i++) {
-    RpcServerThread* thr = new RpcServerThread();
+    RpcServerThread* thr = new RpcServerThread(this);
     thr->start();
     threads.push_back(thr);
   }
-  t_it = threads.begin();
   threads_mut.unlock();
 }
-
@@ -31,18 +31,22 @@
 #define _RpcServerThread_h_
 
 #include "AmEvent.h"
-#include "AmEventQueue.h"
 #include "AmThread.h"
 #include "RpcPeer.h"
 
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+class RpcServerThreadpool;
+
 class RpcServerThread 
-: public AmEventQueue, public AmThread, public AmEventHandler
+: public AmThread
 {
-
-  char rcvbuf[MAX_RPC_MSG_SIZE];
+  RpcServerThreadpool* pool;
 
  public:
-  RpcServerThread();
+  RpcServerThread(RpcServerThreadpool* pool);
   ~RpcServerThread();
 
   void run();
@@ -51,18 +55,29 @@ class RpcServerThread
   void process(AmEvent* event);
 };
 
+/**
+ * server threads taking the messages from one queue: a slow
+ * request holds up only its own thread, not the ones queued
+ * behind it
+ */
 class RpcServerThreadpool 
 {
   vector<RpcServerThread*> threads;
-  vector<RpcServerThread*>::iterator t_it;
   AmMutex threads_mut;
 
+  std::deque<AmEvent*> queue;
+  std::mutex queue_mut;
+  std::condition_variable queue_cond;
+
  public:
   RpcServerThreadpool();
   ~RpcServerThreadpool();
   
   void dispatch(AmEvent* ev);
   void addThreads(unsigned int cnt);
+
+  /** server thread: wait for the next event */
+  AmEvent* next();
 };
 
 #endif
@@ -11,3 +11,23 @@
 #
 # server_threads=5
 
+
+
+# pipeline_depth  - messages (requests, notifications, batches) of one
+#                   connection processed by the server threads at once;
+#                   the replies are sent in the order they are done.
+#                   1 processes one message after the other.
+#
+# optional; default: 16
+#
+# pipeline_depth=16
+
+
+# max_pending_requests  - messages waiting for or being processed by the
+#                         server threads; beyond that, no more is read
+#                         from the connections until the server threads
+#                         have caught up.
+#
+# optional; default: 1000
+#
+# max_pending_requests=1000
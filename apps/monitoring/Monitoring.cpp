@@ -34,6 +34,7 @@
 
 #include <sys/types.h>
 #include <regex.h>
+#include <string.h>
 #include <unistd.h>
 
 //EXPORT_PLUGIN_CLASS_FACTORY(Monitor, MOD_NAME);
@@ -48,6 +49,80 @@ extern "C" void* plugin_class_create()
 Monitor* Monitor::_instance=0;
 unsigned int Monitor::gcInterval = 10;
 unsigned int Monitor::retain_samples_s = 10;
+size_t Monitor::call_memory_limit = CALL_MEMORY_LIMIT;
+
+// snapshot(): which attributes
+#define SNAPSHOT_ALL_ATTRS -1
+#define SNAPSHOT_NO_ATTRS  -2
+
+LogAttrNames::LogAttrNames(unsigned int max_names)
+  : names(new string[max_names]), count(0), max_names(max_names)
+{
+}
+
+int LogAttrNames::find(std::string_view name) {
+  std::shared_lock<std::shared_mutex> l(ids_mut);
+  std::unordered_map<string, unsigned int, Hash, std::equal_to<> >::iterator it =
+    ids.find(name);
+  if (it == ids.end())
+    return -1;
+  return it->second;
+}
+
+int LogAttrNames::intern(std::string_view name) {
+  int id = find(name);
+  if (id >= 0)
+    return id;
+
+  std::unique_lock<std::shared_mutex> l(ids_mut);
+  std::unordered_map<string, unsigned int, Hash, std::equal_to<> >::iterator it =
+    ids.find(name);
+  if (it != ids.end())
+    return it->second;
+
+  unsigned int n = count.load(std::memory_order_relaxed);
+  if (n >= max_names) {
+    ERROR("more than %u monitoring attribute names, not adding '%.*s'\n",
+	  max_names, (int)name.length(), name.data());
+    return -1;
+  }
+  names[n] = string(name);
+  ids.emplace(names[n], n);
+  count.store(n + 1, std::memory_order_release);
+  return n;
+}
+
+LogAttr* LogInfo::find(unsigned int name) {
+  for (std::vector<LogAttr>::iterator it = attrs.begin(); it != attrs.end(); it++) {
+    if (it->name == name)
+      return &*it;
+  }
+  return NULL;
+}
+
+/** approximate memory used by a value */
+static size_t argSize(const AmArg& a) {
+  size_t s = sizeof(AmArg);
+  switch (a.getType()) {
+  case AmArg::CStr:
+    s += strlen(a.asCStr());
+    break;
+  case AmArg::Blob:
+    s += a.asBlob().len;
+    break;
+  case AmArg::Array:
+    for (size_t i=0;i<a.size();i++)
+      s += argSize(a.get(i));
+    break;
+  case AmArg::Struct:
+    for (AmArg::ValueStruct::const_iterator it=a.begin(); it != a.end(); it++)
+      s += 32 /* map node */ + it->first.length() + argSize(it->second);
+    break;
+  default:
+    break;
+  }
+  return s;
+}
 
 Monitor* Monitor::instance()
 {
@@ -57,7 +132,9 @@ Monitor* Monitor::instance()
 }
 
 Monitor::Monitor(const string& name) 
-  : AmDynInvokeFactory(MOD_NAME), gc_thread(nullptr) {
+  : AmDynInvokeFactory(MOD_NAME), gc_thread(nullptr),
+    num_buckets(NUM_LOG_BUCKETS), logs(new LogBucket[NUM_LOG_BUCKETS]),
+    attr_names(new LogAttrNames(MAX_ATTRIBUTE_NAMES)) {
 }
 
 Monitor::~Monitor() {
@@ -71,6 +148,23 @@ int Monitor::onLoad() {
     return 0;
   }
 
+  // nothing is logged yet
+  num_buckets = cfg.getParameterInt("log_buckets", NUM_LOG_BUCKETS);
+  if (!num_buckets)
+    num_buckets = 1;
+  if (num_buckets != NUM_LOG_BUCKETS)
+    logs.reset(new LogBucket[num_buckets]);
+
+  unsigned int max_names =
+    cfg.getParameterInt("max_attribute_names", MAX_ATTRIBUTE_NAMES);
+  if (max_names != MAX_ATTRIBUTE_NAMES)
+    attr_names.reset(new LogAttrNames(max_names));
+
+  call_memory_limit = cfg.getParameterInt("call_memory_limit", CALL_MEMORY_LIMIT);
+
+  DBG("monitoring: %u buckets, max %u attribute names, %zu bytes per call\n",
+      num_buckets, max_names, call_memory_limit);
+
   if (cfg.getParameter("run_garbage_collector","no") == "yes") {
     gcInterval = cfg.getParameterInt("garbage_collector_interval", 10);
     DBG("Running garbage collection for monitoring every %u seconds\n", 
@@ -129,6 +223,8 @@ void Monitor::invoke(const string& method,
     listFinished(args,ret);
   } else if(method == "listActive"){
     listActive(args,ret);
+  } else if(method == "snapshot"){
+    getSnapshot(args,ret);
   } else if(method == "clear"){
     clear(args,ret);
   } else if(method == "clearFinished"){
@@ -161,18 +257,118 @@ void Monitor::invoke(const string& method,
     ret.push(AmArg("listByRegex"));
     ret.push(AmArg("listFinished"));
     ret.push(AmArg("listActive"));
+    ret.push(AmArg("snapshot"));
   } else
     throw AmDynInvoke::NotImplemented(method);
 }
 
+LogInfo& Monitor::getLogInfo(LogBucket& bucket, const char* call_id) {
+  std::map<string, LogInfo, std::less<> >::iterator it = bucket.log.find(call_id);
+  if (it == bucket.log.end())
+    it = bucket.log.emplace(call_id, LogInfo()).first;
+  return it->second;
+}
+
+LogAttr& Monitor::getAttr(LogInfo& info, unsigned int name, bool copy_value) {
+  LogAttr* attr = info.find(name);
+  if (!attr) {
+    info.attrs.push_back(LogAttr());
+    attr = &info.attrs.back();
+    attr->name = name;
+    attr->stamp = 0;
+    attr->size = sizeof(LogAttr) + sizeof(AmArg);
+    info.size += attr->size;
+  }
+
+  // a snapshot still uses the old value
+  if (!attr->value || attr->value.use_count() > 1) {
+    if (copy_value && attr->value)
+      attr->value = std::make_shared<AmArg>(*attr->value);
+    else
+      attr->value = std::make_shared<AmArg>();
+  }
+
+  return *attr;
+}
+
+void Monitor::setAttr(LogInfo& info, unsigned int name, const AmArg& value) {
+  LogAttr& attr = getAttr(info, name, false);
+  *attr.value = value;
+  updated(info, attr, sizeof(LogAttr) + argSize(value), false);
+}
+
+/**
+ * Accounts attr's new size; if the call is over the memory limit then,
+ * removes the oldest values of attr if they were just 'appended' to,
+ * then the least recently written other attributes, and attr itself
+ * as last resort.
+ */
+void Monitor::updated(LogInfo& info, LogAttr& attr, size_t size, bool appended) {
+  info.size = info.size - attr.size + size;
+  attr.size = size;
+  attr.stamp = ++info.stamp;
+  if (!call_memory_limit || info.size <= call_memory_limit)
+    return;
+
+  unsigned int name = attr.name;
+  if (appended) {
+    AmArg& v = *attr.value;
+    AmArg dropped;
+    while (info.size > call_memory_limit && v.size() > 1) {
+      size_t s = argSize(v.get(0));
+      v.pop(dropped);
+      attr.size -= s;
+      info.size -= s;
+    }
+  }
+
+  while (info.size > call_memory_limit) {
+    std::vector<LogAttr>::iterator victim = info.attrs.end();
+    for (std::vector<LogAttr>::iterator it = info.attrs.begin();
+	 it != info.attrs.end(); it++) {
+      if (it->name != name &&
+	  (victim == info.attrs.end() || it->stamp < victim->stamp))
+	victim = it;
+    }
+    if (victim == info.attrs.end())
+      break;
+    DBG("call over memory limit, dropping '%s'\n",
+	attr_names->name(victim->name).c_str());
+    info.size -= victim->size;
+    info.attrs.erase(victim);
+  }
+
+  if (info.size > call_memory_limit) {
+    for (std::vector<LogAttr>::iterator it = info.attrs.begin();
+	 it != info.attrs.end(); it++) {
+      if (it->name == name) {
+	WARN("value of '%s' exceeds call_memory_limit (%zu bytes), dropped\n",
+	     attr_names->name(name).c_str(), call_memory_limit);
+	info.size -= it->size;
+	info.attrs.erase(it);
+	break;
+      }
+    }
+  }
+}
+
 void Monitor::log(const AmArg& args, AmArg& ret) {
   assertArgCStr(args[0]);
   
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
   try {
-    for (size_t i=1;i<args.size();i+=2)
-      bucket.log[args[0].asCStr()].info[args[i].asCStr()]=AmArg(args[i+1]);
+    LogInfo& info = getLogInfo(bucket, args[0].asCStr());
+    for (size_t i=1;i<args.size();i+=2) {
+      int name = attr_names->intern(args[i].asCStr());
+      if (name < 0) {
+	bucket.log_lock.unlock();
+	ret.push(-1);
+	ret.push("too many attribute names");
+	return;
+      }
+      setAttr(info, name, args[i+1]);
+    }
   } catch (...) {
     bucket.log_lock.unlock();
     ret.push(-1);
@@ -190,14 +386,22 @@ void Monitor::add(const AmArg& args, AmArg& ret, int a) {
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
   try {
-    //for (size_t i=1;i<args.size();i++) {
+    int name = attr_names->intern(args[1].asCStr());
+    if (name < 0) {
+      bucket.log_lock.unlock();
+      ret.push(-1);
+      ret.push("too many attribute names");
+      return;
+    }
+    LogInfo& info = getLogInfo(bucket, args[0].asCStr());
+    LogAttr& attr = getAttr(info, name, true);
+    AmArg& v = *attr.value;
     int val = 0;
-    AmArg& v = bucket.log[args[0].asCStr()].info[args[1].asCStr()];
     if (isArgInt(v))
       val = v.asInt();
     val+=a;
     v = val;
-    //}
+    updated(info, attr, sizeof(LogAttr) + sizeof(AmArg), false);
   } catch (...) {
     bucket.log_lock.unlock();
     ret.push(-1);
@@ -229,13 +433,25 @@ void Monitor::logAdd(const AmArg& args, AmArg& ret) {
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
   try {
-    AmArg& val = bucket.log[args[0].asCStr()].info[args[1].asCStr()];
+    int name = attr_names->intern(args[1].asCStr());
+    if (name < 0) {
+      bucket.log_lock.unlock();
+      ret.push(-1);
+      ret.push("too many attribute names");
+      return;
+    }
+    LogInfo& info = getLogInfo(bucket, args[0].asCStr());
+    LogAttr& attr = getAttr(info, name, true);
+    AmArg& val = *attr.value;
+    size_t size = attr.size;
     if (!isArgArray(val) && !isArgUndef(val)) {
       AmArg v1 = val;
       val = AmArg();
       val.push(v1);
+      size += sizeof(AmArg);
     }
     val.push(AmArg(args[2]));
+    updated(info, attr, size + argSize(args[2]), true);
   } catch (...) {
     bucket.log_lock.unlock();
     throw;
@@ -450,8 +666,9 @@ void Monitor::markFinished(const AmArg& args, AmArg& ret) {
 
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
-  if (!bucket.log[args[0].asCStr()].finished)
-    bucket.log[args[0].asCStr()].finished = time(0);
+  LogInfo& info = getLogInfo(bucket, args[0].asCStr());
+  if (!info.finished)
+    info.finished = time(0);
   bucket.log_lock.unlock();
   ret.push(0);
   ret.push("OK");
@@ -463,7 +680,7 @@ void Monitor::setExpiration(const AmArg& args, AmArg& ret) {
 
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
-  bucket.log[args[0].asCStr()].finished = args[1].asInt();
+  getLogInfo(bucket, args[0].asCStr()).finished = args[1].asInt();
   bucket.log_lock.unlock();
   ret.push(0);
   ret.push("OK");
@@ -473,7 +690,10 @@ void Monitor::erase(const AmArg& args, AmArg& ret) {
   assertArgCStr(args[0]);
   LogBucket& bucket = getLogBucket(args[0].asCStr());
   bucket.log_lock.lock();
-  bucket.log.erase(args[0].asCStr());
+  std::map<string, LogInfo, std::less<> >::iterator it =
+    bucket.log.find(args[0].asCStr());
+  if (it != bucket.log.end())
+    bucket.log.erase(it);
   bucket.samples.erase(args[0].asCStr());
   bucket.log_lock.unlock();
   ret.push(0);
@@ -481,7 +701,7 @@ void Monitor::erase(const AmArg& args, AmArg& ret) {
 }
 
 void Monitor::clear(const AmArg& args, AmArg& ret) {
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
     logs[i].log.clear();
     logs[i].samples.clear();
@@ -500,14 +720,14 @@ void Monitor::clearFinished(const AmArg& args, AmArg& ret) {
 
 void Monitor::clearFinished() {
   time_t now = time(0);
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
-    std::map<string, LogInfo>::iterator it=
+    std::map<string, LogInfo, std::less<> >::iterator it=
       logs[i].log.begin();
     while (it != logs[i].log.end()) {
       if (it->second.finished && 
 	  it->second.finished <= now) {
-	std::map<string, LogInfo>::iterator d_it = it;
+	std::map<string, LogInfo, std::less<> >::iterator d_it = it;
 	it++;
 	logs[i].samples.erase(d_it->first);
 	logs[i].log.erase(d_it);
@@ -519,15 +739,57 @@ void Monitor::clearFinished() {
   }
 }
 
+/**
+ * Copies the values of the calls in bucket (or only of call_id), i.e.
+ * only takes references, so that they can be converted without the
+ * bucket lock held.
+ * @param name attribute index, SNAPSHOT_ALL_ATTRS or SNAPSHOT_NO_ATTRS
+ */
+void Monitor::snapshot(LogBucket& bucket, std::vector<LogSnapshot>& snap,
+		       int name, const char* call_id) {
+  bucket.log_lock.lock();
+  std::map<string, LogInfo, std::less<> >::iterator it, end;
+  if (call_id) {
+    it = end = bucket.log.find(call_id);
+    if (end != bucket.log.end())
+      end++;
+  } else {
+    it = bucket.log.begin();
+    end = bucket.log.end();
+  }
+
+  for (; it != end; it++) {
+    snap.push_back(LogSnapshot());
+    LogSnapshot& s = snap.back();
+    s.id = it->first;
+    s.finished = it->second.finished;
+    if (name == SNAPSHOT_NO_ATTRS)
+      continue;
+    for (std::vector<LogAttr>::iterator a = it->second.attrs.begin();
+	 a != it->second.attrs.end(); a++) {
+      if (name == SNAPSHOT_ALL_ATTRS || a->name == (unsigned int)name)
+	s.attrs.push_back(std::make_pair(a->name, a->value));
+    }
+  }
+  bucket.log_lock.unlock();
+}
+
+/** @return the attributes as struct, undef if none */
+AmArg Monitor::attributes(const LogSnapshot& snap) {
+  AmArg res;
+  for (size_t i=0;i<snap.attrs.size();i++)
+    res[attr_names->name(snap.attrs[i].first)] = *snap.attrs[i].second;
+  return res;
+}
+
 void Monitor::get(const AmArg& args, AmArg& ret) {
   assertArgCStr(args[0]);
   ret.assertArray();
-  LogBucket& bucket = getLogBucket(args[0].asCStr());
-  bucket.log_lock.lock();
-  std::map<string, LogInfo>::iterator it=bucket.log.find(args[0].asCStr());
-  if (it!=bucket.log.end())
-    ret.push(it->second.info);
-  bucket.log_lock.unlock();
+  std::vector<LogSnapshot> snap;
+  snapshot(getLogBucket(args[0].asCStr()), snap, SNAPSHOT_ALL_ATTRS,
+	   args[0].asCStr());
+  if (!snap.empty())
+    ret.push(attributes(snap[0]));
 }
 
 void Monitor::getSingle(const AmArg& args, AmArg& ret) {
@@ -539,69 +801,84 @@ void Monitor::getSingle(const AmArg& args, AmArg& ret) {
       args[0].asCStr(),
       args[1].asCStr());
 
-  LogBucket& bucket = getLogBucket(args[0].asCStr());
-  bucket.log_lock.lock();
-  std::map<string, LogInfo>::iterator it=bucket.log.find(args[0].asCStr());
-  if (it!=bucket.log.end()){
-    AmArg& _v = it->second.info;
-    DBG("found log: %s",AmArg::print(_v).c_str());
-    if(isArgStruct(_v) && _v.hasMember(args[1].asCStr())) {
-      ret.push(_v[args[1].asCStr()]);
-    }
-  }
-  bucket.log_lock.unlock();
-  DBG("ret = %s",AmArg::print(ret).c_str());
-}
+  int name = attr_names->find(args[1].asCStr());
+  if (name < 0)
+    return;
 
-void Monitor::getAttribute(const AmArg& args, AmArg& ret) {
-  assertArgCStr(args[0]);
-  string attr_name = args[0].asCStr();
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
-    logs[i].log_lock.lock();
-    for (std::map<string, LogInfo>::iterator it=
-	   logs[i].log.begin();it != logs[i].log.end();it++) {
-      ret.push(AmArg());
-      AmArg& val = ret.get(ret.size()-1);
-      val.push(AmArg(it->first.c_str()));
-      val.push(it->second.info[attr_name]);
-    }
-    logs[i].log_lock.unlock();
-  }
+  std::vector<LogSnapshot> snap;
+  snapshot(getLogBucket(args[0].asCStr()), snap, name, args[0].asCStr());
+  if (!snap.empty() && !snap[0].attrs.empty())
+    ret.push(*snap[0].attrs[0].second);
+  DBG("ret = %s",AmArg::print(ret).c_str());
 }
 
-
 #define DEF_GET_ATTRIB_FUNC(func_name, cond)				\
   void Monitor::func_name(const AmArg& args, AmArg& ret) {		\
     assertArgCStr(args[0]);						\
     ret.assertArray();							\
-    string attr_name = args[0].asCStr();				\
+    int name = attr_names->find(args[0].asCStr());			\
     time_t now = time(0);						\
-    for (int i=0;i<NUM_LOG_BUCKETS;i++) {				\
-      logs[i].log_lock.lock();						\
-      for (std::map<string, LogInfo>::iterator it=			\
-	     logs[i].log.begin();it != logs[i].log.end();it++) {	\
+    std::vector<LogSnapshot> snap;					\
+    for (unsigned int i=0;i<num_buckets;i++) {				\
+      snap.clear();							\
+      snapshot(logs[i], snap, name < 0 ? SNAPSHOT_NO_ATTRS : name);	\
+      for (std::vector<LogSnapshot>::iterator it=snap.begin();		\
+	   it != snap.end(); it++) {					\
 	if (cond) {							\
 	  ret.push(AmArg());						\
 	  AmArg& val = ret.get(ret.size()-1);				\
-	  val.push(AmArg(it->first.c_str()));				\
-	  val.push(it->second.info[attr_name]);				\
+	  val.push(AmArg(it->id.c_str()));				\
+	  val.push(it->attrs.empty() ? AmArg() : *it->attrs[0].second); \
 	}								\
       }									\
-      logs[i].log_lock.unlock();					\
     }									\
   }
 
-DEF_GET_ATTRIB_FUNC(getAttributeActive,  (!(it->second.finished && 
-					    it->second.finished <= now)))
-DEF_GET_ATTRIB_FUNC(getAttributeFinished,(it->second.finished && 
-					  it->second.finished <= now))
+DEF_GET_ATTRIB_FUNC(getAttribute, true)
+DEF_GET_ATTRIB_FUNC(getAttributeActive,  (!(it->finished && 
+					    it->finished <= now)))
+DEF_GET_ATTRIB_FUNC(getAttributeFinished,(it->finished && 
+					  it->finished <= now))
 #undef DEF_GET_ATTRIB_FUNC
 
+void Monitor::getSnapshot(const AmArg& args, AmArg& ret) {
+  // only some attributes?
+  std::vector<int> names;
+  for (size_t i=0;i<args.size();i++) {
+    assertArgCStr(args[i]);
+    int name = attr_names->find(args[i].asCStr());
+    if (name >= 0)
+      names.push_back(name);
+  }
+
+  ret.assertStruct();
+  std::vector<LogSnapshot> snap;
+  for (unsigned int i=0;i<num_buckets;i++) {
+    snap.clear();
+    snapshot(logs[i], snap, SNAPSHOT_ALL_ATTRS);
+    for (std::vector<LogSnapshot>::iterator it=snap.begin(); it != snap.end(); it++) {
+      if (args.size()) {
+	std::vector<std::pair<unsigned int, std::shared_ptr<const AmArg> > > attrs;
+	for (size_t a=0;a<it->attrs.size();a++) {
+	  for (size_t n=0;n<names.size();n++) {
+	    if (it->attrs[a].first == (unsigned int)names[n]) {
+	      attrs.push_back(it->attrs[a]);
+	      break;
+	    }
+	  }
+	}
+	it->attrs.swap(attrs);
+      }
+      ret[it->id] = attributes(*it);
+    }
+  }
+}
+
 void Monitor::listAll(const AmArg& args, AmArg& ret) {
   ret.assertArray();
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
-    for (std::map<string, LogInfo>::iterator it=
+    for (std::map<string, LogInfo, std::less<> >::iterator it=
 	   logs[i].log.begin(); it != logs[i].log.end(); it++) {
       ret.push(AmArg(it->first.c_str()));
     }
@@ -611,16 +888,23 @@ void Monitor::listAll(const AmArg& args, AmArg& ret) {
 
 void Monitor::listByFilter(const AmArg& args, AmArg& ret, bool erase) {
   ret.assertArray();
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+
+  // attribute names of the filter expressions
+  std::vector<int> names;
+  for (size_t a_i=0;a_i<args.size();a_i++)
+    names.push_back(attr_names->find(args.get(a_i).get(0).asCStr()));
+
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
     try {
-      std::map<string, LogInfo>::iterator it=logs[i].log.begin();
+      std::map<string, LogInfo, std::less<> >::iterator it=logs[i].log.begin();
 
       while (it != logs[i].log.end()) {
 	bool match = true;
 	for (size_t a_i=0;a_i<args.size();a_i++) {
 	  const AmArg& p = args.get(a_i);
-	  if (!(it->second.info[p.get(0).asCStr()]==p.get(1).asCStr())) {
+	  LogAttr* attr = names[a_i] < 0 ? NULL : it->second.find(names[a_i]);
+	  if (!attr || !(*attr->value==p.get(1).asCStr())) {
 	    match = false;
 	    break;
 	  }
@@ -629,7 +913,7 @@ void Monitor::listByFilter(const AmArg& args, AmArg& ret, bool erase) {
 	if (match) {
 	  ret.push(AmArg(it->first.c_str()));
 	  if (erase) {
-	    std::map<string, LogInfo>::iterator d_it=it;
+	    std::map<string, LogInfo, std::less<> >::iterator d_it=it;
 	    it++;
 	    logs[i].log.erase(d_it);
 	    continue;
@@ -655,24 +939,23 @@ void Monitor::listByRegex(const AmArg& args, AmArg& ret) {
     ERROR("could not compile regex '%s'\n", args[1].asCStr());
     return;
   }
-  
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
-    logs[i].log_lock.lock();
-    try {
-      for (std::map<string, LogInfo>::iterator it=
-	     logs[i].log.begin(); it != logs[i].log.end(); it++) {
-	if (!it->second.info.hasMember(args[0].asCStr())  || 
-	    !isArgCStr(it->second.info[args[0].asCStr()]) ||
-	    regexec(&attr_reg,it->second.info[args[0].asCStr()].asCStr(),0,0,0))
+
+  int name = attr_names->find(args[0].asCStr());
+  if (name >= 0) {
+    std::vector<LogSnapshot> snap;
+    for (unsigned int i=0;i<num_buckets;i++) {
+      snap.clear();
+      snapshot(logs[i], snap, name);
+      for (std::vector<LogSnapshot>::iterator it=snap.begin();
+	   it != snap.end(); it++) {
+	if (it->attrs.empty() ||
+	    !isArgCStr((*it->attrs[0].second)) ||
+	    regexec(&attr_reg,it->attrs[0].second->asCStr(),0,0,0))
 	  continue;
 
-	ret.push(AmArg(it->first.c_str()));  
+	ret.push(AmArg(it->id.c_str()));
       }
-    } catch(...) {
-      logs[i].log_lock.unlock();
-      throw;
     }
-    logs[i].log_lock.unlock();
   }
 
   regfree(&attr_reg);
@@ -681,9 +964,9 @@ void Monitor::listByRegex(const AmArg& args, AmArg& ret) {
 void Monitor::listFinished(const AmArg& args, AmArg& ret) {
   time_t now = time(0);
   ret.assertArray();
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
-    for (std::map<string, LogInfo>::iterator it=
+    for (std::map<string, LogInfo, std::less<> >::iterator it=
 	   logs[i].log.begin(); it != logs[i].log.end(); it++) {
       if (it->second.finished && 
 	  it->second.finished <= now)
@@ -697,9 +980,9 @@ void Monitor::listFinished(const AmArg& args, AmArg& ret) {
 void Monitor::listActive(const AmArg& args, AmArg& ret) {
   time_t now = time(0);
   ret.assertArray();
-  for (int i=0;i<NUM_LOG_BUCKETS;i++) {
+  for (unsigned int i=0;i<num_buckets;i++) {
     logs[i].log_lock.lock();
-    for (std::map<string, LogInfo>::iterator it=
+    for (std::map<string, LogInfo, std::less<> >::iterator it=
 	   logs[i].log.begin(); it != logs[i].log.end(); it++) {
       if (!(it->second.finished &&
 	    it->second.finished <= now))
@@ -709,14 +992,8 @@ void Monitor::listActive(const AmArg& args, AmArg& ret) {
   }
 }
 
-LogBucket& Monitor::getLogBucket(const string& call_id) {
-  if (call_id.empty())
-    return logs[0];
-  char c = '\0'; // some distribution...bad luck if all callid start with 00000...
-  for (size_t i=0;i<5 && i<call_id.length();i++) 
-    c = c ^ call_id[i];
-  
-  return logs[c % NUM_LOG_BUCKETS];
+LogBucket& Monitor::getLogBucket(std::string_view call_id) {
+  return logs[std::hash<std::string_view>()(call_id) % num_buckets];
 }
 
 void MonitorGarbageCollector::run() {
@@ -30,6 +30,11 @@
 
 #include <map>
 #include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "AmThread.h"
 #include "AmApi.h"
@@ -37,13 +42,70 @@
 
 #include <time.h>
 
+/** default number of buckets (log_buckets) */
 #define NUM_LOG_BUCKETS 16
+/** default max number of attribute names (max_attribute_names) */
+#define MAX_ATTRIBUTE_NAMES 1024
+/** default memory per call in bytes (call_memory_limit) */
+#define CALL_MEMORY_LIMIT 65536
+
+/**
+ * Attribute names, interned: calls only keep the name's index.
+ * Names are never removed, so their number is limited.
+ */
+class LogAttrNames {
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>()(s);
+    }
+  };
+
+  std::shared_mutex ids_mut;
+  std::unordered_map<string, unsigned int, Hash, std::equal_to<> > ids;
+
+  // written once, read without lock below 'count'
+  std::unique_ptr<string[]> names;
+  std::atomic<unsigned int> count;
+  unsigned int max_names;
+
+ public:
+  LogAttrNames(unsigned int max_names);
+
+  /** @return index of name, -1 if not known */
+  int find(std::string_view name);
+  /** @return index of name, -1 if there are too many names */
+  int intern(std::string_view name);
+  const string& name(unsigned int id) const { return names[id]; }
+};
+
+struct LogAttr {
+  unsigned int name;
+  /** last write, for eviction */
+  unsigned int stamp;
+  /** accounted memory */
+  size_t size;
+  /** shared with snapshots; copied on write then */
+  std::shared_ptr<AmArg> value;
+};
 
 struct LogInfo {
   time_t finished; // for garbage collection
-LogInfo() 
- : finished(0) { }
-  AmArg info;
+  size_t size;
+  unsigned int stamp;
+  std::vector<LogAttr> attrs;
+
+  LogInfo()
+    : finished(0), size(0), stamp(0) { }
+
+  LogAttr* find(unsigned int name);
+};
+
+/** a call's attributes, read without holding the bucket lock */
+struct LogSnapshot {
+  string id;
+  time_t finished;
+  std::vector<std::pair<unsigned int, std::shared_ptr<const AmArg> > > attrs;
 };
 
 // empty sample lists are not erased!
@@ -61,7 +123,7 @@ struct SampleInfo {
 
 struct LogBucket {
   AmMutex log_lock;
-  std::map<string, LogInfo> log;
+  std::map<string, LogInfo, std::less<> > log;
   std::map<string, SampleInfo> samples;
 };
 class MonitorGarbageCollector;
@@ -73,9 +135,21 @@ class Monitor
   static Monitor* _instance;
   std::unique_ptr<MonitorGarbageCollector> gc_thread;
 
-  LogBucket logs[NUM_LOG_BUCKETS];
+  unsigned int num_buckets;
+  std::unique_ptr<LogBucket[]> logs;
+  std::unique_ptr<LogAttrNames> attr_names;
+
+  LogBucket& getLogBucket(std::string_view call_id);
+  LogInfo& getLogInfo(LogBucket& bucket, const char* call_id);
+
+  static size_t call_memory_limit;
+  void setAttr(LogInfo& info, unsigned int name, const AmArg& value);
+  LogAttr& getAttr(LogInfo& info, unsigned int name, bool copy_value);
+  void updated(LogInfo& info, LogAttr& attr, size_t size, bool appended);
 
-  LogBucket& getLogBucket(const string& call_id);
+  void snapshot(LogBucket& bucket, std::vector<LogSnapshot>& snap,
+		int name, const char* call_id = NULL);
+  AmArg attributes(const LogSnapshot& snap);
 
   static unsigned int retain_samples_s;
   void truncate_samples(list<SampleInfo::time_cnt>& v, struct timeval now);
@@ -106,6 +180,7 @@ class Monitor
   void listByRegex(const AmArg& args, AmArg& ret);
   void listFinished(const AmArg& args, AmArg& ret);
   void listActive(const AmArg& args, AmArg& ret);
+  void getSnapshot(const AmArg& args, AmArg& ret);
 
   void add(const AmArg& args, AmArg& ret, int a);
 
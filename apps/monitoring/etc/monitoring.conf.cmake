@@ -12,3 +12,30 @@ run_garbage_collector = yes
 # Default: 10
 #
 #garbage_collector_interval = 20
+
+#log_buckets=16
+#
+# number of buckets (each with its own lock) the calls are
+# distributed over; more buckets mean less lock contention with
+# many calls logging concurrently
+# Default: 16
+#
+#log_buckets=64
+
+#max_attribute_names=1024
+#
+# maximum number of different attribute names; attribute names are
+# kept once for all calls, and never removed
+# Default: 1024
+#
+#max_attribute_names=4096
+
+#call_memory_limit=65536
+#
+# approximate memory in bytes the attributes of one call may use; if
+# exceeded, the oldest values of the list just added to (add/logAdd)
+# and then the least recently written attributes of the call are
+# dropped. 0 for no limit.
+# Default: 65536
+#
+#call_memory_limit=16384
@@ -479,7 +479,7 @@ void CallLeg::onB2BEvent(B2BEvent* ev)
              *    on whitelist profiles too, which strip the header before this
              *    leg would otherwise see it - the reason the 491 used to fire
              *    anyway. */
-            string p_force_491 = getHeader(req_ev->req.hdrs, SIP_HDR_P_FORCE_491, true);
+            string p_force_491 = req_ev->req.getHeader(SIP_HDR_P_FORCE_491, true);
 
             if (AmConfig::send_491_on_pending_session_leg &&
                 ((!p_force_491.empty() && p_force_491 != "0") || !req_ev->skip_491)) {
@@ -12,11 +12,29 @@
 
 #include <utility>
 #include <mutex>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
 using std::pair;
 using std::make_pair;
 using std::lock_guard;
 
 #define REG_CACHE_CYCLE 10L /* 10 seconds to expire all buckets */
+/* max. bindings expired per locking of the cache */
+#define REG_CACHE_GBC_CHUNK 256
+
+#define REG_CACHE_SNAPSHOT_MAGIC   "SEMSREGC"
+#define REG_CACHE_SNAPSHOT_VERSION 1
+#define REG_CACHE_SNAPSHOT_BOM     0x01020304
+/* magic, version, byte-order mark, creation time, #bindings */
+#define REG_CACHE_SNAPSHOT_HDR_LEN (8 + 4 + 4 + 8 + 8)
+/* AoR hash buckets copied per locking of the cache */
+#define REG_CACHE_SNAPSHOT_CHUNK   128
 
 static string unescape_sip(const string& str)
 {
@@ -38,43 +56,103 @@ void AorHash::dump_elmt(const string& aor,
   }
 }
 
-void AorHash::gbc(long int now,
-		    list<string>& alias_list)
+AorHash::AorHash()
+  : wheel(REG_CACHE_WHEEL_SLOTS),
+    wheel_pos(time(NULL))
 {
-  for (auto set_it = entries_by_time.begin(); set_it != entries_by_time.end();) {
-    iterator it = *set_it;
-    auto next = set_it;
-    next++;
+}
 
-    AorEntry& aor_e = it->second;
-    if (aor_e.get_lowest_expire() > now)
-      break;
+void AorHash::wheel_insert(std::pair<const string, AorEntry>& aor,
+			   AorEntry::value_type& binding)
+{
+  RegBinding& b = binding.second;
+
+  // bindings already expired are collected on the next run
+  long int t = std::max(b.reg_expire, wheel_pos);
+  b.wheel_slot = t & (REG_CACHE_WHEEL_SLOTS - 1);
+
+  RegExpiryRef ref;
+  ref.aor = &aor;
+  ref.binding = &binding;
+  list<RegExpiryRef>& slot = wheel[b.wheel_slot];
+  b.wheel_it = slot.insert(slot.end(), ref);
+  b.indexed = true;
+}
+
+void AorHash::wheel_remove(RegBinding& b)
+{
+  if (!b.indexed)
+    return;
+
+  wheel[b.wheel_slot].erase(b.wheel_it);
+  b.indexed = false;
+}
 
-    for (AorEntry::iterator reg_it = aor_e.begin();
-	reg_it != aor_e.end();) {
+void AorHash::set_expire(const iterator& aor_it, const AorEntry::iterator& binding_it,
+			 long int expire)
+{
+  RegBinding& b = binding_it->second;
+  if (b.indexed && b.reg_expire == expire)
+    return;
+
+  wheel_remove(b);
+  b.reg_expire = expire;
+  wheel_insert(*aor_it, *binding_it);
+}
 
-      auto& binding = reg_it->second;
+void AorHash::erase_binding(const iterator& aor_it, const AorEntry::iterator& binding_it)
+{
+  wheel_remove(binding_it->second);
+  aor_it->second.erase(binding_it);
+}
 
-      if (binding.get_expire() <= now) {
+void AorHash::erase(const iterator& aor_it)
+{
+  for (auto& b : aor_it->second)
+    wheel_remove(b.second);
+  unordered_hash_map<string, AorEntry>::erase(aor_it);
+}
 
-	alias_list.push_back(binding.alias);
-	AorEntry::iterator del_it = reg_it++;
+bool AorHash::gbc(long int now, list<string>& alias_list, size_t max)
+{
+  // one turn of the wheel visits all the bindings
+  long int last = std::min(now, wheel_pos + REG_CACHE_WHEEL_SLOTS - 1);
+  size_t n = 0;
 
-	DBG("delete binding: '%s' -> '%s' (%li <= %li)",
-	    del_it->first.c_str(), binding.alias.c_str(),
-	    binding.get_expire(), now);
+  for (; wheel_pos <= last; wheel_pos++) {
 
-	erase_binding(it, del_it);
+    list<RegExpiryRef>& slot = wheel[wheel_pos & (REG_CACHE_WHEEL_SLOTS - 1)];
+    for (auto ref_it = slot.begin(); ref_it != slot.end();) {
+
+      RegExpiryRef ref = *ref_it++;
+      RegBinding& binding = ref.binding->second;
+
+      // not this turn
+      if (binding.reg_expire > now)
 	continue;
+
+      if (n++ >= max)
+	return false;
+
+      alias_list.push_back(binding.alias);
+
+      DBG("delete binding: '%s' -> '%s' (%li <= %li)",
+	  ref.binding->first.c_str(), binding.alias.c_str(),
+	  binding.reg_expire, now);
+
+      iterator it = find(ref.aor->first);
+      erase_binding(it, it->second.find(ref.binding->first));
+
+      if (it->second.empty()) {
+	DBG("delete empty AOR: '%s'", it->first.c_str());
+	erase(it);
       }
-      reg_it++;
-    }
-    if (aor_e.empty()) {
-      DBG("delete empty AOR: '%s'", it->first.c_str());
-      erase(it);
     }
-    set_it = next;
   }
+
+  // after a complete turn
+  wheel_pos = now + 1;
+  return true;
 }
 
 void AliasEntry::fire()
@@ -144,7 +222,9 @@ struct RegCacheLogHandler
 
 
 RegisterCache::RegisterCache()
-  : shutdown_flag(false)
+  : shutdown_flag(false),
+    snapshot_interval(0),
+    last_snapshot(0)
 {
   // debug register cache WRITE operations
   setStorageHandler(new RegCacheLogHandler());
@@ -166,16 +246,59 @@ RegisterCache::~RegisterCache()
 
 void RegisterCache::gbc()
 {
-  struct timeval now;
-  gettimeofday(&now,NULL);
+  struct timeval start, end;
+  gettimeofday(&start,NULL);
+
+  unsigned int expired = 0;
+  long max_lock_us = 0;
+  bool done = false;
+
+  // do not lock the cache for too long at once
+  while (!done) {
+    struct timeval lock_start;
+    gettimeofday(&lock_start,NULL);
+
+    lock_guard<AmMutex> _rl(reg_cache_ht);
+    list<string> alias_list;
+    done = reg_cache_ht.gbc(start.tv_sec, alias_list, REG_CACHE_GBC_CHUNK);
+    for(list<string>::iterator it = alias_list.begin();
+	it != alias_list.end(); it++){
+      removeAlias(*it,true);
+    }
+    expired += alias_list.size();
 
-  lock_guard<AmMutex> _rl(reg_cache_ht);
-  list<string> alias_list;
-  reg_cache_ht.gbc(now.tv_sec, alias_list);
-  for(list<string>::iterator it = alias_list.begin();
-      it != alias_list.end(); it++){
-    removeAlias(*it,true);
+    gettimeofday(&end,NULL);
+    max_lock_us = std::max(max_lock_us, (end.tv_sec - lock_start.tv_sec) * 1000000L +
+			   (end.tv_usec - lock_start.tv_usec));
   }
+
+  long us = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec);
+  if (expired) {
+    DBG("register cache: %u bindings expired in %li us (max. lock %li us)",
+	expired, us, max_lock_us);
+  }
+
+  lock_guard<AmMutex> _sl(gbc_stats_mut);
+  gbc_stats.runs++;
+  gbc_stats.expired += expired;
+  gbc_stats.last_expired = expired;
+  gbc_stats.last_us = us;
+  gbc_stats.max_us = std::max(gbc_stats.max_us, us);
+  gbc_stats.max_lock_us = std::max(gbc_stats.max_lock_us, max_lock_us);
+}
+
+void RegisterCache::getStats(AmArg& ret)
+{
+  ret["active_regs"] = (int)active_regs;
+
+  lock_guard<AmMutex> _sl(gbc_stats_mut);
+  AmArg& gbc = ret["gbc"];
+  gbc["runs"] = (long int)gbc_stats.runs;
+  gbc["expired"] = (long int)gbc_stats.expired;
+  gbc["last_expired"] = (int)gbc_stats.last_expired;
+  gbc["last_us"] = gbc_stats.last_us;
+  gbc["max_us"] = gbc_stats.max_us;
+  gbc["max_lock_us"] = gbc_stats.max_lock_us;
 }
 
 void RegisterCache::run()
@@ -183,11 +306,22 @@ void RegisterCache::run()
   while (!stop_requested()) {
     gbc();
 
+    if (!snapshot_file.empty() && snapshot_interval) {
+      long int now = AmAppTimer::instance()->unix_clock.get();
+      if (now - last_snapshot >= (long int)snapshot_interval) {
+	saveSnapshot(snapshot_file);
+	last_snapshot = now;
+      }
+    }
+
     std::unique_lock<std::mutex> _l(shutdown_mutex);
     if (shutdown_flag)
       break;
     sleep_cond.wait_for(_l, std::chrono::seconds(REG_CACHE_CYCLE));
   }
+
+  if (!snapshot_file.empty())
+    saveSnapshot(snapshot_file);
 }
 
 /**
@@ -416,7 +550,7 @@ void RegisterCache::update(long int reg_expires, const AliasEntry& alias_update)
 	}
 
 	// relink binding with the new index
-	auto& binding = binding_it->second;
+	RegBinding binding = binding_it->second;
 	reg_cache_ht.erase_binding(aor_e_it, binding_it);
 	binding_it = aor_e_it->second.insert(make_pair(idx, binding)).first;
       }
@@ -669,6 +803,370 @@ bool RegisterCache::findAEByContact(const string& contact_uri,
 }
 
 
+/*
+ * Snapshot format (host byte order):
+ *  header:  magic (8), version (u32), byte-order mark (u32),
+ *           creation time (i64), number of bindings (u64)
+ *  binding: aor, alias, contact_uri, source_ip, trsp, remote_ua
+ *           (u16 length + bytes each), source_port (u16),
+ *           local_if (u16), reg_expire (i64), ua_expire (i64)
+ *  trailer: hashlittle() of the bindings (u32)
+ */
+namespace {
+
+  template<typename T>
+  inline void snap_put(string& buf, T v)
+  {
+    buf.append((const char*)&v, sizeof(T));
+  }
+
+  inline void snap_put_str(string& buf, const string& s)
+  {
+    snap_put<uint16_t>(buf, s.length());
+    buf.append(s);
+  }
+
+  struct SnapReader
+  {
+    const char* p;
+    const char* end;
+    bool        ok;
+
+    SnapReader(const char* b, const char* e)
+      : p(b), end(e), ok(true)
+    {}
+
+    template<typename T>
+    T get()
+    {
+      T v = 0;
+      if (end - p < (long)sizeof(T)) {
+	ok = false;
+	return v;
+      }
+      memcpy(&v, p, sizeof(T));
+      p += sizeof(T);
+      return v;
+    }
+
+    void get_str(string& s)
+    {
+      uint16_t len = get<uint16_t>();
+      if (!ok || end - p < len) {
+	ok = false;
+	return;
+      }
+      s.assign(p, len);
+      p += len;
+    }
+  };
+
+  class SnapMapping
+  {
+    const char* p;
+    size_t      len;
+
+  public:
+    SnapMapping(int fd, size_t l)
+      : p(NULL), len(l)
+    {
+      void* m = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+      if (m != MAP_FAILED)
+	p = (const char*)m;
+    }
+
+    ~SnapMapping() {
+      if (p) munmap((void*)p, len);
+    }
+
+    const char* data() const { return p; }
+    size_t length() const { return len; }
+  };
+}
+
+void RegisterCache::setSnapshot(const string& file, unsigned int interval)
+{
+  snapshot_file = file;
+  snapshot_interval = interval;
+  last_snapshot = AmAppTimer::instance()->unix_clock.get();
+}
+
+size_t RegisterCache::serialize(string& buf)
+{
+  size_t n = 0;
+  size_t start = buf.length();
+  size_t bucket = 0, buckets = 0;
+
+  // rough estimate of the space needed: avoid growing the buffer
+  // while holding the locks
+  buf.reserve(start + (size_t)active_regs.load() * 192);
+
+  // the locks are released every REG_CACHE_SNAPSHOT_CHUNK hash buckets,
+  // so that REGISTER processing is not blocked by large snapshots
+  for (;;) {
+    lock_guard<AmMutex> _rl(reg_cache_ht);
+    lock_guard<AmMutex> _id_l(id_idx);
+
+    if (reg_cache_ht.bucket_count() != buckets) {
+      // first chunk, or rehashed meanwhile: start over
+      if (buckets)
+	DBG("register cache rehashed while saving the snapshot, restarting");
+      buf.resize(start);
+      n = 0;
+      bucket = 0;
+      buckets = reg_cache_ht.bucket_count();
+    }
+
+    size_t last = std::min(bucket + REG_CACHE_SNAPSHOT_CHUNK, buckets);
+    for (; bucket < last; bucket++) {
+      for (auto aor_it = reg_cache_ht.begin(bucket);
+	   aor_it != reg_cache_ht.end(bucket); ++aor_it) {
+	for (auto b_it = aor_it->second.begin(); b_it != aor_it->second.end(); ++b_it) {
+
+	  auto ae_it = id_idx.find(b_it->second.alias);
+	  if (ae_it == id_idx.end())
+	    continue;
+
+	  const AliasEntry& ae = ae_it->second;
+	  const string& alias = b_it->second.alias;
+	  if ((aor_it->first.length() > 0xffff) || (ae.contact_uri.length() > 0xffff) ||
+	      (ae.remote_ua.length() > 0xffff) || (alias.length() > 0xffff)) {
+	    DBG("skipping oversized binding '%s'", alias.c_str());
+	    continue;
+	  }
+
+	  snap_put_str(buf, aor_it->first);
+	  snap_put_str(buf, alias);
+	  snap_put_str(buf, ae.contact_uri);
+	  snap_put_str(buf, ae.source_ip);
+	  snap_put_str(buf, ae.trsp);
+	  snap_put_str(buf, ae.remote_ua);
+	  snap_put<uint16_t>(buf, ae.source_port);
+	  snap_put<uint16_t>(buf, ae.local_if);
+	  snap_put<int64_t>(buf, b_it->second.get_expire());
+	  snap_put<int64_t>(buf, ae.ua_expire);
+	  n++;
+	}
+      }
+    }
+
+    if (bucket >= buckets)
+      break;
+  }
+
+  return n;
+}
+
+long RegisterCache::saveSnapshot(const string& file)
+{
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+
+  string buf(REG_CACHE_SNAPSHOT_HDR_LEN, '\0');
+  size_t n = serialize(buf);
+
+  gettimeofday(&end, NULL);
+  long copy_us = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec);
+
+  // fill in the header
+  char* hdr = &buf[0];
+  uint32_t version = REG_CACHE_SNAPSHOT_VERSION;
+  uint32_t bom = REG_CACHE_SNAPSHOT_BOM;
+  int64_t created = start.tv_sec;
+  uint64_t count = n;
+  memcpy(hdr, REG_CACHE_SNAPSHOT_MAGIC, 8);
+  memcpy(hdr + 8, &version, 4);
+  memcpy(hdr + 12, &bom, 4);
+  memcpy(hdr + 16, &created, 8);
+  memcpy(hdr + 24, &count, 8);
+
+  snap_put<uint32_t>(buf, hashlittle(buf.data() + REG_CACHE_SNAPSHOT_HDR_LEN,
+				     buf.length() - REG_CACHE_SNAPSHOT_HDR_LEN, 0));
+
+  string tmp_file = file + ".tmp";
+  int fd = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    ERROR("could not open register cache snapshot '%s': %s",
+	  tmp_file.c_str(), strerror(errno));
+    return -1;
+  }
+
+  const char* p = buf.data();
+  size_t left = buf.length();
+  while (left) {
+    ssize_t w = write(fd, p, left);
+    if (w < 0) {
+      if (errno == EINTR)
+	continue;
+      ERROR("could not write register cache snapshot '%s': %s",
+	    tmp_file.c_str(), strerror(errno));
+      close(fd);
+      unlink(tmp_file.c_str());
+      return -1;
+    }
+    p += w;
+    left -= w;
+  }
+
+  if (fsync(fd) < 0 || close(fd) < 0 ||
+      rename(tmp_file.c_str(), file.c_str()) < 0) {
+    ERROR("could not save register cache snapshot '%s': %s",
+	  file.c_str(), strerror(errno));
+    unlink(tmp_file.c_str());
+    return -1;
+  }
+
+  gettimeofday(&end, NULL);
+  DBG("register cache snapshot: %zu bindings, %zu bytes written to '%s' "
+      "in %li ms (copied in %li ms)", n, buf.length(), file.c_str(),
+      (end.tv_sec - start.tv_sec) * 1000L + (end.tv_usec - start.tv_usec) / 1000L,
+      copy_us / 1000L);
+
+  return n;
+}
+
+long RegisterCache::loadSnapshot(const string& file)
+{
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      DBG("no register cache snapshot '%s'", file.c_str());
+      return 0;
+    }
+    ERROR("could not open register cache snapshot '%s': %s",
+	  file.c_str(), strerror(errno));
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    ERROR("could not stat register cache snapshot '%s': %s",
+	  file.c_str(), strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  if ((size_t)st.st_size < REG_CACHE_SNAPSHOT_HDR_LEN + sizeof(uint32_t)) {
+    ERROR("invalid register cache snapshot '%s'", file.c_str());
+    close(fd);
+    return -1;
+  }
+
+  // mapped, not read: saves copying (and faulting in) the whole file
+  SnapMapping buf(fd, st.st_size);
+  close(fd);
+
+  if (!buf.data()) {
+    ERROR("could not map register cache snapshot '%s': %s",
+	  file.c_str(), strerror(errno));
+    return -1;
+  }
+
+  if (memcmp(buf.data(), REG_CACHE_SNAPSHOT_MAGIC, 8)) {
+    ERROR("invalid register cache snapshot '%s'", file.c_str());
+    return -1;
+  }
+
+  SnapReader hdr(buf.data() + 8, buf.data() + REG_CACHE_SNAPSHOT_HDR_LEN);
+  uint32_t version = hdr.get<uint32_t>();
+  uint32_t bom = hdr.get<uint32_t>();
+  hdr.get<int64_t>(); // creation time
+  uint64_t count = hdr.get<uint64_t>();
+  if (version != REG_CACHE_SNAPSHOT_VERSION || bom != REG_CACHE_SNAPSHOT_BOM) {
+    ERROR("unsupported register cache snapshot '%s' (version %u)",
+	  file.c_str(), version);
+    return -1;
+  }
+
+  const char* b = buf.data() + REG_CACHE_SNAPSHOT_HDR_LEN;
+  const char* e = buf.data() + buf.length() - sizeof(uint32_t);
+  uint32_t checksum;
+  memcpy(&checksum, e, sizeof(uint32_t));
+  if (checksum != hashlittle(b, e - b, 0)) {
+    ERROR("corrupted register cache snapshot '%s'", file.c_str());
+    return -1;
+  }
+
+  long int now = AmAppTimer::instance()->unix_clock.get();
+  long loaded = 0, expired = 0;
+  SnapReader r(b, e);
+  AliasEntry ae;
+  string aor;
+
+  lock_guard<AmMutex> _rl(reg_cache_ht);
+  lock_guard<AmMutex> _id_l(id_idx);
+  lock_guard<AmMutex> _cl(contact_idx);
+
+  if (count < (uint64_t)(e - b)) {
+    reg_cache_ht.reserve(count);
+    id_idx.reserve(count);
+    contact_idx.reserve(count);
+  }
+
+  for (uint64_t i = 0; i < count; i++) {
+    r.get_str(aor);
+    r.get_str(ae.alias);
+    r.get_str(ae.contact_uri);
+    r.get_str(ae.source_ip);
+    r.get_str(ae.trsp);
+    r.get_str(ae.remote_ua);
+    ae.source_port = r.get<uint16_t>();
+    ae.local_if = r.get<uint16_t>();
+    long int reg_expire = r.get<int64_t>();
+    ae.ua_expire = r.get<int64_t>();
+
+    if (!r.ok) {
+      ERROR("truncated register cache snapshot '%s' (%lu of %lu bindings)",
+	    file.c_str(), (unsigned long)i, (unsigned long)count);
+      break;
+    }
+
+    if (reg_expire <= now) {
+      expired++;
+      continue;
+    }
+
+    if (id_idx.find(ae.alias) != id_idx.end())
+      continue;
+
+    ae.aor = aor;
+
+    auto aor_e_it = reg_cache_ht.find(aor);
+    if (aor_e_it == reg_cache_ht.end())
+      aor_e_it = reg_cache_ht.insert(make_pair(aor, AorEntry())).first;
+
+    auto ins = aor_e_it->second.insert(make_pair(ae.contact_uri + "/" + ae.source_ip,
+						 RegBinding()));
+    if (!ins.second)
+      continue;
+
+    ins.first->second.alias = ae.alias;
+    reg_cache_ht.set_expire(aor_e_it, ins.first, reg_expire);
+
+    contact_idx.insert(ae.contact_uri, ae.source_ip, ae.source_port, ae.alias);
+    id_idx.insert(make_pair(ae.alias, ae));
+
+#if 0 // disabled UA-timer
+    if(alias_e->ua_expire)
+      setAliasUATimer(alias_e);
+#endif
+
+    active_regs++;
+    loaded++;
+  }
+
+  gettimeofday(&end, NULL);
+  INFO("register cache: loaded %li bindings from '%s' in %li ms (%li expired)",
+       loaded, file.c_str(),
+       (end.tv_sec - start.tv_sec) * 1000L + (end.tv_usec - start.tv_usec) / 1000L,
+       expired);
+
+  return loaded;
+}
+
 int RegisterCache::parseAoR(RegisterCacheCtx& ctx,
 			     const AmSipRequest& req,
                              const shared_ptr<msg_logger>& logger)
@@ -721,7 +1219,7 @@ int RegisterCache::parseExpires(RegisterCacheCtx& ctx,
     return 0;
 
   // move Expires as separate header to contact parameter
-  string expires_str = getHeader(req.hdrs, "Expires");
+  string expires_str = req.getHeader("Expires");
   if (!expires_str.empty() && str2int(expires_str, ctx.requested_expires)) {
     AmBasicSipDialog::reply_error(req, 400, "Bad Request",
 				  "Warning: Malformed expires\r\n", logger);
@@ -970,7 +1468,7 @@ bool RegisterCache::saveSingleContact(RegisterCacheCtx& ctx,
   alias_update.contact_uri = contact->uri_str();
   alias_update.source_ip = req.remote_ip;
   alias_update.source_port = req.remote_port;
-  alias_update.remote_ua = getHeader(req.hdrs,"User-Agent");
+  alias_update.remote_ua = req.getHeader("User-Agent");
   alias_update.trsp = req.trsp;
   alias_update.local_if = req.local_if;
   alias_update.ua_expire = ua_expires + now.tv_sec;
@@ -14,11 +14,15 @@
 #include <unordered_map>
 #include <memory>
 #include <set>
+#include <list>
+#include <vector>
 using std::string;
 using std::map;
 using std::unordered_map;
 using std::unique_ptr;
 using std::set;
+using std::list;
+using std::vector;
 
 #define REG_CACHE_TABLE_POWER   10
 #define REG_CACHE_TABLE_ENTRIES (1<<REG_CACHE_TABLE_POWER)
@@ -33,6 +37,19 @@ using std::set;
  *  - alias         <--1-to-1--> contact
  */
 
+class AorEntry;
+struct RegBinding;
+
+/**
+ * Reference to a binding in the expiry wheel;
+ * the hash table nodes do not move until they are erased.
+ */
+struct RegExpiryRef
+{
+  std::pair<const string, AorEntry>*   aor;
+  std::pair<const string, RegBinding>* binding;
+};
+
 struct RegBinding
 {
 private:
@@ -41,64 +58,42 @@ private:
   // registrar side
   long int reg_expire;
 
+  // position in the expiry wheel (see AorHash),
+  // valid only if 'indexed'
+  bool                         indexed;
+  unsigned int                 wheel_slot;
+  list<RegExpiryRef>::iterator wheel_it;
+
 public:
   // unique-id used as contact user toward the registrar
   string alias;
 
   RegBinding()
-    : reg_expire(0)
+    : reg_expire(0), indexed(false), wheel_slot(0)
   {}
 
+  // copies are not part of the expiry wheel
+  RegBinding(const RegBinding& b)
+    : reg_expire(b.reg_expire), indexed(false), wheel_slot(0),
+      alias(b.alias)
+  {}
+
+  RegBinding& operator=(const RegBinding& b) {
+    reg_expire = b.reg_expire;
+    alias = b.alias;
+    return *this;
+  }
+
   long int get_expire() const {
     return reg_expire;
   }
 
-  friend class AorEntry;
-};
-
-template<> struct std::less<unordered_map<string, RegBinding>::iterator>
-{
-  bool operator()(const unordered_map<string, RegBinding>::iterator& a,
-      const unordered_map<string, RegBinding>::iterator& b) const
-  {
-    if (a->second.get_expire() < b->second.get_expire())
-      return true;
-    if (a->second.get_expire() > b->second.get_expire())
-      return false;
-    // for identical expire values we compare the pointer values of the original object
-    return &a->second < &b->second;
-  }
+  friend class AorHash;
 };
 
 // Contact-URI/Public-IP -> RegBinding
 class AorEntry : public unordered_map<string, RegBinding>
 {
-  // members protected by AorEntry::lock
-
-  set<iterator> bindings_by_time;
-
-  void set_expire(const iterator& it, long int expire) {
-    if (it->second.reg_expire == expire)
-      return;
-    bindings_by_time.erase(it);
-    it->second.reg_expire = expire;
-    bindings_by_time.insert(it);
-  }
-
-  void erase(const iterator& it) {
-    bindings_by_time.erase(it);
-    unordered_map<string, RegBinding>::erase(it);
-  }
-
-  friend class AorHash;
-
-public:
-  long int get_lowest_expire() const {
-    auto it = bindings_by_time.cbegin();
-    if (it == bindings_by_time.cend())
-      return LONG_MAX; // empty sets go last
-    return (*it)->second.reg_expire;
-  }
 };
 
 struct AliasEntry
@@ -183,52 +178,47 @@ public:
   void dump_elmt(const string& alias, const AliasEntry& ae) const;
 };
 
-template<> struct std::less<unordered_map<string, AorEntry>::iterator>
-{
-  bool operator()(const unordered_map<string, AorEntry>::iterator& a,
-      const unordered_map<string, AorEntry>::iterator& b) const
-  {
-    auto lowest_a = a->second.get_lowest_expire();
-    auto lowest_b = b->second.get_lowest_expire();
-    if (lowest_a < lowest_b)
-      return true;
-    if (lowest_a > lowest_b)
-      return false;
-    // for identical set we compare the pointer values of the original object
-    return &a->second < &b->second;
-  }
-};
+#define REG_CACHE_WHEEL_BITS  12
+#define REG_CACHE_WHEEL_SLOTS (1<<REG_CACHE_WHEEL_BITS) /* seconds */
 
 /**
  * AoR hash table:
  *   AoR -> AorEntry
+ *
+ * The bindings are also indexed by expiration time in a timing wheel
+ * with one slot per second: the collector only visits the slots of
+ * the seconds elapsed since its last run. Bindings expiring more than
+ * one turn of the wheel ahead stay in their slot until their turn.
  */
 class AorHash
   : public unordered_hash_map<string, AorEntry>
 {
-  set<iterator> entries_by_time;
+  vector<list<RegExpiryRef> > wheel;
+
+  // next second to be collected
+  long int wheel_pos;
+
+  void wheel_insert(std::pair<const string, AorEntry>& aor,
+		    AorEntry::value_type& binding);
+  void wheel_remove(RegBinding& binding);
 
 public:
-  void set_expire(const iterator& aor_it, const AorEntry::iterator& binding_it, long int expire) {
-    entries_by_time.erase(aor_it);
-    aor_it->second.set_expire(binding_it, expire);
-    entries_by_time.insert(aor_it);
-  }
+  AorHash();
 
-  void erase_binding(const iterator& aor_it, const AorEntry::iterator& binding_it) {
-    entries_by_time.erase(aor_it);
-    aor_it->second.erase(binding_it);
-    entries_by_time.insert(aor_it);
-  }
+  void set_expire(const iterator& aor_it, const AorEntry::iterator& binding_it, long int expire);
 
-  void erase(const iterator& aor_it) {
-    entries_by_time.erase(aor_it);
-    unordered_hash_map<string, AorEntry>::erase(aor_it);
-  }
+  void erase_binding(const iterator& aor_it, const AorEntry::iterator& binding_it);
+
+  void erase(const iterator& aor_it);
 
   /* Maintenance stuff */
 
-  void gbc(long int now, list<string>& alias_list);
+  /**
+   * Remove the bindings expired at 'now' (at most 'max' of them)
+   * and collect their aliases.
+   * Returns false if some expired bindings are left.
+   */
+  bool gbc(long int now, list<string>& alias_list, size_t max);
   void dump_elmt(const string& aor, const AorEntry& p_aor_entry) const;
 };
 
@@ -292,6 +282,24 @@ class RegisterCache
   // stats
   atomic_int active_regs;
 
+  struct GbcStats
+  {
+    unsigned long runs;
+    unsigned long expired;      // total number of bindings expired
+    unsigned int  last_expired; // ... during the last run
+    long          last_us;      // duration of the last run
+    long          max_us;
+    long          max_lock_us;  // longest locking of the cache
+
+    GbcStats()
+      : runs(0), expired(0), last_expired(0),
+	last_us(0), max_us(0), max_lock_us(0)
+    {}
+  };
+
+  AmMutex  gbc_stats_mut;
+  GbcStats gbc_stats;
+
   void gbc();
   void removeAlias(const string& alias, bool generate_event);
 
@@ -299,6 +307,13 @@ class RegisterCache
   std::condition_variable sleep_cond;
   bool shutdown_flag;
 
+  // snapshot (warm restart)
+  string       snapshot_file;
+  unsigned int snapshot_interval;
+  long int     last_snapshot;
+
+  size_t serialize(string& buf);
+
 protected:
   RegisterCache();
   ~RegisterCache();
@@ -327,6 +342,32 @@ public:
 
   void setStorageHandler(RegCacheStorageHandler* h) { storage_handler.reset(h); }
 
+  /**
+   * Enable the snapshot of the cache into 'file':
+   * written every 'interval' seconds (0: never) and on shutdown.
+   */
+  void setSnapshot(const string& file, unsigned int interval);
+
+  /**
+   * Write all bindings into 'file' (replaced atomically).
+   *
+   * Note: the bindings are copied into memory a few hash buckets
+   *       at a time, locking the cache for each chunk only;
+   *       the file is written afterwards.
+   *
+   * Returns the number of bindings written or -1 on error.
+   */
+  long saveSnapshot(const string& file);
+
+  /**
+   * Load the bindings saved by saveSnapshot() into the cache;
+   * the bindings already expired at the registrar side are skipped,
+   * as well as those already present in the cache.
+   *
+   * Returns the number of bindings loaded or -1 on error.
+   */
+  long loadSnapshot(const string& file);
+
   /**
    * Match, retrieve the contact cache entry associated with the URI passed,
    * and return the alias found in the cache entry.
@@ -431,6 +472,11 @@ public:
    * Statistics
    */
   unsigned int getActiveRegs() { return active_regs; }
+
+  /**
+   * Active registrations and garbage collector statistics
+   */
+  void getStats(AmArg& ret);
 };
 
 #endif
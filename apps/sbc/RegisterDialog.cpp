@@ -109,7 +109,7 @@ void RegisterDialog::fillAliasMap()
 int RegisterDialog::fixUacContacts(const AmSipRequest& req)
 {
   // move Expires as separate header to contact parameter
-  string expires = getHeader(req.hdrs, "Expires");
+  string expires = req.getHeader("Expires");
   unsigned int requested_expires=0;
   if (!expires.empty()) {
 
@@ -374,7 +374,7 @@ int RegisterDialog::initUAC(const AmSipRequest& req, const SBCCallProfile& cp)
     source_ip = req.remote_ip;
     source_port = req.remote_port;
     local_if = req.local_if;
-    from_ua = getHeader(req.hdrs,"User-Agent");
+    from_ua = req.getHeader("User-Agent");
     transport = req.trsp;
 
     min_reg_expire = cp.min_reg_expires;
@@ -434,7 +434,7 @@ void RegisterDialog::onSipReply(const AmSipRequest& req,
   }
 
   // unsigned int req_expires = 0;
-  // string expires_str = getHeader(req.hdrs, "Expires");
+  // string expires_str = req.getHeader("Expires");
   // if (!expires_str.empty()) {
   //   str2int(expires_str, req_expires);
   // }
@@ -567,8 +567,8 @@ int RegisterDialog::onTxReply(const AmSipRequest& req, AmSipReply& reply,
 
   if(reply.code >= 200 && reply.code < 300) {
     flags |= SIP_FLAGS_NOCONTACT;
-    removeHeader(reply.hdrs, SIP_HDR_EXPIRES);
-    removeHeader(reply.hdrs, SIP_HDR_MIN_EXPIRES);
+    reply.removeHeader(SIP_HDR_EXPIRES);
+    reply.removeHeader(SIP_HDR_MIN_EXPIRES);
   }
 
   return AmBasicSipDialog::onTxReply(req,reply,flags);
@@ -589,7 +589,7 @@ int RegisterDialog::onTxRequest(AmSipRequest& req, int& flags)
     }
 
     DBG("generated new contact: '%s'\n", contact.c_str());
-    removeHeader(req.hdrs, SIP_HDR_EXPIRES);
+    req.removeHeader(SIP_HDR_EXPIRES);
     req.hdrs += SIP_HDR_COLSP(SIP_HDR_CONTACT) + contact + CRLF;
   }
   else if(star_contact) {
@@ -246,6 +246,17 @@ int SBCFactory::onLoad()
 
   subnot_processor.addThreads(cfg.getParameterInt("out_of_dialog_threads",
                                                   DEFAULT_OOD_THREADS));
+  string regcache_snapshot = cfg.getParameter("regcache_snapshot");
+  if (!regcache_snapshot.empty()) {
+    RegisterCache* reg_cache = RegisterCache::instance();
+    if (reg_cache->loadSnapshot(regcache_snapshot) < 0) {
+      WARN("could not restore the register cache from '%s'\n",
+	   regcache_snapshot.c_str());
+    }
+    reg_cache->setSnapshot(regcache_snapshot,
+			   cfg.getParameterInt("regcache_snapshot_interval",
+					       DEFAULT_REGCACHE_SNAPSHOT_INTERVAL));
+  }
   RegisterCache::instance()->start();
 
   return 0;
@@ -296,7 +307,7 @@ AmSession* SBCFactory::onInvite(const AmSipRequest& req, const string& app_name,
 				const map<string,string>& app_params)
 {
   ParamReplacerCtx ctx;
-  ctx.app_param = getHeader(req.hdrs, PARAM_HDR, true);
+  ctx.app_param = req.getHeader(PARAM_HDR, true);
 
   profiles_mut.lock();
   const SBCCallProfile* p_call_profile = getActiveProfileMatch(req, ctx);
@@ -367,7 +378,7 @@ void SBCFactory::onOoDRequest(const AmSipRequest& req)
   profiles_mut.lock();
 
   ParamReplacerCtx ctx;
-  ctx.app_param = getHeader(req.hdrs, PARAM_HDR, true);
+  ctx.app_param = req.getHeader(PARAM_HDR, true);
 
   string profile_rule;
   const SBCCallProfile* p_call_profile = getActiveProfileMatch(req, ctx);
@@ -480,8 +491,11 @@ void SBCFactory::invoke(const string& method, const AmArg& args,
     ret.push(AmArg("loadCallcontrolModules"));
     ret.push(AmArg("postControlCmd"));
     ret.push(AmArg("printCallStats"));
+    ret.push(AmArg("getRegCacheStats"));
   } else if(method == "printCallStats"){ 
     B2BMediaStatistics::instance()->getReport(args, ret);
+  } else if(method == "getRegCacheStats"){
+    RegisterCache::instance()->getStats(ret);
   }  else
     throw AmDynInvoke::NotImplemented(method);
 }
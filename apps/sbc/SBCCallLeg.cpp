@@ -266,6 +266,8 @@ void SBCCallLeg::applyAProfile(const AmSipRequest &req)
   // apply A leg configuration (but most of the configuration is applied in
   // SBCFactory::onInvite)
 
+  setSdpVerbatim(call_profile.sdp_verbatim);
+
   if (call_profile.rtprelay_enabled_value || call_profile.transcoder.isActive()) {
     ILOG_DLG(L_DBG, "Enabling RTP relay mode for SBC call\n");
 
@@ -404,6 +406,8 @@ void SBCCallLeg::applyBProfile()
   //   dlg->contact_uri = SIP_HDR_COLSP(SIP_HDR_CONTACT) + call_profile.contact + CRLF;
   // }
 
+  setSdpVerbatim(call_profile.sdp_verbatim);
+
   if (call_profile.auth_enabled) {
     // adding auth handler
     AmSessionEventHandlerFactory* uac_auth_f =
@@ -536,12 +540,12 @@ int SBCCallLeg::relayEvent(AmEvent* ev)
           if (call_profile.headerfilter.size()) {
             //B2BSipRequestEvent* req_ev = dynamic_cast<B2BSipRequestEvent*>(ev);
             // header filter
-            inplaceHeaderFilter(req_ev->req.hdrs, call_profile.headerfilter);
+            inplaceHeaderFilter(req_ev->req.hdrs.modify(), call_profile.headerfilter);
           }
 
           if (req_ev->req.method == SIP_METH_REFER && call_profile.fix_replaces_ref == "yes")
           {
-            fixReplaces(req_ev->req.hdrs, false);
+            fixReplaces(req_ev->req.hdrs.modify(), false);
           }
 
           ILOG_DLG(L_DBG, "filtering body for request '%s' (c/t '%s')\n",
@@ -564,7 +568,7 @@ int SBCCallLeg::relayEvent(AmEvent* ev)
           }
 
           if ((a_leg && call_profile.keep_vias) || (!a_leg && call_profile.bleg_keep_vias)) {
-             req_ev->req.hdrs = req_ev->req.vias + req_ev->req.hdrs;
+             req_ev->req.hdrs = req_ev->req.getVias() + req_ev->req.hdrs;
           }
         }
         break;
@@ -584,7 +588,7 @@ int SBCCallLeg::relayEvent(AmEvent* ev)
               call_profile.reply_translations.size()) {
             // header filter
             if (call_profile.headerfilter.size()) {
-              inplaceHeaderFilter(reply_ev->reply.hdrs, call_profile.headerfilter);
+              inplaceHeaderFilter(reply_ev->reply.hdrs.modify(), call_profile.headerfilter);
             }
 
             // reply translations
@@ -811,7 +815,7 @@ void SBCCallLeg::onSendRequest(AmSipRequest& req, int &flags) {
     if (!sessionTimerSupportedByLeg(call_profile, a_leg)) {
       ILOG_DLG(L_DBG, "SST isn't supported by '%c' leg, remove according headers and option tags.\n",
               a_leg ? 'A' : 'B');
-      removeSessionTimerHeaders(req.hdrs);
+      removeSessionTimerHeaders(req.hdrs.modify());
     }
   }
   else {
@@ -831,7 +835,7 @@ void SBCCallLeg::onSendReply(const AmSipRequest& req, AmSipReply& reply, int &fl
     if (!sessionTimerSupportedByLeg(call_profile, a_leg)) {
       ILOG_DLG(L_DBG, "SST isn't supported by '%c' leg, remove according headers and option tags.\n",
               a_leg ? 'A' : 'B');
-      removeSessionTimerHeaders(reply.hdrs);
+      removeSessionTimerHeaders(reply.hdrs.modify());
     }
   }
   else {
@@ -1023,7 +1027,7 @@ void SBCCallLeg::onInvite(const AmSipRequest& req)
   ILOG_DLG(L_DBG, "processing initial INVITE %s\n", req.r_uri.c_str());
 
   ParamReplacerCtx ctx(&call_profile);
-  ctx.app_param = getHeader(req.hdrs, PARAM_HDR, true);
+  ctx.app_param = req.getHeader(PARAM_HDR, true);
 
   // process call control
   if (call_profile.cc_interfaces.size()) {
@@ -1126,18 +1130,18 @@ void SBCCallLeg::onInvite(const AmSipRequest& req)
   AmSipRequest invite_req(req);
   est_invite_cseq = req.cseq;
 
-  removeHeader(invite_req.hdrs,PARAM_HDR);
-  removeHeader(invite_req.hdrs,"P-App-Name");
+  invite_req.removeHeader(PARAM_HDR);
+  invite_req.removeHeader("P-App-Name");
 
   if (call_profile.sst_enabled_value) {
-    removeHeader(invite_req.hdrs,SIP_HDR_SESSION_EXPIRES);
-    removeHeader(invite_req.hdrs,SIP_HDR_MIN_SE);
+    invite_req.removeHeader(SIP_HDR_SESSION_EXPIRES);
+    invite_req.removeHeader(SIP_HDR_MIN_SE);
   }
 
-  inplaceHeaderFilter(invite_req.hdrs, call_profile.headerfilter);
+  inplaceHeaderFilter(invite_req.hdrs.modify(), call_profile.headerfilter);
 
   if (call_profile.fix_replaces_inv == "yes") {
-    fixReplaces(invite_req.hdrs, true);
+    fixReplaces(invite_req.hdrs.modify(), true);
   }
 
   if (call_profile.append_headers.size() > 2) {
@@ -1171,7 +1175,7 @@ void SBCCallLeg::onInvite(const AmSipRequest& req)
   CallLeg::onInvite(req);
 
   if(a_leg && call_profile.keep_vias)
-    invite_req.hdrs = invite_req.vias + invite_req.hdrs;
+    invite_req.hdrs = invite_req.getVias() + invite_req.hdrs;
 
   subs->allowUnsolicitedNotify(call_profile.allow_subless_notify);
 
@@ -1623,7 +1627,7 @@ void SBCCallLeg::logCallStart(const AmSipReply& reply)
 {
   std::map<int,AmSipRequest>::iterator t_req = recvd_req.find(reply.cseq);
   if (t_req != recvd_req.end()) {
-    string b_leg_ua = getHeader(reply.hdrs,"Server");
+    string b_leg_ua = reply.getHeader("Server");
     SBCEventLog::instance()->logCallStart(t_req->second,getLocalTag(),
 					  dlg->getRemoteUA(),b_leg_ua,
 					  (int)reply.code,reply.reason);
@@ -1678,7 +1682,7 @@ int SBCCallLeg::filterSdp(AmMimeBody &body, const string &method)
   }
 
   AmSdp sdp;
-  if (!sdp.parse(sdp_body->getPayload()))
+  if (!sdp.parse(sdp_body->getPayload(), call_profile.sdp_verbatim))
   {
     ILOG_DLG(L_DBG, "SDP parsing failed during body filtering!\n");
     return -1; /* just interpret false as -1, to show there is any kind of error */
@@ -2198,6 +2202,7 @@ void SBCCallLeg::copyGlobalSettings(const SBCCallProfile& callee_profile)
   call_profile.headerfilter    = callee_profile.headerfilter;
   call_profile.messagefilter   = callee_profile.messagefilter;
   call_profile.anonymize_sdp   = callee_profile.anonymize_sdp;
+  call_profile.sdp_verbatim    = callee_profile.sdp_verbatim;
   call_profile.sdpfilter       = callee_profile.sdpfilter;
   call_profile.sdpalinesfilter = callee_profile.sdpalinesfilter;
   call_profile.mediafilter     = callee_profile.mediafilter;
@@ -197,6 +197,7 @@ bool SBCCallProfile::readFromConfiguration(const string& name,
     return false;
 
   anonymize_sdp = cfg.getParameter("sdp_anonymize", "no") == "yes";
+  sdp_verbatim = cfg.getParameter("sdp_verbatim", "no") == "yes";
 
   // SDP alines filter
   if (!readFilter(cfg, "sdp_alines_filter", "sdp_alinesfilter_list", 
@@ -492,6 +493,8 @@ bool SBCCallProfile::readFromConfiguration(const string& name,
     INFO("SBC:      SDP filter is %sabled, %s, %zd items in list, %sanonymizing SDP\n",
 	 sdpfilter.size()?"en":"dis", filter_type.c_str(), filter_elems,
 	 anonymize_sdp?"":"not ");
+    if (sdp_verbatim)
+      INFO("SBC:      unchanged SDP sections are relayed verbatim\n");
 
     if (have_aleg_sdpfilter) {
       filter_type = aleg_sdpfilter.size() ?
@@ -831,7 +834,7 @@ bool SBCCallProfile::evaluate(ParamReplacerCtx& ctx,
     // enable symmetric RTP by P-MsgFlags?
     // SBC need not to know if it is from P-MsgFlags or from profile parameter
     if (msgflags_symmetric_rtp) {
-      string str_msg_flags = getHeader(req.hdrs,"P-MsgFlags", true);
+      string str_msg_flags = req.getHeader("P-MsgFlags", true);
       unsigned int msg_flags = 0;
       if(!reverse_hex2int(str_msg_flags,msg_flags)){
         ERROR("while parsing 'P-MsgFlags' header\n");
@@ -136,6 +136,7 @@ struct SBCCallProfile
   vector<FilterEntry> messagefilter;
 
   bool anonymize_sdp;
+  bool sdp_verbatim;
   vector<FilterEntry> sdpfilter;
   vector<FilterEntry> aleg_sdpfilter;
   bool have_aleg_sdpfilter;
@@ -353,6 +354,7 @@ struct SBCCallProfile
     next_hop_fixed(false),
     allow_subless_notify(false),
     anonymize_sdp(false),
+    sdp_verbatim(false),
     have_aleg_sdpfilter(false),
     sst_transparent(false),
     sst_enabled_value(false),
@@ -89,9 +89,9 @@ int SimpleRelayDialog::relayRequest(const AmSipRequest& req)
   if(!append_headers.empty()) hdrs += append_headers;
 
   if(keep_vias)
-    hdrs = req.vias + hdrs;
+    hdrs = req.getVias() + hdrs;
 
-  if(sendRequest(req.method,&req.body,hdrs,SIP_FLAGS_VERBATIM)) {
+  if(sendRequest(req.method,&req.body,hdrs,SIP_FLAGS_VERBATIM,req.parsed)) {
 
     AmSipReply error;
     error.code = 500;
@@ -144,7 +144,7 @@ int SimpleRelayDialog::relayReply(const AmSipReply& reply)
   }
 
   if(this->reply(*uas_req,code,reason,&reply.body,
-		 hdrs,SIP_FLAGS_VERBATIM)) {
+		 hdrs,SIP_FLAGS_VERBATIM,reply.parsed)) {
     //TODO: what can we do???
     return -1;
   }
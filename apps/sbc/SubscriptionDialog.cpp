@@ -106,7 +106,7 @@ void SubscriptionDialog::onSipRequest(const AmSipRequest& req)
 
   if(req.method == SIP_METH_NOTIFY) {
 
-    string event = getHeader(req.hdrs,SIP_HDR_EVENT,true);
+    string event = req.getHeader(SIP_HDR_EVENT,true);
     string id = get_header_param(event,"id");
     event = strip_header_params(event);
 
@@ -119,7 +119,7 @@ void SubscriptionDialog::onSipRequest(const AmSipRequest& req)
 	if(getMappedReferID(id_int,mapped_id)) {
 
 	  AmSipRequest n_req(req);
-	  removeHeader(n_req.hdrs,SIP_HDR_EVENT);
+	  n_req.removeHeader(SIP_HDR_EVENT);
 	  n_req.hdrs += SIP_HDR_COLSP(SIP_HDR_EVENT) "refer;id=" 
 	    + int2str(mapped_id) + CRLF;
 
@@ -31,3 +31,5 @@ sdpfilter_list=g729,g723,ilbc,speex,gsm,amr
 # anonymize SDP or not (u, s, o lines)
 #
 #sdp_anonymize=yes
+# relay unchanged session/media descriptions as received
+#sdp_verbatim=yes
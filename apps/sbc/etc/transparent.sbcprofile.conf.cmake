@@ -52,6 +52,8 @@
 # Lines to be filtered, separated by ","
 #sdp_alinesfilter_list=crypto,x-cap
 #sdp_anonymize=yes
+# relay unchanged session/media descriptions as received
+#sdp_verbatim=yes
 
 ## append extra headers
 #append_headers="P-Source-IP: $si\r\nP-Source-Port: $sp\r\n"
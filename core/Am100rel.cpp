@@ -24,9 +24,9 @@ int  Am100rel::onRequestIn(const AmSipRequest& req)
   if (req.method == SIP_METH_INVITE) {
     switch(reliable_1xx) {
       case REL100_SUPPORTED: /* if support is on, enforce if asked by UAC */
-        if (key_in_list(getHeader(req.hdrs, SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
+        if (key_in_list(req.getHeader(SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
               SIP_EXT_100REL) ||
-            key_in_list(getHeader(req.hdrs, SIP_HDR_REQUIRE), 
+            key_in_list(req.getHeader(SIP_HDR_REQUIRE), 
               SIP_EXT_100REL)) {
           reliable_1xx = REL100_REQUIRE;
           DBG(SIP_EXT_100REL " now active.\n");
@@ -34,9 +34,9 @@ int  Am100rel::onRequestIn(const AmSipRequest& req)
         break;
 
       case REL100_REQUIRE: /* if support is required, reject if UAC doesn't */
-        if (! (key_in_list(getHeader(req.hdrs,SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
+        if (! (key_in_list(req.getHeader(SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
               SIP_EXT_100REL) ||
-            key_in_list(getHeader(req.hdrs, SIP_HDR_REQUIRE), 
+            key_in_list(req.getHeader(SIP_HDR_REQUIRE), 
               SIP_EXT_100REL))) {
           ERROR("'" SIP_EXT_100REL "' extension required, but not advertised"
             " by peer.\n");
@@ -50,7 +50,7 @@ int  Am100rel::onRequestIn(const AmSipRequest& req)
 
       case REL100_DISABLED:
         // TODO: shouldn't this be part of a more general check in SEMS?
-        if (key_in_list(getHeader(req.hdrs,SIP_HDR_REQUIRE),SIP_EXT_100REL)) {
+        if (key_in_list(req.getHeader(SIP_HDR_REQUIRE),SIP_EXT_100REL)) {
           AmBasicSipDialog::reply_error(req, 420, SIP_REPLY_BAD_EXTENSION,
 					SIP_HDR_COLSP(SIP_HDR_UNSUPPORTED) 
 					SIP_EXT_100REL CRLF);
@@ -96,7 +96,7 @@ int  Am100rel::onReplyIn(const AmSipReply& reply)
   if (100<reply.code && reply.code<200 && reply.cseq_method==SIP_METH_INVITE) {
     switch (reliable_1xx) {
     case REL100_SUPPORTED:
-      if (key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), 
+      if (key_in_list(reply.getHeader(SIP_HDR_REQUIRE), 
           SIP_EXT_100REL))
         reliable_1xx = REL100_REQUIRE;
         // no break!
@@ -104,7 +104,7 @@ int  Am100rel::onReplyIn(const AmSipReply& reply)
         break;
 
     case REL100_REQUIRE:
-      if (!key_in_list(getHeader(reply.hdrs,SIP_HDR_REQUIRE),SIP_EXT_100REL) ||
+      if (!key_in_list(reply.getHeader(SIP_HDR_REQUIRE),SIP_EXT_100REL) ||
           !reply.rseq) {
         ERROR(SIP_EXT_100REL " not supported or no positive RSeq value in "
             "(reliable) 1xx.\n");
@@ -151,11 +151,11 @@ void Am100rel::onRequestOut(AmSipRequest& req)
 
   switch(reliable_1xx) {
     case REL100_SUPPORTED:
-      if (! key_in_list(getHeader(req.hdrs, SIP_HDR_REQUIRE), SIP_EXT_100REL))
+      if (! key_in_list(req.getHeader(SIP_HDR_REQUIRE), SIP_EXT_100REL))
         req.hdrs += SIP_HDR_COLSP(SIP_HDR_SUPPORTED) SIP_EXT_100REL CRLF;
       break;
     case REL100_REQUIRE:
-      if (! key_in_list(getHeader(req.hdrs, SIP_HDR_REQUIRE), SIP_EXT_100REL))
+      if (! key_in_list(req.getHeader(SIP_HDR_REQUIRE), SIP_EXT_100REL))
         req.hdrs += SIP_HDR_COLSP(SIP_HDR_REQUIRE) SIP_EXT_100REL CRLF;
       break;
     default:
@@ -175,17 +175,17 @@ void Am100rel::onReplyOut(AmSipReply& reply)
     if (100 < reply.code && reply.code < 200) {
       switch (reliable_1xx) {
         case REL100_SUPPORTED:
-          if (! key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), 
+          if (! key_in_list(reply.getHeader(SIP_HDR_REQUIRE), 
 			    SIP_EXT_100REL))
             reply.hdrs += SIP_HDR_COLSP(SIP_HDR_SUPPORTED) SIP_EXT_100REL CRLF;
           break;
         case REL100_REQUIRE:
           // add Require HF
-          if (! key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), 
+          if (! key_in_list(reply.getHeader(SIP_HDR_REQUIRE), 
 			    SIP_EXT_100REL))
             reply.hdrs += SIP_HDR_COLSP(SIP_HDR_REQUIRE) SIP_EXT_100REL CRLF;
           // add RSeq HF
-          if (getHeader(reply.hdrs, SIP_HDR_RSEQ).length())
+          if (reply.getHeader(SIP_HDR_RSEQ).length())
             // already added (by app?)
             break;
           if (! rseq) { // only init rseq if 1xx is used
@@ -231,7 +231,7 @@ bool Am100rel::willBeReliable(const AmSipReply& reply)
 {
   if ((reply.cseq_method == SIP_METH_INVITE)
       && (100 < reply.code && reply.code < 200)
-      && (key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), SIP_EXT_100REL)
+      && (key_in_list(reply.getHeader(SIP_HDR_REQUIRE), SIP_EXT_100REL)
           || (reliable_1xx == REL100_REQUIRE))) {
     return true;
   }
@@ -392,7 +392,8 @@ class AmArg
 
   void clear();
 
-  friend bool json2arg(std::istream& input, AmArg& res);
+  /** builds the values in place */
+  friend class JsonArgReader;
 
   static string print(const AmArg &a);
 };
@@ -78,6 +78,10 @@ using std::string;
 struct SdpPayload;
 struct CodecContainer;
 struct Payload;
+class AmAudioRtpFormat;
+
+/** returned by AmAudio::getEncoded() if the audio has only samples */
+#define AM_AUDIO_NOT_ENCODED -100
 
 /** \brief Audio Event */
 class AmAudioEvent: public AmEvent
@@ -366,6 +370,15 @@ public:
    */
   virtual int put(unsigned long long system_ts, unsigned char* buffer, 
 		  int input_sample_rate, unsigned int size);
+
+  /**
+   * Get the next frame already encoded in the RTP payload format
+   * rtp_fmt, instead of samples for the RTP stream to encode.
+   * @return # bytes of payload, AM_AUDIO_NOT_ENCODED if get() has
+   *         to be used, else < 0 like get() (error, end of audio)
+   */
+  virtual int getEncoded(unsigned long long system_ts, AmAudioRtpFormat* rtp_fmt,
+			 unsigned char* buffer) { return AM_AUDIO_NOT_ENCODED; }
   
   int  getSampleRate();
 
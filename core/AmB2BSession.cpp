@@ -103,6 +103,7 @@ AmB2BSession::AmB2BSession(const string& other_local_tag, AmSipDialog* p_dlg,
     enable_dtmf_rtp_filtering(false),
     enable_dtmf_rtp_detection(false),
     rtp_relay_transparent_seqno(true), rtp_relay_transparent_ssrc(true),
+    sdp_verbatim(false),
     est_invite_cseq(0),est_invite_other_cseq(0),
     media_session(NULL),
     terminate_rtp(false),
@@ -675,14 +676,14 @@ void AmB2BSession::onSipRequest(const AmSipRequest& req)
    * whitelist profile silently drops the header before the other leg's
    * onB2BEvent() could read it */
   if (req.method == SIP_METH_INVITE)
-    r_ev->skip_491 = (getHeader(req.hdrs, SIP_HDR_P_FORCE_491, true) == "0");
+    r_ev->skip_491 = (req.getHeader(SIP_HDR_P_FORCE_491, true) == "0");
 
   if (fwd) {
     ILOG_DLG(L_DBG, "relaying B2B SIP request (fwd) %s %s\n", r_ev->req.method.c_str(), r_ev->req.r_uri.c_str());
 
     if(r_ev->req.method == SIP_METH_NOTIFY) {
 
-      string event = getHeader(r_ev->req.hdrs,SIP_HDR_EVENT,true);
+      string event = r_ev->req.getHeader(SIP_HDR_EVENT,true);
       string id = get_header_param(event,"id");
       event = strip_header_params(event);
 
@@ -694,7 +695,7 @@ void AmB2BSession::onSipRequest(const AmSipRequest& req)
 	  unsigned int mapped_id=0;
 	  if(getMappedReferID(id_int,mapped_id)) {
 
-	    removeHeader(r_ev->req.hdrs,SIP_HDR_EVENT);
+	    r_ev->req.removeHeader(SIP_HDR_EVENT);
 	    r_ev->req.hdrs += SIP_HDR_COLSP(SIP_HDR_EVENT) "refer;id=" 
 	      + int2str(mapped_id) + CRLF;
 	  }
@@ -838,7 +839,7 @@ void AmB2BSession::updateLocalBody(AmMimeBody& body)
   if (!sdp) return;
 
   AmSdp parser_sdp;
-  if (!parser_sdp.parse(sdp->getPayload())) {
+  if (!parser_sdp.parse(sdp->getPayload(), sdp_verbatim)) {
     ILOG_DLG(L_DBG, "SDP parsing failed!\n");
     return; // FIXME: throw an exception here?
   }
@@ -1273,7 +1274,7 @@ int AmB2BSession::relaySip(const AmSipRequest& req)
   if (req.method != "ACK") {
     relayed_req[dlg->cseq] = req;
 
-    const string* hdrs = &req.hdrs;
+    const string* hdrs = &req.hdrs.str();
     string m_hdrs;
 
     /* translate RAck for PRACK */
@@ -1303,7 +1304,8 @@ int AmB2BSession::relaySip(const AmSipRequest& req)
 
     ILOG_DLG(L_DBG, "relaying SIP request %s %s\n", req.method.c_str(), req.r_uri.c_str());
 
-    int err = dlg->sendRequest(req.method, &body, *hdrs, SIP_FLAGS_VERBATIM);
+    int err = dlg->sendRequest(req.method, &body, *hdrs, SIP_FLAGS_VERBATIM,
+			       req.parsed);
 
     if(err < 0){
       ILOG_DLG(L_ERR, "dlg->sendRequest() failed\n");
@@ -1357,7 +1359,7 @@ int AmB2BSession::relaySip(const AmSipRequest& req)
 
 int AmB2BSession::relaySip(const AmSipRequest& orig, const AmSipReply& reply)
 {
-  const string* hdrs = &reply.hdrs;
+  const string* hdrs = &reply.hdrs.str();
   string m_hdrs;
   const string method(orig.method);
 
@@ -1383,7 +1385,7 @@ int AmB2BSession::relaySip(const AmSipRequest& orig, const AmSipReply& reply)
     flags |= SIP_FLAGS_NOTAG;
 
   int err = dlg->reply(orig,reply.code,reply.reason,
-		       &body, *hdrs, flags);
+		       &body, *hdrs, flags, reply.parsed);
 
   if(err < 0){
     ILOG_DLG(L_ERR, "dlg->reply() failed\n");
@@ -359,6 +359,8 @@ private:
   bool rtp_relay_transparent_seqno;
   /** transparent SSRC for RTP relay */
   bool rtp_relay_transparent_ssrc;
+  /** re-emit unchanged SDP sections as received */
+  bool sdp_verbatim;
   /** If true, transcoded audio is injected into 
       the inband DTMF detector */
   bool enable_dtmf_transcoding;
@@ -429,6 +431,7 @@ private:
   virtual void setRtpRelayForceSymmetricRtp(bool force_symmetric);
   void setRtpRelayTransparentSeqno(bool transparent);
   void setRtpRelayTransparentSSRC(bool transparent);
+  void setSdpVerbatim(bool verbatim) { sdp_verbatim = verbatim; }
 
   void setEnableDtmfTranscoding(bool enable);
   void setEnableDtmfRtpFiltering(bool enable);
@@ -355,7 +355,7 @@ void AmBasicSipDialog::onRxRequest(const AmSipRequest& req)
       }
     }
 
-    string ua = getHeader(req.hdrs, SIP_HDR_USER_AGENT);
+    string ua = req.getHeader(SIP_HDR_USER_AGENT);
     setRemoteUA(ua);
   }
 
@@ -517,7 +517,7 @@ void AmBasicSipDialog::updateDialogTarget(const AmSipReply& reply)
       setNextHop(nh);
     }
 
-    string ua = getHeader(reply.hdrs,"Server");
+    string ua = reply.getHeader("Server");
     setRemoteUA(ua);
   }
 }
@@ -599,7 +599,8 @@ int AmBasicSipDialog::reply(const AmSipRequest& req,
 			    const string& reason,
 			    const AmMimeBody* body,
 			    const string& hdrs,
-			    int flags)
+			    int flags,
+			    const std::shared_ptr<const AmSipParsedMsg>& parsed)
 {
   TransMap::const_iterator t_it = uas_trans.find(req.cseq);
 
@@ -624,11 +625,12 @@ int AmBasicSipDialog::reply(const AmSipRequest& req,
      reply.to_tag = ext_local_tag.empty() ? local_tag : ext_local_tag;
   }
   reply.hdrs = hdrs;
+  reply.parsed = parsed;
   reply.cseq = req.cseq;
   reply.cseq_method = req.method;
 
    /* Add Allow header in 200OK with default Allow, if it is empty */
-  if (reply.code == 200 && getHeader(reply.hdrs, SIP_HDR_ALLOW).empty()) {
+  if (reply.code == 200 && reply.getHeader(SIP_HDR_ALLOW).empty()) {
     /* Add default Allow list, supporting all major methods */
     reply.hdrs += SIP_HDR_ALLOW_FULL CRLF;
   }
@@ -702,7 +704,8 @@ int AmBasicSipDialog::reply_error(const AmSipRequest& req, unsigned int code,
 int AmBasicSipDialog::sendRequest(const string& method, 
 				  const AmMimeBody* body,
 				  const string& hdrs,
-				  int flags)
+				  int flags,
+				  const std::shared_ptr<const AmSipParsedMsg>& parsed)
 {
   AmSipRequest req;
 
@@ -730,6 +733,7 @@ int AmBasicSipDialog::sendRequest(const string& method,
   req.cseq = cseq;
   req.callid = callid;
   req.hdrs = hdrs;
+  req.parsed = parsed;
   req.route = getRoute();
 
   if (body != NULL) {
@@ -377,19 +377,27 @@ public:
    */
   void updateDialogTarget(const AmSipReply& reply);
 
-  /** @return 0 on success */
+  /**
+   * @param parsed received reply hdrs has been taken from (if relayed)
+   * @return 0 on success
+   */
   virtual int reply(const AmSipRequest& req,
 		    unsigned int  code, 
 		    const string& reason,
 		    const AmMimeBody* body = NULL,
 		    const string& hdrs = "",
-		    int flags = 0);
+		    int flags = 0,
+		    const std::shared_ptr<const AmSipParsedMsg>& parsed = nullptr);
 
-  /** @return 0 on success */
+  /**
+   * @param parsed received request hdrs has been taken from (if relayed)
+   * @return 0 on success
+   */
   virtual int sendRequest(const string& method, 
 			  const AmMimeBody* body = NULL,
 			  const string& hdrs = "",
-			  int flags = 0);
+			  int flags = 0,
+			  const std::shared_ptr<const AmSipParsedMsg>& parsed = nullptr);
 
   /**
    * Terminates pending UAS/UAC transactions
@@ -24,6 +24,7 @@
  */
 
 #include "AmCachedAudioFile.h"
+#include "AmEncodedPromptCache.h"
 #include "AmUtils.h"
 #include "log.h"
 #include "AmPlugIn.h"
@@ -40,7 +41,8 @@ using std::string;
 
 AmFileCache::AmFileCache() 
   : data(NULL), 
-    data_size(0)
+    data_size(0),
+    mtime(0)
 { }
 
 AmFileCache::~AmFileCache() {
@@ -78,6 +80,7 @@ int AmFileCache::load(const std::string& filename) {
   }
 
   data_size = sbuf.st_size;
+  mtime = sbuf.st_mtime;
   close(fd);
 
   return 0;
@@ -101,17 +104,10 @@ int AmFileCache::read(void* buf,
   return r_size;
 }
 
-inline size_t AmFileCache::getSize() {
-  return data_size;
-}
-
-inline const string& AmFileCache::getFilename() {
-  return name;
-}
-
 
 AmCachedAudioFile::AmCachedAudioFile(AmFileCache* cache) 
-  : cache(cache), loop(false), fpos(0), begin(0), good(false)
+  : cache(cache), loop(false), fpos(0), begin(0), good(false),
+    encoded_fmt(NULL), encoded_codec(NULL), encoded_frame_size(0), encoded_pos(0)
 {
   if (!cache) {
     ERROR("Need open file cache.\n");
@@ -180,6 +176,7 @@ AmAudioFileFormat* AmCachedAudioFile::fileName2Fmt(const string& name)
 
 void AmCachedAudioFile::rewind() {
   fpos = begin;
+  encoded_pos = 0;
 }
 
 /** Closes the file. */
@@ -216,6 +213,55 @@ int AmCachedAudioFile::read(unsigned int user_ts, unsigned int size) {
   return (fpos==cache->getSize() && !loop ? -2 : ret);
 }
 
+int AmCachedAudioFile::getEncoded(unsigned long long system_ts,
+				  AmAudioRtpFormat* rtp_fmt, unsigned char* buffer)
+{
+  if (!good || !AmEncodedPromptCache::enabled())
+    return AM_AUDIO_NOT_ENCODED;
+
+  if ((rtp_fmt != encoded_fmt) || (rtp_fmt->getCodec() != encoded_codec) ||
+      (rtp_fmt->getFrameSize() != encoded_frame_size)) {
+    // (new) payload format: go on at the same time in the file
+    unsigned long long played_ms = 0;
+    bool was_encoded = encoded.get() != NULL;
+    if (was_encoded)
+      played_ms = (unsigned long long)encoded_pos * encoded->getFrameSize() * 1000
+	/ encoded->getRate();
+    bool decoding = !was_encoded && (fpos != begin);
+
+    encoded_fmt = rtp_fmt;
+    encoded_codec = rtp_fmt->getCodec();
+    encoded_frame_size = rtp_fmt->getFrameSize();
+    // once playing the samples, stay with them
+    encoded = decoding ? NULL : AmEncodedPromptCache::instance()->get(cache, rtp_fmt);
+    if (encoded.get()) {
+      encoded_pos = played_ms * encoded->getRate() / 1000 / encoded->getFrameSize();
+    } else if (was_encoded) {
+      // not cached in the new format: go on with the samples from there
+      size_t bytes = fmt->calcBytesToRead(played_ms * fmt->getRate() / 1000);
+      fpos = begin + bytes;
+      if (fpos > cache->getSize())
+	fpos = cache->getSize();
+    }
+  }
+
+  if (!encoded.get())
+    return AM_AUDIO_NOT_ENCODED;
+
+  int size = encoded->getFrame(encoded_pos, buffer);
+  if (!size && loop) {
+    DBG("rewinding encoded audio file...\n");
+    rewind();
+    size = encoded->getFrame(encoded_pos, buffer);
+  }
+
+  if (size <= 0)
+    return -2; // end of file, like read()
+
+  encoded_pos++;
+  return size;
+}
+
 int AmCachedAudioFile::write(unsigned int user_ts, unsigned int size) {
   ERROR("AmCachedAudioFile writing not supported!\n");
   return -1;
@@ -28,8 +28,11 @@
 
 #include "AmAudioFile.h"
 
+#include <memory>
 #include <string>
 
+class AmEncodedPrompt;
+
 /**
  * \brief memory cache for AmAudioFile 
  * 
@@ -40,6 +43,7 @@ class AmFileCache
 {
   void* data;
   size_t data_size;
+  time_t mtime;
   std::string name;
 
  public:
@@ -51,11 +55,13 @@ class AmFileCache
    */
   int load(const std::string& filename);
   /** get the size of the file */
-  size_t getSize();
+  size_t getSize() { return data_size; }
+  /** get the modification time of the file when loaded */
+  time_t getMTime() { return mtime; }
   /** read size bytes from pos into buf */
   int read(void* buf, size_t* pos, size_t size);
   /** get the filename */
-  const string& getFilename();
+  const string& getFilename() { return name; }
   /** get a pointer to the file's data - use with caution! */
   void* getData() { return data; }
 };
@@ -88,6 +94,15 @@ class AmCachedAudioFile
   /** Format of that file. @see fp, open(). */
   amci_inoutfmt_t* iofmt;
 
+  /** the file encoded in the RTP format of getEncoded() */
+  std::shared_ptr<AmEncodedPrompt> encoded;
+  /** the RTP format it has been looked up for */
+  AmAudioRtpFormat* encoded_fmt;
+  amci_codec_t* encoded_codec;
+  unsigned int encoded_frame_size;
+  /** next frame to send */
+  unsigned int encoded_pos;
+
  public:
   AmCachedAudioFile(AmFileCache* cache);
   ~AmCachedAudioFile();
@@ -95,6 +110,10 @@ class AmCachedAudioFile
   /** loop the file? */
   atomic_bool loop;
 
+  /** @see AmAudio::getEncoded, uses the AmEncodedPromptCache */
+  int getEncoded(unsigned long long system_ts, AmAudioRtpFormat* rtp_fmt,
+		 unsigned char* buffer);
+
   /**
    * Rewind the file.
    */
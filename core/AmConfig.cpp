@@ -41,6 +41,7 @@
 #include "AmConfigReader.h"
 #include "AmUtils.h"
 #include "AmSessionContainer.h"
+#include "AmRtpReceiver.h"
 #include "Am100rel.h"
 #include "sip/transport.h"
 #include "sip/resolver.h"
@@ -61,6 +62,8 @@ string       AmConfig::ExcludePlugins          = "";
 string       AmConfig::ExcludePayloads         = "";
 int          AmConfig::LogLevel                = L_INFO;
 bool         AmConfig::LogStderr               = false;
+bool         AmConfig::LogAsync                = false;
+unsigned int AmConfig::LogRingSize             = LOG_RING_SIZE;
 
 vector<AmConfig::SIP_interface> AmConfig::SIP_Ifs;
 vector<AmConfig::RTP_interface> AmConfig::RTP_Ifs;
@@ -80,7 +83,9 @@ string       AmConfig::DaemonGid               = DEFAULT_DAEMON_GID;
 unsigned int AmConfig::MaxShutdownTime         = DEFAULT_MAX_SHUTDOWN_TIME;
 
 int          AmConfig::SessionProcessorThreads = NUM_SESSION_PROCESSORS;
+unsigned int AmConfig::SessionProcessorStealThreshold = 0;
 int          AmConfig::MediaProcessorThreads   = NUM_MEDIA_PROCESSORS;
+unsigned int AmConfig::MediaProcessorRebalance = 0;
 int          AmConfig::RTPReceiverThreads      = NUM_RTP_RECEIVERS;
 int          AmConfig::SIPServerThreads        = NUM_SIP_SERVERS;
 string       AmConfig::OutboundProxy           = "";
@@ -99,11 +104,18 @@ bool	     AmConfig::SingleCodecInOK	       = false;
 unsigned int AmConfig::DeadRtpTime             = DEAD_RTP_TIME;
 unsigned int AmConfig::RtpKeepaliveFreq        = 0;
 bool         AmConfig::IgnoreRTPXHdrs          = false;
+unsigned int AmConfig::RtpPacketPoolMax        = 0;
+unsigned int AmConfig::RtpPacketPoolSpill      = RTP_PACKET_POOL_SPILL;
+unsigned int AmConfig::RtpReceiveBatch         = 1;
+bool         AmConfig::RtpSendBatch            = false;
+unsigned int AmConfig::RtcpReportInterval      = 0;
+unsigned int AmConfig::EncodedPromptCacheSize  = 0;
 string       AmConfig::Application             = "";
 AmConfig::ApplicationSelector AmConfig::AppSelect        = AmConfig::App_SPECIFIED;
 RegexMappingVector AmConfig::AppMapping;
 bool         AmConfig::LogSessions             = false;
 bool         AmConfig::LogEvents               = false;
+bool         AmConfig::LockFreeSessionQueues   = false;
 int          AmConfig::UnhandledReplyLoglevel  = 0;
 
 bool         AmConfig::SkipGenerateDirectionBoth = false;
@@ -359,6 +371,19 @@ int AmConfig::readConfiguration()
   }
 #endif
 
+  if(cfg.hasParameter("log_async")){
+    LogAsync = (cfg.getParameter("log_async") == "yes");
+  }
+
+  if(cfg.hasParameter("log_ring_size")){
+    if(str2int(cfg.getParameter("log_ring_size"), LogRingSize) ||
+       LogRingSize < LOG_RING_MIN_SIZE) {
+      ERROR("invalid log_ring_size specified (min. %u bytes)\n",
+	    LOG_RING_MIN_SIZE);
+      ret = -1;
+    }
+  }
+
   // plugin_config_path
   if (cfg.hasParameter("plugin_config_path")) {
     ModConfigPath = cfg.getParameter("plugin_config_path",ModConfigPath);
@@ -419,6 +444,37 @@ int AmConfig::readConfiguration()
   if(cfg.hasParameter("disable_dns_srv")) {
     resolver::disable_srv = (cfg.getParameter("disable_dns_srv") == "yes");
   }
+
+  if(cfg.hasParameter("dns_servers")) {
+    resolver::dns_servers = cfg.getParameter("dns_servers");
+  }
+
+  if(cfg.hasParameter("dns_timeout")) {
+    if(str2int(cfg.getParameter("dns_timeout"), resolver::dns_timeout) ||
+       !resolver::dns_timeout) {
+      ERROR("invalid dns_timeout specified\n");
+      ret = -1;
+    }
+  }
+
+  if(cfg.hasParameter("dns_attempts")) {
+    if(str2int(cfg.getParameter("dns_attempts"), resolver::dns_attempts) ||
+       !resolver::dns_attempts) {
+      ERROR("invalid dns_attempts specified\n");
+      ret = -1;
+    }
+  }
+
+  if(cfg.hasParameter("dns_serve_stale")) {
+    if(str2int(cfg.getParameter("dns_serve_stale"), resolver::dns_serve_stale)) {
+      ERROR("invalid dns_serve_stale specified\n");
+      ret = -1;
+    }
+  }
+
+  if(cfg.hasParameter("dns_prefetch")) {
+    resolver::dns_prefetch = (cfg.getParameter("dns_prefetch") == "yes");
+  }
   
 
   for (int t = STIMER_A; t < __STIMER_MAX; t++) {
@@ -494,6 +550,17 @@ int AmConfig::readConfiguration()
   if(cfg.hasParameter("log_events"))
     LogEvents = cfg.getParameter("log_events")=="yes";
 
+  if(cfg.hasParameter("session_event_queue")) {
+    string q_type = cfg.getParameter("session_event_queue");
+    if (q_type == "lockfree") LockFreeSessionQueues = true;
+    else if (q_type == "locked") LockFreeSessionQueues = false;
+    else {
+      ERROR("invalid session_event_queue value specified"
+	    " (valid: locked, lockfree)\n");
+      ret = -1;
+    }
+  }
+
   if (cfg.hasParameter("unhandled_reply_loglevel")) {
     string msglog = cfg.getParameter("unhandled_reply_loglevel");
     if (msglog == "no") UnhandledReplyLoglevel = -1;
@@ -578,6 +645,9 @@ int AmConfig::readConfiguration()
 #endif
   }
 
+  SessionProcessorStealThreshold =
+    cfg.getParameterInt("session_processor_steal_threshold", 0);
+
   if(cfg.hasParameter("media_processor_threads")){
     if(!setMediaProcessorThreads(cfg.getParameter("media_processor_threads"))){
       ERROR("invalid media_processor_threads value specified");
@@ -585,6 +655,8 @@ int AmConfig::readConfiguration()
     }
   }
 
+  MediaProcessorRebalance = cfg.getParameterInt("media_processor_rebalance", 0);
+
   if(cfg.hasParameter("rtp_receiver_threads")){
     if(!setRTPReceiverThreads(cfg.getParameter("rtp_receiver_threads"))){
       ERROR("invalid rtp_receiver_threads value specified");
@@ -609,6 +681,34 @@ int AmConfig::readConfiguration()
     IgnoreRTPXHdrs = (cfg.getParameter("ignore_rtpxheaders") == "yes");
   }
 
+  if(cfg.hasParameter("rtp_receive_batch")){
+    int batch = cfg.getParameterInt("rtp_receive_batch", 1);
+    if((batch < 1) || (batch > RTP_RECV_BATCH_MAX)) {
+      ERROR("invalid rtp_receive_batch value specified"
+	    " (valid: 1..%d)\n", RTP_RECV_BATCH_MAX);
+      ret = -1;
+    }
+    else {
+      RtpReceiveBatch = batch;
+    }
+  }
+
+  if(cfg.hasParameter("rtp_send_batch")){
+    RtpSendBatch = (cfg.getParameter("rtp_send_batch") == "yes");
+  }
+
+  RtpPacketPoolMax = cfg.getParameterInt("rtp_packet_pool_max", 0);
+  RtpPacketPoolSpill = cfg.getParameterInt("rtp_packet_pool_spill",
+					   RTP_PACKET_POOL_SPILL);
+
+  EncodedPromptCacheSize = cfg.getParameterInt("encoded_prompt_cache_size", 0);
+
+  RtcpReportInterval = cfg.getParameterInt("rtcp_report_interval", 0);
+  if(RtcpReportInterval && RtcpReportInterval < 100) {
+    ERROR("invalid rtcp_report_interval value specified (min. 100 ms)\n");
+    ret = -1;
+  }
+
   // codec_order
   CodecOrder = explode(cfg.getParameter("codec_order"), ",");
 
@@ -65,6 +65,10 @@ struct AmConfig
   static int LogLevel;
   /** log to stderr */
   static bool LogStderr;
+  /** hand log messages to a writer thread instead of the logging hooks */
+  static bool LogAsync;
+  /** size of the per-thread log ring buffers in bytes (async logging) */
+  static unsigned int LogRingSize;
 
 #ifndef DISABLE_DAEMON_MODE
   /** run the program in daemon mode? */
@@ -172,8 +176,12 @@ struct AmConfig
 
   /** number of session (signaling/application) processor threads */
   static int SessionProcessorThreads;
+  /** sessions waiting for a session processor thread before idle threads take some over, 0 for never */
+  static unsigned int SessionProcessorStealThreshold;
   /** number of media processor threads */
   static int MediaProcessorThreads;
+  /** interval for rebalancing callgroups between media processor threads in ms, 0 for none */
+  static unsigned int MediaProcessorRebalance;
   /** number of RTP receiver threads */
   static int RTPReceiverThreads;
   /** number of SIP server threads */
@@ -273,6 +281,24 @@ struct AmConfig
   /** Ignore RTP Extension headers? */
   static bool IgnoreRTPXHdrs;
 
+  /** max. number of packets in the RTP packet pool, 0 for no limit */
+  static unsigned int RtpPacketPoolMax;
+
+  /** max. number of free packets per size class kept by the RTP packet pool */
+  static unsigned int RtpPacketPoolSpill;
+
+  /** max. number of datagrams read per RTP socket wakeup (recvmmsg), 1 = recvfrom */
+  static unsigned int RtpReceiveBatch;
+
+  /** send the RTP packets of a media processor tick in batches (sendmmsg) */
+  static bool RtpSendBatch;
+
+  /** max. size of the AmEncodedPromptCache in kB, 0 to disable it */
+  static unsigned int EncodedPromptCacheSize;
+
+  /** mean interval between RTCP sender/receiver reports in ms, 0 for none */
+  static unsigned int RtcpReportInterval;
+
   static Dtmf::InbandDetectorType DefaultDTMFDetector;
 
   static bool IgnoreSIGCHLD;
@@ -283,6 +309,9 @@ struct AmConfig
 
   static bool LogEvents;
 
+  /** use lock-free (MPSC) event queues for sessions */
+  static bool LockFreeSessionQueues;
+
   static int UnhandledReplyLoglevel;
 
   static AmAudio::ResamplingImplementationType ResamplingImplementationType;
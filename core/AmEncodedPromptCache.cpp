@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "AmEncodedPromptCache.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <string.h>
+
+/** seconds before a prompt which could not be encoded is tried again */
+#define ENCODE_RETRY_TIME 10
+/** max. number of prompts remembered as not encodable */
+#define MAX_FAILED_PROMPTS 1024
+
+AmEncodedPrompt::AmEncodedPrompt(unsigned int rate, unsigned int frame_size,
+				 std::shared_ptr<std::atomic<size_t> > total)
+  : complete(false), bytes(0), total(total), rate(rate), frame_size(frame_size)
+{
+  offsets.push_back(0);
+}
+
+AmEncodedPrompt::~AmEncodedPrompt()
+{
+  setSize(0);
+}
+
+void AmEncodedPrompt::setSize(size_t new_bytes)
+{
+  size_t old_bytes = bytes.exchange(new_bytes, std::memory_order_relaxed);
+  // wraps around for shrinking
+  total->fetch_add(new_bytes - old_bytes, std::memory_order_relaxed);
+}
+
+int AmEncodedPrompt::init(const string& filename, int codec_id,
+			  unsigned int ts_rate, const string& sdp_format_parameters)
+{
+  // an own copy of the file, the caller's may go away while encoding
+  file.reset(new AmFileCache());
+  if (file->load(filename))
+    return -1;
+
+  source.reset(new AmCachedAudioFile(file.get()));
+  if (!source->is_good())
+    return -1;
+
+  Payload pl;
+  pl.pt = 0;
+  pl.clock_rate = rate;
+  pl.advertised_clock_rate = ts_rate;
+  pl.codec_id = codec_id;
+  pl.sdp_format_parameters = sdp_format_parameters;
+
+  enc_fmt.reset(new AmAudioRtpFormat());
+  enc_fmt->setCurrentPayload(pl);
+  if (!enc_fmt->getCodec() || (enc_fmt->getHCodec() == -1)) {
+    ERROR("could not initialize codec %d for encoding '%s'\n",
+	  codec_id, filename.c_str());
+    return -1;
+  }
+
+  if (enc_fmt->getFrameSize() != frame_size) {
+    ERROR("codec %d encodes %u samples per frame, stream sends %u\n",
+	  codec_id, enc_fmt->getFrameSize(), frame_size);
+    return -1;
+  }
+
+  return 0;
+}
+
+bool AmEncodedPrompt::encodeFrame()
+{
+  unsigned int frame_bytes = PCM16_S2B(frame_size);
+  unsigned char buf[AUDIO_BUFFER_SIZE];
+
+  // the same samples the call would get from the file
+  while (pcm.size() < frame_bytes) {
+    int got = source->get(0, buf, rate, frame_size);
+    if (got <= 0)
+      break;
+    pcm.insert(pcm.end(), buf, buf + got);
+  }
+
+  if (pcm.empty())
+    return false;
+
+  // last frame: fill up with silence
+  if (pcm.size() < frame_bytes)
+    pcm.resize(frame_bytes, 0);
+
+  amci_codec_t* codec = enc_fmt->getCodec();
+  const unsigned char* frame = pcm.data();
+  int s = frame_bytes;
+
+  if (codec->encode) {
+    s = (*codec->encode)(buf, pcm.data(), frame_bytes, enc_fmt->channels,
+			 rate, enc_fmt->getHCodec());
+    if (s < 0) {
+      ERROR("encoding '%s' failed: %d\n", file->getFilename().c_str(), s);
+      return false;
+    }
+    frame = buf;
+  }
+
+  data.insert(data.end(), frame, frame + s);
+  offsets.push_back(data.size());
+  setSize(data.capacity() + offsets.capacity() * sizeof(size_t));
+
+  pcm.erase(pcm.begin(), pcm.begin() + frame_bytes);
+  return true;
+}
+
+void AmEncodedPrompt::finish()
+{
+  DBG("'%s' encoded: %zu frames, %zu bytes\n", file->getFilename().c_str(),
+      offsets.size() - 1, data.size());
+
+  enc_fmt.reset();
+  source.reset();
+  file.reset();
+  pcm.clear();
+  pcm.shrink_to_fit();
+
+  data.shrink_to_fit();
+  offsets.shrink_to_fit();
+  setSize(data.capacity() + offsets.capacity() * sizeof(size_t));
+
+  complete.store(true, std::memory_order_release);
+}
+
+int AmEncodedPrompt::copyFrame(unsigned int n, unsigned char* buffer)
+{
+  if (n + 1 >= offsets.size())
+    return 0;
+
+  size_t len = offsets[n + 1] - offsets[n];
+  memcpy(buffer, &data[offsets[n]], len);
+  return len;
+}
+
+int AmEncodedPrompt::getFrame(unsigned int n, unsigned char* buffer)
+{
+  if (!complete.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> l(mut);
+
+    // the first one to get here encodes the frame
+    while (!complete.load(std::memory_order_relaxed) && (n + 1 >= offsets.size())) {
+      if (!encodeFrame())
+	finish();
+    }
+    return copyFrame(n, buffer);
+  }
+
+  return copyFrame(n, buffer);
+}
+
+AmEncodedPromptCache* AmEncodedPromptCache::_instance = NULL;
+
+AmEncodedPromptCache::AmEncodedPromptCache()
+  : total(std::make_shared<std::atomic<size_t> >(0)),
+    hits(0), misses(0), rejected(0), failures(0)
+{
+}
+
+AmEncodedPromptCache* AmEncodedPromptCache::instance()
+{
+  return _instance ? _instance : ((_instance = new AmEncodedPromptCache()));
+}
+
+void AmEncodedPromptCache::dispose()
+{
+  if (_instance != NULL) {
+    delete _instance;
+    _instance = NULL;
+  }
+}
+
+std::shared_ptr<AmEncodedPrompt>
+AmEncodedPromptCache::get(AmFileCache* file, AmAudioRtpFormat* rtp_fmt)
+{
+  amci_codec_t* codec = rtp_fmt->getCodec();
+  if (!enabled() || !codec)
+    return NULL;
+
+  string key = file->getFilename() + "|" +
+    int2str((unsigned long int)file->getSize()) + "|" +
+    int2str((long int)file->getMTime()) + "|" + int2str(codec->id) + "|" +
+    int2str(rtp_fmt->getRate()) + "|" + int2str(rtp_fmt->getFrameSize()) + "|" +
+    rtp_fmt->sdp_format_parameters;
+
+  std::shared_ptr<AmEncodedPrompt> prompt;
+  {
+    std::lock_guard<std::mutex> l(prompts_mut);
+
+    auto it = prompts.find(key);
+    if (it != prompts.end()) {
+      if (!it->second.ready)
+	return NULL; // still being set up by another call, encode this time
+      hits.fetch_add(1, std::memory_order_relaxed);
+      return it->second.prompt;
+    }
+
+    auto f_it = failed.find(key);
+    if (f_it != failed.end()) {
+      if (time(NULL) < f_it->second) {
+	failures.fetch_add(1, std::memory_order_relaxed);
+	return NULL;
+      }
+      failed.erase(f_it);
+    }
+
+    if (total->load(std::memory_order_relaxed) >=
+	(size_t)AmConfig::EncodedPromptCacheSize * 1024) {
+      rejected.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    prompt = std::make_shared<AmEncodedPrompt>(rtp_fmt->getRate(),
+					       rtp_fmt->getFrameSize(), total);
+    prompts[key] = Entry{prompt, false};
+  }
+
+  // loading the file and setting up the codec take a while
+  DBG("encoding '%s' for codec %d, %u Hz, %u samples per frame\n",
+      file->getFilename().c_str(), codec->id, rtp_fmt->getRate(),
+      rtp_fmt->getFrameSize());
+  bool ok = !prompt->init(file->getFilename(), codec->id, rtp_fmt->getTSRate(),
+			  rtp_fmt->sdp_format_parameters);
+
+  std::lock_guard<std::mutex> l(prompts_mut);
+  auto it = prompts.find(key);
+  // cleared meanwhile: nothing to do
+  bool ours = (it != prompts.end()) && (it->second.prompt == prompt);
+
+  if (!ok) {
+    // don't try again for every call
+    failures.fetch_add(1, std::memory_order_relaxed);
+    if (ours) {
+      prompts.erase(it);
+      if (failed.size() >= MAX_FAILED_PROMPTS)
+	failed.clear();
+      failed[key] = time(NULL) + ENCODE_RETRY_TIME;
+    }
+    return NULL;
+  }
+
+  if (ours)
+    it->second.ready = true;
+  return prompt;
+}
+
+size_t AmEncodedPromptCache::size()
+{
+  std::lock_guard<std::mutex> l(prompts_mut);
+  return total->load(std::memory_order_relaxed);
+}
+
+void AmEncodedPromptCache::getStats(AmArg& ret)
+{
+  ret["hits"] = (long long int)hits.load();
+  ret["misses"] = (long long int)misses.load();
+  ret["rejected"] = (long long int)rejected.load();
+  ret["failures"] = (long long int)failures.load();
+
+  std::lock_guard<std::mutex> l(prompts_mut);
+  ret["prompts"] = (int)prompts.size();
+  ret["size"] = (long long int)total->load(std::memory_order_relaxed);
+}
+
+void AmEncodedPromptCache::clear()
+{
+  std::lock_guard<std::mutex> l(prompts_mut);
+  prompts.clear();
+  failed.clear();
+  // the prompts still played account for the old total
+  total = std::make_shared<std::atomic<size_t> >(0);
+}
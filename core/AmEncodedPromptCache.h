@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmEncodedPromptCache.h */
+#ifndef _AmEncodedPromptCache_h_
+#define _AmEncodedPromptCache_h_
+
+#include "AmArg.h"
+#include "AmCachedAudioFile.h"
+#include "AmConfig.h"
+#include "AmRtpAudio.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+using std::string;
+
+/**
+ * \brief a prompt file encoded in one RTP payload format
+ *
+ * The frames are encoded when the first listener gets to them, i.e.
+ * the prompt is encoded once, at the pace it is played the first
+ * time; everybody else gets the frames from memory.
+ */
+class AmEncodedPrompt
+{
+  std::mutex mut;
+
+  /** frame i is data[offsets[i] .. offsets[i+1]) */
+  std::vector<unsigned char> data;
+  std::vector<size_t> offsets;
+  /** set once all frames are there; frames are read without lock then */
+  std::atomic<bool> complete;
+  std::atomic<size_t> bytes;
+  /** running total of the cache the prompt has been created for */
+  std::shared_ptr<std::atomic<size_t> > total;
+
+  /** the encoder, until complete */
+  unique_ptr<AmFileCache> file;
+  unique_ptr<AmCachedAudioFile> source;
+  unique_ptr<AmAudioRtpFormat> enc_fmt;
+  /** PCM16 at the codec's rate, not yet encoded */
+  std::vector<unsigned char> pcm;
+
+  unsigned int rate;
+  unsigned int frame_size;
+
+  /** encode the next frame, @return false at the end of the file */
+  bool encodeFrame();
+  void finish();
+  /** update bytes and the total */
+  void setSize(size_t new_bytes);
+  int copyFrame(unsigned int n, unsigned char* buffer);
+
+ public:
+  AmEncodedPrompt(unsigned int rate, unsigned int frame_size,
+		  std::shared_ptr<std::atomic<size_t> > total);
+  ~AmEncodedPrompt();
+
+  /** set up the encoder, @return 0 on success */
+  int init(const string& filename, int codec_id, unsigned int ts_rate,
+	   const string& sdp_format_parameters);
+
+  /**
+   * copy frame n into buffer (AUDIO_BUFFER_SIZE)
+   * @return payload size, 0 after the last frame, < 0 on error
+   */
+  int getFrame(unsigned int n, unsigned char* buffer);
+
+  unsigned int getRate() const { return rate; }
+  unsigned int getFrameSize() const { return frame_size; }
+
+  /** memory used by the encoded frames */
+  size_t size() const { return bytes.load(std::memory_order_relaxed); }
+};
+
+/**
+ * \brief process-wide cache of prompts encoded in RTP payload formats
+ *
+ * Keyed by file (name, size and modification time) and payload format
+ * (codec, rate, frame size, format parameters), so that every call
+ * playing a cached prompt (see AmCachedAudioFile, AmPromptCollection)
+ * in the same format sends the same, once encoded frames.
+ *
+ * Enabled with encoded_prompt_cache_size (sems.conf); when the cache
+ * is full, prompts in new formats are encoded per call as usual.
+ */
+class AmEncodedPromptCache
+{
+  static AmEncodedPromptCache* _instance;
+
+  struct Entry {
+    std::shared_ptr<AmEncodedPrompt> prompt;
+    /** false while the prompt is set up (outside of prompts_mut) */
+    bool ready;
+  };
+
+  std::mutex prompts_mut;
+  std::map<string, Entry> prompts;
+  /** memory used by the prompts, replaced by clear() */
+  std::shared_ptr<std::atomic<size_t> > total;
+  /** prompts which could not be encoded: when to try again */
+  std::map<string, time_t> failed;
+
+  std::atomic<unsigned long long> hits;
+  std::atomic<unsigned long long> misses;
+  std::atomic<unsigned long long> rejected;
+  std::atomic<unsigned long long> failures;
+
+  AmEncodedPromptCache();
+
+ public:
+  /** created at startup, before the calls get to it */
+  static AmEncodedPromptCache* instance();
+  static void dispose();
+
+  static bool enabled() { return AmConfig::EncodedPromptCacheSize > 0; }
+
+  /**
+   * @return the prompt of file in the format of rtp_fmt, encoding
+   *         it if needed; NULL if not cached (disabled, full, error)
+   */
+  std::shared_ptr<AmEncodedPrompt> get(AmFileCache* file,
+				       AmAudioRtpFormat* rtp_fmt);
+
+  /** memory used by all prompts */
+  size_t size();
+
+  /** hits, misses, rejected, failures, prompts, size */
+  void getStats(AmArg& ret);
+
+  /** drop all prompts (they stay with the calls playing them) */
+  void clear();
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
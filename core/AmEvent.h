@@ -46,6 +46,9 @@ struct AmEvent
   int event_id;
   bool processed;
 
+  /** intrusive link, used by lock-free event queues */
+  AmEvent* queue_next;
+
   AmEvent(int event_id);
   AmEvent(const AmEvent& rhs);
 
@@ -30,19 +30,24 @@
 #include "AmConfig.h"
 #include "sip/hash.h"
 
-unsigned int AmEventDispatcher::hash(const string& s1)
+uint32_t AmEventDispatcher::hash(const string& s)
 {
-  return hashlittle(s1.c_str(),s1.length(),0) & (EVENT_DISPATCHER_BUCKETS-1);
+  return hashlittle(s.c_str(),s.length(),0);
 }
 
-unsigned int AmEventDispatcher::hash(const string& s1, const string s2)
+string AmEventDispatcher::make_id(const string& callid,
+				  const string& remote_tag,
+				  const string& via_branch)
 {
-  unsigned int h=0;
-
-  h = hashlittle(s1.c_str(),s1.length(),h);
-  h = hashlittle(s2.c_str(),s2.length(),h);
-
-  return h & (EVENT_DISPATCHER_BUCKETS-1);
+  string id;
+  id.reserve(callid.length() + remote_tag.length() +
+	     (AmConfig::AcceptForkedDialogs ? via_branch.length() : 0));
+  id = callid;
+  id += remote_tag;
+  if (AmConfig::AcceptForkedDialogs) {
+    id += via_branch;
+  }
+  return id;
 }
 
 AmEventDispatcher* AmEventDispatcher::_instance=NULL;
@@ -55,16 +60,12 @@ AmEventDispatcher* AmEventDispatcher::instance()
 bool AmEventDispatcher::addEventQueue(const string& local_tag,
                                       AmEventQueueInterface* q)
 {
-  unsigned int queue_bucket = hash(local_tag);
+  uint32_t tag_hash = hash(local_tag);
+  unsigned int queue_bucket = bucket(tag_hash);
 
-  lock_guard<AmMutex> lock(queues_mut[queue_bucket]);
+  std::unique_lock<std::shared_mutex> lock(queues_mut[queue_bucket]);
 
-  if (queues[queue_bucket].find(local_tag) != queues[queue_bucket].end()) {
-    return false;
-  }
-
-  queues[queue_bucket][local_tag] = QueueEntry(q);
-  return true;
+  return queues[queue_bucket].insert(local_tag, tag_hash, QueueEntry(q));
 }
 
 /** @return false on error */
@@ -79,29 +80,27 @@ bool AmEventDispatcher::addEventQueue(const string& local_tag,
     return false;
   }
 
-  unsigned int queue_bucket = hash(local_tag);
+  uint32_t tag_hash = hash(local_tag);
+  unsigned int queue_bucket = bucket(tag_hash);
 
-  lock_guard<AmMutex> lock(queues_mut[queue_bucket]);
+  std::unique_lock<std::shared_mutex> lock(queues_mut[queue_bucket]);
 
-  if (queues[queue_bucket].find(local_tag) != queues[queue_bucket].end()) {
+  if (queues[queue_bucket].find(local_tag, tag_hash)) {
     return false;
   }
 
   // try to find via id_lookup
-  string id = callid+remote_tag;
-  if(AmConfig::AcceptForkedDialogs){
-    id += via_branch;
-  }
-  unsigned int id_bucket = hash(id);
+  string id = make_id(callid, remote_tag, via_branch);
+  uint32_t id_hash = hash(id);
+  unsigned int id_bucket = bucket(id_hash);
 
-  lock_guard<AmMutex> lock_l(id_lookup_mut[id_bucket]);
+  std::unique_lock<std::shared_mutex> lock_l(id_lookup_mut[id_bucket]);
 
-  if (id_lookup[id_bucket].find(id) != id_lookup[id_bucket].end()) {
+  if (!id_lookup[id_bucket].insert(id, id_hash, IdEntry(local_tag, tag_hash))) {
     return false;
   }
 
-  queues[queue_bucket][local_tag] = QueueEntry(q,id);
-  id_lookup[id_bucket][id] = local_tag;
+  queues[queue_bucket].insert(local_tag, tag_hash, QueueEntry(q,id));
 
   return true;
 }
@@ -118,65 +117,60 @@ AmEventQueueInterface* AmEventDispatcher::getEventQueue(const string& local_tag)
     return NULL;
   }
 
-  AmEventQueueInterface* sess = NULL;
-  unsigned int queue_bucket = hash(local_tag);
-
-  EvQueueMapIter qi = queues[queue_bucket].find(local_tag);
+  uint32_t tag_hash = hash(local_tag);
 
-  if (qi != queues[queue_bucket].end()) {
-    QueueEntry& qe = qi->second;
-
-    if (!qe.id.empty())
-      return qe.q;
-  }
+  QueueEntry* qe = queues[bucket(tag_hash)].find(local_tag, tag_hash);
+  if (qe && !qe->id.empty())
+    return qe->q;
 
   return NULL;
 }
 
 AmEventQueueInterface* AmEventDispatcher::delEventQueue(const string& local_tag)
 {
-  AmEventQueueInterface* q = NULL;
-  unsigned int queue_bucket = hash(local_tag);
-
-  lock_guard<AmMutex> lock(queues_mut[queue_bucket]);
+  uint32_t tag_hash = hash(local_tag);
+  unsigned int queue_bucket = bucket(tag_hash);
 
-  EvQueueMapIter qi = queues[queue_bucket].find(local_tag);
-  if (qi != queues[queue_bucket].end()) {
+  std::unique_lock<std::shared_mutex> lock(queues_mut[queue_bucket]);
 
-    QueueEntry qe(qi->second);
-    queues[queue_bucket].erase(qi);
-    q = qe.q;
-    
-    if (!qe.id.empty()) {
-      unsigned int id_bucket = hash(qe.id);
+  QueueEntry qe;
+  if (!queues[queue_bucket].erase(local_tag, tag_hash, &qe))
+    return NULL;
 
-      lock_guard<AmMutex> lock_l(id_lookup_mut[id_bucket]);
+  if (!qe.id.empty()) {
+    uint32_t id_hash = hash(qe.id);
+    unsigned int id_bucket = bucket(id_hash);
 
-      DictIter di = id_lookup[id_bucket].find(qe.id);
-      if (di != id_lookup[id_bucket].end()) {
-        id_lookup[id_bucket].erase(di);
-      }
-    }
+    std::unique_lock<std::shared_mutex> lock_l(id_lookup_mut[id_bucket]);
+    id_lookup[id_bucket].erase(qe.id, id_hash);
   }
 
-  return q;
+  return qe.q;
 }
 
-bool AmEventDispatcher::post(const string& local_tag, AmEvent* ev)
+/*
+ * Posting only takes the bucket lock shared: concurrent posts do not
+ * serialize, while delEventQueue() still waits for posts in progress
+ * before the queue may be destroyed.
+ */
+bool AmEventDispatcher::post(const string& local_tag, uint32_t tag_hash,
+			     AmEvent* ev)
 {
-  bool posted = false;
+  unsigned int queue_bucket = bucket(tag_hash);
 
-  unsigned int queue_bucket = hash(local_tag);
+  std::shared_lock<std::shared_mutex> lock(queues_mut[queue_bucket]);
 
-  lock_guard<AmMutex> lock(queues_mut[queue_bucket]);
+  QueueEntry* qe = queues[queue_bucket].find(local_tag, tag_hash);
+  if (!qe)
+    return false;
 
-  EvQueueMapIter it = queues[queue_bucket].find(local_tag);
-  if (it != queues[queue_bucket].end()) {
-    it->second.q->postEvent(ev);
-    posted = true;
-  }
+  qe->q->postEvent(ev);
+  return true;
+}
 
-  return posted;
+bool AmEventDispatcher::post(const string& local_tag, AmEvent* ev)
+{
+  return post(local_tag, hash(local_tag), ev);
 }
 
 bool AmEventDispatcher::post(const string& callid, 
@@ -184,21 +178,22 @@ bool AmEventDispatcher::post(const string& callid,
                               const string& via_branch,
                               AmEvent* ev)
 {
-  string id = callid+remote_tag;
-  if (AmConfig::AcceptForkedDialogs) {
-    id += via_branch;
-  }
-  unsigned int id_bucket = hash(id);
+  string id = make_id(callid, remote_tag, via_branch);
+  uint32_t id_hash = hash(id);
+  unsigned int id_bucket = bucket(id_hash);
 
-  lock_guard<AmMutex> lock(id_lookup_mut[id_bucket]);
+  IdEntry entry;
+  {
+    std::shared_lock<std::shared_mutex> lock(id_lookup_mut[id_bucket]);
 
-  DictIter di = id_lookup[id_bucket].find(id);
-  if (di == id_lookup[id_bucket].end()) {
-    return false;
+    IdEntry* e = id_lookup[id_bucket].find(id, id_hash);
+    if (!e) {
+      return false;
+    }
+    entry = *e;
   }
-  string local_tag = di->second;
 
-  return post(local_tag, ev);
+  return post(entry.local_tag, entry.tag_hash, ev);
 }
 
 bool AmEventDispatcher::broadcast(AmEvent* ev)
@@ -209,19 +204,12 @@ bool AmEventDispatcher::broadcast(AmEvent* ev)
   bool posted = false;
   for (size_t i=0; i < EVENT_DISPATCHER_BUCKETS; i++)
   {
-    queues_mut[i].lock();
+    std::shared_lock<std::shared_mutex> lock(queues_mut[i]);
 
-    EvQueueMapIter it = queues[i].begin();
-    while (it != queues[i].end())
-    {
-      EvQueueMapIter this_evq = it;
-      it++;
-      queues_mut[i].unlock();
-      this_evq->second.q->postEvent(ev->clone());
-      queues_mut[i].lock();
-      posted = true;
-    }
-    queues_mut[i].unlock();
+    queues[i].for_each([&](const string&, QueueEntry& qe) {
+	qe.q->postEvent(ev->clone());
+	posted = true;
+      });
   }
 
   delete ev;
@@ -233,7 +221,7 @@ bool AmEventDispatcher::empty() {
   bool res = true;
   for (size_t i=0; i < EVENT_DISPATCHER_BUCKETS; i++)
   {
-    lock_guard<AmMutex> lock(queues_mut[i]);
+    std::shared_lock<std::shared_mutex> lock(queues_mut[i]);
     res = res&queues[i].empty();
     if (!res)
       break;
@@ -246,17 +234,17 @@ void AmEventDispatcher::dump()
   DBG("*** dumping Event dispatcher buckets ***\n");
   for (size_t i=0; i<EVENT_DISPATCHER_BUCKETS; i++)
   {
-    queues_mut[i].lock();
-    if (!queues[i].empty()) {
-      DBG("queues[%zu].size() = %zu",i,queues[i].size());
-      for (EvQueueMapIter it = queues[i].begin(); it != queues[i].end(); it++)
-      {
-        DBG("\t%s -> %p\n",it->first.c_str(),it->second.q);
+    {
+      std::shared_lock<std::shared_mutex> lock(queues_mut[i]);
+      if (!queues[i].empty()) {
+	DBG("queues[%zu].size() = %zu",i,queues[i].size());
+	queues[i].for_each([](const string& tag, QueueEntry& qe) {
+	    DBG("\t%s -> %p\n",tag.c_str(),qe.q);
+	  });
       }
     }
-    queues_mut[i].unlock();
 
-    lock_guard<AmMutex> lock(id_lookup_mut[i]);
+    std::shared_lock<std::shared_mutex> lock(id_lookup_mut[i]);
     if(!id_lookup[i].empty()) {
       DBG("id_lookup[%zu].size() = %zu",i,id_lookup[i].size());
     }
@@ -280,36 +268,30 @@ void AmEventDispatcher::dispose()
 bool AmEventDispatcher::postSipRequest(const AmSipRequest& req)
 {
   // get local tag
-  bool posted = false;
-  string callid = req.callid;
-  string remote_tag = req.from_tag;
-
-  string id = callid+remote_tag;
-  if (AmConfig::AcceptForkedDialogs) {
-    id += req.via_branch;
-  }
-  unsigned int id_bucket = hash(id);
+  string id = make_id(req.callid, req.from_tag, req.via_branch);
+  uint32_t id_hash = hash(id);
+  unsigned int id_bucket = bucket(id_hash);
 
-  id_lookup_mut[id_bucket].lock();
+  IdEntry entry;
+  {
+    std::shared_lock<std::shared_mutex> lock(id_lookup_mut[id_bucket]);
 
-  DictIter di = id_lookup[id_bucket].find(id);
-  if (di == id_lookup[id_bucket].end()) {
-    id_lookup_mut[id_bucket].unlock();
-    return false;
+    IdEntry* e = id_lookup[id_bucket].find(id, id_hash);
+    if (!e) {
+      return false;
+    }
+    entry = *e;
   }
-  string local_tag = di->second;
-  id_lookup_mut[id_bucket].unlock();
 
   // post(local_tag)
-  unsigned int queue_bucket = hash(local_tag);
+  unsigned int queue_bucket = bucket(entry.tag_hash);
 
-  lock_guard<AmMutex> lock(queues_mut[queue_bucket]);
+  std::shared_lock<std::shared_mutex> lock(queues_mut[queue_bucket]);
 
-  EvQueueMapIter it = queues[queue_bucket].find(local_tag);
-  if (it != queues[queue_bucket].end()) {
-    it->second.q->postEvent(new AmSipRequestEvent(req));
-    posted = true;
-  }
+  QueueEntry* qe = queues[queue_bucket].find(entry.local_tag, entry.tag_hash);
+  if (!qe)
+    return false;
 
-  return posted;
+  qe->q->postEvent(new AmSipRequestEvent(req));
+  return true;
 }
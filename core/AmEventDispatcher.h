@@ -29,7 +29,9 @@
 
 #include "AmEventQueue.h"
 #include "AmSipMsg.h"
-#include <map>
+#include "AmStringHashTable.h"
+
+#include <shared_mutex>
 
 #define EVENT_DISPATCHER_POWER   10
 #define EVENT_DISPATCHER_BUCKETS (1<<EVENT_DISPATCHER_POWER)
@@ -52,12 +54,20 @@ public:
 	: q(q), id(id){} 
     };
 
-    typedef std::map<string, QueueEntry> EvQueueMap;
-    typedef EvQueueMap::iterator         EvQueueMapIter;
-    
-    typedef std::map<string,string>  Dictionnary;
-    typedef Dictionnary::iterator    DictIter;
+    /** id_lookup value: local tag and its precomputed hash */
+    struct IdEntry {
+      string   local_tag;
+      uint32_t tag_hash;
+
+      IdEntry()
+	: local_tag(), tag_hash(0) {}
+
+      IdEntry(const string& local_tag, uint32_t tag_hash)
+	: local_tag(local_tag), tag_hash(tag_hash) {}
+    };
 
+    typedef AmStringHashTable<QueueEntry> EvQueueMap;
+    typedef AmStringHashTable<IdEntry>    Dictionnary;
 
 private:
 
@@ -69,8 +79,9 @@ private:
      */
     EvQueueMap queues[EVENT_DISPATCHER_BUCKETS];
     
-    // mutex for "queues" 
-    AmMutex queues_mut[EVENT_DISPATCHER_BUCKETS];
+    // lock for "queues": shared for lookups/posting,
+    // exclusive for adding/removing queues
+    std::shared_mutex queues_mut[EVENT_DISPATCHER_BUCKETS];
 
     /** 
      * Call ID + remote tag + via_branch -> local tag 
@@ -78,11 +89,21 @@ private:
      *  (UAS sessions only)
      */
     Dictionnary id_lookup[EVENT_DISPATCHER_BUCKETS];
-    // mutex for "id_lookup" 
-    AmMutex id_lookup_mut[EVENT_DISPATCHER_BUCKETS];
+    // lock for "id_lookup" 
+    std::shared_mutex id_lookup_mut[EVENT_DISPATCHER_BUCKETS];
+
+    /** full 32 bit hash; the upper bits select the bucket,
+	the lower ones the slot within the bucket's table */
+    static uint32_t hash(const string& s);
+    static unsigned int bucket(uint32_t h) {
+      return h >> (32 - EVENT_DISPATCHER_POWER);
+    }
+
+    string make_id(const string& callid, const string& remote_tag,
+		   const string& via_branch);
+
+    bool post(const string& local_tag, uint32_t tag_hash, AmEvent* ev);
 
-    unsigned int hash(const string& s1);
-    unsigned int hash(const string& s1, const string s2);
 public:
 
     static AmEventDispatcher* instance();
@@ -118,21 +139,19 @@ public:
      * TODO: rework container so, that there is no need to expose possibilities
      *       to lock/unlock container (encapsulation violation).
      * Was developed only for the snapshot mechanism, not recommended to be used
-     * with other things.
+     * with other things. Takes the bucket lock shared (read-only access).
      */
     void lockQueue(const string& local_tag)
     {
         if (local_tag.empty())
             return;
-        unsigned int queue_bucket = hash(local_tag);
-        queues_mut[queue_bucket].lock();
+        queues_mut[bucket(hash(local_tag))].lock_shared();
     }
     void unlockQueue(const string& local_tag)
     {
         if (local_tag.empty())
             return;
-        unsigned int queue_bucket = hash(local_tag);
-        queues_mut[queue_bucket].unlock();
+        queues_mut[bucket(hash(local_tag))].unlock_shared();
     }
 
     bool empty();
@@ -30,12 +30,16 @@
 #include "AmConfig.h"
 
 #include <typeinfo>
-AmEventQueueBase::AmEventQueueBase(AmEventHandler* handler, std::mutex& _m, std::condition_variable& _c)
+AmEventQueueBase::AmEventQueueBase(AmEventHandler* handler, std::mutex& _m, std::condition_variable& _c,
+				   QueueType type)
   : handler(handler),
     wakeup_handler(NULL),
     finalized(false),
     _mut(_m),
-    _cond(_c)
+    _cond(_c),
+    queue_type(type),
+    lf_head(NULL),
+    lf_batch(NULL)
 {
 }
 
@@ -45,6 +49,58 @@ AmEventQueueBase::~AmEventQueueBase()
     delete ev_queue.front();
     ev_queue.pop();
   }
+
+  AmEvent* event;
+  while((event = popEventLockFree()) != NULL)
+    delete event;
+}
+
+// producer side: any thread
+void AmEventQueueBase::postEventLockFree(AmEvent* event)
+{
+  AmEvent* old_head = lf_head.load(std::memory_order_relaxed);
+  do {
+    event->queue_next = old_head;
+  } while (!lf_head.compare_exchange_weak(old_head, event,
+					  std::memory_order_release,
+					  std::memory_order_relaxed));
+
+  // consumer has already been woken up for the pending events
+  if (old_head)
+    return;
+
+  // queue was empty: the consumer might be sleeping in waitForEvent(),
+  // or not be scheduled for processing. Locking the mutex makes sure
+  // it is either already waiting or will see the new event.
+  std::lock_guard<std::mutex> _l(_mut);
+  _cond.notify_all();
+
+  if (NULL != wakeup_handler)
+    wakeup_handler->notify(this);
+}
+
+// consumer side: takes all pending events at once,
+// then hands them out in posting order
+AmEvent* AmEventQueueBase::popEventLockFree()
+{
+  if (!lf_batch) {
+    AmEvent* list = lf_head.exchange(NULL, std::memory_order_acquire);
+
+    while (list) {
+      AmEvent* next = list->queue_next;
+      list->queue_next = lf_batch;
+      lf_batch = list;
+      list = next;
+    }
+  }
+
+  AmEvent* event = lf_batch;
+  if (event) {
+    lf_batch = event->queue_next;
+    event->queue_next = NULL;
+  }
+
+  return event;
 }
 
 void AmEventQueueBase::postEvent(AmEvent* event)
@@ -55,6 +111,14 @@ void AmEventQueueBase::postEvent(AmEvent* event)
   if (AmConfig::LogEvents) 
     DBG("AmEventQueue: trying to post event\n");
 
+  if (queue_type == LockFree) {
+    postEventLockFree(event);
+
+    if (AmConfig::LogEvents)
+      DBG("AmEventQueue: event posted\n");
+    return;
+  }
+
   std::lock_guard<std::mutex> _l(_mut);
 
   bool was_empty = ev_queue.empty();
@@ -71,6 +135,22 @@ void AmEventQueueBase::postEvent(AmEvent* event)
 
 void AmEventQueueBase::processEvents()
 {
+  if (queue_type == LockFree) {
+    AmEvent* event;
+    while ((event = popEventLockFree()) != NULL) {
+
+      if (AmConfig::LogEvents)
+	DBG("before processing event (%s)\n",
+	    typeid(*event).name());
+      handler->process(event);
+      if (AmConfig::LogEvents)
+	DBG("event processed (%s)\n",
+	    typeid(*event).name());
+      delete event;
+    }
+    return;
+  }
+
   std::unique_lock<std::mutex> _l(_mut);
 
   while (!ev_queue.empty()) {
@@ -110,14 +190,22 @@ void AmEventQueueBase::waitForEventTimed(unsigned long msec)
 
 void AmEventQueueBase::processSingleEvent()
 {
-  std::unique_lock<std::mutex> _l(_mut);
+  AmEvent* event = NULL;
 
-  if (ev_queue.empty())
-    return;
+  if (queue_type == LockFree) {
+    event = popEventLockFree();
+    if (!event)
+      return;
+  }
+  else {
+    std::unique_lock<std::mutex> _l(_mut);
 
-  AmEvent* event = ev_queue.front();
-  ev_queue.pop();
-  _l.unlock();
+    if (ev_queue.empty())
+      return;
+
+    event = ev_queue.front();
+    ev_queue.pop();
+  }
 
   if (AmConfig::LogEvents)
     DBG("before processing event\n");
@@ -136,6 +224,11 @@ void AmEventQueueBase::setEventNotificationSink(AmEventNotificationSink*
 					    _wakeup_handler) {
   std::unique_lock<std::mutex> _l(_mut);
   wakeup_handler = _wakeup_handler;
-  if (wakeup_handler && !ev_queue.empty())
+
+  // may be called from any thread: lf_batch belongs to the consumer,
+  // which is processing its events anyway
+  bool pending = (queue_type == LockFree) ?
+    (lf_head.load(std::memory_order_acquire) != NULL) : !ev_queue.empty();
+  if (wakeup_handler && pending)
     wakeup_handler->notify(this);
 }
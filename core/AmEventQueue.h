@@ -33,6 +33,7 @@
 #include "atomic_types.h"
 
 #include <queue>
+#include <atomic>
 
 class AmEventQueueInterface
 {
@@ -62,11 +63,27 @@ class AmEventNotificationSink
  *
  * This is a generic base class that requires an external
  * mutex and condition variable.
+ *
+ * Two implementations can be selected per queue:
+ *  - Locked: std::queue guarded by the mutex.
+ *  - LockFree: intrusive multi-producer/single-consumer list
+ *    (AmEvent::queue_next). Producers push with a single CAS and
+ *    only take the mutex to wake up the consumer if the queue was
+ *    empty; the consumer drains all pending events at once.
+ *    Consuming methods (processEvents, processSingleEvent,
+ *    waitForEvent*, eventPending) must then be called from
+ *    one thread at a time only.
  */
 class AmEventQueueBase
   : public AmEventQueueInterface,
     virtual public atomic_ref_cnt
 {
+public:
+  enum QueueType {
+    Locked = 0,
+    LockFree
+  };
+
 protected:
   AmEventHandler*           handler;
   AmEventNotificationSink*  wakeup_handler;
@@ -77,6 +94,12 @@ protected:
 
   // mutex must be held
   virtual bool shouldSleep() const {
+    return queueEmpty();
+  }
+
+  bool queueEmpty() const {
+    if (queue_type == LockFree)
+      return !lf_batch && !lf_head.load(std::memory_order_acquire);
     return ev_queue.empty();
   }
 
@@ -84,10 +107,23 @@ private:
   std::mutex& _mut;
   std::condition_variable& _cond;
 
+  const QueueType queue_type;
+
+  // LockFree: events pushed by producers, newest first
+  std::atomic<AmEvent*> lf_head;
+  // LockFree: consumer's batch taken from lf_head, oldest first
+  AmEvent* lf_batch;
+
+  void postEventLockFree(AmEvent* event);
+  AmEvent* popEventLockFree();
+
 public:
-  AmEventQueueBase(AmEventHandler* handler, std::mutex& _m, std::condition_variable& _c);
+  AmEventQueueBase(AmEventHandler* handler, std::mutex& _m, std::condition_variable& _c,
+		   QueueType type = Locked);
   virtual ~AmEventQueueBase();
 
+  QueueType getQueueType() const { return queue_type; }
+
   void postEvent(AmEvent*);
   void processEvents();
   void waitForEvent();
@@ -115,7 +151,8 @@ class AmEventQueue : public AmEventQueueBase {
   std::condition_variable _cond;
 
 public:
-  AmEventQueue(AmEventHandler* handler) : AmEventQueueBase(handler, _mut, _cond) {}
+  AmEventQueue(AmEventHandler* handler, QueueType type = Locked)
+    : AmEventQueueBase(handler, _mut, _cond, type) {}
 };
 
 /**
@@ -135,8 +172,8 @@ protected:
   }
 
 public:
-  AmEventQueueThread(AmEventHandler* handler)
-    : AmEventQueueBase(handler, run_mut, run_cond)
+  AmEventQueueThread(AmEventHandler* handler, QueueType type = Locked)
+    : AmEventQueueBase(handler, run_mut, run_cond, type)
   {}
 
   virtual void on_destroy() {
@@ -46,12 +46,24 @@ struct SchedRequest :
     : AmEvent(id), s(s) {}
 };
 
+/** \brief Request to move the sessions of a callgroup between threads */
+struct MigrateRequest :
+  public SchedRequest
+{
+  std::vector<AmMediaSession*> sessions;
+  unsigned int target;
+
+  MigrateRequest(int id, unsigned int target)
+    : SchedRequest(id, NULL), target(target) {}
+};
+
 /*         session scheduler              */
 
 AmMediaProcessor* AmMediaProcessor::_instance = NULL;
 
 AmMediaProcessor::AmMediaProcessor()
-  : threads(NULL),num_threads(0)
+  : threads(NULL),num_threads(0),
+    epoch(0),migrating(false)
 {
 }
 
@@ -65,9 +77,10 @@ void AmMediaProcessor::init() {
   num_threads = AmConfig::MediaProcessorThreads;
   assert(num_threads > 0);
   DBG("Starting %u MediaProcessorThreads.\n", num_threads);
+  epoch = gettimeofday_us();
   threads = new AmMediaProcessorThread*[num_threads];
   for (unsigned int i=0;i<num_threads;i++) {
-    threads[i] = new AmMediaProcessorThread();
+    threads[i] = new AmMediaProcessorThread(i);
     threads[i]->start();
   }
 }
@@ -112,11 +125,12 @@ void AmMediaProcessor::addSession(AmMediaSession* s,
   callgroupmembers.insert(make_pair(callgroup, s));
   session2callgroup[s]=callgroup;
     
-  group_mut.unlock();
-    
   // add the session to selected thread
+  // (while locked, so that it can not be overtaken by a migration)
   threads[sched_thread]->
     postRequest(new SchedRequest(InsertSession,s));
+
+  group_mut.unlock();
 }
 
 void AmMediaProcessor::clearSession(AmMediaSession* s) {
@@ -131,9 +145,6 @@ void AmMediaProcessor::softRemoveSession(AmMediaSession* s) {
   removeFromProcessor(s, SoftRemoveSession);
 }
 
-/* FIXME: implement Call Group ts offsets for soft changing of 
-	call groups 
-*/
 void AmMediaProcessor::changeCallgroup(AmMediaSession* s, 
 				       const string& new_callgroup) {
   removeFromProcessor(s, SoftRemoveSession);
@@ -144,8 +155,15 @@ void AmMediaProcessor::removeFromProcessor(AmMediaSession* s,
 					   unsigned int r_type) {
   DBG("AmMediaProcessor::removeSession\n");
   group_mut.lock();
+  std::map<AmMediaSession*, std::string>::iterator s_it = session2callgroup.find(s);
+  if (s_it == session2callgroup.end()) {
+    // removed already (e.g. by the media processor after an error)
+    group_mut.unlock();
+    DBG("  session not in any callgroup\n");
+    return;
+  }
   // get scheduler
-  string callgroup = session2callgroup[s];
+  string callgroup = s_it->second;
   unsigned int sched_thread = callgroup2thread[callgroup];
   DBG("  callgroup is '%s', thread %u\n", callgroup.c_str(), sched_thread);
   // erase callgroup membership entry
@@ -165,10 +183,118 @@ void AmMediaProcessor::removeFromProcessor(AmMediaSession* s,
     DBG("callgroup empty, erasing it.\n");
   }
   // erase session entry
-  session2callgroup.erase(s);
-  group_mut.unlock();    
+  session2callgroup.erase(s_it);
 
   threads[sched_thread]->postRequest(new SchedRequest(r_type,s));
+  group_mut.unlock();    
+}
+
+/*
+ * Moving a callgroup: the mapping of the callgroup is switched to the
+ * target thread at once, and the source thread is asked to hand over
+ * the sessions it holds at that moment. All requests are posted with
+ * group_mut held, so requests for the callgroup issued before the switch
+ * are processed by the source thread before the hand-over, requests
+ * issued after it by the target thread. The latter may arrive before
+ * the sessions do; the target thread keeps them until then (see
+ * AmMediaProcessorThread::migrateIn).
+ *
+ * All threads derive the media timestamp from the common epoch, so a
+ * moved session continues with the timestamp of the next tick.
+ */
+void AmMediaProcessor::rebalance()
+{
+  if (num_threads < 2)
+    return;
+
+  group_mut.lock();
+
+  if (migrating) {
+    group_mut.unlock();
+    return;
+  }
+
+  unsigned int src = 0, dst = 0;
+  unsigned int src_avg = threads[0]->getTickAvg(), dst_avg = src_avg;
+  for (unsigned int i=1;i<num_threads;i++) {
+    unsigned int avg = threads[i]->getTickAvg();
+    if (avg > src_avg) { src_avg = avg; src = i; }
+    if (avg < dst_avg) { dst_avg = avg; dst = i; }
+  }
+
+  unsigned int diff = src_avg - dst_avg;
+  unsigned int src_sessions = threads[src]->getLoad();
+  if (diff < MEDIA_REBALANCE_MIN_DIFF || !src_sessions) {
+    group_mut.unlock();
+    return;
+  }
+
+  // estimated cost of a session on the source thread
+  unsigned int per_session = src_avg / src_sessions;
+  if (!per_session)
+    per_session = 1;
+
+  // find the callgroup which evens out the load best, i.e. with the
+  // smallest remaining difference |diff - 2*cost|; moving it must
+  // lower the difference, i.e. cost < diff
+  const string* best = NULL;
+  unsigned int best_rest = diff;
+  for (std::map<string, unsigned int>::iterator it = callgroup2thread.begin();
+       it != callgroup2thread.end(); it++) {
+    if (it->second != src)
+      continue;
+
+    unsigned int cost = callgroupmembers.count(it->first) * per_session;
+    if (!cost || cost >= diff)
+      continue;
+
+    unsigned int rest = 2*cost > diff ? 2*cost - diff : diff - 2*cost;
+    if (rest < best_rest) {
+      best = &it->first;
+      best_rest = rest;
+    }
+  }
+
+  if (!best) {
+    group_mut.unlock();
+    return;
+  }
+
+  DBG("moving callgroup '%s' from media processor %u (%u us/tick) "
+      "to %u (%u us/tick)\n", best->c_str(), src, src_avg, dst, dst_avg);
+
+  MigrateRequest* mr = new MigrateRequest(MigrateOut, dst);
+  std::multimap<string, AmMediaSession*>::iterator m_it =
+    callgroupmembers.lower_bound(*best);
+  for (; m_it != callgroupmembers.end() && m_it->first == *best; m_it++)
+    mr->sessions.push_back(m_it->second);
+
+  callgroup2thread[*best] = dst;
+  migrating = true;
+  threads[dst]->setMigrationIn();
+  threads[src]->postRequest(mr);
+
+  group_mut.unlock();
+}
+
+void AmMediaProcessor::migrationDone()
+{
+  group_mut.lock();
+  migrating = false;
+  group_mut.unlock();
+}
+
+void AmMediaProcessor::getInfo(AmArg& ret)
+{
+  ret.assertArray();
+  if (!threads)
+    return;
+
+  for (unsigned int i=0;i<num_threads;i++) {
+    AmArg t;
+    threads[i]->getInfo(t);
+    ret.push(t);
+  }
 }
 
 void AmMediaProcessor::stop() {
@@ -213,9 +339,18 @@ void AmMediaProcessor::dispose()
 
 /* the actual media processing thread */
 
-AmMediaProcessorThread::AmMediaProcessorThread()
-  : events(this)
+const unsigned int AmMediaProcessorThread::
+tick_hist_bounds[MEDIA_TICK_HIST_BUCKETS - 1] = {
+  250, 500, 1000, 2000, 5000, 10000, 20000, 50000
+};
+
+AmMediaProcessorThread::AmMediaProcessorThread(unsigned int idx)
+  : idx(idx), events(this),
+    tick_overruns(0), tick_max(0), tick_avg(0),
+    migrated_in(0), migrated_out(0), migration_in(false)
 {
+  for (unsigned int i=0;i<MEDIA_TICK_HIST_BUCKETS;i++)
+    tick_hist[i] = 0;
 }
 AmMediaProcessorThread::~AmMediaProcessorThread()
 {
@@ -228,16 +363,22 @@ void AmMediaProcessorThread::on_stop()
 
 void AmMediaProcessorThread::run()
 {
-  // wallclock time
-  unsigned long long ts = 0;//4294417296;
-
   // everything else in microseconds
   uint64_t tick = 1000*WC_INC_MS;
 
+  // ticks are counted from the common epoch, so that all threads
+  // use the same wallclock timestamp for a tick
+  uint64_t epoch = AmMediaProcessor::instance()->epoch;
+
   uint64_t now = gettimeofday_us();
 
-  uint64_t next_tick = now + tick;
-    
+  uint64_t tick_no = (now - epoch) / tick + 1;
+  uint64_t next_tick = epoch + tick_no * tick;
+
+  uint64_t rebalance_ticks = 0;
+  if (idx == 0 && AmConfig::MediaProcessorRebalance)
+    rebalance_ticks = (AmConfig::MediaProcessorRebalance + WC_INC_MS - 1) / WC_INC_MS;
+
   while (!stop_requested()) {
 
     now = gettimeofday_us();
@@ -260,19 +401,44 @@ void AmMediaProcessorThread::run()
     now = gettimeofday_us();
 
     if (now >= next_tick) {
+      // wallclock time
+      unsigned long long ts = (tick_no * WC_INC) & WALLCLOCK_MASK;
+
       processAudio(ts);
       processDtmfEvents();
 
-      ts = (ts + WC_INC) & WALLCLOCK_MASK;
+      accountTick(gettimeofday_us() - now);
+
+      if (rebalance_ticks && !(tick_no % rebalance_ticks))
+        AmMediaProcessor::instance()->rebalance();
 
       // advance to next tick in increments of "tick":
       // mathematical equivalent of: while (now >= next_tick) next_tick += tick;
       uint64_t ticks = (now - next_tick) / tick + 1;
       next_tick += tick * ticks;
+      tick_no += ticks;
     }
   }
 }
 
+void AmMediaProcessorThread::accountTick(uint64_t busy)
+{
+  unsigned int b = 0;
+  while (b < MEDIA_TICK_HIST_BUCKETS - 1 && busy > tick_hist_bounds[b])
+    b++;
+  tick_hist[b].fetch_add(1, std::memory_order_relaxed);
+
+  if (busy > 1000*WC_INC_MS)
+    tick_overruns.fetch_add(1, std::memory_order_relaxed);
+
+  if (busy > tick_max.load(std::memory_order_relaxed))
+    tick_max.store(busy, std::memory_order_relaxed);
+
+  // avg += (busy - avg) / 16, with avg scaled by 16
+  unsigned int avg = tick_avg.load(std::memory_order_relaxed);
+  tick_avg.store(avg + busy - (avg >> 4), std::memory_order_relaxed);
+}
+
 /**
  * process pending DTMF events
  */
@@ -288,12 +454,18 @@ void AmMediaProcessorThread::processDtmfEvents()
 
 void AmMediaProcessorThread::processAudio(unsigned long long ts)
 {
+  bool batch = AmConfig::RtpSendBatch;
+  if (batch)
+    send_batch.begin();
+
+  set<AmMediaSession*> failed;
+
   // receiving
   for(set<AmMediaSession*>::iterator it = sessions.begin();
       it != sessions.end(); it++)
   {
     if ((*it)->readStreams(ts, buffer) < 0)
-      postRequest(new SchedRequest(AmMediaProcessor::ClearSession, *it));
+      failed.insert(*it);
   }
 
   // sending
@@ -301,8 +473,17 @@ void AmMediaProcessorThread::processAudio(unsigned long long ts)
       it != sessions.end(); it++)
   {
     if ((*it)->writeStreams(ts, buffer) < 0)
-      postRequest(new SchedRequest(AmMediaProcessor::ClearSession, *it));
+      failed.insert(*it);
   }
+
+  if (batch)
+    send_batch.flush();
+
+  // like any other removal, so that the callgroup is left and a
+  // migration of it does not take the session along
+  for(set<AmMediaSession*>::iterator it = failed.begin();
+      it != failed.end(); it++)
+    AmMediaProcessor::instance()->clearSession(*it);
 }
 
 void AmMediaProcessorThread::process(AmEvent* e)
@@ -315,10 +496,20 @@ void AmMediaProcessorThread::process(AmEvent* e)
 
   switch(sr->event_id){
 
-  case AmMediaProcessor::InsertSession:
+  case AmMediaProcessor::InsertSession:{
+    if (!migration_pending.empty()) {
+      // removed and re-added while on its way to this thread
+      std::map<AmMediaSession*, int>::iterator p_it =
+	migration_pending.find(sr->s);
+      if (p_it != migration_pending.end()) {
+	p_it->second = AmMediaProcessor::InsertSession;
+	break;
+      }
+    }
     DBG("Session inserted to the scheduler\n");
     sessions.insert(sr->s);
     sr->s->clearRTPTimeout();
+  }
     break;
 
   case AmMediaProcessor::RemoveSession:{
@@ -328,6 +519,8 @@ void AmMediaProcessorThread::process(AmEvent* e)
       sessions.erase(s_it);
       s->onMediaProcessingTerminated();
       DBG("Session removed from the scheduler\n");
+    } else if (migration_in) {
+      migration_pending[s] = sr->event_id;
     }
   }
     break;
@@ -340,6 +533,8 @@ void AmMediaProcessorThread::process(AmEvent* e)
       s->clearAudio();
       s->onMediaProcessingTerminated();
       DBG("Session removed from the scheduler\n");
+    } else if (migration_in) {
+      migration_pending[s] = sr->event_id;
     }
   }
     break;
@@ -351,21 +546,113 @@ void AmMediaProcessorThread::process(AmEvent* e)
     if(s_it != sessions.end()){
       sessions.erase(s_it);
       DBG("Session removed softly from the scheduler\n");
+    } else if (migration_in) {
+      migration_pending[s] = sr->event_id;
     }
   }
     break;
 
+  case AmMediaProcessor::MigrateOut:
+    migrateOut(static_cast<MigrateRequest*>(sr));
+    break;
+
+  case AmMediaProcessor::MigrateIn:
+    migrateIn(static_cast<MigrateRequest*>(sr));
+    break;
+
   default:
     ERROR("AmMediaProcessorThread::process: unknown event id.");
     break;
   }
 }
 
+void AmMediaProcessorThread::migrateOut(MigrateRequest* mr)
+{
+  MigrateRequest* in = new MigrateRequest(AmMediaProcessor::MigrateIn,
+					  mr->target);
+
+  for (std::vector<AmMediaSession*>::iterator it = mr->sessions.begin();
+       it != mr->sessions.end(); it++) {
+    if (sessions.erase(*it))
+      in->sessions.push_back(*it);
+  }
+
+  migrated_out += in->sessions.size();
+  DBG("handing over %zd sessions to media processor %u\n",
+      in->sessions.size(), mr->target);
+
+  AmMediaProcessor::instance()->threads[mr->target]->postRequest(in);
+}
+
+void AmMediaProcessorThread::migrateIn(MigrateRequest* mr)
+{
+  for (std::vector<AmMediaSession*>::iterator it = mr->sessions.begin();
+       it != mr->sessions.end(); it++) {
+
+    AmMediaSession* s = *it;
+    std::map<AmMediaSession*, int>::iterator p_it = migration_pending.find(s);
+    if (p_it == migration_pending.end()) {
+      sessions.insert(s);
+      continue;
+    }
+
+    // apply what has been requested while the session was moved
+    switch (p_it->second) {
+    case AmMediaProcessor::InsertSession:
+      sessions.insert(s);
+      break;
+    case AmMediaProcessor::ClearSession:
+      s->clearAudio();
+      // fall through
+    case AmMediaProcessor::RemoveSession:
+      s->onMediaProcessingTerminated();
+      break;
+    default:
+      break;
+    }
+  }
+
+  migrated_in += mr->sessions.size();
+  DBG("took over %zd sessions\n", mr->sessions.size());
+
+  migration_pending.clear();
+  migration_in = false;
+  AmMediaProcessor::instance()->migrationDone();
+}
+
 unsigned int AmMediaProcessorThread::getLoad() {
   // lock ? 
   return sessions.size();
 }
 
+void AmMediaProcessorThread::getInfo(AmArg& ret)
+{
+  ret["sessions"] = (int)getLoad();
+  send_batch.getInfo(ret["send_batch"]);
+
+  AmArg& ticks = ret["ticks"];
+  unsigned long count = 0;
+  AmArg& hist = ticks["hist"];
+  hist.assertArray();
+  for (unsigned int i=0;i<MEDIA_TICK_HIST_BUCKETS;i++) {
+    AmArg b;
+    if (i < MEDIA_TICK_HIST_BUCKETS - 1)
+      b["le_us"] = (int)tick_hist_bounds[i];
+    else
+      b["le_us"] = "inf";
+    b["count"] = (long int)tick_hist[i];
+    count += tick_hist[i];
+    hist.push(b);
+  }
+  ticks["count"] = (long int)count;
+  ticks["overruns"] = (long int)tick_overruns;
+  ticks["max_us"] = (int)tick_max;
+  ticks["avg_us"] = (int)getTickAvg();
+
+  ret["migrated_in"] = (long int)migrated_in;
+  ret["migrated_out"] = (long int)migrated_out;
+}
+
 inline void AmMediaProcessorThread::postRequest(SchedRequest* sr) {
   events.postEvent(sr);
 }
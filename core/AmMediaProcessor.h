@@ -29,13 +29,24 @@
 #define _AmMediaProcessor_h_
 
 #include "AmEventQueue.h"
+#include "AmRtpSendBatch.h"
 #include "amci/amci.h" // AUDIO_BUFFER_SIZE
 
 #include <set>
 using std::set;
 #include <map>
+#include <vector>
+#include <atomic>
 
 struct SchedRequest;
+struct MigrateRequest;
+
+/** number of buckets of the tick processing time histogram */
+#define MEDIA_TICK_HIST_BUCKETS 9
+
+/** min. difference in avg. processing time per tick (us) between two
+    threads for moving a callgroup */
+#define MEDIA_REBALANCE_MIN_DIFF 500
 
 /** Interface for basic media session processing.
  *
@@ -158,16 +169,43 @@ class AmMediaProcessorThread :
   public AmThread,
   public AmEventHandler
 {
+  unsigned int    idx;
   AmEventQueue    events;
   unsigned char   buffer[AUDIO_BUFFER_SIZE];
   set<AmMediaSession*> sessions;
-  
+
+  /** RTP packets sent within one tick (if AmConfig::RtpSendBatch) */
+  AmRtpSendBatch  send_batch;
+
+  /** upper bounds (us) of the tick histogram buckets */
+  static const unsigned int tick_hist_bounds[MEDIA_TICK_HIST_BUCKETS - 1];
+
+  /** processing time per tick */
+  std::atomic<unsigned long> tick_hist[MEDIA_TICK_HIST_BUCKETS];
+  std::atomic<unsigned long> tick_overruns;
+  std::atomic<unsigned int>  tick_max;
+  /** moving average of the processing time per tick (us, scaled by 16) */
+  std::atomic<unsigned int>  tick_avg;
+
+  std::atomic<unsigned long> migrated_in;
+  std::atomic<unsigned long> migrated_out;
+
+  /** a callgroup is being moved to this thread */
+  std::atomic<bool> migration_in;
+  /** requests for sessions not yet moved here (session -> request type) */
+  std::map<AmMediaSession*, int> migration_pending;
+
   void processAudio(unsigned long long ts);
   /**
    * Process pending DTMF events
    */
   void processDtmfEvents();
 
+  void accountTick(uint64_t busy);
+
+  void migrateOut(MigrateRequest* mr);
+  void migrateIn(MigrateRequest* mr);
+
   // AmThread interface
   void run();
   void on_stop();
@@ -176,12 +214,19 @@ class AmMediaProcessorThread :
   // AmEventHandler interface
   void process(AmEvent* e);
 public:
-  AmMediaProcessorThread();
+  AmMediaProcessorThread(unsigned int idx);
   ~AmMediaProcessorThread();
 
   inline void postRequest(SchedRequest* sr);
   
   unsigned int getLoad();
+
+  /** avg. processing time per tick in us */
+  unsigned int getTickAvg() { return tick_avg >> 4; }
+
+  void setMigrationIn() { migration_in = true; }
+
+  void getInfo(AmArg& ret);
 };
 
 /**
@@ -194,28 +239,44 @@ public:
  */
 class AmMediaProcessor
 {
+  friend class AmMediaProcessorThread;
+
   static AmMediaProcessor* _instance;
 
-  unsigned int num_threads; 
   AmMediaProcessorThread**  threads;
+  unsigned int num_threads; 
   
   std::map<string, unsigned int> callgroup2thread;
   std::multimap<string, AmMediaSession*> callgroupmembers;
   std::map<AmMediaSession*, string> session2callgroup;
   AmMutex group_mut;
 
+  /** time base of all threads, so that a moved session keeps its ts */
+  uint64_t epoch;
+
+  /** a callgroup is being moved between threads */
+  bool migrating;
+
   AmMediaProcessor();
   ~AmMediaProcessor();
 	
   void removeFromProcessor(AmMediaSession* s, unsigned int r_type);
+
+  /** move one callgroup from the busiest to the least busy thread */
+  void rebalance();
+  /** called by the target thread once a callgroup has been moved */
+  void migrationDone();
 public:
   /** 
    * InsertSession     : inserts the session to the processor
    * RemoveSession     : remove the session from the processor
    * SoftRemoveSession : remove the session from the processor but leave it attached
    * ClearSession      : remove the session from processor and clear audio
+   * MigrateOut        : hand over sessions of a callgroup to another thread
+   * MigrateIn         : take over sessions of a callgroup from another thread
    */
-  enum { InsertSession, RemoveSession, SoftRemoveSession, ClearSession };
+  enum { InsertSession, RemoveSession, SoftRemoveSession, ClearSession,
+	 MigrateOut, MigrateIn };
 
   static AmMediaProcessor* instance();
 
@@ -232,6 +293,9 @@ public:
   void changeCallgroup(AmMediaSession* s, 
 		       const string& new_callgroup);
 
+  /** fill ret with the statistics of all media processor threads */
+  void getInfo(AmArg& ret);
+
   void stop();
   static void dispose();
 };
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "AmMixerKernels.h"
+#include "log.h"
+
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIXER_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* scalar */
+
+static void mix_add_scalar(int* dest, const int* src1, const short* src2,
+			   unsigned int size)
+{
+  int* end_dest = dest + size;
+
+  while(dest != end_dest)
+    *(dest++) = *(src1++) + int(*(src2++));
+}
+
+static void mix_sub_scalar(int* dest, const int* src1, const short* src2,
+			   unsigned int size)
+{
+  int* end_dest = dest + size;
+
+  while(dest != end_dest)
+    *(dest++) = *(src1++) - int(*(src2++));
+}
+
+static void scale_scalar(short* buffer, const int* tmp_buf, unsigned int size,
+			 int& scaling_factor)
+{
+  short* end_dest = buffer + size;
+
+  while(buffer != end_dest){
+
+    int s = (*tmp_buf * scaling_factor) >> 6;
+    if(abs(s) > MAX_LINEAR_SAMPLE){
+      scaling_factor = abs( (MAX_LINEAR_SAMPLE<<6) / (*tmp_buf) );
+      if(s < 0)
+	s = -MAX_LINEAR_SAMPLE;
+      else
+	s = MAX_LINEAR_SAMPLE;
+    }
+    *(buffer++) = short(s);
+    tmp_buf++;
+  }
+}
+
+static const AmMixerKernels scalar_kernels = {
+  "scalar", mix_add_scalar, mix_sub_scalar, scale_scalar
+};
+
+#ifdef MIXER_KERNELS_X86
+
+/* SSE2: 8 samples per step */
+
+__attribute__((target("sse2")))
+static inline void load_short8_sse2(const short* src, __m128i& lo, __m128i& hi)
+{
+  __m128i s = _mm_loadu_si128((const __m128i*)src);
+  // sign extension without SSE4.1 pmovsxwd
+  lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+  hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+}
+
+__attribute__((target("sse2")))
+static void mix_add_sse2(int* dest, const int* src1, const short* src2,
+			 unsigned int size)
+{
+  unsigned int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128i lo, hi;
+    load_short8_sse2(src2 + i, lo, hi);
+    __m128i a = _mm_loadu_si128((const __m128i*)(src1 + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src1 + i + 4));
+    _mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi32(a, lo));
+    _mm_storeu_si128((__m128i*)(dest + i + 4), _mm_add_epi32(b, hi));
+  }
+  mix_add_scalar(dest + i, src1 + i, src2 + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static void mix_sub_sse2(int* dest, const int* src1, const short* src2,
+			 unsigned int size)
+{
+  unsigned int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128i lo, hi;
+    load_short8_sse2(src2 + i, lo, hi);
+    __m128i a = _mm_loadu_si128((const __m128i*)(src1 + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src1 + i + 4));
+    _mm_storeu_si128((__m128i*)(dest + i), _mm_sub_epi32(a, lo));
+    _mm_storeu_si128((__m128i*)(dest + i + 4), _mm_sub_epi32(b, hi));
+  }
+  mix_sub_scalar(dest + i, src1 + i, src2 + i, size - i);
+}
+
+// low 32 bits of a 32x32 bit product (no pmulld before SSE4.1)
+__attribute__((target("sse2")))
+static inline __m128i mullo_epi32_sse2(__m128i a, __m128i b)
+{
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+			    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+__attribute__((target("sse2")))
+static void scale_sse2(short* buffer, const int* tmp_buf, unsigned int size,
+		       int& scaling_factor)
+{
+  const __m128i max_s = _mm_set1_epi32(MAX_LINEAR_SAMPLE);
+  const __m128i min_s = _mm_set1_epi32(-MAX_LINEAR_SAMPLE);
+
+  unsigned int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128i f = _mm_set1_epi32(scaling_factor);
+    __m128i a = _mm_srai_epi32(mullo_epi32_sse2(_mm_loadu_si128((const __m128i*)(tmp_buf + i)), f), 6);
+    __m128i b = _mm_srai_epi32(mullo_epi32_sse2(_mm_loadu_si128((const __m128i*)(tmp_buf + i + 4)), f), 6);
+
+    __m128i clip = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(a, max_s), _mm_cmplt_epi32(a, min_s)),
+				_mm_or_si128(_mm_cmpgt_epi32(b, max_s), _mm_cmplt_epi32(b, min_s)));
+    if (_mm_movemask_epi8(clip)) {
+      // the scaling factor changes within this block
+      scale_scalar(buffer + i, tmp_buf + i, 8, scaling_factor);
+      continue;
+    }
+
+    _mm_storeu_si128((__m128i*)(buffer + i), _mm_packs_epi32(a, b));
+  }
+  scale_scalar(buffer + i, tmp_buf + i, size - i, scaling_factor);
+}
+
+static const AmMixerKernels sse2_kernels = {
+  "sse2", mix_add_sse2, mix_sub_sse2, scale_sse2
+};
+
+/* AVX2: 16 samples per step */
+
+__attribute__((target("avx2")))
+static void mix_add_avx2(int* dest, const int* src1, const short* src2,
+			 unsigned int size)
+{
+  unsigned int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src2 + i)));
+    __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src2 + i + 8)));
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src1 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src1 + i + 8));
+    _mm256_storeu_si256((__m256i*)(dest + i), _mm256_add_epi32(a, lo));
+    _mm256_storeu_si256((__m256i*)(dest + i + 8), _mm256_add_epi32(b, hi));
+  }
+  mix_add_scalar(dest + i, src1 + i, src2 + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static void mix_sub_avx2(int* dest, const int* src1, const short* src2,
+			 unsigned int size)
+{
+  unsigned int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src2 + i)));
+    __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src2 + i + 8)));
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src1 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src1 + i + 8));
+    _mm256_storeu_si256((__m256i*)(dest + i), _mm256_sub_epi32(a, lo));
+    _mm256_storeu_si256((__m256i*)(dest + i + 8), _mm256_sub_epi32(b, hi));
+  }
+  mix_sub_scalar(dest + i, src1 + i, src2 + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static void scale_avx2(short* buffer, const int* tmp_buf, unsigned int size,
+		       int& scaling_factor)
+{
+  const __m256i max_s = _mm256_set1_epi32(MAX_LINEAR_SAMPLE);
+  const __m256i min_s = _mm256_set1_epi32(-MAX_LINEAR_SAMPLE);
+
+  unsigned int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m256i f = _mm256_set1_epi32(scaling_factor);
+    __m256i a = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(tmp_buf + i)), f), 6);
+    __m256i b = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(tmp_buf + i + 8)), f), 6);
+
+    __m256i clip = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(a, max_s), _mm256_cmpgt_epi32(min_s, a)),
+				   _mm256_or_si256(_mm256_cmpgt_epi32(b, max_s), _mm256_cmpgt_epi32(min_s, b)));
+    if (!_mm256_testz_si256(clip, clip)) {
+      // the scaling factor changes within this block
+      scale_scalar(buffer + i, tmp_buf + i, 16, scaling_factor);
+      continue;
+    }
+
+    // packs works per 128 bit lane: restore sample order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3,1,2,0));
+    _mm256_storeu_si256((__m256i*)(buffer + i), packed);
+  }
+  scale_scalar(buffer + i, tmp_buf + i, size - i, scaling_factor);
+}
+
+static const AmMixerKernels avx2_kernels = {
+  "avx2", mix_add_avx2, mix_sub_avx2, scale_avx2
+};
+
+#endif /* MIXER_KERNELS_X86 */
+
+const AmMixerKernels& AmMixerKernels::scalar()
+{
+  return scalar_kernels;
+}
+
+const AmMixerKernels* AmMixerKernels::sse2()
+{
+#ifdef MIXER_KERNELS_X86
+  if (__builtin_cpu_supports("sse2"))
+    return &sse2_kernels;
+#endif
+  return NULL;
+}
+
+const AmMixerKernels* AmMixerKernels::avx2()
+{
+#ifdef MIXER_KERNELS_X86
+  if (__builtin_cpu_supports("avx2"))
+    return &avx2_kernels;
+#endif
+  return NULL;
+}
+
+static const AmMixerKernels& select_kernels()
+{
+  const AmMixerKernels* k = AmMixerKernels::avx2();
+  if (!k)
+    k = AmMixerKernels::sse2();
+  if (!k)
+    k = &AmMixerKernels::scalar();
+
+  DBG("using %s conference mixer kernels\n", k->name);
+  return *k;
+}
+
+const AmMixerKernels& AmMixerKernels::get()
+{
+  static const AmMixerKernels& kernels = select_kernels();
+  return kernels;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmMixerKernels.h */
+#ifndef _AmMixerKernels_h_
+#define _AmMixerKernels_h_
+
+// PCM16 range: [-32767:32768]
+#define MAX_LINEAR_SAMPLE 32737
+
+/**
+ * \brief sample processing kernels of the conference mixer
+ *
+ * Scalar, SSE2 and AVX2 variants of the mixing loops. The best
+ * variant supported by the CPU is selected at runtime (get()); all
+ * variants produce identical output.
+ */
+struct AmMixerKernels
+{
+  const char* name;
+
+  /** dest[i] = src1[i] + src2[i] */
+  void (*mix_add)(int* dest, const int* src1, const short* src2, unsigned int size);
+
+  /** dest[i] = src1[i] - src2[i] */
+  void (*mix_sub)(int* dest, const int* src1, const short* src2, unsigned int size);
+
+  /**
+   * buffer[i] = (tmp_buf[i] * scaling_factor) >> 6, limited to
+   * +/-MAX_LINEAR_SAMPLE; on clipping the scaling factor is
+   * lowered for the following samples.
+   */
+  void (*scale)(short* buffer, const int* tmp_buf, unsigned int size,
+		int& scaling_factor);
+
+  /** @return the best kernels for this CPU */
+  static const AmMixerKernels& get();
+
+  static const AmMixerKernels& scalar();
+  /** @return NULL if not supported by CPU or build */
+  static const AmMixerKernels* sse2();
+  static const AmMixerKernels* avx2();
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
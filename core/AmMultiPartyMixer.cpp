@@ -30,9 +30,6 @@
 #include <assert.h>
 #include <math.h>
 
-// PCM16 range: [-32767:32768]
-#define MAX_LINEAR_SAMPLE 32737
-
 // the internal delay of the mixer (between put and get)
 #define MIXER_DELAY_MS 20
 
@@ -52,7 +49,8 @@ void DEBUG_MIXER_BUFFER_STATE(const MixerBufferState& mbs, const string& context
 AmMultiPartyMixer::AmMultiPartyMixer()
   : sampleratemap(), samplerates(),
     channelids(), scaling_factor(16),
-    buffer_state(), audio_mut()
+    buffer_state(), audio_mut(),
+    kernels(&AmMixerKernels::get())
 {
 }
 
@@ -212,40 +210,20 @@ int AmMultiPartyMixer::GetCurrentSampleRate()
 //
 void AmMultiPartyMixer::mix_add(int* dest,int* src1,short* src2,unsigned int size)
 {
-  int* end_dest = dest + size;
-
-  while(dest != end_dest)
-    *(dest++) = *(src1++) + int(*(src2++));
+  kernels->mix_add(dest,src1,src2,size);
 }
 
 void AmMultiPartyMixer::mix_sub(int* dest,int* src1,short* src2,unsigned int size)
 {
-  int* end_dest = dest + size;
-
-  while(dest != end_dest)
-    *(dest++) = *(src1++) - int(*(src2++));
+  kernels->mix_sub(dest,src1,src2,size);
 }
 
 void AmMultiPartyMixer::scale(short* buffer,int* tmp_buf,unsigned int size)
 {
-  short* end_dest = buffer + size;
-    
   if(scaling_factor<64)
     scaling_factor++;
-    
-  while(buffer != end_dest){
-	
-    int s = (*tmp_buf * scaling_factor) >> 6;
-    if(abs(s) > MAX_LINEAR_SAMPLE){
-      scaling_factor = abs( (MAX_LINEAR_SAMPLE<<6) / (*tmp_buf) );
-      if(s < 0)
-	s = -MAX_LINEAR_SAMPLE;
-      else
-	s = MAX_LINEAR_SAMPLE;
-    }
-    *(buffer++) = short(s);
-    tmp_buf++;
-  }
+
+  kernels->scale(buffer,tmp_buf,size,scaling_factor);
 }
 
 std::deque<MixerBufferState>::iterator AmMultiPartyMixer::findOrCreateBufferState(unsigned int sample_rate)
@@ -29,6 +29,7 @@
 #include "AmAudio.h"
 #include "AmThread.h"
 #include "SampleArray.h"
+#include "AmMixerKernels.h"
 
 //#define RORPP_PLC
 
@@ -78,6 +79,8 @@ class AmMultiPartyMixer
   int              scaling_factor; 
   int              tmp_buffer[AUDIO_BUFFER_SIZE/2];
 
+  const AmMixerKernels* kernels;
+
   std::deque<MixerBufferState>::iterator findOrCreateBufferState(unsigned int sample_rate);
   std::deque<MixerBufferState>::iterator findBufferStateForReading(unsigned int sample_rate, 
 								   unsigned long long last_ts);
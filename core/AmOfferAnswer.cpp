@@ -244,7 +244,7 @@ int AmOfferAnswer::onReplyIn(const AmSipReply& reply)
         }
 
       } else {
-        bool is_reliable = reply.code >= 200 || key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), SIP_EXT_100REL);
+        bool is_reliable = reply.code >= 200 || key_in_list(reply.getHeader(SIP_HDR_REQUIRE), SIP_EXT_100REL);
         saveState();
         err_code = onRxSdp(reply.cseq,reply.to_tag,is_reliable, *sdp_body,&err_txt);
         checkStateChange();
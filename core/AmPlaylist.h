@@ -81,6 +81,9 @@ class AmPlaylist: public AmAudio
 
   int put(unsigned long long system_ts, unsigned char* buffer, 
 	  int input_sample_rate, unsigned int size);
+
+  int getEncoded(unsigned long long system_ts, AmAudioRtpFormat* rtp_fmt,
+		 unsigned char* buffer);
 	
   /** from AmAudio */
   void close();
@@ -805,7 +805,7 @@ AmSessionFactory* AmPlugIn::findSessionFactory(const AmSipRequest& req, string&
       m_app_name = req.user; 
       break;
     case AmConfig::App_APPHDR: 
-      m_app_name = getHeader(req.hdrs, APPNAME_HDR, true); 
+      m_app_name = req.getHeader(APPNAME_HDR, true); 
       break;      
     case AmConfig::App_RURIPARAM: 
       m_app_name = get_header_param(req.r_uri, "app");
@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "AmRtcpStats.h"
+#include "AmArg.h"
+#include "log.h"
+
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#define RTP_SEQ_MOD    (1<<16)
+#define MAX_DROPOUT    3000
+#define MAX_MISORDER   100
+#define MIN_SEQUENTIAL 2
+
+/** seconds between 1900 (NTP epoch) and 1970 (unix epoch) */
+#define NTP_UNIX_OFFSET 2208988800UL
+
+/** middle 32 bits of a 64 bit NTP timestamp */
+#define NTP_MIDDLE(ntp) ((uint32_t)((ntp) >> 16))
+
+static inline void put32(unsigned char* p, uint32_t v)
+{
+  v = htonl(v);
+  memcpy(p, &v, 4);
+}
+
+static inline uint32_t get32(const unsigned char* p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return ntohl(v);
+}
+
+static inline void putHdr(unsigned char* p, unsigned int count,
+			  unsigned int pt, unsigned int len)
+{
+  // len is the length in bytes, a multiple of 4
+  p[0] = 0x80 | (count & 0x1f);
+  p[1] = pt;
+  uint16_t l = htons(len / 4 - 1);
+  memcpy(p + 2, &l, 2);
+}
+
+uint64_t AmRtcpStats::ntpNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint64_t sec = (uint64_t)ts.tv_sec + NTP_UNIX_OFFSET;
+  uint64_t frac = ((uint64_t)ts.tv_nsec << 32) / 1000000000ULL;
+  return (sec << 32) | frac;
+}
+
+uint64_t AmRtcpStats::monotonicUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+AmRtcpStats::AmRtcpStats()
+  : rx_clock_rate(0),
+    sent(0), sent_octets(0), sent_prior(0),
+    last_sent_ts(0), last_sent_time(0),
+    tx_clock_rate(0),
+    rtt(0), rtt_valid(false),
+    remote_fraction_lost(0), remote_cum_lost(0), remote_jitter(0),
+    sr_sent(0), rr_sent(0), rtcp_recv(0)
+{
+  reset();
+}
+
+void AmRtcpStats::reset()
+{
+  std::lock_guard<AmMutex> l(rx_mut);
+
+  r_ssrc = 0;
+  r_ssrc_valid = false;
+  max_seq = 0;
+  cycles = 0;
+  base_seq = 0;
+  bad_seq = RTP_SEQ_MOD + 1;
+  probation = 0;
+  received = 0;
+  received_octets = 0;
+  expected_prior = 0;
+  received_prior = 0;
+  duplicates = 0;
+  jitter = 0;
+  transit = 0;
+  transit_valid = false;
+  last_sr = 0;
+  last_sr_recv = 0;
+  rr_fraction_lost = 0;
+}
+
+void AmRtcpStats::setClockRates(unsigned int rx_rate, unsigned int tx_rate)
+{
+  rx_mut.lock();
+  if (rx_rate != rx_clock_rate) {
+    rx_clock_rate = rx_rate;
+    transit_valid = false;
+  }
+  rx_mut.unlock();
+
+  tx_mut.lock();
+  tx_clock_rate = tx_rate;
+  tx_mut.unlock();
+}
+
+void AmRtcpStats::initSeq(uint16_t seq)
+{
+  base_seq = seq;
+  max_seq = seq;
+  bad_seq = RTP_SEQ_MOD + 1;
+  cycles = 0;
+  received = 0;
+  received_prior = 0;
+  expected_prior = 0;
+}
+
+bool AmRtcpStats::updateSeq(uint16_t seq)
+{
+  uint16_t udelta = seq - max_seq;
+
+  if (probation) {
+    // source is not valid until MIN_SEQUENTIAL packets
+    // with sequential sequence numbers have been received
+    if (seq == (uint16_t)(max_seq + 1)) {
+      probation--;
+      max_seq = seq;
+      if (probation == 0) {
+	initSeq(seq);
+	received++;
+	return true;
+      }
+    } else {
+      probation = MIN_SEQUENTIAL - 1;
+      max_seq = seq;
+    }
+    return false;
+  }
+
+  if (udelta == 0) {
+    duplicates++;
+  } else if (udelta < MAX_DROPOUT) {
+    // in order, with permissible gap
+    if (seq < max_seq)
+      cycles += RTP_SEQ_MOD;
+    max_seq = seq;
+  } else if (udelta <= RTP_SEQ_MOD - MAX_MISORDER) {
+    // the sequence number made a very large jump
+    if (seq == bad_seq) {
+      // two sequential packets -- assume that the other side
+      // restarted without telling us
+      initSeq(seq);
+    } else {
+      bad_seq = (seq + 1) & (RTP_SEQ_MOD - 1);
+      return false;
+    }
+  }
+  // else: duplicate or reordered packet
+
+  received++;
+  return true;
+}
+
+int32_t AmRtcpStats::cumulativeLost() const
+{
+  if (!received)
+    return 0;
+
+  int64_t expected = (int64_t)extendedMax() - base_seq + 1;
+  int64_t lost = expected - received;
+  // clamp to the signed 24 bit field of the report block
+  if (lost > 0x7fffff) lost = 0x7fffff;
+  if (lost < -0x800000) lost = -0x800000;
+  return (int32_t)lost;
+}
+
+void AmRtcpStats::rtpReceived(uint32_t ssrc, uint16_t seq, uint32_t ts,
+			      unsigned int payload_len, uint64_t now_us)
+{
+  std::lock_guard<AmMutex> l(rx_mut);
+
+  if (!r_ssrc_valid || ssrc != r_ssrc) {
+    uint32_t sr = last_sr;
+    uint64_t sr_recv = last_sr_recv;
+    bool ssrc_change = r_ssrc_valid;
+
+    r_ssrc = ssrc;
+    r_ssrc_valid = true;
+    initSeq(seq);
+    max_seq = seq - 1;
+    probation = MIN_SEQUENTIAL;
+    received_octets = 0;
+    duplicates = 0;
+    jitter = 0;
+    transit_valid = false;
+
+    if (ssrc_change) {
+      last_sr = 0;
+      last_sr_recv = 0;
+    } else {
+      // the SR may have been received before the first RTP packet
+      last_sr = sr;
+      last_sr_recv = sr_recv;
+    }
+  }
+
+  if (!updateSeq(seq))
+    return;
+
+  received_octets += payload_len;
+
+  if (!rx_clock_rate)
+    return;
+
+  // interarrival jitter (RFC 3550 A.8), in timestamp units
+  uint32_t arrival = (uint32_t)(now_us * rx_clock_rate / 1000000ULL);
+  uint32_t t = arrival - ts;
+
+  if (transit_valid) {
+    int32_t d = (int32_t)(t - transit);
+    if (d < 0) d = -d;
+    jitter += d - ((jitter + 8) >> 4);
+  }
+
+  transit = t;
+  transit_valid = true;
+}
+
+void AmRtcpStats::rtpSent(uint32_t ts, unsigned int payload_len,
+			  uint64_t now_us)
+{
+  std::lock_guard<AmMutex> l(tx_mut);
+  sent++;
+  sent_octets += payload_len;
+  last_sent_ts = ts;
+  last_sent_time = now_us;
+}
+
+void AmRtcpStats::parseReportBlock(const unsigned char* p, uint32_t l_ssrc,
+				   uint64_t now_ntp)
+{
+  if (get32(p) != l_ssrc)
+    return;
+
+  uint32_t lost_word = get32(p + 4);
+  int32_t cum_lost = lost_word & 0xffffff;
+  if (cum_lost & 0x800000)
+    cum_lost |= 0xff000000; // sign extension
+
+  uint32_t lsr = get32(p + 16);
+  uint32_t dlsr = get32(p + 20);
+
+  std::lock_guard<AmMutex> l(tx_mut);
+
+  remote_fraction_lost = lost_word >> 24;
+  remote_cum_lost = cum_lost;
+  remote_jitter = get32(p + 12);
+
+  if (lsr) {
+    // RFC 3550 6.4.1: RTT = A - LSR - DLSR
+    uint32_t r = NTP_MIDDLE(now_ntp) - lsr - dlsr;
+    if ((int32_t)r >= 0) {
+      rtt = r;
+      rtt_valid = true;
+    }
+  }
+}
+
+bool AmRtcpStats::rtcpReceived(const unsigned char* buf, unsigned int len,
+			       uint32_t l_ssrc)
+{
+  uint64_t now_ntp = ntpNow();
+  bool res = true;
+
+  while (len >= 4) {
+    unsigned int count = buf[0] & 0x1f;
+    unsigned int pt = buf[1];
+    unsigned int pkt_len = ((buf[2] << 8) | buf[3]) * 4 + 4;
+
+    if ((buf[0] >> 6) != 2 || pkt_len > len) {
+      res = false;
+      break;
+    }
+
+    const unsigned char* blocks = NULL;
+
+    if (pt == RTCP_SR) {
+      if (pkt_len < 28 + count * 24) {
+	res = false;
+	break;
+      }
+
+      uint64_t ntp = ((uint64_t)get32(buf + 8) << 32) | get32(buf + 12);
+      rx_mut.lock();
+      last_sr = NTP_MIDDLE(ntp);
+      last_sr_recv = now_ntp;
+      rx_mut.unlock();
+
+      blocks = buf + 28;
+    } else if (pt == RTCP_RR) {
+      if (pkt_len < 8 + count * 24) {
+	res = false;
+	break;
+      }
+      blocks = buf + 8;
+    }
+
+    if (blocks) {
+      for (unsigned int i = 0; i < count; i++)
+	parseReportBlock(blocks + i * 24, l_ssrc, now_ntp);
+    }
+
+    buf += pkt_len;
+    len -= pkt_len;
+  }
+
+  tx_mut.lock();
+  rtcp_recv++;
+  tx_mut.unlock();
+
+  return res;
+}
+
+unsigned char* AmRtcpStats::writeReportBlock(unsigned char* p, uint64_t now_ntp)
+{
+  uint32_t expected = extendedMax() - base_seq + 1;
+  uint32_t expected_interval = expected - expected_prior;
+  uint32_t received_interval = received - received_prior;
+  int32_t lost_interval = (int32_t)(expected_interval - received_interval);
+
+  expected_prior = expected;
+  received_prior = received;
+
+  if (expected_interval == 0 || lost_interval <= 0)
+    rr_fraction_lost = 0;
+  else
+    rr_fraction_lost = ((uint32_t)lost_interval << 8) / expected_interval;
+
+  uint32_t dlsr = 0;
+  if (last_sr_recv)
+    dlsr = (uint32_t)((now_ntp - last_sr_recv) >> 16);
+
+  put32(p, r_ssrc);
+  put32(p + 4, (rr_fraction_lost << 24) | (cumulativeLost() & 0xffffff));
+  put32(p + 8, extendedMax());
+  put32(p + 12, jitter >> 4);
+  put32(p + 16, last_sr);
+  put32(p + 20, dlsr);
+
+  return p + 24;
+}
+
+unsigned int AmRtcpStats::buildReport(unsigned char* buf, unsigned int size,
+				      uint32_t l_ssrc, const string& cname)
+{
+  // SR (28) + one report block (24) + SDES with CNAME (8 + 2 + len + pad)
+  unsigned int cname_len = cname.length() > 255 ? 255 : cname.length();
+  unsigned int sdes_len = (8 + 2 + cname_len + 1 + 3) & ~3U;
+  if (size < 28 + 24 + sdes_len)
+    return 0;
+
+  uint64_t now_ntp = ntpNow();
+  unsigned char* p = buf;
+  bool sr = false;
+
+  tx_mut.lock();
+  if (sent != sent_prior) {
+    uint32_t ts = last_sent_ts;
+    if (tx_clock_rate) {
+      uint64_t elapsed = monotonicUs() - last_sent_time;
+      ts += (uint32_t)(elapsed * tx_clock_rate / 1000000ULL);
+    }
+
+    put32(p + 4, l_ssrc);
+    put32(p + 8, (uint32_t)(now_ntp >> 32));
+    put32(p + 12, (uint32_t)now_ntp);
+    put32(p + 16, ts);
+    put32(p + 20, sent);
+    put32(p + 24, sent_octets);
+
+    sent_prior = sent;
+    sr_sent++;
+    sr = true;
+  } else {
+    put32(p + 4, l_ssrc);
+    rr_sent++;
+  }
+  tx_mut.unlock();
+
+  unsigned char* blk = p + (sr ? 28 : 8);
+  unsigned int rc = 0;
+
+  rx_mut.lock();
+  if (r_ssrc_valid && received) {
+    blk = writeReportBlock(blk, now_ntp);
+    rc = 1;
+  }
+  rx_mut.unlock();
+
+  putHdr(p, rc, sr ? RTCP_SR : RTCP_RR, blk - p);
+  p = blk;
+
+  // SDES: one chunk with CNAME, terminated by a null item
+  memset(p, 0, sdes_len);
+  putHdr(p, 1, RTCP_SDES, sdes_len);
+  put32(p + 4, l_ssrc);
+  p[8] = RTCP_SDES_CNAME;
+  p[9] = cname_len;
+  memcpy(p + 10, cname.data(), cname_len);
+  p += sdes_len;
+
+  return p - buf;
+}
+
+void AmRtcpStats::getInfo(AmArg& ret)
+{
+  rx_mut.lock();
+  if (r_ssrc_valid) {
+    ret["r_ssrc"] = (long int)r_ssrc;
+    ret["received"] = (long int)received;
+    ret["received_octets"] = (long int)received_octets;
+    ret["expected"] = received ? (long int)(extendedMax() - base_seq + 1) : 0L;
+    ret["lost"] = (int)cumulativeLost();
+    ret["fraction_lost"] = (int)rr_fraction_lost;
+    ret["duplicates"] = (long int)duplicates;
+    ret["ext_max_seq"] = (long int)extendedMax();
+    ret["jitter"] = (long int)(jitter >> 4);
+    if (rx_clock_rate)
+      ret["jitter_ms"] = (double)(jitter >> 4) * 1000.0 / rx_clock_rate;
+  }
+  rx_mut.unlock();
+
+  tx_mut.lock();
+  ret["sent"] = (long int)sent;
+  ret["sent_octets"] = (long int)sent_octets;
+  ret["sr_sent"] = (long int)sr_sent;
+  ret["rr_sent"] = (long int)rr_sent;
+  ret["rtcp_received"] = (long int)rtcp_recv;
+  if (rtt_valid) {
+    ret["rtt_ms"] = (double)rtt * 1000.0 / 65536.0;
+    ret["remote_fraction_lost"] = (int)remote_fraction_lost;
+    ret["remote_lost"] = (int)remote_cum_lost;
+    ret["remote_jitter"] = (long int)remote_jitter;
+  }
+  tx_mut.unlock();
+}
+
+// Local Variables:
+// mode:C++
+// End:
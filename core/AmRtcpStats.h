@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmRtcpStats.h */
+#ifndef _AmRtcpStats_h_
+#define _AmRtcpStats_h_
+
+#include "AmThread.h"
+
+#include <stdint.h>
+#include <string>
+using std::string;
+
+class AmArg;
+
+/** RTCP packet types (RFC 3550) */
+#define RTCP_SR    200
+#define RTCP_RR    201
+#define RTCP_SDES  202
+#define RTCP_BYE   203
+
+/** SDES item type CNAME */
+#define RTCP_SDES_CNAME 1
+
+/** max. size of a compound report built by AmRtcpStats */
+#define RTCP_REPORT_MAX_SIZE 512
+
+/**
+ * \brief RTP/RTCP quality statistics of one RTP stream
+ *
+ * Keeps the receiver state of RFC 3550 appendix A.1 (sequence number
+ * tracking, cumulative and interval loss) and A.8 (interarrival
+ * jitter) for the remote source, as well as the sender counters of the
+ * local source. Both are updated in constant time for each packet.
+ *
+ * From this state, sender and receiver reports are built; received
+ * SR/RR are parsed to remember the last SR of the remote side (for
+ * LSR/DLSR) and to compute the round trip time from report blocks
+ * that refer to the local source.
+ *
+ * Receive side, send side and reports may be handled by different
+ * threads; each side has its own mutex.
+ */
+class AmRtcpStats
+{
+  /* receiver state (RFC 3550 A.1, A.8) */
+  AmMutex  rx_mut;
+  uint32_t r_ssrc;
+  bool     r_ssrc_valid;
+  uint16_t max_seq;
+  uint32_t cycles;
+  uint32_t base_seq;
+  uint32_t bad_seq;
+  uint32_t probation;
+  uint32_t received;
+  uint64_t received_octets;
+  uint32_t expected_prior;
+  uint32_t received_prior;
+  uint32_t duplicates;
+  /** jitter in RTP timestamp units, scaled by 16 */
+  uint32_t jitter;
+  uint32_t transit;
+  bool     transit_valid;
+  unsigned int rx_clock_rate;
+
+  /* last SR from the remote side */
+  uint32_t last_sr;        // middle 32 bits of its NTP timestamp
+  uint64_t last_sr_recv;   // local NTP time when it was received
+  uint32_t rr_fraction_lost;
+
+  /* sender state */
+  AmMutex  tx_mut;
+  uint32_t sent;
+  uint32_t sent_octets;
+  uint32_t sent_prior;
+  uint32_t last_sent_ts;
+  uint64_t last_sent_time; // usec, monotonic
+  unsigned int tx_clock_rate;
+
+  /* what the remote side reports about our stream */
+  uint32_t rtt;            // 1/65536 s
+  bool     rtt_valid;
+  uint32_t remote_fraction_lost;
+  int32_t  remote_cum_lost;
+  uint32_t remote_jitter;
+  uint32_t sr_sent;
+  uint32_t rr_sent;
+  uint32_t rtcp_recv;
+
+  void initSeq(uint16_t seq);
+  /** @return false if the packet is to be discarded (probation) */
+  bool updateSeq(uint16_t seq);
+
+  uint32_t extendedMax() const { return cycles + max_seq; }
+  int32_t cumulativeLost() const;
+
+  /** write a report block about the remote source; rx_mut locked */
+  unsigned char* writeReportBlock(unsigned char* p, uint64_t now_ntp);
+
+  void parseReportBlock(const unsigned char* p, uint32_t l_ssrc,
+			uint64_t now_ntp);
+
+public:
+  AmRtcpStats();
+
+  /** forget about the remote source (e.g. after a re-INVITE) */
+  void reset();
+
+  /** clock rates used for jitter and SR timestamps */
+  void setClockRates(unsigned int rx_rate, unsigned int tx_rate);
+
+  /**
+   * Account a received RTP packet.
+   * @param now_us monotonic arrival time in microseconds
+   */
+  void rtpReceived(uint32_t ssrc, uint16_t seq, uint32_t ts,
+		   unsigned int payload_len, uint64_t now_us);
+
+  /**
+   * Account a sent RTP packet.
+   * @param now_us monotonic send time in microseconds
+   */
+  void rtpSent(uint32_t ts, unsigned int payload_len, uint64_t now_us);
+
+  /**
+   * Process a received compound RTCP packet.
+   * @return false if the packet could not be parsed
+   */
+  bool rtcpReceived(const unsigned char* buf, unsigned int len,
+		    uint32_t l_ssrc);
+
+  /**
+   * Build a compound RTCP packet: SR if RTP was sent since the last
+   * report, RR otherwise, followed by SDES CNAME.
+   * @return length of the packet, 0 on error
+   */
+  unsigned int buildReport(unsigned char* buf, unsigned int size,
+			   uint32_t l_ssrc, const string& cname);
+
+  /** fill ret with the stream statistics */
+  void getInfo(AmArg& ret);
+
+  /** current wall clock as 64 bit NTP timestamp */
+  static uint64_t ntpNow();
+  /** monotonic clock in microseconds */
+  static uint64_t monotonicUs();
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
@@ -303,6 +303,29 @@ int AmRtpAudio::put(unsigned long long system_ts, unsigned char* buffer,
     return s;
   }
 
+  return send(rtpTimestamp(system_ts),(unsigned char*)samples,s);
+}
+
+int AmRtpAudio::putEncoded(unsigned long long system_ts, AmAudio* audio,
+			   unsigned char* buffer)
+{
+  if (!fmt.get())
+    return AM_AUDIO_NOT_ENCODED;
+
+  int size = audio->getEncoded(system_ts, (AmAudioRtpFormat*)fmt.get(), buffer);
+  if (size <= 0)
+    return size;
+
+  last_send_ts_i = true;
+  last_send_ts = system_ts;
+
+  if (mute) return 0;
+
+  return send(rtpTimestamp(system_ts),buffer,size);
+}
+
+unsigned int AmRtpAudio::rtpTimestamp(unsigned long long system_ts)
+{
   AmAudioRtpFormat* rtp_fmt = (AmAudioRtpFormat*)fmt.get();
 
   // pre-division by 100 is important
@@ -312,7 +335,7 @@ int AmRtpAudio::put(unsigned long long system_ts, unsigned char* buffer,
     system_ts * ((unsigned long long)rtp_fmt->getTSRate() / 100)
     / (WALLCLOCK_RATE/100);
 
-  return send((unsigned int)user_ts,(unsigned char*)samples,s);
+  return (unsigned int)user_ts;
 }
 
 void AmRtpAudio::getSdpOffer(unsigned int index, SdpMedia& offer)
@@ -385,7 +408,9 @@ int AmRtpAudio::setCurrentPayload(int payload)
       return -1;
     }
     
+    rtcp_mut.lock();
     this->payload = payload;
+    rtcp_mut.unlock();
     int res = ((AmAudioRtpFormat*)fmt.get())->setCurrentPayload(payloads[index]);
 
     amci_codec_t* codec = fmt->getCodec();
@@ -123,6 +123,9 @@ class AmRtpAudio: public AmRtpStream, public AmAudio, public AmPLCBuffer
 			   unsigned int   channels,
 			   unsigned int   rate);
 
+  /** RTP timestamp of the current payload format for system_ts */
+  unsigned int rtpTimestamp(unsigned long long system_ts);
+
 public:
   AmRtpAudio(AmSession* _s, int _if);
   ~AmRtpAudio();
@@ -145,6 +148,14 @@ public:
   int put(unsigned long long system_ts, unsigned char* buffer, 
 	  int input_sample_rate, unsigned int size);
 
+  /**
+   * Send the next frame of audio if it comes encoded in the current
+   * payload format (see AmAudio::getEncoded())
+   * @return like put(), AM_AUDIO_NOT_ENCODED if audio only has samples
+   */
+  int putEncoded(unsigned long long system_ts, AmAudio* audio,
+		 unsigned char* buffer);
+
   unsigned int bytes2samples(unsigned int) const;
 
   // AmRtpStream interface
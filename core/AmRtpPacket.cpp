@@ -45,8 +45,9 @@
 
 #include "sip/msg_logger.h"
 
-AmRtpPacket::AmRtpPacket()
-  : data_offset(0)
+AmRtpPacket::AmRtpPacket(unsigned char* buf, unsigned int buf_size)
+  : buffer(buf), buffer_size(buf_size),
+    b_size(0), data_offset(0), d_size(0)
 {
   // buffer will be overwritten by received packet 
   // of hdr+data - does not need to be set to 0s
@@ -132,12 +133,12 @@ int AmRtpPacket::compile(unsigned char* data_buf, unsigned int size)
 
   d_size = size;
   b_size = d_size + sizeof(rtp_hdr_t);
-  assert(b_size <= 4096);
+  assert(b_size <= RTP_PACKET_BUF_SIZE);
   rtp_hdr_t* hdr = (rtp_hdr_t*)buffer;
 
-  if(b_size>sizeof(buffer)){
-    ERROR("builtin buffer size (%d) exceeded: %d\n",
-	  (int)sizeof(buffer), b_size);
+  if(b_size>buffer_size){
+    ERROR("packet buffer size (%u) exceeded: %u\n",
+	  buffer_size, b_size);
     return -1;
   }
 
@@ -161,9 +162,9 @@ int AmRtpPacket::compile_raw(unsigned char* data_buf, unsigned int size)
   if ((!size) || (!data_buf))
     return -1;
 
-  if(size>sizeof(buffer)){
-    ERROR("builtin buffer size (%d) exceeded: %d\n",
-	  (int)sizeof(buffer), size);
+  if(size>buffer_size){
+    ERROR("packet buffer size (%u) exceeded: %u\n",
+	  buffer_size, size);
     return -1;
   }
 
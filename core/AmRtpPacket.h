@@ -40,10 +40,20 @@ class AmRtpTransport;
 
 class msg_logger;
 
-/** \brief RTP packet implementation */
+/** size of the largest RTP packet we are able to handle */
+#define RTP_PACKET_BUF_SIZE 4096
+
+/**
+ * \brief RTP packet implementation
+ *
+ * The packet buffer is not part of the packet itself: received packets
+ * get their buffer from the AmRtpPacketPool, packets which are compiled
+ * on the stack for sending use AmRtpPacketBuf.
+ */
 class AmRtpPacket {
 
-  unsigned char  buffer[4096];
+  unsigned char* buffer;
+  unsigned int   buffer_size;
   unsigned int   b_size;
 
   unsigned int   data_offset;
@@ -59,7 +69,7 @@ public:
 
   struct timeval recv_time;
 
-  AmRtpPacket();
+  AmRtpPacket(unsigned char* buf, unsigned int buf_size);
   ~AmRtpPacket();
 
   // returns -1 if error, else 0
@@ -76,10 +86,24 @@ public:
   unsigned char* getBuffer();
   void setBufferSize(unsigned int b) { b_size = b; }
 
+  /** maximum packet size which fits into the buffer */
+  unsigned int   getBufferCapacity() const { return buffer_size; }
+
   static bool isPacketRtp(unsigned char *buffer, size_t len);
   static bool isPacketRtcp(unsigned char *buffer, size_t len);
 };
 
+/** \brief RTP packet with a built-in buffer of maximum size */
+class AmRtpPacketBuf
+  : public AmRtpPacket
+{
+  unsigned char storage[RTP_PACKET_BUF_SIZE];
+
+public:
+  AmRtpPacketBuf()
+    : AmRtpPacket(storage, sizeof(storage)) {}
+};
+
 #endif
 
 
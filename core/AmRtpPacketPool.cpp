@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "AmRtpPacketPool.h"
+#include "AmConfig.h"
+#include "AmArg.h"
+#include "log.h"
+
+#include <new>
+
+const unsigned int AmRtpPacketPool::class_sizes[RTP_POOL_SIZE_CLASSES] = {
+  256,                 // narrow band voice (G.711/G.729/GSM, up to 30 ms)
+  512,                 // wide band voice, larger ptime
+  1472,                // max. UDP payload on an Ethernet MTU (video)
+  RTP_PACKET_BUF_SIZE  // anything bigger (fragmented / jumbo frames)
+};
+
+struct AmRtpPacketPool::Packet
+  : public AmRtpPacket
+{
+  Packet*      next;
+  unsigned int cls;
+
+  Packet(unsigned char* buf, unsigned int size, unsigned int cls)
+    : AmRtpPacket(buf, size), next(NULL), cls(cls) {}
+};
+
+struct AmRtpPacketPool::ThreadCache
+{
+  FreeList lists[RTP_POOL_SIZE_CLASSES];
+
+  ~ThreadCache()
+  {
+    for(unsigned int cls = 0; cls < RTP_POOL_SIZE_CLASSES; cls++) {
+      if(lists[cls].len)
+        AmRtpPacketPool::instance()->spill(cls, lists[cls], lists[cls].len);
+    }
+  }
+};
+
+thread_local AmRtpPacketPool::ThreadCache AmRtpPacketPool::thread_cache;
+
+void AmRtpPacketPool::FreeList::push(Packet* p)
+{
+  p->next = head;
+  head = p;
+  len++;
+}
+
+AmRtpPacketPool::Packet* AmRtpPacketPool::FreeList::pop()
+{
+  Packet* p = head;
+  if(p) {
+    head = p->next;
+    p->next = NULL;
+    len--;
+  }
+  return p;
+}
+
+unsigned int AmRtpPacketPool::FreeList::move(FreeList& dst, unsigned int n)
+{
+  unsigned int moved = 0;
+  for(; moved < n && head; moved++)
+    dst.push(pop());
+  return moved;
+}
+
+AmRtpPacketPool::AmRtpPacketPool()
+  : total_allocated(0)
+{
+}
+
+AmRtpPacketPool::~AmRtpPacketPool()
+{
+  for(unsigned int cls = 0; cls < RTP_POOL_SIZE_CLASSES; cls++) {
+    SizeClass& sc = classes[cls];
+    while(Packet* p = sc.spill.pop())
+      destroy(p);
+  }
+}
+
+AmRtpPacketPool::Packet* AmRtpPacketPool::create(unsigned int cls)
+{
+  unsigned int max_packets = AmConfig::RtpPacketPoolMax;
+  if(max_packets && (total_allocated.fetch_add(1) >= max_packets)) {
+    total_allocated--;
+    return NULL;
+  }
+  else if(!max_packets) {
+    total_allocated++;
+  }
+
+  unsigned int size = class_sizes[cls];
+  unsigned char* mem = (unsigned char*)::operator new(sizeof(Packet) + size);
+  classes[cls].allocated++;
+
+  return new (mem) Packet(mem + sizeof(Packet), size, cls);
+}
+
+void AmRtpPacketPool::destroy(Packet* p)
+{
+  classes[p->cls].allocated--;
+  total_allocated--;
+
+  p->~Packet();
+  ::operator delete((void*)p);
+}
+
+AmRtpPacketPool::Packet* AmRtpPacketPool::refill(unsigned int cls, FreeList& cache)
+{
+  SizeClass& sc = classes[cls];
+
+  sc.spill_mut.lock();
+  sc.spill.move(cache, RTP_POOL_BATCH);
+  sc.spill_mut.unlock();
+
+  if(cache.len) {
+    sc.spill_hits++;
+    return cache.pop();
+  }
+
+  Packet* p = create(cls);
+  if(p) return p;
+
+  // pool limit reached: try to borrow
+  // a free packet from a bigger size class
+  for(unsigned int c = cls + 1; c < RTP_POOL_SIZE_CLASSES; c++) {
+    classes[c].spill_mut.lock();
+    p = classes[c].spill.pop();
+    classes[c].spill_mut.unlock();
+    if(p) return p;
+  }
+
+  return NULL;
+}
+
+void AmRtpPacketPool::spill(unsigned int cls, FreeList& cache, unsigned int n)
+{
+  SizeClass& sc = classes[cls];
+  FreeList surplus;
+
+  sc.spill_mut.lock();
+  cache.move(sc.spill, n);
+  if(sc.spill.len > AmConfig::RtpPacketPoolSpill)
+    sc.spill.move(surplus, sc.spill.len - AmConfig::RtpPacketPoolSpill);
+  sc.spill_mut.unlock();
+
+  while(Packet* p = surplus.pop())
+    destroy(p);
+}
+
+AmRtpPacket* AmRtpPacketPool::alloc(unsigned int size)
+{
+  unsigned int cls = 0;
+  while((cls < RTP_POOL_SIZE_CLASSES) && (class_sizes[cls] < size))
+    cls++;
+
+  if(cls == RTP_POOL_SIZE_CLASSES) {
+    ERROR("RTP packet too big for packet pool (%u)\n", size);
+    return NULL;
+  }
+
+  FreeList& cache = thread_cache.lists[cls];
+  Packet* p = cache.pop();
+  if(!p) p = refill(cls, cache);
+
+  if(!p) {
+    classes[cls].exhausted++;
+    return NULL;
+  }
+
+  classes[p->cls].in_use++;
+  return p;
+}
+
+void AmRtpPacketPool::release(AmRtpPacket* rp)
+{
+  Packet* p = static_cast<Packet*>(rp);
+  unsigned int cls = p->cls;
+
+  classes[cls].in_use--;
+
+  FreeList& cache = thread_cache.lists[cls];
+  cache.push(p);
+
+  if(cache.len > RTP_POOL_THREAD_CACHE)
+    spill(cls, cache, RTP_POOL_BATCH);
+}
+
+void AmRtpPacketPool::getInfo(AmArg& ret)
+{
+  ret["allocated"] = (int)total_allocated;
+  ret["max"] = (int)AmConfig::RtpPacketPoolMax;
+
+  AmArg& cls_info = ret["classes"];
+  cls_info.assertArray();
+
+  for(unsigned int cls = 0; cls < RTP_POOL_SIZE_CLASSES; cls++) {
+    SizeClass& sc = classes[cls];
+    AmArg c;
+
+    sc.spill_mut.lock();
+    c["spilled"] = (int)sc.spill.len;
+    sc.spill_mut.unlock();
+
+    c["size"] = (int)class_sizes[cls];
+    c["allocated"] = (int)sc.allocated;
+    c["in_use"] = (int)sc.in_use;
+    c["spill_hits"] = (long int)sc.spill_hits;
+    c["exhausted"] = (long int)sc.exhausted;
+
+    cls_info.push(c);
+  }
+}
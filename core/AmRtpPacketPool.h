@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmRtpPacketPool.h */
+#ifndef _AmRtpPacketPool_h_
+#define _AmRtpPacketPool_h_
+
+#include "AmRtpPacket.h"
+#include "AmThread.h"
+#include "singleton.h"
+
+#include <atomic>
+
+class AmArg;
+
+/** number of packet size classes */
+#define RTP_POOL_SIZE_CLASSES 4
+
+/** max. number of free packets per size class cached by one thread */
+#define RTP_POOL_THREAD_CACHE 128
+
+/** number of packets moved at once between a thread cache and the pool */
+#define RTP_POOL_BATCH 32
+
+/**
+ * \brief process-wide pool of RTP packets
+ *
+ * Packets are handed out by size class, so that a G.711 packet does
+ * not occupy a buffer large enough for a video frame. Every thread
+ * keeps a small per size class free-list, from which it allocates and
+ * to which it frees without locking; surplus packets are spilled in
+ * batches to a global free-list, which is bounded by
+ * AmConfig::RtpPacketPoolSpill. Beyond that, packets are released
+ * to the heap.
+ *
+ * The total number of packets in existence may be limited with
+ * AmConfig::RtpPacketPoolMax; if the limit is reached, alloc()
+ * fails and the exhaustion counter is incremented.
+ */
+class AmRtpPacketPool
+  : public singleton<AmRtpPacketPool>
+{
+  friend class singleton<AmRtpPacketPool>;
+
+public:
+  struct Packet;
+
+  /** free-list of pooled packets */
+  struct FreeList {
+    Packet*      head;
+    unsigned int len;
+
+    FreeList() : head(NULL), len(0) {}
+
+    void push(Packet* p);
+    Packet* pop();
+    /** move up to n packets from this list to dst */
+    unsigned int move(FreeList& dst, unsigned int n);
+  };
+
+private:
+  /** per thread free-lists */
+  struct ThreadCache;
+  static thread_local ThreadCache thread_cache;
+
+  struct SizeClass {
+    AmMutex  spill_mut;
+    FreeList spill;
+
+    /** packets allocated from the heap (used or free) */
+    std::atomic<unsigned int> allocated;
+    /** packets handed out to streams */
+    std::atomic<unsigned int> in_use;
+    /** number of failed allocations */
+    std::atomic<unsigned long> exhausted;
+    /** allocations served by the spill list */
+    std::atomic<unsigned long> spill_hits;
+
+    SizeClass()
+      : allocated(0), in_use(0), exhausted(0), spill_hits(0) {}
+  };
+
+  static const unsigned int class_sizes[RTP_POOL_SIZE_CLASSES];
+
+  SizeClass classes[RTP_POOL_SIZE_CLASSES];
+
+  /** packets allocated from the heap over all size classes */
+  std::atomic<unsigned int> total_allocated;
+
+  AmRtpPacketPool();
+  ~AmRtpPacketPool();
+
+  Packet* create(unsigned int cls);
+  void destroy(Packet* p);
+
+  /** refill a thread cache from the spill list or the heap */
+  Packet* refill(unsigned int cls, FreeList& cache);
+  /** return surplus packets of a thread cache to the spill list */
+  void spill(unsigned int cls, FreeList& cache, unsigned int n);
+
+public:
+  /**
+   * Get a packet able to hold at least size bytes.
+   * @return NULL if the pool is exhausted or size is too large
+   */
+  AmRtpPacket* alloc(unsigned int size);
+
+  /** Return a packet obtained by alloc() to the pool */
+  void release(AmRtpPacket* p);
+
+  /** fill ret with the pool occupancy and exhaustion counters */
+  void getInfo(AmArg& ret);
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
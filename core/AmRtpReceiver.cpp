@@ -30,6 +30,7 @@
 #include "AmRtpPacket.h"
 #include "log.h"
 #include "AmConfig.h"
+#include "AmArg.h"
 
 #include <errno.h>
 
@@ -53,7 +54,25 @@ AmRtpReceiver::~AmRtpReceiver()
   delete [] receivers;
 }
 
+void AmRtpRecvBatch::reset(unsigned int n)
+{
+  for(unsigned int i=0; i<n; i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len  = sizeof(buffers[i]);
+
+    msgs[i].msg_hdr.msg_name       = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen    = sizeof(addrs[i]);
+    msgs[i].msg_hdr.msg_iov        = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen     = 1;
+    msgs[i].msg_hdr.msg_control    = NULL;
+    msgs[i].msg_hdr.msg_controllen = 0;
+    msgs[i].msg_hdr.msg_flags      = 0;
+    msgs[i].msg_len = 0;
+  }
+}
+
 AmRtpReceiverThread::AmRtpReceiverThread()
+  : wakeups(0), packets(0), max_batch(0)
 {
   // libevent event base
   ev_base = event_base_new();
@@ -92,6 +111,32 @@ struct event_base* AmRtpReceiverThread::getBase() {
   return ev_base;
 }
 
+AmRtpRecvBatch* AmRtpReceiverThread::getRecvBatch()
+{
+  if(!recv_batch)
+    recv_batch.reset(new AmRtpRecvBatch());
+  return recv_batch.get();
+}
+
+void AmRtpReceiverThread::countReceived(unsigned int n)
+{
+  wakeups.fetch_add(1, std::memory_order_relaxed);
+  packets.fetch_add(n, std::memory_order_relaxed);
+  if(n > max_batch.load(std::memory_order_relaxed))
+    max_batch.store(n, std::memory_order_relaxed);
+}
+
+void AmRtpReceiverThread::getInfo(AmArg& ret)
+{
+  unsigned long w = wakeups;
+  unsigned long p = packets;
+
+  ret["wakeups"] = (long int)w;
+  ret["packets"] = (long int)p;
+  ret["packets_per_wakeup"] = w ? (double)p / (double)w : 0.0;
+  ret["max_batch"] = (int)max_batch;
+}
+
 void AmRtpReceiver::start()
 {
   for(unsigned int i=0; i<n_receivers; i++)
@@ -99,7 +144,26 @@ void AmRtpReceiver::start()
 }
 
 struct event_base* AmRtpReceiver::getBase(int sd)
+{
+  return getReceiverThread(sd)->getBase();
+}
+
+AmRtpReceiverThread* AmRtpReceiver::getReceiverThread(int sd)
 {
   unsigned int i = sd % n_receivers;
-  return receivers[i].getBase();
+  return &receivers[i];
+}
+
+void AmRtpReceiver::getInfo(AmArg& ret)
+{
+  ret["batch"] = (int)AmConfig::RtpReceiveBatch;
+
+  AmArg& threads = ret["threads"];
+  threads.assertArray();
+
+  for(unsigned int i=0; i<n_receivers; i++) {
+    AmArg t;
+    receivers[i].getInfo(t);
+    threads.push(t);
+  }
 }
@@ -29,15 +29,38 @@
 #define _AmRtpReceiver_h_
 
 #include "AmThread.h"
+#include "AmRtpPacket.h"
 #include "atomic_types.h"
 #include "singleton.h"
 
 #include <event2/event.h>
+#include <sys/socket.h>
 
 #include <map>
+#include <memory>
 using std::greater;
 
 class _AmRtpReceiver;
+class AmArg;
+
+/** max. number of datagrams read with one recvmmsg() call */
+#define RTP_RECV_BATCH_MAX 64
+
+/**
+ * \brief receive buffers for reading a batch of datagrams at once
+ *
+ * One per receiver thread, shared by all sockets served by that thread.
+ */
+struct AmRtpRecvBatch
+{
+  struct mmsghdr   msgs[RTP_RECV_BATCH_MAX];
+  struct iovec     iov[RTP_RECV_BATCH_MAX];
+  sockaddr_storage addrs[RTP_RECV_BATCH_MAX];
+  unsigned char    buffers[RTP_RECV_BATCH_MAX][RTP_PACKET_BUF_SIZE];
+
+  /** re-arm the message headers before the next recvmmsg() */
+  void reset(unsigned int n);
+};
 
 /**
  * \brief receiver for RTP for all RTP transports.
@@ -52,6 +75,15 @@ class AmRtpReceiverThread
   struct event_base* ev_base;
   struct event*      ev_default;
 
+  std::unique_ptr<AmRtpRecvBatch> recv_batch;
+
+  /** socket read events */
+  std::atomic<unsigned long> wakeups;
+  /** datagrams read */
+  std::atomic<unsigned long> packets;
+  /** largest number of datagrams read on one wakeup */
+  std::atomic<unsigned int>  max_batch;
+
 public:    
   AmRtpReceiverThread();
   ~AmRtpReceiverThread();
@@ -61,6 +93,14 @@ public:
   const char *identify() { return "RTP receiver"; }
 
   struct event_base* getBase();
+
+  /** batch receive buffers, only to be used from within this thread */
+  AmRtpRecvBatch* getRecvBatch();
+
+  /** account n datagrams read on one socket wakeup */
+  void countReceived(unsigned int n);
+
+  void getInfo(AmArg& ret);
 };
 
 class AmRtpReceiver : public singleton<AmRtpReceiver>
@@ -80,6 +120,12 @@ public:
   void start();
 
   struct event_base* getBase(int sd);
+
+  /** receiver thread serving the socket sd */
+  AmRtpReceiverThread* getReceiverThread(int sd);
+
+  /** fill ret with the receive statistics of all receiver threads */
+  void getInfo(AmArg& ret);
 };
 
 #endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "AmRtpSendBatch.h"
+#include "AmRtpPacketPool.h"
+#include "AmArg.h"
+#include "sip/ip_util.h"
+#include "log.h"
+
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+
+thread_local AmRtpSendBatch* AmRtpSendBatch::current = NULL;
+
+AmRtpSendBatch::AmRtpSendBatch()
+  : pool(AmRtpPacketPool::instance()),
+    packets(0), syscalls(0)
+{
+}
+
+AmRtpSendBatch::~AmRtpSendBatch()
+{
+  // release whatever has not been flushed
+  for(size_t i = 0; i < entries.size(); i++)
+    pool->release(entries[i].p);
+
+  if(current == this)
+    current = NULL;
+}
+
+void AmRtpSendBatch::begin()
+{
+  current = this;
+}
+
+bool AmRtpSendBatch::queue(int sd, const unsigned char* buf, size_t len,
+			   const sockaddr_storage* addr)
+{
+  AmRtpSendBatch* batch = current;
+  if(!batch)
+    return false;
+
+  AmRtpPacket* p = batch->pool->alloc(len);
+  if(!p)
+    return false;
+
+  p->compile_raw((unsigned char*)buf, len);
+
+  Entry e;
+  e.sd = sd;
+  memcpy(&e.addr, addr, SA_len(addr));
+  e.p = p;
+  batch->entries.push_back(e);
+
+  return true;
+}
+
+void AmRtpSendBatch::sendRun(size_t begin, size_t end)
+{
+  size_t n = end - begin;
+
+  for(size_t i = 0; i < n; i++) {
+    Entry& e = entries[begin + i];
+
+    iov[i].iov_base = e.p->getBuffer();
+    iov[i].iov_len  = e.p->getBufferSize();
+
+    memset(&msgs[i], 0, sizeof(struct mmsghdr));
+    msgs[i].msg_hdr.msg_name    = &e.addr;
+    msgs[i].msg_hdr.msg_namelen = SA_len(&e.addr);
+    msgs[i].msg_hdr.msg_iov     = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+  }
+
+  int sd = entries[begin].sd;
+  size_t sent = 0;
+
+  while(sent < n) {
+    int res = sendmmsg(sd, &msgs[sent], n - sent, 0);
+    syscalls.fetch_add(1, std::memory_order_relaxed);
+
+    if(res < 0) {
+      if(errno == EINTR)
+	continue;
+
+      ERROR("while sending data: %s\n", strerror(errno));
+      // skip the packet which failed
+      sent++;
+      continue;
+    }
+
+    sent += res;
+    packets.fetch_add(res, std::memory_order_relaxed);
+  }
+}
+
+void AmRtpSendBatch::flush()
+{
+  if(current == this)
+    current = NULL;
+
+  if(entries.empty())
+    return;
+
+  // group by socket, keeping the order of the packets of each socket
+  std::stable_sort(entries.begin(), entries.end(),
+		   [](const Entry& a, const Entry& b) { return a.sd < b.sd; });
+
+  if(msgs.size() < entries.size()) {
+    msgs.resize(entries.size());
+    iov.resize(entries.size());
+  }
+
+  size_t run = 0;
+  for(size_t i = 1; i <= entries.size(); i++) {
+    if((i == entries.size()) || (entries[i].sd != entries[run].sd)) {
+      sendRun(run, i);
+      run = i;
+    }
+  }
+
+  for(size_t i = 0; i < entries.size(); i++)
+    pool->release(entries[i].p);
+
+  entries.clear();
+}
+
+void AmRtpSendBatch::getInfo(AmArg& ret)
+{
+  unsigned long p = packets;
+  unsigned long s = syscalls;
+
+  ret["packets"] = (long int)p;
+  ret["syscalls"] = (long int)s;
+  ret["packets_per_syscall"] = s ? (double)p / (double)s : 0.0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmRtpSendBatch.h */
+#ifndef _AmRtpSendBatch_h_
+#define _AmRtpSendBatch_h_
+
+#include <sys/socket.h>
+#include <atomic>
+#include <vector>
+
+class AmRtpPacket;
+class AmRtpPacketPool;
+class AmArg;
+
+/**
+ * \brief collects the RTP packets sent within one media processor tick
+ *
+ * While a batch is active in a thread (between begin() and flush()),
+ * AmRtpUdpSocket::sendRtp does not send the packet right away but
+ * copies it into a packet from the AmRtpPacketPool and queues it here.
+ * flush() then sends all packets queued for the same socket with one
+ * sendmmsg() call, keeping the order of packets per socket.
+ */
+class AmRtpSendBatch
+{
+  struct Entry {
+    int              sd;
+    sockaddr_storage addr;
+    AmRtpPacket*     p;
+  };
+
+  AmRtpPacketPool*            pool;
+  std::vector<Entry>          entries;
+  std::vector<struct mmsghdr> msgs;
+  std::vector<struct iovec>   iov;
+
+  /** batch active in the current thread */
+  static thread_local AmRtpSendBatch* current;
+
+  /** packets sent from the batch */
+  std::atomic<unsigned long> packets;
+  /** sendmmsg() calls */
+  std::atomic<unsigned long> syscalls;
+
+  /** send entries [begin, end) which all use the same socket */
+  void sendRun(size_t begin, size_t end);
+
+public:
+  AmRtpSendBatch();
+  ~AmRtpSendBatch();
+
+  /** start collecting packets sent from the calling thread */
+  void begin();
+
+  /** send the collected packets and stop collecting */
+  void flush();
+
+  /**
+   * Queue a packet in the batch active in the calling thread.
+   * @return false if no batch is active or the packet
+   *         could not be queued; it needs to be sent directly then.
+   */
+  static bool queue(int sd, const unsigned char* buf, size_t len,
+		    const sockaddr_storage* addr);
+
+  void getInfo(AmArg& ret);
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
@@ -54,7 +54,7 @@ AmRtpSocket::AmRtpSocket(AmRtpSocketPair* listener, int interface,
     l_if(interface),
     sys_if(AmConfig::RTP_Ifs[l_if].NetIfIdx),
     l_sd(0),
-    ev_base(NULL),ev_read(NULL),
+    receiver(NULL),ev_base(NULL),ev_read(NULL),
     is_udp(false)
 {
 
@@ -125,7 +125,8 @@ AmRtpSocket::AmRtpSocket(AmRtpSocketPair* listener, int interface,
     throw runtime_error("while setting local address reusable.");
   }
 
-  ev_base = AmRtpReceiver::instance()->getBase(l_sd);
+  receiver = AmRtpReceiver::instance()->getReceiverThread(l_sd);
+  ev_base = receiver->getBase();
 
   addToReceiver();
 }
@@ -183,9 +184,14 @@ void AmRtpSocket::removeFromReceiver()
  */
 void AmRtpSocket::recv()
 {
+  if (AmConfig::RtpReceiveBatch > 1) {
+    recvBatch(AmConfig::RtpReceiveBatch);
+    return;
+  }
+
   sockaddr_storage addr;
   socklen_t addr_len = sizeof(addr);
-  unsigned char buffer[4096];
+  unsigned char buffer[RTP_PACKET_BUF_SIZE];
   ssize_t len = recvfrom(l_sd,buffer,sizeof(buffer),0,(struct sockaddr*)&addr,
                      &addr_len);
 
@@ -202,9 +208,47 @@ void AmRtpSocket::recv()
     return;
   }
 
+  receiver->countReceived(1);
   recvData(buffer, len, addr);
 }
 
+/*
+ * Receive a batch of datagrams from network
+ */
+void AmRtpSocket::recvBatch(unsigned int n)
+{
+  if (n > RTP_RECV_BATCH_MAX)
+    n = RTP_RECV_BATCH_MAX;
+
+  AmRtpRecvBatch* batch = receiver->getRecvBatch();
+  batch->reset(n);
+
+  int cnt = recvmmsg(l_sd, batch->msgs, n, MSG_DONTWAIT, NULL);
+  if (cnt < 0) {
+    if((errno != EINTR) && (errno != EAGAIN)) {
+      ERROR("recvmmsg(%d): %s",l_sd,strerror(errno));
+    }
+    return;
+  }
+
+  receiver->countReceived(cnt);
+
+  for (int i = 0; i < cnt; i++) {
+    struct msghdr& hdr = batch->msgs[i].msg_hdr;
+    size_t len = batch->msgs[i].msg_len;
+
+    if (!len) {
+      ERROR("Received empty packet");
+      continue;
+    } else if (hdr.msg_flags & MSG_TRUNC) {
+      ERROR("Received huge RTP/RTCP packet (truncated to %zu)",len);
+      continue;
+    }
+
+    recvData(batch->buffers[i], len, batch->addrs[i]);
+  }
+}
+
 void AmRtpSocket::setRemoteAddress(const string& addr, unsigned short port)
 {
 
@@ -40,6 +40,7 @@ using std::shared_ptr;
 
 class AmRtpSocketPair;
 class AmRtpPacket;
+class AmRtpReceiverThread;
 class msg_logger;
 
 /*
@@ -47,8 +48,9 @@ class msg_logger;
  */
 class AmRtpSocket
 {
-  struct event_base* ev_base;
-  struct event*      ev_read;
+  AmRtpReceiverThread* receiver;
+  struct event_base*   ev_base;
+  struct event*        ev_read;
 
   bool isAttachedToReceiver();
 
@@ -103,6 +105,9 @@ public:
 
   void recv();
 
+  /** read up to n datagrams with one recvmmsg() call */
+  void recvBatch(unsigned int n);
+
   // TODO: Do we really need these twoo??? Try to remove them!
   inline sockaddr_storage* getRemoteSocket() { return &r_saddr; };
 
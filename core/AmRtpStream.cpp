@@ -46,6 +46,8 @@
 #include "sip/msg_logger.h"
 
 #include "log.h"
+#include "AmSessionContainer.h"
+#include "ampi/MonitoringAPI.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -105,7 +107,7 @@ void AmRtpStream::ping()
   ping_chr[0] = 0;
   ping_chr[1] = 0;
 
-  AmRtpPacket rp;
+  AmRtpPacketBuf rp;
   rp.version = 0;
   rp.payload = payload;
   rp.marker = true;
@@ -124,7 +126,7 @@ int AmRtpStream::compile_and_send(const int payload, bool marker, unsigned int t
   if (!rtp_transport)
     return 0;
 
-  AmRtpPacket rp;
+  AmRtpPacketBuf rp;
   rp.payload = payload;
   rp.timestamp = ts;
   rp.marker = marker;
@@ -135,6 +137,8 @@ int AmRtpStream::compile_and_send(const int payload, bool marker, unsigned int t
   if (rtp_transport->sendRtp(&rp) < 0)
     return -1;
 
+  rtcp_stats.rtpSent(ts, size, AmRtcpStats::monotonicUs());
+
   return size;
 }
 
@@ -171,7 +175,7 @@ int AmRtpStream::send_raw( char* packet, unsigned int length )
   if (!rtp_transport)
     return 0;
 
-  AmRtpPacket rp;
+  AmRtpPacketBuf rp;
   rp.compile_raw((unsigned char*)packet, length);
 
   if(rtp_transport->sendRtp(&rp) < 0){
@@ -257,13 +261,18 @@ AmRtpStream::AmRtpStream(AmSession* _s, int _if)
     rtp_keepalive_freq(0),
     rtp_timeout(0),
     rtp_keepalive_timer(this),
-    rtp_timer(this)
+    rtp_timer(this),
+    rtcp_timer(this),
+    rtcp_interval(0)
 {
 
   l_ssrc = get_random();
   sequence = get_random();
   clearRTPTimeout();
 
+  // random CNAME (RFC 7022)
+  rtcp_cname = int2hex(get_random(), true) + int2hex(get_random(), true);
+
   // by default the system codecs
   payload_provider = AmPlugIn::instance();
 
@@ -273,6 +282,9 @@ AmRtpStream::AmRtpStream(AmSession* _s, int _if)
 
     // RTP Timeout
     rtp_timeout = session->rtp_timeout;
+
+    // RTCP reports
+    rtcp_interval = AmConfig::RtcpReportInterval;
   }
 }
 
@@ -284,8 +296,13 @@ AmRtpStream::~AmRtpStream()
   if (rtp_timeout)
     AmAppTimer::instance()->removeTimer(&rtp_timer);
 
+  if (rtcp_interval)
+    AmAppTimer::instance()->removeTimer(&rtcp_timer);
+
   if (rtp_transport)
     rtp_transport->removeStream(this);
+
+  clearBuffers();
 }
 
 int AmRtpStream::getLocalRtpPort()
@@ -617,7 +634,9 @@ int AmRtpStream::init(const AmSdp& local,
     mute = true;
   }
 
+  rtcp_mut.lock();
   payload = getDefaultPT();
+  rtcp_mut.unlock();
   if(payload < 0) {
     DBG("could not set a default payload\n");
     return -1;
@@ -626,6 +645,13 @@ int AmRtpStream::init(const AmSdp& local,
   DBG("default payload selected = %i\n",payload);
   last_payload = payload;
 
+  // RTP clock of the default payload, for jitter and SR timestamps
+  PayloadMappingTable::iterator pl_it = pl_map.find(payload);
+  if (pl_it != pl_map.end() && pl_it->second.index < payloads.size()) {
+    unsigned int rate = payloads[pl_it->second.index].advertised_clock_rate;
+    rtcp_stats.setClockRates(rate, rate);
+  }
+
 
   active = false; // mark as nothing received yet
 
@@ -633,6 +659,11 @@ int AmRtpStream::init(const AmSdp& local,
   if (rtp_transport)
     rtp_transport->addStream(this);
 
+  // streams of a session are not resumed by anybody, start the
+  // reports here (re-arming an armed timer only replaces it)
+  if (session && rtcp_interval)
+    setRtcpTimer();
+
   return 0;
 }
 
@@ -651,15 +682,14 @@ void AmRtpStream::resume()
 {
   DBG("RTP Stream instance [%p] resuming (receiving=true, clearing biffers/TS/TO)\n", this);
   clearRTPTimeout();
-  receive_mut.lock();
-  mem.clear();
-  receive_buf.clear();
-  receive_mut.unlock();
+  clearBuffers();
   receiving = true;
 }
 
 void AmRtpStream::setOnHold(bool on_hold) {
+  rtcp_mut.lock();
   hold = on_hold;
+  rtcp_mut.unlock();
 }
 
 bool AmRtpStream::getOnHold() {
@@ -807,12 +837,13 @@ int AmRtpStream::nextPacket(AmRtpPacket*& p)
   return 1;
 }
 
-AmRtpPacket *AmRtpStream::reuseBufferedPacket()
+AmRtpPacket *AmRtpStream::reuseBufferedPacket(unsigned int size)
 {
   AmRtpPacket *p = NULL;
 
   receive_mut.lock();
-  if(!receive_buf.empty()) {
+  if(!receive_buf.empty() &&
+     (receive_buf.begin()->second->getBufferCapacity() >= size)) {
     p = receive_buf.begin()->second;
     receive_buf.erase(receive_buf.begin());
   }
@@ -820,10 +851,27 @@ AmRtpPacket *AmRtpStream::reuseBufferedPacket()
   return p;
 }
 
+void AmRtpStream::clearBuffers()
+{
+  receive_mut.lock();
+
+  for(ReceiveBuffer::iterator it = receive_buf.begin();
+      it != receive_buf.end(); ++it)
+    mem.freePacket(it->second);
+  receive_buf.clear();
+
+  while(!rtp_ev_qu.empty()) {
+    mem.freePacket(rtp_ev_qu.front());
+    rtp_ev_qu.pop();
+  }
+
+  receive_mut.unlock();
+}
+
 void AmRtpStream::recvRtpPacket(unsigned char* buffer, int size, sockaddr_storage& recv_addr)
 { 
-  AmRtpPacket* p = mem.newPacket();
-  if (!p) p = reuseBufferedPacket();
+  AmRtpPacket* p = mem.newPacket(size);
+  if (!p) p = reuseBufferedPacket(size);
   if (!p) {
     DBG("out of buffers for RTP packets (stream [%p])\n",
 	this);
@@ -843,6 +891,9 @@ void AmRtpStream::recvRtpPacket(unsigned char* buffer, int size, sockaddr_storag
       mem.freePacket(p);	  
       return;
     }
+
+    rtcp_stats.rtpReceived(p->ssrc, p->sequence, p->timestamp,
+			   p->getDataSize(), AmRtcpStats::monotonicUs());
   }
 
   bufferPacket(p, recv_addr);
@@ -852,6 +903,9 @@ void AmRtpStream::recvRtcpPacket(unsigned char* buffer, int recved_bytes, sockad
 {
   static const cstring empty;
 
+  if (!rtcp_stats.rtcpReceived(buffer, recved_bytes, l_ssrc))
+    DBG("malformed RTCP packet received (stream [%p])\n", this);
+
   if(!relay_enabled || !relay_stream)
     return;
 
@@ -946,12 +1000,16 @@ void AmRtpStream::setRelayPayloads(const PayloadMask &_relay_payloads)
 
 void AmRtpStream::enableRtpRelay() {
   DBG("enabled RTP relay for RTP stream instance [%p]\n", this);
+  rtcp_mut.lock();
   relay_enabled = true;
+  rtcp_mut.unlock();
 }
 
 void AmRtpStream::disableRtpRelay() {
   DBG("disabled RTP relay for RTP stream instance [%p]\n", this);
+  rtcp_mut.lock();
   relay_enabled = false;
+  rtcp_mut.unlock();
 }
 
 void AmRtpStream::enableRawRelay()
@@ -996,6 +1054,9 @@ void AmRtpStream::stopReceiving()
   if (rtp_timeout)
     AmAppTimer::instance()->removeTimer(&rtp_timer);
 
+  if (rtcp_interval)
+    AmAppTimer::instance()->removeTimer(&rtcp_timer);
+
   bool onhold = getOnHold();
 
   if (rtp_transport) {
@@ -1019,11 +1080,26 @@ void AmRtpStream::resumeReceiving()
 
   if (rtp_timeout)
     AmAppTimer::instance()->setTimer(&rtp_timer,rtp_timeout);
+
+  if (rtcp_interval)
+    setRtcpTimer();
 }
 
 
 void AmRtpStream::changeSession(AmSession *_s)
 {
+  if(!_s) {
+    // the destructor only removes the timers still configured; waits
+    // for a timer being fired (rtcp_mut must not be held here)
+    if (rtp_keepalive_freq)
+      AmAppTimer::instance()->removeTimer(&rtp_keepalive_timer);
+    if (rtp_timeout)
+      AmAppTimer::instance()->removeTimer(&rtp_timer);
+    if (rtcp_interval)
+      AmAppTimer::instance()->removeTimer(&rtcp_timer);
+  }
+
+  rtcp_mut.lock();
   session = _s;
   if(!_s) {
     // we assume the stream has already been removed from the transport...
@@ -1031,6 +1107,7 @@ void AmRtpStream::changeSession(AmSession *_s)
 
     rtp_keepalive_freq = 0;
     rtp_timeout = 0;
+    rtcp_interval = 0;
   }
   else {
     // TODO:
@@ -1043,7 +1120,11 @@ void AmRtpStream::changeSession(AmSession *_s)
 
     // RTP Timeout
     rtp_timeout = session->rtp_timeout;
+
+    // RTCP reports
+    rtcp_interval = AmConfig::RtcpReportInterval;
   }
+  rtcp_mut.unlock();
 }
 
 string AmRtpStream::getPayloadName(int payload_type)
@@ -1058,54 +1139,35 @@ string AmRtpStream::getPayloadName(int payload_type)
 }
 
 PacketMem::PacketMem()
-  : cur_idx(0), n_used(0)
+  : pool(AmRtpPacketPool::instance()), n_used(0)
 {
-  memset(used, 0, sizeof(used));
 }
 
-inline AmRtpPacket* PacketMem::newPacket() 
+inline AmRtpPacket* PacketMem::newPacket(unsigned int size)
 {
   if(n_used >= MAX_PACKETS)
     return NULL; // full
 
-  while(used[cur_idx])
-    cur_idx = (cur_idx + 1) & MAX_PACKETS_MASK;
-
-  used[cur_idx] = true;
-  n_used++;
-
-  AmRtpPacket* p = &packets[cur_idx];
-  cur_idx = (cur_idx + 1) & MAX_PACKETS_MASK;
+  AmRtpPacket* p = pool->alloc(size);
+  if(p) n_used++;
 
   return p;
 }
 
-inline void PacketMem::freePacket(AmRtpPacket* p) 
+inline void PacketMem::freePacket(AmRtpPacket* p)
 {
   if (!p)  return;
 
-  int idx = p-packets;
-  assert(idx >= 0);
-  assert(idx < MAX_PACKETS);
-
-  if(!used[idx]) {
-    ERROR("freePacket() double free: n_used = %d, idx = %d",n_used,idx);
-    return;
-  }
-
-  used[p-packets] = false;
+  assert(n_used > 0);
   n_used--;
-}
-
-inline void PacketMem::clear() 
-{
-  memset(used, 0, sizeof(used));
-  n_used = cur_idx = 0;
+  pool->release(p);
 }
 
 void AmRtpStream::setRtpTransport(AmRtpTransport* rtp_transport)
 {
+  rtcp_mut.lock();
   this->rtp_transport = rtp_transport;
+  rtcp_mut.unlock();
 }
 
 AmRtpTransport* AmRtpStream::getRtpTransport()
@@ -1191,6 +1253,74 @@ void AmRtpStream::onRtpTimeout()
   }
 }
 
+void AmRtpStream::setRtcpTimer()
+{
+  // RFC 3550 6.3.1: randomize to [0.5, 1.5] times the interval
+  double t = rtcp_interval * (0.5 + (get_random() % 1000) / 1000.0);
+  AmAppTimer::instance()->setTimer(&rtcp_timer, t / 1000.0);
+}
+
+void AmRtpStream::sendRtcpReport()
+{
+  unsigned char buf[RTCP_REPORT_MAX_SIZE];
+
+  unsigned int len = rtcp_stats.buildReport(buf, sizeof(buf), l_ssrc, rtcp_cname);
+  if (!len)
+    return;
+
+  if (rtp_transport->sendRtcp(buf, len) < 0)
+    DBG("could not send RTCP report: %s\n", strerror(errno));
+}
+
+void AmRtpStream::onRtcpTimeout()
+{
+  // the session thread changes the stream meanwhile
+  rtcp_mut.lock();
+  if (!session || !rtcp_interval) {
+    rtcp_mut.unlock();
+    return;
+  }
+
+  // relayed streams carry the reports of the remote ends
+  if (rtp_transport && rtp_transport->getLocalRtpPort() &&
+      !hold && !relay_enabled && rtp_transport->getRemoteRtcpPort())
+    sendRtcpReport();
+
+#ifdef USE_MONITORING
+  string ltag;
+  AmArg info;
+  if (NULL != AmSessionContainer::monitoring_di) {
+    getInfo(info);
+    ltag = session->getLocalTag();
+  }
+#endif
+
+  setRtcpTimer();
+  rtcp_mut.unlock();
+
+#ifdef USE_MONITORING
+  if (!ltag.empty())
+    MONITORING_LOG(ltag.c_str(), ("rtp_" + int2str(sdp_media_index)).c_str(), info);
+#endif
+}
+
+void AmRtpStream::getInfo(AmArg& ret)
+{
+  ret["l_ssrc"] = (long int)l_ssrc;
+  ret["payload"] = payload;
+  ret["mute"] = mute;
+  ret["hold"] = hold;
+  ret["relay"] = relay_enabled;
+
+  if (rtp_transport) {
+    ret["local_port"] = getLocalRtpPort();
+    ret["remote_addr"] = getRemoteAddress();
+    ret["remote_port"] = getRemoteRtpPort();
+  }
+
+  rtcp_stats.getInfo(ret["stats"]);
+}
+
 AmRtpStream::Hook *AmRtpStream::setHook(Hook *h)
 {
   Hook *old = hook;
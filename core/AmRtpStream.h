@@ -33,9 +33,11 @@
 #include "AmThread.h"
 #include "SampleArray.h"
 #include "AmRtpPacket.h"
+#include "AmRtpPacketPool.h"
 #include "AmEvent.h"
 #include "AmDtmfSender.h"
 #include "AmAppTimer.h"
+#include "AmRtcpStats.h"
 
 #include <netinet/in.h>
 
@@ -43,6 +45,7 @@
 #include <map>
 #include <queue>
 #include <memory>
+#include <atomic>
 using std::string;
 using std::unique_ptr;
 using std::pair;
@@ -70,24 +73,21 @@ class msg_logger;
 
 /**
  * This provides the memory for the receive buffer.
+ * Packets are taken from the process-wide AmRtpPacketPool,
+ * at most MAX_PACKETS per stream.
  */
 struct PacketMem {
 #define MAX_PACKETS_BITS 5
 #define MAX_PACKETS (1<<MAX_PACKETS_BITS)
-#define MAX_PACKETS_MASK (MAX_PACKETS-1)
-
-  AmRtpPacket packets[MAX_PACKETS];
-  bool        used[MAX_PACKETS];
 
   PacketMem();
 
-  inline AmRtpPacket* newPacket();
+  inline AmRtpPacket* newPacket(unsigned int size);
   inline void freePacket(AmRtpPacket* p);
-  inline void clear();
 
 private:
-  unsigned int cur_idx;
-  unsigned int n_used;
+  AmRtpPacketPool* pool;
+  std::atomic<unsigned int> n_used;
 };
 
 /** \brief event fired on RTP timeout */
@@ -184,10 +184,26 @@ private:
     }
   };
 
+  class RtcpTimer
+    : public DirectAppTimer
+  {
+    AmRtpStream* stream;
+
+  public:
+    RtcpTimer(AmRtpStream* stream)
+      : stream(stream)
+    {}
+
+    void fire(){
+      stream->onRtcpTimeout();
+    }
+  };
+
 friend class AmSession;
 friend class AmRtpTransport;
 friend class KeepAliveTimer;
 friend class RtpTimer;
+friend class RtcpTimer;
 
 public:
 
@@ -217,6 +233,28 @@ protected:
 
   void onRtpTimeout();
 
+  /* RTCP report timer */
+  RtcpTimer rtcp_timer;
+
+  /** mean interval between RTCP reports in ms, 0 for none */
+  unsigned int rtcp_interval;
+
+  /** CNAME sent in the reports */
+  string rtcp_cname;
+
+  /** reception/transmission statistics, source of the reports */
+  AmRtcpStats rtcp_stats;
+
+  /**
+   * session, transport, hold, relay and payload as read by the RTCP
+   * timer (AppTimer thread)
+   */
+  AmMutex rtcp_mut;
+
+  void onRtcpTimeout();
+  void setRtcpTimer();
+  void sendRtcpReport();
+
   // payload collection
   typedef std::vector<Payload> PayloadCollection;
   
@@ -331,7 +369,10 @@ protected:
   int nextPacket(AmRtpPacket*& p);
   
   /** Try to reuse oldest buffered packet for newly coming packet */
-  AmRtpPacket *reuseBufferedPacket();
+  AmRtpPacket *reuseBufferedPacket(unsigned int size);
+
+  /** Return all buffered packets to the packet pool */
+  void clearBuffers();
 
   /** handle symmetric RTP/RTCP - if in passive mode, update raddr from rp */
   void handleSymmetricRtp(struct sockaddr_storage* recv_addr, bool rtcp);
@@ -550,6 +591,9 @@ public:
   void setRtpTransport(AmRtpTransport* rtp_transport);
 
   AmRtpTransport* getRtpTransport();
+
+  /** fill ret with addresses, payload and RTP/RTCP statistics */
+  void getInfo(AmArg& ret);
 };
 
 #endif
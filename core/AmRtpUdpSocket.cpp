@@ -30,6 +30,7 @@
 #include "AmRtpPacket.h"
 #include "AmStunPacket.h"
 #include "AmConfig.h"
+#include "AmRtpSendBatch.h"
 
 #include "sip/raw_sender.h"
 
@@ -141,6 +142,14 @@ int AmRtpUdpSocket::send(unsigned char* buffer, size_t len, int sys_if,
 
 int AmRtpUdpSocket::sendRtp(AmRtpPacket* rp)
 {
+  // queue into the media processor's send batch, if any
+  if ((_send == sendto) &&
+      AmRtpSendBatch::queue(l_sd, rp->getBuffer(), rp->getBufferSize(), &r_saddr)) {
+    if (logger)
+      logSent(rp->getBuffer(), rp->getBufferSize(), &r_saddr);
+    return 0;
+  }
+
   return send(rp->getBuffer(),(size_t)rp->getBufferSize());
 }
 
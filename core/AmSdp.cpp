@@ -56,7 +56,7 @@ const char* get_token(const char* s, const char* end, const char delim, const ch
 
 static MediaType media_type(const std::string& media);
 static TransProt transport_type(const std::string& transport);
-static bool attr_check(std::string attr);
+static bool attr_check(const std::string& attr);
 
 enum parse_st {SDP_DESCR, SDP_MEDIA};
 enum sdp_connection_st {NET_TYPE, ADDR_TYPE, IP4, IP6};
@@ -349,7 +349,9 @@ AmSdp::AmSdp(const AmSdp& p_sdp_msg)
     sessionName(p_sdp_msg.sessionName),
     conn(p_sdp_msg.conn),
     media(p_sdp_msg.media),
-    attributes(p_sdp_msg.attributes)
+    attributes(p_sdp_msg.attributes),
+    raw_body(p_sdp_msg.raw_body),
+    sections(p_sdp_msg.sections)
 {
 }
 
@@ -384,7 +386,8 @@ bool AmSdp::sdp_parse_rtcp()
         DBG("Re-setting rtcp address to '%s'\n", it->conn.address.c_str());
       }
 
-      it->rtcp_address.setPort(it->rtcp_address.getPort() + 1);
+      if (it->port > 0)
+        it->rtcp_address.setPort(it->port + 1);
     }
   }
   return true;
@@ -421,8 +424,8 @@ void AmSdp::sdp_parse_fingerprint()
     unsigned int pos = fingerprint.find(' ');
 
     if (pos != string::npos) {
-      dtls_hash = fingerprint.substr(0, pos);
-      dtls_fingerprint = fingerprint.substr(pos+1, fingerprint.size() - pos);
+      dtls_hash.assign(fingerprint, 0, pos);
+      dtls_fingerprint.assign(fingerprint, pos+1);
     }
 
     if (!dtls_hash.empty() && !dtls_fingerprint.empty()) {
@@ -454,22 +457,25 @@ void AmSdp::sdp_parse_ssrc()
   }
 }
 
-bool AmSdp::parse(const string& sdp_copy)
+bool AmSdp::parse(const string& sdp_copy, bool keep_body)
 {
   if (sdp_copy.empty()) {
     WARN("Nothing to parse.\n");
     return false;
   }
 
-  const char * sdp_msg = sdp_copy.c_str();
+  /* remove all values already parsed before */
+  clear();
+
+  if (keep_body)
+    raw_body = std::make_shared<const string>(sdp_copy);
+
+  const char * sdp_msg = keep_body ? raw_body->c_str() : sdp_copy.c_str();
   if (!sdp_msg) {
     WARN("Cannot duplicate SDP for parsing.\n");
     return false;
   }
 
-  /* remove all values already parsed before */
-  clear();
-
   /* returns true if parsed normally,
    * parses such things as session/media connection as well*/
   bool parsed = parse_sdp_line_ex(this, sdp_msg);
@@ -501,9 +507,143 @@ bool AmSdp::parse(const string& sdp_copy)
   sdp_parse_fingerprint();
   sdp_parse_ssrc();
 
+  if (keep_body)
+    indexSections();
+
   return parsed;
 }
 
+/**
+ * hash over the fields print() generates a section from
+ */
+struct SdpDigest
+{
+  uint64_t h;
+
+  SdpDigest() : h(0) { }
+
+  void add(uint64_t v) {
+    h = ((h << 5 | h >> 59) ^ v) * 0x9e3779b97f4a7c15ULL;
+  }
+
+  void add(const void* p, size_t len) {
+    add(len);
+    add(std::hash<std::string_view>()(std::string_view((const char*)p, len)));
+  }
+
+  void add(const string& s) { add(s.data(), s.size()); }
+
+  void add(const SdpConnection& c) {
+    add((uint64_t)c.addrType);
+    add(c.address);
+  }
+
+  void add(const RtcpAddress& r) {
+    add((uint64_t)r.port);
+    add((uint64_t)(r.explicitPort | r.explicitAddress << 1));
+    add(r.nettype);
+    add(r.addrtype);
+    add(r.address);
+  }
+
+  void add(const std::vector<SdpAttribute>& attrs) {
+    add((uint64_t)attrs.size());
+    for (const SdpAttribute& a : attrs) {
+      add(a.attribute);
+      add(a.value);
+    }
+  }
+};
+
+uint64_t AmSdp::sessionDigest() const
+{
+  SdpDigest d;
+  d.add((uint64_t)version);
+  d.add(origin.user);
+  d.add(&origin.sessId, sizeof(origin.sessId));
+  d.add(&origin.sessV, sizeof(origin.sessV));
+  d.add(origin.conn);
+  d.add(sessionName);
+  d.add(conn);
+  if (!media.empty())
+    d.add(media[0].conn.address); // o= line fallback
+  d.add(attributes);
+  return d.h;
+}
+
+unsigned int AmSdp::sessionDirections() const
+{
+  // session level direction attributes suppress the media level ones
+  return hasAttribute("sendrecv") | hasAttribute("sendonly") << 1 |
+    hasAttribute("recvonly") << 2 | hasAttribute("inactive") << 3;
+}
+
+uint64_t AmSdp::mediaDigest(const SdpMedia& m, unsigned int directions) const
+{
+  SdpDigest d;
+  d.add(directions);
+  d.add((uint64_t)m.type);
+  d.add(m.type_str);
+  d.add((uint64_t)m.port);
+  d.add((uint64_t)m.transport);
+  d.add(m.transport_str);
+  d.add(m.fmt);
+  d.add((uint64_t)m.payloads.size());
+  for (const SdpPayload& p : m.payloads) {
+    d.add((uint64_t)p.payload_type);
+    d.add(p.encoding_name);
+    d.add((uint64_t)p.clock_rate);
+    d.add((uint64_t)p.encoding_param);
+    d.add(p.sdp_format_parameters);
+  }
+  d.add(m.conn);
+  d.add((uint64_t)(m.send | m.recv << 1 | m.rtcp_mux << 2));
+  d.add(m.rtcp_address_orig);
+  d.add(m.rtcp_address);
+  d.add(m.attributes);
+  d.add(m.dtls_role);
+  d.add(m.dtls_hash);
+  d.add(m.dtls_fingerprint);
+  d.add(m.ice_username);
+  d.add(m.ice_password);
+  d.add((uint64_t)m.iceCandidates.size());
+  return d.h;
+}
+
+/**
+ * Split the kept body at the m= lines the same way the parser does
+ * and remember the digests of the sections as parsed.
+ */
+void AmSdp::indexSections()
+{
+  sections.clear();
+
+  std::string_view b(raw_body->c_str()); // the parser stops at '\0'
+  size_t start = 0;
+  for (size_t pos = 0; pos < b.size();) {
+    if (b[pos] == 'm') {
+      sections.push_back(Section{b.substr(start, pos - start), 0});
+      start = pos;
+    }
+    pos = b.find(LF, pos);
+    if (pos == string::npos)
+      break;
+    pos++;
+  }
+  sections.push_back(Section{b.substr(start), 0});
+
+  if (sections.size() != media.size() + 1) {
+    DBG("SDP sections do not match the media lines, not keeping them\n");
+    sections.clear();
+    return;
+  }
+
+  sections[0].digest = sessionDigest();
+  unsigned int directions = sessionDirections();
+  for (size_t i = 0; i < media.size(); i++)
+    sections[i + 1].digest = mediaDigest(media[i], directions);
+}
+
 string SdpIceCandidate::print() const
 {
 
@@ -520,159 +660,227 @@ string SdpIceCandidate::print() const
   return buf;
 }
 
-void AmSdp::print(string& body) const
+static void print_attribute(const SdpAttribute& a, string& out_buf)
 {
-  string out_buf = "v="+int2str(version)+"\r\n"
-    "o="+origin.user+" "+int2str(origin.sessId)+" "+
-    int2str(origin.sessV)+" IN ";
+  out_buf += "a=";
+  out_buf += a.attribute;
+  if (!a.value.empty()) {
+    out_buf += ':';
+    out_buf += a.value;
+  }
+  out_buf += CRLF;
+}
 
-  if (!origin.conn.address.empty())
-    if (origin.conn.address.find(".") != std::string::npos)
-      out_buf += "IP4 " + origin.conn.address + "\r\n";
-    else
-      out_buf += "IP6 " + origin.conn.address + "\r\n";
-  else if (!conn.address.empty())
-    if (conn.address.find(".") != std::string::npos)
-      out_buf += "IP4 " + conn.address + "\r\n";
-    else
-      out_buf += "IP6 " + conn.address + "\r\n";
-  else if (media.size() && !media[0].conn.address.empty())
-    if (media[0].conn.address.find(".") != std::string::npos)
-      out_buf += "IP4 " + media[0].conn.address + "\r\n";
-    else
-      out_buf += "IP6 " + media[0].conn.address + "\r\n";
+static void print_address(const string& address, string& out_buf)
+{
+  if (address.find('.') != std::string::npos)
+    out_buf += "IP4 ";
+  else
+    out_buf += "IP6 ";
+  out_buf += address;
+  out_buf += CRLF;
+}
+
+static void print_session(const AmSdp& sdp, string& out_buf)
+{
+  out_buf += "v=";
+  out_buf += int2str(sdp.version);
+  out_buf += "\r\no=";
+  out_buf += sdp.origin.user;
+  out_buf += ' ';
+  out_buf += int2str(sdp.origin.sessId);
+  out_buf += ' ';
+  out_buf += int2str(sdp.origin.sessV);
+  out_buf += " IN ";
+
+  if (!sdp.origin.conn.address.empty())
+    print_address(sdp.origin.conn.address, out_buf);
+  else if (!sdp.conn.address.empty())
+    print_address(sdp.conn.address, out_buf);
+  else if (sdp.media.size() && !sdp.media[0].conn.address.empty())
+    print_address(sdp.media[0].conn.address, out_buf);
   else
     out_buf += "IP4 0.0.0.0\r\n";
 
-  out_buf +=
-    "s="+sessionName+"\r\n";
-  if (!conn.address.empty()) {
-    if (conn.address.find(".") != std::string::npos)
-      out_buf += "c=IN IP4 ";
-    else
-      out_buf += "c=IN IP6 ";
-    out_buf += conn.address + "\r\n";
+  out_buf += "s=";
+  out_buf += sdp.sessionName;
+  out_buf += CRLF;
+  if (!sdp.conn.address.empty()) {
+    out_buf += "c=IN ";
+    print_address(sdp.conn.address, out_buf);
   }
 
   out_buf += "t=0 0\r\n";
 
   // add attributes (session level)
-  for (std::vector<SdpAttribute>::const_iterator a_it=
-	 attributes.begin(); a_it != attributes.end(); a_it++) {
-    out_buf += a_it->print();
+  for (const SdpAttribute& a : sdp.attributes)
+    print_attribute(a, out_buf);
+}
+
+static void print_media(const AmSdp& sdp, const SdpMedia& m, string& out_buf)
+{
+  out_buf += "m=";
+  out_buf += media_t_2_str(m);
+  out_buf += ' ';
+  out_buf += int2str(m.port);
+  out_buf += ' ';
+  out_buf += transport_p_2_str(m);
+
+  bool rtp = m.transport == TP_RTPAVP || m.transport == TP_RTPSAVP ||
+    m.transport == TP_RTPAVPF || m.transport == TP_RTPSAVPF ||
+    m.transport == TP_UDPTLSRTPSAVP || m.transport == TP_UDPTLSRTPSAVPF;
+
+  if (rtp) {
+    for (const SdpPayload& pl : m.payloads) {
+      out_buf += ' ';
+      out_buf += int2str(pl.payload_type);
+    }
+  } else {
+    // for other transports (UDP/UDPTL) just print out fmt
+    out_buf += ' ';
+    out_buf += m.fmt;
+    // ... and continue with c=, attributes, ...
   }
 
-  for(std::vector<SdpMedia>::const_iterator media_it = media.begin();
-      media_it != media.end(); media_it++) {
-      
-      out_buf += "m=" + media_t_2_str(*media_it) + " "
-	+ int2str(media_it->port) + " " 
-	+ transport_p_2_str(*media_it);
+  if (!m.conn.address.empty()) {
+    out_buf += "\r\nc=IN ";
+    out_buf += addr_t_2_str(m.conn.addrType);
+    out_buf += ' ';
+    out_buf += m.conn.address;
+  }
+  out_buf += CRLF;
+
+  if (rtp) {
+    for (const SdpPayload& pl : m.payloads) {
+      // "a=rtpmap:" line
+      if (!pl.encoding_name.empty()) {
+	out_buf += "a=rtpmap:";
+	out_buf += int2str(pl.payload_type);
+	out_buf += ' ';
+	out_buf += pl.encoding_name;
+	out_buf += '/';
+	out_buf += int2str(pl.clock_rate);
+
+	if (pl.encoding_param > 0) {
+	  out_buf += '/';
+	  out_buf += int2str(pl.encoding_param);
+	}
 
-      string options;
+	out_buf += CRLF;
+      }
 
-      if (media_it->transport == TP_RTPAVP || media_it->transport == TP_RTPSAVP ||
-	  media_it->transport == TP_RTPAVPF || media_it->transport == TP_RTPSAVPF ||
-	  media_it->transport == TP_UDPTLSRTPSAVP || media_it->transport == TP_UDPTLSRTPSAVPF ) {
-	for(std::vector<SdpPayload>::const_iterator pl_it = media_it->payloads.begin();
-	    pl_it != media_it->payloads.end(); pl_it++) {
+      // "a=fmtp:" line
+      if (pl.sdp_format_parameters.size()) {
+	out_buf += "a=fmtp:";
+	out_buf += int2str(pl.payload_type);
+	out_buf += ' ';
+	out_buf += pl.sdp_format_parameters;
+	out_buf += CRLF;
+      }
+    }
 
-	  out_buf += " " + int2str(pl_it->payload_type);
+//  switch (m.dir) {
+//  case SdpMedia::DirActive:  out_buf += "a=direction:active\r\n"; break;
+//  case SdpMedia::DirPassive: out_buf += "a=direction:passive\r\n"; break;
+//  case SdpMedia::DirBoth:  out_buf += "a=direction:both\r\n"; break;
+//  case SdpMedia::DirUndefined: break;
+//  }
+  }
 
-	  // "a=rtpmap:" line
-	  if (!pl_it->encoding_name.empty()) {
-	    options += "a=rtpmap:" + int2str(pl_it->payload_type) + " "
-	      + pl_it->encoding_name + "/" + int2str(pl_it->clock_rate);
+  if (m.send) {
+    if (m.recv) {
 
-	    if(pl_it->encoding_param > 0){
-	      options += "/" + int2str(pl_it->encoding_param);
-	    }
+      if (!sdp.hasAttribute("sendrecv"))
+	out_buf += "a=sendrecv\r\n";
 
-	    options += "\r\n";
-	  }
-	  
-	  // "a=fmtp:" line
-	  if(pl_it->sdp_format_parameters.size()){
-	    options += "a=fmtp:" + int2str(pl_it->payload_type) + " "
-	      + pl_it->sdp_format_parameters + "\r\n";
-	  }
-	  
-	}
+    } else if (!sdp.hasAttribute("sendonly")) {
 
-//  switch (media_it->dir) {
-//  case SdpMedia::DirActive:  options += "a=direction:active\r\n"; break;
-//  case SdpMedia::DirPassive: options += "a=direction:passive\r\n"; break;
-//  case SdpMedia::DirBoth:  options += "a=direction:both\r\n"; break;
-//  case SdpMedia::DirUndefined: break;
-//  }
-      }
-      else {
-        // for other transports (UDP/UDPTL) just print out fmt
-        out_buf += " " + media_it->fmt;
-        // ... and continue with c=, attributes, ...
-      }
+      out_buf += "a=sendonly\r\n";
+    }
+  }
+  else {
+    if (m.recv) {
 
-      if (!media_it->conn.address.empty())
-        out_buf += "\r\nc=IN " + addr_t_2_str(media_it->conn.addrType) + 
-		" " + media_it->conn.address;
+      if (!sdp.hasAttribute("recvonly"))
+	out_buf += "a=recvonly\r\n";
 
-      out_buf += "\r\n" + options;
+    } else if (!sdp.hasAttribute("inactive")) {
 
-      if(media_it->send){
-	if(media_it->recv){
-	  
-	  if(!hasAttribute("sendrecv"))
-	    out_buf += "a=sendrecv\r\n";
+      out_buf += "a=inactive\r\n";
+    }
+  }
 
-	} else if(!hasAttribute("sendonly")){
+  // if we have a=rtcp parsed from an original SDP, print it back out as received
+  if (m.rtcp_address_orig.isExplicit()) {
+    out_buf += "a=rtcp:";
+    out_buf += m.rtcp_address_orig.printExplicit();
+    out_buf += CRLF;
+  } else if (m.rtcp_address.isExplicit()) {
+    out_buf += "a=rtcp:";
+    out_buf += m.rtcp_address.printExplicit();
+    out_buf += CRLF;
+  }
 
-	  out_buf += "a=sendonly\r\n";
-	}
-      }
-      else {
-	if(media_it->recv) {
+  if (m.rtcp_mux)
+    out_buf += "a=rtcp-mux\r\n";
 
-	  if(!hasAttribute("recvonly"))
-	    out_buf += "a=recvonly\r\n";
+  // add attributes (media level)
+  for (const SdpAttribute& a : m.attributes)
+    print_attribute(a, out_buf);
 
-	} else if(!hasAttribute("inactive")) {
+  // add DTLS attributes
+  if (!m.dtls_role.empty()) {
+    out_buf += "a=setup:";
+    out_buf += m.dtls_role;
+    out_buf += CRLF;
+  }
+  if (!m.dtls_hash.empty() && !m.dtls_fingerprint.empty()) {
+    out_buf += "a=fingerprint:";
+    out_buf += m.dtls_hash;
+    out_buf += ' ';
+    out_buf += m.dtls_fingerprint;
+    out_buf += CRLF;
+  }
 
-	  out_buf += "a=inactive\r\n";
-	}
-      }
+  // add ICE credentials
+  if (!m.ice_username.empty() && !m.ice_password.empty()) {
+    out_buf += "a=ice-ufrag:";
+    out_buf += m.ice_username;
+    out_buf += "\r\na=ice-pwd:";
+    out_buf += m.ice_password;
+    out_buf += CRLF;
+  }
 
-      // if we have a=rtcp parsed from an original SDP, print it back out as received
-      if (media_it->rtcp_address_orig.isExplicit())
-	out_buf += "a=rtcp:" + media_it->rtcp_address_orig.printExplicit() + CRLF;
-      else if (media_it->rtcp_address.isExplicit())
-	out_buf += "a=rtcp:" + media_it->rtcp_address.printExplicit() + CRLF;
+  // add ICE candidates
+  for (const SdpIceCandidate& c : m.iceCandidates)
+    out_buf += c.print();
+}
 
-      if (media_it->rtcp_mux)
-	out_buf += "a=rtcp-mux\r\n";
+static void print_section(std::string_view text, string& out_buf)
+{
+  out_buf.append(text.data(), text.size());
+  if (!text.empty() && text.back() != LF)
+    out_buf += CRLF; // last line of the body
+}
 
-      // add attributes (media level)
-      for (std::vector<SdpAttribute>::const_iterator a_it=
-	     media_it->attributes.begin(); a_it != media_it->attributes.end(); a_it++) {
-	out_buf += a_it->print();
-      }
+void AmSdp::print(string& body) const
+{
+  string out_buf;
+  out_buf.reserve(raw_body ? raw_body->size() + 256 : 1024);
 
-      // add DTLS attributes
-      if (!media_it->dtls_role.empty())
-        out_buf += "a=setup:" + media_it->dtls_role + "\r\n";
-      if (!media_it->dtls_hash.empty() && !media_it->dtls_fingerprint.empty())
-        out_buf += "a=fingerprint:" + media_it->dtls_hash + " " +
-          media_it->dtls_fingerprint + "\r\n";
-
-      // add ICE credentials
-      if (!media_it->ice_username.empty() && !media_it->ice_password.empty()) {
-        out_buf += "a=ice-ufrag:" + media_it->ice_username + "\r\n";
-        out_buf += "a=ice-pwd:" + media_it->ice_password + "\r\n";
-      }
+  // sections that still print the same are re-emitted as received
+  if (!sections.empty() && sections[0].digest == sessionDigest())
+    print_section(sections[0].text, out_buf);
+  else
+    print_session(*this, out_buf);
 
-      // add ICE candidates
-      for (std::vector<SdpIceCandidate>::const_iterator ice_it=media_it->iceCandidates.begin(); ice_it != media_it->iceCandidates.end(); ice_it++) {
-        out_buf += ice_it->print();
-      }
+  unsigned int directions = sections.size() > 1 ? sessionDirections() : 0;
+  for (size_t i = 0; i < media.size(); i++) {
+    if (i + 1 < sections.size() && media[i].iceCandidates.empty() &&
+	sections[i + 1].digest == mediaDigest(media[i], directions))
+      print_section(sections[i + 1].text, out_buf);
+    else
+      print_media(*this, media[i], out_buf);
   }
 
   body = std::move(out_buf);
@@ -680,7 +888,7 @@ void AmSdp::print(string& body) const
 
 void AmSdp::addAttribute(SdpAttribute attr)
 {
-  attributes.push_back(attr);
+  attributes.push_back(std::move(attr));
 }
 
 bool AmSdp::hasAttribute(const string& name) const
@@ -831,6 +1039,8 @@ void AmSdp::clear()
   attributes.clear();
   media.clear();
   l_origin = SdpOrigin();
+  raw_body.reset();
+  sections.clear();
 }
 
 void SdpMedia::calcAnswer(const AmPayloadProvider* payload_prov,
@@ -887,7 +1097,7 @@ void SdpMedia::calcAnswer(const AmPayloadProvider* payload_prov,
 
 void SdpMedia::addAttribute(SdpAttribute attr)
 {
-  attributes.push_back(attr);
+  attributes.push_back(std::move(attr));
 }
 
 bool SdpMedia::removeAttribute(const string& name)
@@ -1182,12 +1392,12 @@ static const char* parse_sdp_connection(AmSdp* sdp_msg, const char* s, char t)
     }
   }
   if(t == 'd') {
-    sdp_msg->conn = c;
-    DBG("SDP: got session level connection: %s\n", c.debugPrint().c_str());
+    sdp_msg->conn = std::move(c);
+    DBG("SDP: got session level connection: %s\n", sdp_msg->conn.debugPrint().c_str());
   } else if(t == 'm'){
     SdpMedia& media = sdp_msg->media.back();
-    media.conn = c;
-    DBG("SDP: got media level connection: %s\n", c.debugPrint().c_str());
+    media.conn = std::move(c);
+    DBG("SDP: got media level connection: %s\n", media.conn.debugPrint().c_str());
   }
 
   //DBG("parse_sdp_line_ex: parse_sdp_connection: done parsing sdp connection\n");
@@ -1295,11 +1505,11 @@ static void parse_sdp_media(AmSdp* sdp_msg, const char* s)
 	//   state = FMT;
 	//   break;
 	// }
-	m.transport_str = proto;
 	m.transport = transport_type(proto);
 	if(m.transport == TP_NONE){
 	  DBG("Unknown transport protocol: \"%s\"\n",proto.c_str());
 	}
+	m.transport_str = std::move(proto);
 	media_line = next;
 	state = FMT;
 	break;
@@ -1353,9 +1563,9 @@ static void parse_sdp_media(AmSdp* sdp_msg, const char* s)
       } break;
     }
   }
-  sdp_msg->media.push_back(m);
+  sdp_msg->media.push_back(std::move(m));
 
-  DBG("SDP: got media: %s\n", m.debugPrint().c_str());
+  DBG("SDP: got media: %s\n", sdp_msg->media.back().debugPrint().c_str());
   //DBG("parse_sdp_line_ex: parse_sdp_media: done parsing media description \n");
   return;
 }
@@ -1384,12 +1594,12 @@ static void parse_session_attr(AmSdp* sdp_msg, const char* s, const char** next)
 
   if (col == attr_end) {
     // property attribute
-    sdp_msg->attributes.push_back(SdpAttribute(string(s, attr_end-s+1)));
+    sdp_msg->attributes.emplace_back(string(s, attr_end-s+1));
     // DBG("got session attribute '%.*s\n", (int)(attr_end-s+1), s);
   } else {
     // value attribute
-    sdp_msg->attributes.push_back(SdpAttribute(string(s, col-s-1),
-					       string(col, attr_end-col+1)));
+    sdp_msg->attributes.emplace_back(string(s, col-s-1),
+				     string(col, attr_end-col+1));
     // DBG("got session attribute '%.*s:%.*s'\n", (int)(col-s-1), s, (int)(attr_end-col+1), col);
   }
 }
@@ -1516,7 +1726,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
 
     if (pl_it != media.payloads.end()) {
       *pl_it = SdpPayload( int(payload_type),
-                  encoding_name,
+                  std::move(encoding_name),
                   int(clock_rate),
                   int(encoding_param));
     }
@@ -1559,7 +1769,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
           pl_it++);
 
     if(pl_it != media.payloads.end())
-      pl_it->sdp_format_parameters = params;
+      pl_it->sdp_format_parameters = std::move(params);
 
   /* direction */
   } else if (attr == "direction") {
@@ -1622,8 +1832,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
     if (parsing) {
       next = parse_until(attr_line, '\r');
       if (next < line_end) {
-        string value(attr_line, int(next-attr_line)-1);
-        media.ice_username = value;
+        media.ice_username.assign(attr_line, int(next-attr_line)-1);
       } else {
         DBG("found media attribute 'ice-ufrag', but value is not followed by cr\n");
       }
@@ -1636,8 +1845,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
     if (parsing) {
       next = parse_until(attr_line, '\r');
       if (next < line_end) {
-        string value(attr_line, int(next-attr_line)-1);
-        media.ice_password = value;
+        media.ice_password.assign(attr_line, int(next-attr_line)-1);
       } else {
         DBG("found media attribute 'ice-pwd', but value is not followed by cr\n");
       }
@@ -1653,8 +1861,8 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
         string value(attr_line, int(next-attr_line)-1);
         unsigned int pos = value.find(' ');
         if (pos != string::npos) {
-          media.dtls_hash = value.substr(0, pos);
-          media.dtls_fingerprint = value.substr(pos+1, value.size() - pos);
+          media.dtls_hash.assign(value, 0, pos);
+          media.dtls_fingerprint.assign(value, pos+1);
         }
       } else {
         DBG("found media attribute 'fingerprint', but value is not followed by cr\n");
@@ -1668,8 +1876,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
     if (parsing) {
       next = parse_until(attr_line, '\r');
       if (next < line_end){
-        string value(attr_line, int(next-attr_line)-1);
-        media.dtls_role = value;
+        media.dtls_role.assign(attr_line, int(next-attr_line)-1);
       } else {
         DBG("found media attribute 'setup', but value is not followed by cr\n");
       }
@@ -1686,7 +1893,7 @@ static const char* parse_sdp_attr(AmSdp* sdp_msg, const char* s)
       next = skip_till_next_line(attr_line, attr_len);
       value = string (attr_line, attr_len);
     }
-    media.attributes.push_back(SdpAttribute(attr, value));
+    media.attributes.emplace_back(std::move(attr), std::move(value));
   }
   return line_end;
 }
@@ -1812,7 +2019,7 @@ static void parse_sdp_origin(AmSdp* sdp_msg, const char* s)
       }
   }
   
-  sdp_msg->origin = origin;
+  sdp_msg->origin = std::move(origin);
 
   //DBG("parse_sdp_line_ex: parse_sdp_origin: done parsing sdp origin\n");
   return;
@@ -2004,7 +2211,7 @@ static TransProt transport_type(const string& transport)
 /*
 *Check if known attribute name is used
 */
-static bool attr_check(std::string attr)
+static bool attr_check(const std::string& attr)
 {
   if(attr == "cat")
     return true;
@@ -33,7 +33,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <string_view>
 #include <netinet/in.h>
+#include <stdint.h>
 #include "AmPlugIn.h"
 #include <memory>
 using std::string;
@@ -90,11 +92,6 @@ struct SdpOrigin
 
   SdpOrigin() : user(), conn(), sessId(0), sessV(0) {}
 
-  SdpOrigin(const SdpOrigin& other)
-    : user(other.user), sessId(other.sessId), sessV(other.sessV),
-      conn(other.conn)
-  {}
-
   bool operator == (const SdpOrigin& other) const;
 };
 /** 
@@ -126,18 +123,11 @@ struct SdpPayload
       encoding_param(-1) 
   {}
 
-  SdpPayload(int pt, const string& name, int rate, int param) 
-    : type(-1), payload_type(pt), encoding_name(name), 
+  SdpPayload(int pt, string name, int rate, int param) 
+    : type(-1), payload_type(pt), encoding_name(std::move(name)), 
       clock_rate(rate), encoding_param(param) 
   {}
 
-  SdpPayload(const SdpPayload& other)
-    : type(other.type), payload_type(other.payload_type),
-      encoding_name(other.encoding_name), clock_rate(other.clock_rate),
-      format(other.format), sdp_format_parameters(other.sdp_format_parameters),
-      encoding_param(other.encoding_param)
-  {}
-
   bool operator == (int r);
 
   bool operator == (const SdpPayload& other) const;
@@ -150,16 +140,12 @@ struct SdpAttribute
   string value;
 
   // property attribute
-  SdpAttribute(const string& attribute,
-	       const string& value)
-    : attribute(attribute), value(value) { }
+  SdpAttribute(string attribute, string value)
+    : attribute(std::move(attribute)), value(std::move(value)) { }
 
   // value attribute
-  SdpAttribute(const string& attribute)
-    : attribute(attribute) { }
-
-  SdpAttribute(const SdpAttribute& other)
-    : attribute(other.attribute), value(other.value) {}
+  SdpAttribute(string attribute)
+    : attribute(std::move(attribute)) { }
 
   string print() const;
 
@@ -191,6 +177,8 @@ class RtcpAddress
     bool explicitPort = false,
 	 explicitAddress = false;
 
+    friend struct SdpDigest;
+
   public:
     RtcpAddress() : port(0) { }
     RtcpAddress(const SdpConnection &);
@@ -309,6 +297,25 @@ class AmSdp
    */
   const SdpPayload *findPayload(const string& name) const;
 
+  /**
+   * A session or media section of the body kept by parse(), with
+   * the digest of the fields print() generates that section from.
+   */
+  struct Section {
+    std::string_view text;
+    uint64_t digest;
+  };
+
+  /** body kept by parse(); shared by copies of this object */
+  std::shared_ptr<const string> raw_body;
+  /** session section, then one per media */
+  std::vector<Section> sections;
+
+  uint64_t sessionDigest() const;
+  unsigned int sessionDirections() const;
+  uint64_t mediaDigest(const SdpMedia& m, unsigned int directions) const;
+  void indexSections();
+
 public:
   // parsed SDP definition
   unsigned int     version;     // v=
@@ -329,8 +336,13 @@ public:
   /** 
    * Parse the SDP message passed as an argument.
    * Returns true on well parsed SDP, otherwise false.
+   *
+   * With keep_body, the body is kept with this object (and its
+   * copies), and print() re-emits the session and media sections
+   * that have not been changed since as received, instead of
+   * regenerating them.
    */
-  bool parse(const string& sdp_copy);
+  bool parse(const string& sdp_copy, bool keep_body = false);
 
   /**
    * Add attribute
@@ -355,6 +367,7 @@ public:
   /**
    * Prints the current SDP structure
    * into a proper SDP message.
+   * @see parse() for sections printed verbatim
    */
   void print(string& body) const;
 
@@ -71,7 +71,9 @@ struct timeval avg_first_timestamp = avg_last_timestamp;
 // AmSession methods
 
 AmSession::AmSession(AmSipDialog* p_dlg)
-  : AmEventQueue(this), dlg(p_dlg),
+  : AmEventQueue(this, AmConfig::LockFreeSessionQueues ?
+		 AmEventQueue::LockFree : AmEventQueue::Locked),
+    dlg(p_dlg),
     input(NULL), output(NULL),
     sess_stopped(false),
     m_dtmfDetector(this), m_dtmfEventQueue(&m_dtmfDetector),
@@ -1442,8 +1444,15 @@ int AmSession::writeStreams(unsigned long long ts, unsigned char *buffer)
   if (stream->sendIntReached()) { // FIXME: shouldn't depend on checkInterval call before!
     unsigned int f_size = stream->getFrameSize();
     int got = 0;
-    if (output)
+    if (output) {
+      // cached prompts may come encoded already
+      res = stream->putEncoded(ts, output, buffer);
+      if (res != AM_AUDIO_NOT_ENCODED)
+	return res < 0 ? -1 : res;
+      res = 0;
+
       got = output->get(ts, buffer, stream->getSampleRate(), f_size);
+    }
     if (got < 0)
       res = -1;
     if (got > 0)
@@ -31,28 +31,53 @@
 
 #include "AmSessionProcessor.h"
 #include "AmSession.h"
+#include "AmConfig.h"
 
 #include <vector>
 #include <list>
 
+using std::chrono::steady_clock;
+
 vector<AmSessionProcessorThread*> AmSessionProcessor::threads;
 AmMutex AmSessionProcessor::threads_mut;
 
 vector<AmSessionProcessorThread*>::iterator 
 AmSessionProcessor::threads_it = AmSessionProcessor::threads.begin();
 
+std::atomic<unsigned int> AmSessionProcessor::idle_threads(0);
+
+thread_local AmSessionProcessorThread* AmSessionProcessorThread::current = NULL;
+
 AmSessionProcessorThread* AmSessionProcessor::getProcessorThread() {
+  // started by a session on this thread: keep them together, they
+  // will mostly exchange events with each other
+  if (AmSessionProcessorThread::current)
+    return AmSessionProcessorThread::current;
+
   std::lock_guard<AmMutex> _l(threads_mut);
   if (!threads.size()) {
     ERROR("requesting Session processing thread but none available\n");
     return NULL;
   }
 
-  // round robin
+  // the least loaded, starting round robin for equally loaded threads
   if (threads_it == threads.end())
     threads_it = threads.begin();
 
-  AmSessionProcessorThread* res = *threads_it;
+  AmSessionProcessorThread* res = NULL;
+  size_t res_sessions = 0;
+  vector<AmSessionProcessorThread*>::iterator it = threads_it;
+  do {
+    size_t n = (*it)->num_sessions.load(std::memory_order_relaxed) +
+      (*it)->num_starting.load(std::memory_order_relaxed);
+    if (!res || (n < res_sessions)) {
+      res = *it;
+      res_sessions = n;
+    }
+    if (++it == threads.end())
+      it = threads.begin();
+  } while (it != threads_it);
+
   threads_it++;
   return res;
 }
@@ -70,22 +95,90 @@ void AmSessionProcessor::addThreads(unsigned int num_threads) {
 
 void AmSessionProcessor::stopThreads()
 {
-  std::lock_guard<AmMutex> _l(threads_mut);
-  DBG("shutting down %zu session processor threads\n", threads.size());
+  // not joined under threads_mut: the threads take it to steal
+  // sessions from each other
+  vector<AmSessionProcessorThread*> stopping;
+  {
+    std::lock_guard<AmMutex> _l(threads_mut);
+    stopping.swap(threads);
+    threads_it = threads.begin();
+  }
+
+  DBG("shutting down %zu session processor threads\n", stopping.size());
   // two-pass: first request stop, then join and delete
-  for (auto it = threads.begin(); it != threads.end(); it++)
+  for (auto it = stopping.begin(); it != stopping.end(); it++)
     (*it)->stop();
-  while (!threads.empty()) {
-    auto* thread = threads.back();
-    threads.pop_back();
+  while (!stopping.empty()) {
+    auto* thread = stopping.back();
+    stopping.pop_back();
     thread->join();
     delete thread;
   }
 }
 
+bool AmSessionProcessor::steal(AmSessionProcessorThread* thief)
+{
+  if (!AmConfig::SessionProcessorStealThreshold)
+    return false;
+
+  AmSession* s = NULL;
+  steady_clock::time_point since;
+  {
+    std::lock_guard<AmMutex> _l(threads_mut);
+
+    // the thread with the most sessions waiting for it
+    AmSessionProcessorThread* victim = NULL;
+    size_t victim_waiting = 0;
+    for (auto* t : threads) {
+      size_t waiting = t->num_waiting.load(std::memory_order_relaxed);
+      if ((t != thief) && (waiting >= AmConfig::SessionProcessorStealThreshold) &&
+	  (waiting > victim_waiting)) {
+	victim = t;
+	victim_waiting = waiting;
+      }
+    }
+
+    if (victim)
+      s = victim->giveAway(since);
+  }
+
+  if (!s)
+    return false;
+
+  // not under threads_mut: adopt() has the session notify us
+  thief->adopt(s, since);
+  return true;
+}
+
+void AmSessionProcessor::wakeIdleThread(AmSessionProcessorThread* busy)
+{
+  if (!idle_threads.load(std::memory_order_relaxed))
+    return;
+
+  std::lock_guard<AmMutex> _l(threads_mut);
+  for (auto* t : threads) {
+    if ((t != busy) && t->wakeUpIdle())
+      return;
+  }
+}
+
+void AmSessionProcessor::getInfo(AmArg& ret)
+{
+  ret.assertArray();
+  std::lock_guard<AmMutex> _l(threads_mut);
+  for (auto* t : threads) {
+    AmArg info;
+    t->getInfo(info);
+    ret.push(info);
+  }
+}
+
 
 AmSessionProcessorThread::AmSessionProcessorThread() 
-  : events(this)
+  : events(this), idle(false),
+    cycles(0), processed(0), latency_sum_us(0), latency_max_us(0), queue_max(0),
+    stolen_in(0), stolen_out(0),
+    num_sessions(0), num_waiting(0), num_starting(0)
 {
 }
 
@@ -94,24 +187,111 @@ AmSessionProcessorThread::~AmSessionProcessorThread() {
 
 void AmSessionProcessorThread::notify(AmEventQueueBase* sender) {
   run_mut.lock();
-  process_sessions.insert(sender);
+  // keeps the time of the first notification
+  process_sessions.emplace(sender, steady_clock::now());
+  size_t waiting = process_sessions.size();
+  num_waiting.store(waiting, std::memory_order_relaxed);
   run_mut.unlock();
   run_cond.notify_all();
+
+  if (AmConfig::SessionProcessorStealThreshold &&
+      (waiting >= AmConfig::SessionProcessorStealThreshold))
+    AmSessionProcessor::wakeIdleThread(this);
+}
+
+AmSession* AmSessionProcessorThread::giveAway(time_point& since) {
+  std::lock_guard<std::mutex> _l(run_mut);
+  if (process_sessions.size() < AmConfig::SessionProcessorStealThreshold)
+    return NULL;
+
+  // the one waiting longest, not being processed right now
+  auto oldest = process_sessions.end();
+  for (auto it = process_sessions.begin(); it != process_sessions.end(); it++) {
+    if ((processing.find(it->first) == processing.end()) &&
+	(sessions.find(it->first) != sessions.end()) &&
+	((oldest == process_sessions.end()) || (it->second < oldest->second)))
+      oldest = it;
+  }
+  if (oldest == process_sessions.end())
+    return NULL;
+
+  auto s_it = sessions.find(oldest->first);
+  AmSession* s = s_it->second;
+  since = oldest->second;
+
+  sessions.erase(s_it);
+  process_sessions.erase(oldest);
+  num_sessions.store(sessions.size(), std::memory_order_relaxed);
+  num_waiting.store(process_sessions.size(), std::memory_order_relaxed);
+  stolen_out++;
+  return s;
+}
+
+void AmSessionProcessorThread::adopt(AmSession* s, time_point since) {
+  run_mut.lock();
+  sessions[s] = s;
+  process_sessions.emplace(s, since);
+  num_sessions.store(sessions.size(), std::memory_order_relaxed);
+  num_waiting.store(process_sessions.size(), std::memory_order_relaxed);
+  stolen_in++;
+  run_mut.unlock();
+
+  DBG("took over session [%p/%s/%s]\n",
+      s, s->getCallID().c_str(), s->getLocalTag().c_str());
+
+  // events posted before this went to the old thread, which does not
+  // process the session any more; we have it in process_sessions
+  s->setEventNotificationSink(this);
+}
+
+bool AmSessionProcessorThread::wakeUpIdle() {
+  run_mut.lock();
+  bool was_idle = idle;
+  idle = false;
+  run_mut.unlock();
+
+  if (was_idle)
+    run_cond.notify_all();
+  return was_idle;
 }
 
 void AmSessionProcessorThread::run() {
+  current = this;
   std::unique_lock<std::mutex> _l(run_mut);
 
   while (!stop_requested_unlocked()) {
 
-    if (process_sessions.empty())
-      run_cond.wait(_l);
+    if (process_sessions.empty()) {
+      // nothing to do here: help out a busy thread
+      _l.unlock();
+      bool stolen = AmSessionProcessor::steal(this);
+      _l.lock();
+
+      if (!stolen && process_sessions.empty() && !stop_requested_unlocked()) {
+	idle = true;
+	AmSessionProcessor::idle_threads.fetch_add(1, std::memory_order_relaxed);
+	run_cond.wait(_l);
+	AmSessionProcessor::idle_threads.fetch_sub(1, std::memory_order_relaxed);
+	idle = false;
+      }
+    }
 
     DBG("running processing loop\n");
 
-    // get the list of session s that need processing
-    auto pending_process_sessions = process_sessions;
+    // get the list of session s that need processing; sessions that
+    // are finished or were taken over by another thread are skipped
+    std::vector<std::pair<AmSession*, time_point> > pending_process_sessions;
+    for (auto& p : process_sessions) {
+      auto s_it = sessions.find(p.first);
+      if (s_it == sessions.end())
+	continue;
+      pending_process_sessions.push_back(std::make_pair(s_it->second, p.second));
+      processing.insert(p.first);
+    }
     process_sessions.clear();
+    num_waiting.store(0, std::memory_order_relaxed);
+    if (pending_process_sessions.size() > queue_max)
+      queue_max = pending_process_sessions.size();
     _l.unlock();
 
     // process control events (AmSessionProcessorThreadAddEvent)
@@ -128,12 +308,18 @@ void AmSessionProcessorThread::run() {
 	DBG("starting up [%s|%s]: [%p]\n",
 	    (*it)->getCallID().c_str(), (*it)->getLocalTag().c_str(),*it);
 	if ((*it)->startup()) {
-	  sessions.push_back(*it); // startup successful
+	  // startup successful
+	  _l.lock();
+	  sessions[*it] = *it;
+	  processing.insert(*it);
+	  num_sessions.store(sessions.size(), std::memory_order_relaxed);
+	  _l.unlock();
 	  // make sure this session is being processed for startup events
-	  pending_process_sessions.insert(*it);
+	  pending_process_sessions.push_back(std::make_pair(*it, steady_clock::now()));
 	}
       }
 
+      num_starting.fetch_sub(startup_sessions.size(), std::memory_order_relaxed);
       startup_sessions.clear();
     }
 
@@ -142,20 +328,31 @@ void AmSessionProcessorThread::run() {
     DBG("processing events for  up to %zd sessions\n",
 	pending_process_sessions.size());
 
-    std::list<AmSession*>::iterator it=sessions.begin();
-    while (it != sessions.end()) {
-      if ((pending_process_sessions.find(*it)!=
-	      pending_process_sessions.end()) &&
-	  (!(*it)->processingCycle())) {
-	fin_sessions.push_back(*it);
-	std::list<AmSession*>::iterator d_it = it;
-	it++;
-	sessions.erase(d_it);
-      } else {
-	it++;
-      }
+    unsigned long long lat_sum = 0;
+    unsigned long lat_max = 0;
+    for (auto& p : pending_process_sessions) {
+      unsigned long lat = std::chrono::duration_cast<std::chrono::microseconds>
+	(steady_clock::now() - p.second).count();
+      lat_sum += lat;
+      if (lat > lat_max)
+	lat_max = lat;
+
+      if (!p.first->processingCycle())
+	fin_sessions.push_back(p.first);
     }
 
+    _l.lock();
+    for (auto* s : fin_sessions)
+      sessions.erase(s);
+    processing.clear();
+    num_sessions.store(sessions.size(), std::memory_order_relaxed);
+    cycles++;
+    processed += pending_process_sessions.size();
+    latency_sum_us += lat_sum;
+    if (lat_max > latency_max_us)
+      latency_max_us = lat_max;
+    _l.unlock();
+
     if (fin_sessions.size()) {
       DBG("finalizing %zd sessions\n", fin_sessions.size());
       for (std::vector<AmSession*>::iterator it=fin_sessions.begin(); 
@@ -187,11 +384,28 @@ void AmSessionProcessorThread::startSession(AmSession* s) {
   // register us to be notified if some event comes to the session
   s->setEventNotificationSink(this);
 
-  // add this to be scheduled
+  // add this to be scheduled; counted from now on, so that the
+  // sessions started meanwhile go to other threads
+  num_starting.fetch_add(1, std::memory_order_relaxed);
   events.postEvent(new AmSessionProcessorThreadAddEvent(s));
 
   // trigger processing of events already in queue at startup
   notify(s);
 }
 
+void AmSessionProcessorThread::getInfo(AmArg& ret)
+{
+  std::lock_guard<std::mutex> _l(run_mut);
+  ret["sessions"] = (int)sessions.size();
+  ret["starting"] = (int)num_starting.load(std::memory_order_relaxed);
+  ret["waiting"] = (int)process_sessions.size();
+  ret["waiting_max"] = (int)queue_max;
+  ret["cycles"] = (long int)cycles;
+  ret["processed"] = (long int)processed;
+  ret["latency_avg_us"] = processed ? (int)(latency_sum_us / processed) : 0;
+  ret["latency_max_us"] = (int)latency_max_us;
+  ret["stolen_in"] = (long int)stolen_in;
+  ret["stolen_out"] = (long int)stolen_out;
+}
+
 #endif
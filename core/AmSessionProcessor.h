@@ -34,10 +34,14 @@
 
 #include "AmThread.h"
 #include "AmEventQueue.h"
+#include "AmArg.h"
 
 #include <vector>
 #include <list>
 #include <set>
+#include <map>
+#include <atomic>
+#include <chrono>
 class AmSessionProcessorThread;
 class AmSession;
 
@@ -47,10 +51,30 @@ class AmSessionProcessor {
   static vector<AmSessionProcessorThread*>::iterator 
     threads_it;
 
+  /** number of threads waiting for work */
+  static std::atomic<unsigned int> idle_threads;
+
+  friend class AmSessionProcessorThread;
+
  public: 
+  /**
+   * Sessions started while a processor thread processes another
+   * session (e.g. the callee leg of a B2B call) stay on that thread,
+   * others go to the thread with the fewest sessions.
+   */
   static AmSessionProcessorThread* getProcessorThread();
   static void addThreads(unsigned int num_threads);
   static void stopThreads();
+
+  /**
+   * move one waiting session from the busiest thread to thief
+   * @return true if a session was moved
+   */
+  static bool steal(AmSessionProcessorThread* thief);
+  /** wake up an idle thread to take sessions from busy */
+  static void wakeIdleThread(AmSessionProcessorThread* busy);
+
+  static void getInfo(AmArg& ret);
 };
 
 struct AmSessionProcessorThreadAddEvent 
@@ -66,15 +90,56 @@ class AmSessionProcessorThread
   public AmEventHandler,
   public AmEventNotificationSink
 {
+  typedef std::chrono::steady_clock::time_point time_point;
+
   AmEventQueue    events;
-  std::list<AmSession*> sessions;
   std::vector<AmSession*> startup_sessions;
 
-  std::set<AmEventQueueBase*> process_sessions;
+  /*
+   * protected by run_mut, sessions may be taken over by other
+   * threads (AmSessionProcessor::steal)
+   */
+
+  /** the sessions of this thread */
+  std::map<AmEventQueueBase*, AmSession*> sessions;
+  /** sessions with pending events, since when */
+  std::map<AmEventQueueBase*, time_point> process_sessions;
+  /** sessions in the current processing cycle, not to be taken */
+  std::set<AmEventQueueBase*> processing;
+  /** waiting for work */
+  bool idle;
+
+  /* statistics, protected by run_mut */
+  /** loop iterations */
+  unsigned long cycles;
+  /** processing cycles of sessions */
+  unsigned long processed;
+  unsigned long long latency_sum_us;
+  unsigned long latency_max_us;
+  size_t queue_max;
+  unsigned long stolen_in;
+  unsigned long stolen_out;
+
+  /** for getInfo() and choosing a thread without locking */
+  std::atomic<size_t> num_sessions;
+  std::atomic<size_t> num_waiting;
+  /** queued by startSession(), not started up yet */
+  std::atomic<size_t> num_starting;
+
+  static thread_local AmSessionProcessorThread* current;
 
   // AmEventHandler interface
   void process(AmEvent* e);
 
+  /** @return a waiting session for another thread, NULL if none */
+  AmSession* giveAway(time_point& since);
+  /** take over a session given away by another thread */
+  void adopt(AmSession* s, time_point since);
+  /** @return true if the thread was idle */
+  bool wakeUpIdle();
+
+  friend class AmSessionProcessor;
+
  public:
   AmSessionProcessorThread();
   ~AmSessionProcessorThread();
@@ -86,6 +151,8 @@ class AmSessionProcessorThread
   void notify(AmEventQueueBase* sender);
 
   void startSession(AmSession* s);
+
+  void getInfo(AmArg& ret);
 };
 
 #endif // _AmSessionProcessor_h_
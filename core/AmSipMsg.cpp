@@ -5,7 +5,102 @@
 #include "AmSipHeaders.h"
 #include "sip/sip_trans.h"
 #include "sip/sip_parser.h"
+#include "sip/parse_header.h"
 #include "sip/msg_logger.h"
+#include "log.h"
+
+AmSipParsedMsg::AmSipParsedMsg(const sip_msg* msg)
+  : buf(msg->buf)
+{
+  for (list<sip_header*>::const_iterator it = msg->hdrs.begin();
+       it != msg->hdrs.end(); ++it) {
+
+    switch((*it)->type) {
+    case sip_header::H_OTHER:
+    case sip_header::H_REQUIRE:
+      hdrs.push_back(makeHeader(msg, *it));
+      break;
+    case sip_header::H_VIA:
+      vias.push_back(makeHeader(msg, *it));
+      break;
+    }
+  }
+}
+
+AmSipParsedMsg::Header AmSipParsedMsg::makeHeader(const sip_msg* msg,
+						  const sip_header* h) const
+{
+  // same offsets in our copy of the buffer
+  const char* base = msg->buf.c_str();
+  Header hdr;
+  hdr.type = h->type;
+  hdr.name = std::string_view(buf.data() + (h->name.s - base), h->name.len);
+  hdr.value = std::string_view(buf.data() + (h->value.s - base), h->value.len);
+  return hdr;
+}
+
+std::string_view AmSipParsedMsg::getHeader(std::string_view name) const
+{
+  for (std::vector<Header>::const_iterator it = hdrs.begin();
+       it != hdrs.end(); ++it) {
+    if (it->name.length() == name.length() &&
+	!strncasecmp(it->name.data(), name.data(), name.length()))
+      return it->value;
+  }
+  return std::string_view();
+}
+
+string AmSipParsedMsg::printVias() const
+{
+  string res;
+  for (std::vector<Header>::const_iterator it = vias.begin();
+       it != vias.end(); ++it) {
+    res.append(it->name);
+    res.append(": ");
+    res.append(it->value);
+    res.append(CRLF);
+  }
+  return res;
+}
+
+bool AmSipParsedMsg::matchAt(const Header& h, const string& flat, size_t pos)
+{
+  size_t n = h.name.length(), v = h.value.length();
+  if (pos + n + 2 + v + 2 > flat.length())
+    return false;
+
+  const char* c = flat.data() + pos;
+  return !memcmp(c, h.name.data(), n) &&
+    c[n] == ':' && c[n+1] == ' ' &&
+    !memcmp(c + n + 2, h.value.data(), v) &&
+    c[n+2+v] == '\r' && c[n+3+v] == '\n';
+}
+
+size_t AmSipParsedMsg::reuseHeaders(const string& flat,
+				    list<sip_header*>& out) const
+{
+  size_t pos = 0;
+  std::vector<Header>::const_iterator it = hdrs.begin();
+
+  while (pos < flat.length()) {
+    // headers may have been removed: look for the next one matching
+    std::vector<Header>::const_iterator m = it;
+    while (m != hdrs.end() && !matchAt(*m, flat, pos))
+      ++m;
+
+    if (m == hdrs.end())
+      break;
+
+    out.push_back(new sip_header(m->type,
+				 cstring(m->name.data(), m->name.length()),
+				 cstring(m->value.data(), m->value.length())));
+
+    pos += m->name.length() + 2 + m->value.length() + 2;
+    it = m + 1;
+  }
+
+  return pos;
+}
 
 AmSipRequest::AmSipRequest()
   : _AmSipMsgInDlg(),
@@ -16,6 +111,20 @@ AmSipRequest::AmSipRequest()
 {
 }
 
+static inline char lower_c(char c)
+{
+  return ('A' <= c && c <= 'Z') ? c - ('A' - 'a') : c;
+}
+
+/** case-insensitive comparison of len chars */
+static inline bool name_eq(const char* a, const char* b, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    if (lower_c(a[i]) != lower_c(b[i]))
+      return false;
+  return true;
+}
+
 string getHeader(const string& hdrs,const string& hdr_name, bool single)
 {
   if (hdr_name.empty())
@@ -30,9 +139,9 @@ string getHeader(const string& hdrs,const string& hdr_name, bool single)
   {
     if(skip)
       ret.append(", ");
-  else
+    else
       if(single) return hdrs.substr(pos1,pos2-pos1);
-    ret.append(hdrs.substr(pos1,pos2-pos1));
+    ret.append(hdrs, pos1, pos2-pos1);
     skip = pos2+1;
   }
   return ret;
@@ -52,88 +161,40 @@ bool hasHeader(const string& hdrs,const string& hdr_name) {
   return findHeader(hdrs, hdr_name, skip, pos1, pos2, hdr_start);
 }
 
-#include "log.h"
 bool findHeader(const string& hdrs,const string& hdr_name, const size_t skip, 
 		size_t& pos1, size_t& pos2, size_t& hdr_start)
 {
-  unsigned int p;
-  if(skip >= hdrs.length()) return false;
-  char* hdr = strdup(hdr_name.c_str());
-  const char* hdrs_c = hdrs.c_str() + skip;
-  char* hdr_c = hdr;
-  const char* hdrs_end = hdrs.c_str() + hdrs.length();
-  const char* hdr_end = hdr_c + hdr_name.length(); 
-
-  while(hdr_c != hdr_end){
-    if('A' <= *hdr_c && *hdr_c <= 'Z')
-      *hdr_c -= 'A' - 'a';
-    hdr_c++;
-  }
-
-  while(hdrs_c != hdrs_end){
-
-    hdr_c = hdr;
-
-    while((hdrs_c != hdrs_end) && (hdr_c != hdr_end)){
-
-      char c = *hdrs_c;
-      if('A' <= *hdrs_c && *hdrs_c <= 'Z')
-	c -= 'A' - 'a';
-
-      if(c != *hdr_c)
-	break;
-
-      hdr_c++;
-      hdrs_c++;
+  const char* s = hdrs.data();
+  const size_t end = hdrs.length();
+  const size_t len = hdr_name.length();
+
+  // headers are only matched at the start of a line
+  size_t l = skip;
+  while (l < end) {
+    size_t p = l + len;
+    if (p <= end && name_eq(s + l, hdr_name.data(), len)) {
+      while (p < end && (s[p] == ' ' || s[p] == '\t'))
+	p++;
+      if (p < end && s[p] == ':') {
+	hdr_start = l + len;
+	p++;
+	while (p < end && s[p] == ' ')
+	  p++;
+	pos1 = p;
+	while (p < end && s[p] != '\r' && s[p] != '\n')
+	  p++;
+	pos2 = p;
+	return true;
+      }
+      // current hdr just starts with hdr_name, continue search
     }
 
-    if(hdr_c == hdr_end) {
-      // matched whole of needle.
-      // ...all of current header?
-      const char* srccol = hdrs_c;
-      while (*srccol==' ' || *srccol=='\t')
-	srccol++;
-      if (*srccol == ':')
-	break; // was end of current hdr
-      // current hdr just starts with hdr, continue search
-    }
-
-    while((hdrs_c != hdrs_end) && (*hdrs_c != '\n'))
-      hdrs_c++;
-
-    if(hdrs_c != hdrs_end)
-      hdrs_c++;
-  }
-    
-  if(hdr_c == hdr_end){
-    hdr_start = hdrs_c - hdrs.c_str();;
-
-    while((hdrs_c != hdrs_end) && (*hdrs_c == ' '))
-      hdrs_c++;
-
-    if((hdrs_c != hdrs_end) && (*hdrs_c == ':')){
-
-      hdrs_c++;
-      while((hdrs_c != hdrs_end) && (*hdrs_c == ' '))
-	hdrs_c++;
-	    
-      p = hdrs_c - hdrs.c_str();
-	    
-      string::size_type p_end = p;
-      while (p_end < hdrs.size() &&
-	     hdrs[p_end] != '\r' &&
-	     hdrs[p_end] != '\n')
-	p_end++;
-      free(hdr);
-      // return hdrs.substr(p,p_end-p);
-      pos1 = p;
-      pos2 = p_end;
-      return true;
-    }
+    const char* nl = (const char*)memchr(s + l, '\n', end - l);
+    if (!nl)
+      break;
+    l = nl - s + 1;
   }
 
-  free(hdr);
-  //    return "";
   return false;
 }
 
@@ -154,6 +215,227 @@ bool removeHeader(string& hdrs, const string& hdr_name) {
   return found;
 }
 
+#define HDR_INDEX_REMOVED ((uint32_t)-1)
+
+std::atomic<uint64_t> AmSipHdrs::last_version(0);
+
+uint32_t AmSipHeaderIndex::hashName(const char* name, size_t len)
+{
+  // word-wise multiplicative hash; OR-ing in 0x20 lower-cases letters
+  // (and may make some other characters collide, which the comparison
+  // in match() takes care of)
+  const uint64_t k = 0x9e3779b97f4a7c15ULL;
+  const uint64_t lc = 0x2020202020202020ULL;
+  uint64_t h = len, w;
+  while (len >= 8) {
+    memcpy(&w, name, 8);
+    h = (h ^ (w | lc)) * k;
+    name += 8;
+    len -= 8;
+  }
+  if (len) {
+    w = 0;
+    memcpy(&w, name, len);
+    h = (h ^ (w | lc)) * k;
+  }
+  return h ^ (h >> 32);
+}
+
+void AmSipHeaderIndex::scan(const string& hdrs, size_t from)
+{
+  const char* s = hdrs.data();
+  const size_t end = hdrs.length();
+
+  size_t l = from;
+  while (l < end) {
+    const char* nl = (const char*)memchr(s + l, '\n', end - l);
+    size_t next = nl ? (size_t)(nl - s) + 1 : end;
+
+    const char* col = (const char*)memchr(s + l, ':', next - l);
+    if (col) {
+      size_t n = col - s;
+      while (n > l && (s[n-1] == ' ' || s[n-1] == '\t'))
+	n--;
+
+      Entry e;
+      e.hash = hashName(s + l, n - l);
+      e.start = l;
+      e.name_len = n - l;
+
+      size_t p = col - s + 1;
+      while (p < end && s[p] == ' ')
+	p++;
+      e.pos1 = p;
+      const char* cr = (const char*)memchr(s + p, '\r', next - p);
+      p = cr ? (size_t)(cr - s) : (nl ? (size_t)(nl - s) : end);
+      e.pos2 = p;
+      while (p < end && (s[p] == '\r' || s[p] == '\n'))
+	p++;
+      e.end = p;
+
+      entries.push_back(e);
+    }
+
+    l = next;
+  }
+}
+
+void AmSipHeaderIndex::build(const AmSipHdrs& hdrs)
+{
+  version = hdrs.getVersion();
+  entries.clear();
+  entries.reserve(32);
+  scan(hdrs, 0);
+}
+
+bool AmSipHeaderIndex::match(const string& hdrs, const Entry& e,
+			     const string& name, uint32_t h) const
+{
+  return e.hash == h && e.name_len == name.length() &&
+    name_eq(hdrs.data() + e.start, name.data(), e.name_len);
+}
+
+const AmSipHeaderIndex::Entry* AmSipHeaderIndex::find(const string& hdrs,
+						      const string& name,
+						      const Entry* after) const
+{
+  uint32_t h = hashName(name.data(), name.length());
+  size_t i = after ? (after - entries.data()) + 1 : 0;
+  for (; i < entries.size(); i++) {
+    if (match(hdrs, entries[i], name, h))
+      return &entries[i];
+  }
+  return NULL;
+}
+
+string AmSipHeaderIndex::getHeader(const string& hdrs, const string& name,
+				   bool single) const
+{
+  if (name.empty())
+    return "";
+
+  string ret;
+  bool first = true;
+  for (const Entry* e = find(hdrs, name); e != NULL; e = find(hdrs, name, e)) {
+    if (first) {
+      if (single)
+	return hdrs.substr(e->pos1, e->pos2 - e->pos1);
+      first = false;
+    } else {
+      ret.append(", ");
+    }
+    ret.append(hdrs, e->pos1, e->pos2 - e->pos1);
+  }
+  return ret;
+}
+
+bool AmSipHeaderIndex::removeHeader(AmSipHdrs& hdrs, const string& name)
+{
+  uint32_t h = hashName(name.data(), name.length());
+  std::vector<Entry>::iterator it = entries.begin();
+  while (it != entries.end() && !match(hdrs, *it, name, h))
+    it++;
+  if (it == entries.end())
+    return false;
+
+  // remove the lines from the back, so that the offsets stay valid
+  string& s = hdrs.modify();
+  for (std::vector<Entry>::iterator r = entries.end(); r != it;) {
+    --r;
+    if (match(s, *r, name, h)) {
+      s.erase(r->start, r->end - r->start);
+      r->name_len = HDR_INDEX_REMOVED;
+    }
+  }
+  version = hdrs.getVersion();
+
+  // drop them from the index, shifting the following entries
+  uint32_t removed = 0;
+  std::vector<Entry>::iterator out = it;
+  for (; it != entries.end(); it++) {
+    if (it->name_len == HDR_INDEX_REMOVED) {
+      removed += it->end - it->start;
+      continue;
+    }
+    Entry e = *it;
+    e.start -= removed;
+    e.pos1 -= removed;
+    e.pos2 -= removed;
+    e.end -= removed;
+    *out++ = e;
+  }
+  entries.erase(out, entries.end());
+  return true;
+}
+
+void AmSipHeaderIndex::addHeader(AmSipHdrs& hdrs, const string& name,
+				 const string& value)
+{
+  string& s = hdrs.modify();
+  size_t from = s.length();
+  s.append(name).append(COLSP).append(value).append(CRLF);
+  version = hdrs.getVersion();
+
+  if (from && s[from-1] != '\n') {
+    // appended to the last line
+    entries.clear();
+    from = 0;
+  }
+  scan(s, from);
+}
+
+const AmSipHeaderIndex& _AmSipMsgInDlg::headerIndex() const
+{
+  if (!hdr_index || !hdr_index->isFor(hdrs))
+    hdr_index = std::make_shared<AmSipHeaderIndex>(hdrs);
+  return *hdr_index;
+}
+
+AmSipHeaderIndex& _AmSipMsgInDlg::writableHeaderIndex()
+{
+  if (!hdr_index || !hdr_index->isFor(hdrs))
+    hdr_index = std::make_shared<AmSipHeaderIndex>(hdrs);
+  else if (hdr_index.use_count() > 1)
+    hdr_index = std::make_shared<AmSipHeaderIndex>(*hdr_index);
+  return *hdr_index;
+}
+
+void _AmSipMsgInDlg::indexHeaders()
+{
+  hdr_index = std::make_shared<AmSipHeaderIndex>(hdrs);
+}
+
+string _AmSipMsgInDlg::getHeader(const string& hdr_name, bool single) const
+{
+  return headerIndex().getHeader(hdrs, hdr_name, single);
+}
+
+string _AmSipMsgInDlg::getHeader(const string& hdr_name,
+				 const string& compact_hdr_name,
+				 bool single) const
+{
+  const AmSipHeaderIndex& idx = headerIndex();
+  string res = idx.getHeader(hdrs, hdr_name, single);
+  if (res.empty())
+    return idx.getHeader(hdrs, compact_hdr_name, single);
+  return res;
+}
+
+bool _AmSipMsgInDlg::hasHeader(const string& hdr_name) const
+{
+  return headerIndex().hasHeader(hdrs, hdr_name);
+}
+
+bool _AmSipMsgInDlg::removeHeader(const string& hdr_name)
+{
+  return writableHeaderIndex().removeHeader(hdrs, hdr_name);
+}
+
+void _AmSipMsgInDlg::addHeader(const string& hdr_name, const string& value)
+{
+  writableHeaderIndex().addHeader(hdrs, hdr_name, value);
+}
+
 void addOptionTag(string& hdrs, const string& hdr_name, const string& tag) {
   // see if option tag already exists
   string options = getHeader(hdrs, hdr_name);
@@ -6,8 +6,232 @@
 #include <string>
 using std::string;
 
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
 #include "sip/trans_layer.h"
 
+struct sip_msg;
+struct sip_header;
+
+/**
+ * \brief received SIP message a request or reply has been made from
+ *
+ * Keeps a copy of the message buffer and the list of headers which
+ * make up the 'hdrs' of the AmSipRequest/AmSipReply, as views into
+ * that buffer. It is immutable and shared by all copies of the
+ * request/reply, so that the Via headers are only materialised when
+ * asked for, and the headers of a relayed message are not parsed once
+ * more when it is sent (see SipCtrlInterface::send).
+ */
+class AmSipParsedMsg
+{
+public:
+  struct Header
+  {
+    int              type; // sip_header::H_*
+    std::string_view name;
+    std::string_view value;
+  };
+
+private:
+  string buf;
+  std::vector<Header> hdrs;
+  std::vector<Header> vias;
+
+  Header makeHeader(const sip_msg* msg, const sip_header* h) const;
+
+  /** @return whether h is found in flat as "name: value\r\n" at pos */
+  static bool matchAt(const Header& h, const string& flat, size_t pos);
+
+public:
+  AmSipParsedMsg(const sip_msg* msg);
+
+  /** the whole received message */
+  std::string_view getBuffer() const { return buf; }
+
+  /** headers contained in 'hdrs' of the request/reply (in order) */
+  const std::vector<Header>& getHeaders() const { return hdrs; }
+
+  /** value of the first header named 'name' (case-insensitive), empty if none */
+  std::string_view getHeader(std::string_view name) const;
+
+  /** Via headers, formatted like 'hdrs' */
+  string printVias() const;
+
+  /**
+   * Find the headers of this message within flat, which is expected
+   * to be derived from this message's 'hdrs' (e.g. by removing or
+   * appending headers).
+   *
+   * Starting from the beginning, every header of flat that is one of
+   * the parsed headers is appended to 'out' (pointing into this
+   * message's buffer) until one is not.
+   *
+   * @return length of the prefix of flat covered by 'out'
+   */
+  size_t reuseHeaders(const string& flat, list<sip_header*>& out) const;
+};
+
+/**
+ * \brief the 'hdrs' of a request or reply
+ *
+ * A string which gets a new version number (unique in the process)
+ * whenever it is modified, so that the header index can tell whether
+ * it is still current without keeping a copy. Copies keep the version
+ * together with the content.
+ *
+ * It converts to const string&. Functions modifying a string in place
+ * get it through modify(), which counts as the modification: the
+ * reference must not be kept beyond that.
+ */
+class AmSipHdrs
+{
+  string s;
+  uint64_t version;
+
+  static std::atomic<uint64_t> last_version;
+
+  void modified() {
+    version = last_version.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+public:
+  /* version 0: empty */
+  AmSipHdrs() : version(0) { }
+  AmSipHdrs(const string& h) : s(h) { modified(); }
+  AmSipHdrs(const char* h) : s(h) { modified(); }
+
+  AmSipHdrs& operator=(const string& h) { s = h; modified(); return *this; }
+  AmSipHdrs& operator=(string&& h) { s = std::move(h); modified(); return *this; }
+  AmSipHdrs& operator=(const char* h) { s = h; modified(); return *this; }
+
+  AmSipHdrs& operator+=(const string& h) { s += h; modified(); return *this; }
+  AmSipHdrs& operator+=(const char* h) { s += h; modified(); return *this; }
+  AmSipHdrs& operator+=(char c) { s += c; modified(); return *this; }
+
+  template<typename... Args>
+  AmSipHdrs& append(Args&&... args) {
+    s.append(std::forward<Args>(args)...); modified(); return *this;
+  }
+
+  template<typename... Args>
+  AmSipHdrs& erase(Args&&... args) {
+    s.erase(std::forward<Args>(args)...); modified(); return *this;
+  }
+
+  template<typename... Args>
+  AmSipHdrs& replace(Args&&... args) {
+    s.replace(std::forward<Args>(args)...); modified(); return *this;
+  }
+
+  void clear() { s.clear(); modified(); }
+  void reserve(size_t n) { s.reserve(n); }
+
+  /** for modifying the string in place (see above) */
+  string& modify() { modified(); return s; }
+
+  operator const string&() const { return s; }
+  const string& str() const { return s; }
+  uint64_t getVersion() const { return version; }
+
+  const char* c_str() const { return s.c_str(); }
+  const char* data() const { return s.data(); }
+  size_t length() const { return s.length(); }
+  size_t size() const { return s.size(); }
+  bool empty() const { return s.empty(); }
+  char operator[](size_t pos) const { return s[pos]; }
+
+  template<typename... Args>
+  size_t find(Args&&... args) const { return s.find(std::forward<Args>(args)...); }
+
+  template<typename... Args>
+  size_t rfind(Args&&... args) const { return s.rfind(std::forward<Args>(args)...); }
+
+  string substr(size_t pos = 0, size_t n = string::npos) const { return s.substr(pos, n); }
+};
+
+inline string operator+(const AmSipHdrs& a, const string& b) { return a.str() + b; }
+inline string operator+(const string& a, const AmSipHdrs& b) { return a + b.str(); }
+inline string operator+(const AmSipHdrs& a, const char* b) { return a.str() + b; }
+inline string operator+(const char* a, const AmSipHdrs& b) { return a + b.str(); }
+inline bool operator==(const AmSipHdrs& a, const string& b) { return a.str() == b; }
+inline bool operator==(const AmSipHdrs& a, const char* b) { return a.str() == b; }
+inline bool operator!=(const AmSipHdrs& a, const string& b) { return a.str() != b; }
+inline bool operator!=(const AmSipHdrs& a, const char* b) { return a.str() != b; }
+
+/**
+ * \brief index of the headers contained in a 'hdrs' string
+ *
+ * Built in one pass over 'hdrs', it keeps the offsets of every header
+ * together with a hash of its lower-case name, so that looking up a
+ * header does not need to scan (and case-fold) the whole string. All
+ * headers of the same name are kept in order (multi-value headers).
+ *
+ * The index is built for one version of 'hdrs' and only used while it
+ * is current (see isFor()), i.e. 'hdrs' may still be modified
+ * directly, at the cost of rebuilding the index on the next lookup.
+ */
+class AmSipHeaderIndex
+{
+public:
+  struct Entry
+  {
+    uint32_t hash;     // of the lower-case name
+    uint32_t start;    // start of the header line
+    uint32_t name_len;
+    uint32_t pos1;     // start of the value
+    uint32_t pos2;     // end of the value
+    uint32_t end;      // end of the line, including line break(s)
+  };
+
+private:
+  uint64_t version;
+  std::vector<Entry> entries;
+
+  static uint32_t hashName(const char* name, size_t len);
+  /** index the header lines of hdrs starting at from */
+  void scan(const string& hdrs, size_t from);
+  bool match(const string& hdrs, const Entry& e,
+	     const string& name, uint32_t h) const;
+
+public:
+  AmSipHeaderIndex() : version(0) { }
+  explicit AmSipHeaderIndex(const AmSipHdrs& hdrs) { build(hdrs); }
+
+  void build(const AmSipHdrs& hdrs);
+
+  /** @return whether this index is current for hdrs */
+  bool isFor(const AmSipHdrs& hdrs) const { return version == hdrs.getVersion(); }
+
+  const std::vector<Entry>& getEntries() const { return entries; }
+
+  /*
+   * The following take the 'hdrs' this index is current for.
+   */
+
+  /** @return first header named name after 'after' (NULL: first), NULL if none */
+  const Entry* find(const string& hdrs, const string& name,
+		    const Entry* after = NULL) const;
+
+  /** same as ::getHeader(hdrs, name, single) */
+  string getHeader(const string& hdrs, const string& name,
+		   bool single = false) const;
+
+  bool hasHeader(const string& hdrs, const string& name) const {
+    return find(hdrs, name) != NULL;
+  }
+
+  /** Same as ::removeHeader(hdrs, name), keeping the index current. */
+  bool removeHeader(AmSipHdrs& hdrs, const string& name);
+
+  /** Append header 'name: value' to hdrs, keeping the index current. */
+  void addHeader(AmSipHdrs& hdrs, const string& name, const string& value);
+};
+
 /* enforce common naming in Req&Rpl */
 class _AmSipMsgInDlg
   : public AmObject
@@ -29,7 +253,7 @@ class _AmSipMsgInDlg
   string route;
   string contact;
 
-  string hdrs;
+  AmSipHdrs hdrs;
 
   AmMimeBody body;
 
@@ -42,9 +266,41 @@ class _AmSipMsgInDlg
   unsigned short local_port;
   string         trsp;
 
+  /** received message this one was made from (may be NULL) */
+  std::shared_ptr<const AmSipParsedMsg> parsed;
+
+ private:
+  /* shared by copies until modified through addHeader/removeHeader */
+  mutable std::shared_ptr<AmSipHeaderIndex> hdr_index;
+
+  const AmSipHeaderIndex& headerIndex() const;
+  AmSipHeaderIndex& writableHeaderIndex();
+
+ public:
   _AmSipMsgInDlg() : cseq(0), rseq(0), remote_port(0), local_port(0) { }
   virtual ~_AmSipMsgInDlg() { };
 
+  /** (re)build the header index of 'hdrs' now */
+  void indexHeaders();
+
+  /*
+   * Header access through the index of 'hdrs': same results as the
+   * free functions on 'hdrs' below, which 'hdrs' may still be used
+   * with. The index is rebuilt on first use after 'hdrs' has been
+   * changed otherwise.
+   */
+  string getHeader(const string& hdr_name, bool single = false) const;
+  string getHeader(const string& hdr_name, const string& compact_hdr_name,
+		   bool single = false) const;
+  /* not to be taken for getHeader(hdr_name, bool) */
+  string getHeader(const string& hdr_name, const char* compact_hdr_name,
+		   bool single = false) const {
+    return getHeader(hdr_name, string(compact_hdr_name), single);
+  }
+  bool hasHeader(const string& hdr_name) const;
+  bool removeHeader(const string& hdr_name);
+  void addHeader(const string& hdr_name, const string& value);
+
   virtual string print() const = 0;
 };
 
@@ -91,7 +347,6 @@ class AmSipRequest : public _AmSipMsgInDlg
   string rack_method;
   unsigned int rack_cseq;
 
-  string vias;
   string via1;
   string via_branch;
   bool   first_hop;
@@ -103,6 +358,9 @@ class AmSipRequest : public _AmSipMsgInDlg
   AmSipRequest();
   ~AmSipRequest() { }
 
+  /** Via headers of the received request (one line each) */
+  string getVias() const { return parsed ? parsed->printVias() : string(); }
+
   string print() const;
   void log(const shared_ptr<msg_logger>& logger) const;
 };
@@ -112,6 +370,13 @@ string getHeader(const string& hdrs,const string& hdr_name, bool single = false)
 string getHeader(const string& hdrs,const string& hdr_name,
 		 const string& compact_hdr_name, bool single = false);
 
+/* not to be taken for getHeader(hdrs, hdr_name, bool) */
+inline string getHeader(const string& hdrs,const string& hdr_name,
+			const char* compact_hdr_name, bool single = false)
+{
+  return getHeader(hdrs, hdr_name, string(compact_hdr_name), single);
+}
+
 /** find a header, starting from char skip
     if found, value is between pos1 and pos2 
     and hdr start is the start of the header 
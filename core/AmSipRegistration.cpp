@@ -268,7 +268,7 @@ void AmSIPRegistration::onSipReply(const AmSipRequest& req,
 
     string contacts = reply.contact;
     if (contacts.empty()) 
-      contacts = getHeader(reply.hdrs, "Contact", "m", true);
+      contacts = reply.getHeader("Contact", "m", true);
 
     if (unregistering) {
       DBG("received positive reply to De-REGISTER\n");
@@ -125,7 +125,7 @@ SingleSubscription* AmSipSubscription::makeSubscription(const AmSipRequest& req,
   /* SUBSCRIBE */
   if (req.method == SIP_METH_SUBSCRIBE) {
     // fetch Event-HF
-    event = getHeader(req.hdrs,SIP_HDR_EVENT,true);
+    event = req.getHeader(SIP_HDR_EVENT,true);
     id = get_header_param(event,"id");
     event = strip_header_params(event);
 
@@ -240,7 +240,7 @@ void SingleSubscription::replyFSM(const AmSipRequest& req, const AmSipReply& rep
       }
 
       // check Expires-HF
-      string expires_txt = getHeader(reply.hdrs,SIP_HDR_EXPIRES,true);
+      string expires_txt = reply.getHeader(SIP_HDR_EXPIRES,true);
       expires_txt = strip_header_params(expires_txt);
 
       int sub_expires=0;
@@ -298,7 +298,7 @@ void SingleSubscription::replyFSM(const AmSipRequest& req, const AmSipReply& rep
     }
     
     // check Subscription-State-HF
-    string sub_state_txt = getHeader(req.hdrs,SIP_HDR_SUBSCRIPTION_STATE,true);
+    string sub_state_txt = req.getHeader(SIP_HDR_SUBSCRIPTION_STATE,true);
     string expires_txt = get_header_param(sub_state_txt,"expires");
     int notify_expire=0;
   
@@ -544,7 +544,7 @@ AmSipSubscription::matchSubscription(const AmSipRequest& req, bool uac)
   }
 
   // parse Event-HF
-  event = getHeader(req.hdrs,SIP_HDR_EVENT,true);
+  event = req.getHeader(SIP_HDR_EVENT,true);
   id = get_header_param(event,"id");
   event = strip_header_params(event);
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file AmStringHashTable.h */
+#ifndef _AmStringHashTable_h_
+#define _AmStringHashTable_h_
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/** keys up to this length are stored inline in the slot */
+#define STRING_HASH_TABLE_INLINE_KEY 40
+
+/**
+ * \brief open-addressing hash table with string keys
+ *
+ * Linear probing with backward-shift deletion (no tombstones).
+ * Each slot keeps the key's precomputed 32 bit hash, so probing
+ * compares strings only on a full hash match. Short keys are stored
+ * inline, longer ones in a separate allocation.
+ *
+ * The hash is supplied by the caller, so that it can be computed once
+ * and be reused, e.g. for selecting a lock shard as well. Slot
+ * selection uses the low bits of the hash.
+ *
+ * Not thread-safe: callers must lock.
+ */
+template<class V>
+class AmStringHashTable
+{
+  struct Slot {
+    uint32_t hash;
+    uint32_t len;
+    bool     used;
+    union {
+      char  inl[STRING_HASH_TABLE_INLINE_KEY];
+      char* ext;
+    } key;
+    V        value;
+
+    Slot() : hash(0), len(0), used(false), value() {}
+
+    const char* key_ptr() const {
+      return len <= STRING_HASH_TABLE_INLINE_KEY ? key.inl : key.ext;
+    }
+
+    bool matches(const char* k, size_t l, uint32_t h) const {
+      return used && hash == h && len == l && !memcmp(key_ptr(), k, l);
+    }
+
+    void set_key(const char* k, size_t l, uint32_t h) {
+      hash = h;
+      len = l;
+      if (l <= STRING_HASH_TABLE_INLINE_KEY) {
+	memcpy(key.inl, k, l);
+      } else {
+	key.ext = (char*)malloc(l);
+	memcpy(key.ext, k, l);
+      }
+      used = true;
+    }
+
+    void free_key() {
+      if (used && len > STRING_HASH_TABLE_INLINE_KEY)
+	free(key.ext);
+      used = false;
+    }
+
+    // takes over key and value, leaves 'src' unused
+    void move_from(Slot& src) {
+      hash  = src.hash;
+      len   = src.len;
+      key   = src.key;
+      used  = true;
+      value = std::move(src.value);
+      src.used = false;
+      src.value = V();
+    }
+  };
+
+  std::vector<Slot> slots;
+  size_t            mask;
+  size_t            n_used;
+
+  size_t find_slot(const char* k, size_t l, uint32_t h) const {
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      const Slot& s = slots[i];
+      if (!s.used)
+	return slots.size();
+      if (s.matches(k, l, h))
+	return i;
+    }
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    mask = slots.size() - 1;
+
+    for (Slot& s : old) {
+      if (!s.used)
+	continue;
+      size_t i = s.hash & mask;
+      while (slots[i].used)
+	i = (i + 1) & mask;
+      slots[i].move_from(s);
+    }
+  }
+
+public:
+  AmStringHashTable(size_t initial_size = 16)
+    : n_used(0)
+  {
+    size_t n = 8;
+    while (n < initial_size)
+      n <<= 1;
+    slots.resize(n);
+    mask = n - 1;
+  }
+
+  ~AmStringHashTable() {
+    for (Slot& s : slots)
+      s.free_key();
+  }
+
+  AmStringHashTable(const AmStringHashTable&) = delete;
+  AmStringHashTable& operator=(const AmStringHashTable&) = delete;
+
+  size_t size() const { return n_used; }
+  bool empty() const { return !n_used; }
+
+  /** @return value of key, or NULL if not found */
+  V* find(const char* k, size_t l, uint32_t h) {
+    size_t i = find_slot(k, l, h);
+    return i < slots.size() ? &slots[i].value : NULL;
+  }
+
+  V* find(const std::string& k, uint32_t h) {
+    return find(k.data(), k.length(), h);
+  }
+
+  /** @return false if the key already exists */
+  bool insert(const std::string& k, uint32_t h, const V& v) {
+    if (find_slot(k.data(), k.length(), h) < slots.size())
+      return false;
+
+    // keep load factor <= 3/4
+    if ((n_used + 1) * 4 > slots.size() * 3)
+      grow();
+
+    size_t i = h & mask;
+    while (slots[i].used)
+      i = (i + 1) & mask;
+
+    slots[i].set_key(k.data(), k.length(), h);
+    slots[i].value = v;
+    n_used++;
+    return true;
+  }
+
+  /** @return false if not found; the value is moved into 'v' if set */
+  bool erase(const std::string& k, uint32_t h, V* v = NULL) {
+    size_t i = find_slot(k.data(), k.length(), h);
+    if (i >= slots.size())
+      return false;
+
+    if (v)
+      *v = std::move(slots[i].value);
+    slots[i].free_key();
+    slots[i].value = V();
+    n_used--;
+
+    // backward-shift the following entries of the probe chain
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; slots[j].used; j = (j + 1) & mask) {
+      size_t home = slots[j].hash & mask;
+      // move j into the hole unless its home lies cyclically in (hole, j]
+      bool stays = (hole <= j) ? (hole < home && home <= j)
+	                       : (hole < home || home <= j);
+      if (!stays) {
+	slots[hole].move_from(slots[j]);
+	hole = j;
+      }
+    }
+
+    return true;
+  }
+
+  /** calls f(key, value) for all entries; the table must not be modified */
+  template<class F>
+  void for_each(F f) {
+    for (Slot& s : slots) {
+      if (s.used)
+	f(std::string(s.key_ptr(), s.len), s.value);
+    }
+  }
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
@@ -51,6 +51,7 @@
 #include "log.h"
 
 #include <assert.h>
+#include <vector>
 
 #include "AmApi.h"
 #include "AmConfigReader.h"
@@ -59,43 +60,69 @@
 #include "AmSipEvent.h"
 
 using std::make_shared;
+using std::vector;
 
 bool SipCtrlInterface::log_parsed_messages = true;
 int SipCtrlInterface::udp_rcvbuf = -1;
+unsigned int SipCtrlInterface::udp_reuseport_sockets = 1;
+bool SipCtrlInterface::udp_cpu_steering = false;
 
 int SipCtrlInterface::init_udp_servers(int if_num)
 {
-    auto udp_socket =
-	make_shared<udp_trsp_socket>(if_num,AmConfig::SIP_Ifs[if_num].SigSockOpts
-			    | (AmConfig::ForceOutboundIf ? 
-			       trsp_socket::force_outbound_if : 0)
-			    | (AmConfig::UseRawSockets ?
-			       trsp_socket::use_raw_sockets : 0),
-			    AmConfig::SIP_Ifs[if_num].NetIfIdx);
+    unsigned int n_sockets = udp_reuseport_sockets > 0 ?
+	udp_reuseport_sockets : 1;
+
+    vector<shared_ptr<udp_trsp_socket> > if_sockets;
+    for(unsigned int i=0; i<n_sockets; i++) {
+
+	auto udp_socket =
+	    make_shared<udp_trsp_socket>(if_num,AmConfig::SIP_Ifs[if_num].SigSockOpts
+				| (AmConfig::ForceOutboundIf ? 
+				   trsp_socket::force_outbound_if : 0)
+				| (AmConfig::UseRawSockets ?
+				   trsp_socket::use_raw_sockets : 0)
+				| (n_sockets > 1 ?
+				   trsp_socket::reuse_port : 0),
+				AmConfig::SIP_Ifs[if_num].NetIfIdx);
 	
-    if(!AmConfig::SIP_Ifs[if_num].PublicIP.empty()) {
-	udp_socket->set_public_ip(AmConfig::SIP_Ifs[if_num].PublicIP);
-    }
+	if(!AmConfig::SIP_Ifs[if_num].PublicIP.empty()) {
+	    udp_socket->set_public_ip(AmConfig::SIP_Ifs[if_num].PublicIP);
+	}
 
-    if(udp_socket->bind(AmConfig::SIP_Ifs[if_num].LocalIP,
-			AmConfig::SIP_Ifs[if_num].LocalPort) < 0){
+	if(udp_socket->bind(AmConfig::SIP_Ifs[if_num].LocalIP,
+			    AmConfig::SIP_Ifs[if_num].LocalPort) < 0){
 
-	ERROR("Could not bind SIP/UDP socket to %s:%i",
-	      AmConfig::SIP_Ifs[if_num].LocalIP.c_str(),
-	      AmConfig::SIP_Ifs[if_num].LocalPort);
+	    ERROR("Could not bind SIP/UDP socket to %s:%i",
+		  AmConfig::SIP_Ifs[if_num].LocalIP.c_str(),
+		  AmConfig::SIP_Ifs[if_num].LocalPort);
 
-	return -1;
+	    return -1;
+	}
+
+	if(udp_rcvbuf > 0) {
+	    udp_socket->set_recvbuf_size(udp_rcvbuf);
+	}
+
+	if_sockets.push_back(udp_socket);
+	udp_sockets.push_back(udp_socket);
     }
 
-    if(udp_rcvbuf > 0) {
-	udp_socket->set_recvbuf_size(udp_rcvbuf);
+    if((n_sockets > 1) && udp_cpu_steering) {
+	// not fatal: the kernel falls back to hashing the 4-tuple
+	if_sockets[0]->attach_cpu_steering(n_sockets);
     }
 
-    trans_layer::instance()->register_transport(udp_socket);
-    udp_sockets.push_back(udp_socket);
+    // only the first socket is known to the transaction layer;
+    // the others of the SO_REUSEPORT group are receive-only and
+    // hand over their messages as if received on the first one.
+    trans_layer::instance()->register_transport(if_sockets[0]);
 
-    for(int j=0; j<AmConfig::SIPServerThreads;j++){
-	udp_servers.emplace_back(udp_socket);
+    unsigned int n_threads = AmConfig::SIPServerThreads;
+    if(n_threads < n_sockets)
+	n_threads = n_sockets;
+
+    for(unsigned int j=0; j<n_threads;j++){
+	udp_servers.emplace_back(if_sockets[0], if_sockets[j % n_sockets]);
     }
 
     return 0;
@@ -188,6 +215,29 @@ int SipCtrlInterface::load()
 	    DBG("udp_rcvbuf = %d\n", udp_rcvbuf);
 	}
 
+	if (cfg.hasParameter("sip_udp_sockets")) {
+	    unsigned int config_udp_sockets = 1;
+	    if (str2int(cfg.getParameter("sip_udp_sockets"), config_udp_sockets)
+		|| !config_udp_sockets) {
+		ERROR("invalid value specified for sip_udp_sockets\n");
+		return -1;
+	    }
+	    udp_reuseport_sockets = config_udp_sockets;
+	}
+	DBG("sip_udp_sockets = %u\n", udp_reuseport_sockets);
+
+	if (cfg.hasParameter("sip_udp_steering")) {
+	    string steering = cfg.getParameter("sip_udp_steering");
+	    if (steering == "cpu") udp_cpu_steering = true;
+	    else if (steering == "hash") udp_cpu_steering = false;
+	    else {
+		ERROR("invalid value specified for sip_udp_steering"
+		      " (expected 'hash' or 'cpu')\n");
+		return -1;
+	    }
+	}
+	DBG("sip_udp_steering = %s\n", udp_cpu_steering ? "cpu" : "hash");
+
     } else {
 	DBG("assuming SIP default settings.\n");
     }
@@ -290,8 +340,13 @@ int SipCtrlInterface::send(AmSipRequest &req, const string& dialog_id,
     msg.hdrs.push_back(new sip_header(0, SIP_HDR_MAX_FORWARDS, stl2cstr(mf)));
 
     if (!req.hdrs.empty()) {
-        c = (char*)req.hdrs.c_str();
-        err = parse_headers(msg, &c, (c + req.hdrs.length()));
+        // headers taken over from a received request are not parsed again
+        size_t reused = 0;
+        if (req.parsed)
+            reused = req.parsed->reuseHeaders(req.hdrs, msg.hdrs);
+
+        c = (char*)req.hdrs.c_str() + reused;
+        err = parse_headers(msg, &c, (req.hdrs.c_str() + req.hdrs.length()));
         if (err) {
             ERROR("Additional headers parsing failed\n");
             ERROR("Faulty headers were: <%s>\n", req.hdrs.c_str());
@@ -368,8 +423,13 @@ int SipCtrlInterface::send(const AmSipReply &rep, const string& dialog_id,
 
     if(!rep.hdrs.empty()) {
 
-	const char* c = rep.hdrs.c_str();
-	int err = parse_headers(msg, &c, c+rep.hdrs.length());
+	// headers taken over from a received reply are not parsed again
+	size_t reused = 0;
+	if (rep.parsed)
+	    reused = rep.parsed->reuseHeaders(rep.hdrs, msg.hdrs);
+
+	const char* c = rep.hdrs.c_str() + reused;
+	int err = parse_headers(msg, &c, rep.hdrs.c_str()+rep.hdrs.length());
 	if(err){
 	    ERROR("Malformed additional header\n");
 	    return -1;
@@ -411,6 +471,25 @@ int SipCtrlInterface::send(const AmSipReply &rep, const string& dialog_id,
 }
 
 
+/** append the headers as "name: value\r\n" to hdrs */
+static void append_hdrs(const std::vector<AmSipParsedMsg::Header>& parsed,
+			string& hdrs)
+{
+    size_t len = hdrs.length();
+    for (std::vector<AmSipParsedMsg::Header>::const_iterator it = parsed.begin();
+	 it != parsed.end(); ++it)
+	len += it->name.length() + it->value.length() + 4;
+    hdrs.reserve(len);
+
+    for (std::vector<AmSipParsedMsg::Header>::const_iterator it = parsed.begin();
+	 it != parsed.end(); ++it) {
+	hdrs.append(it->name);
+	hdrs.append(": ");
+	hdrs.append(it->value);
+	hdrs.append(CRLF);
+    }
+}
+
 inline bool SipCtrlInterface::sip_msg2am_request(const sip_msg *msg,
 						 const trans_ticket& tt,
 						 AmSipRequest &req)
@@ -512,19 +591,14 @@ inline bool SipCtrlInterface::sip_msg2am_request(const sip_msg *msg,
 
     prepare_routes_uas(msg->record_route, req.route);
 
+    req.parsed.reset(new AmSipParsedMsg(msg));
+    append_hdrs(req.parsed->getHeaders(), req.hdrs.modify());
+    req.indexHeaders();
+
     for (list<sip_header *>::const_iterator it = msg->hdrs.begin();
 	 it != msg->hdrs.end(); ++it) {
 
 	switch((*it)->type) {
-	case sip_header::H_OTHER:
-	case sip_header::H_REQUIRE:
-	    req.hdrs += c2stlstr((*it)->name) + ": "
-		+ c2stlstr((*it)->value) + CRLF;
-	    break;
-	case sip_header::H_VIA:
-	    req.vias += c2stlstr((*it)->name) + ": "
-		+ c2stlstr((*it)->value) + CRLF;
-	    break;
 	case sip_header::H_MAX_FORWARDS:
 	    if(!str2int(c2stlstr((*it)->value),req.max_forwards) ||
 	       (req.max_forwards < 0) ||
@@ -614,6 +688,10 @@ inline bool SipCtrlInterface::sip_msg2am_reply(sip_msg *msg, AmSipReply &reply)
 
     prepare_routes_uac(msg->record_route, reply.route);
 
+    reply.parsed.reset(new AmSipParsedMsg(msg));
+    append_hdrs(reply.parsed->getHeaders(), reply.hdrs.modify());
+    reply.indexHeaders();
+
     unsigned rseq;
     for (list<sip_header*>::iterator it = msg->hdrs.begin();
 	 it != msg->hdrs.end(); ++it) {
@@ -621,11 +699,6 @@ inline bool SipCtrlInterface::sip_msg2am_reply(sip_msg *msg, AmSipReply &reply)
         reply.unparsed_headers.push_back(AmSipHeader((*it)->name, (*it)->value));
 #endif
         switch ((*it)->type) {
-          case sip_header::H_OTHER:
-          case sip_header::H_REQUIRE:
-	      reply.hdrs += c2stlstr((*it)->name) + ": "
-                  + c2stlstr((*it)->value) + CRLF;
-              break;
           case sip_header::H_RSEQ:
               if (! parse_rseq(&rseq, (*it)->value.s, (*it)->value.len)) {
                   ERROR("failed to parse (rcvd) '" SIP_HDR_RSEQ "' hdr.\n");
@@ -85,6 +85,10 @@ public:
     static unsigned int outbound_port;
     static bool log_parsed_messages;
     static int udp_rcvbuf;
+    /** SO_REUSEPORT sockets bound per SIP/UDP interface */
+    static unsigned int udp_reuseport_sockets;
+    /** steer datagrams to the reuseport socket by receiving CPU */
+    static bool udp_cpu_steering;
 
     SipCtrlInterface();
     //~SipCtrlInterface(){}
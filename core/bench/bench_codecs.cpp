@@ -0,0 +1,336 @@
+/*
+ * Codec micro-benchmark: loads the built-in audio codec plug-ins from
+ * the plug-in directory (skipping the ones that are not built) and
+ * times encoding and decoding of a speech-like test signal with every
+ * codec they export, frame by frame as the RTP stream does.
+ *
+ * For the G.711 codecs of the wav plug-in, it also compares the
+ * scalar, SSE2 and AVX2 conversion kernels, checks that they agree
+ * with the lookup tables for every input value, and times direct
+ * A-law <-> u-law conversion against decoding and encoding again.
+ *
+ * usage: bench_codecs [seconds of audio] [plug-in dir]
+ *        (default: 60 ../lib)
+ */
+
+#include "amci/amci.h"
+#include "amci/codecs.h"
+#include "../plug-in/wav/g711_kernels.h"
+#include "log.h"
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+static const char* plugins[] = {
+  "wav", "l16", "adpcm", "g722", "gsm", "ilbc", "speex", "opus",
+  "g729", "silk", "isac"
+};
+
+#define MAX_ENCODED_FRAME 4096
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* voiced-speech-like: harmonics of a wandering pitch, syllable
+   envelope, some noise */
+static vector<short> make_signal(unsigned int rate, unsigned int seconds)
+{
+  vector<short> s((size_t)rate * seconds);
+  std::mt19937 rnd(7);
+  std::normal_distribution<double> noise(0.0, 300.0);
+  double phase = 0.0;
+
+  for (size_t i = 0; i < s.size(); i++) {
+    double t = (double)i / rate;
+    double f0 = 140.0 + 40.0 * sin(2 * M_PI * 0.7 * t);
+    phase += 2 * M_PI * f0 / rate;
+    double env = 0.5 + 0.5 * sin(2 * M_PI * 3.0 * t);
+    double v = 0.0;
+    for (int h = 1; h <= 8; h++)
+      v += sin(h * phase) / h;
+    v = 9000.0 * env * v + noise(rnd);
+    s[i] = (short)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+  }
+  return s;
+}
+
+static string codec_name(amci_exports_t* exports, int codec_id, int& rate)
+{
+  rate = 8000;
+  for (amci_payload_t* p = exports->payloads; p->name; p++) {
+    if (p->codec_id == codec_id) {
+      rate = p->sample_rate;
+      return p->name;
+    }
+  }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "codec %d", codec_id);
+  return buf;
+}
+
+static void bench_codec(amci_exports_t* exports, amci_codec_t* c,
+			unsigned int seconds)
+{
+  int rate;
+  string name = codec_name(exports, c->id, rate);
+
+  long h_codec = 0;
+  unsigned int frame_size = rate / 50;
+  if (c->init) {
+    const char* fmt_out = NULL;
+    amci_codec_fmt_info_t* fmt_info = NULL;
+    h_codec = c->init("", &fmt_out, &fmt_info);
+    if (h_codec == -1) {
+      printf("%-8s init failed\n", name.c_str());
+      return;
+    }
+    for (; fmt_info && fmt_info->id; fmt_info++) {
+      if (fmt_info->id == AMCI_FMT_FRAME_SIZE)
+	frame_size = fmt_info->value;
+    }
+  }
+
+  vector<short> pcm = make_signal(rate, seconds);
+  size_t frames = pcm.size() / frame_size;
+  vector<unsigned char> enc(frames * MAX_ENCODED_FRAME);
+  vector<int> enc_len(frames);
+  vector<short> out(frame_size * 4);
+
+  size_t enc_bytes = 0;
+  double start = now_ms();
+  for (size_t f = 0; f < frames; f++) {
+    enc_len[f] = c->encode(&enc[f * MAX_ENCODED_FRAME],
+			   (unsigned char*)&pcm[f * frame_size],
+			   frame_size * sizeof(short), 1, rate, h_codec);
+    if (enc_len[f] < 0) {
+      printf("%-8s encoding failed\n", name.c_str());
+      goto out;
+    }
+    enc_bytes += enc_len[f];
+  }
+  {
+    double enc_ms = now_ms() - start;
+
+    start = now_ms();
+    for (size_t f = 0; f < frames; f++) {
+      if (c->decode((unsigned char*)out.data(), &enc[f * MAX_ENCODED_FRAME],
+		    enc_len[f], 1, rate, h_codec) < 0) {
+	printf("%-8s decoding failed\n", name.c_str());
+	goto out;
+      }
+    }
+    double dec_ms = now_ms() - start;
+
+    printf("%-8s %5d Hz %4u smp %6.1f kbit/s  enc %8.0f ns/frame  dec %8.0f ns/frame"
+	   "  %8.0f x realtime\n",
+	   name.c_str(), rate, frame_size, enc_bytes * 8.0 / seconds / 1000.0,
+	   enc_ms * 1e6 / frames, dec_ms * 1e6 / frames,
+	   seconds * 1000.0 / (enc_ms + dec_ms));
+  }
+
+ out:
+  if (c->destroy)
+    c->destroy(h_codec);
+}
+
+/* G.711 kernels */
+
+#define G711_RUNS 5
+
+/* best of G711_RUNS, the runs being short */
+template<class F> static double best_ms(F f)
+{
+  double best = 0.0;
+  for (int r = 0; r < G711_RUNS; r++) {
+    double start = now_ms();
+    f();
+    double t = now_ms() - start;
+    if (!r || t < best)
+      best = t;
+  }
+  return best;
+}
+
+typedef const g711_kernels* (*g711_kernels_fn)(void);
+
+static int check_g711(const g711_kernels* k, const g711_kernels* ref)
+{
+  // every PCM16 value and every code byte, at unaligned offsets
+  // and with tails
+  vector<short> pcm(65536 + 3);
+  vector<unsigned char> codes(256 * 3 + 5);
+  for (size_t i = 0; i < pcm.size(); i++)
+    pcm[i] = (short)(i - 32768);
+  for (size_t i = 0; i < codes.size(); i++)
+    codes[i] = (unsigned char)i;
+
+  for (unsigned int off = 0; off < 3; off++) {
+    unsigned int n = 65536 - off;
+    vector<unsigned char> e1(n), e2(n);
+    ref->alaw_encode(e1.data(), (int16_t*)&pcm[off], n);
+    k->alaw_encode(e2.data(), (int16_t*)&pcm[off], n);
+    if (e1 != e2) return 1;
+    ref->ulaw_encode(e1.data(), (int16_t*)&pcm[off], n);
+    k->ulaw_encode(e2.data(), (int16_t*)&pcm[off], n);
+    if (e1 != e2) return 1;
+
+    n = codes.size() - off;
+    vector<short> d1(n), d2(n);
+    ref->alaw_decode((int16_t*)d1.data(), &codes[off], n);
+    k->alaw_decode((int16_t*)d2.data(), &codes[off], n);
+    if (d1 != d2) return 1;
+    ref->ulaw_decode((int16_t*)d1.data(), &codes[off], n);
+    k->ulaw_decode((int16_t*)d2.data(), &codes[off], n);
+    if (d1 != d2) return 1;
+
+    // direct transcoding == decoding and encoding again
+    vector<unsigned char> t1(n), t2(n);
+    k->alaw_decode((int16_t*)d1.data(), &codes[off], n);
+    k->ulaw_encode(t1.data(), (int16_t*)d1.data(), n);
+    k->alaw2ulaw(t2.data(), &codes[off], n);
+    if (t1 != t2) return 1;
+    k->ulaw_decode((int16_t*)d1.data(), &codes[off], n);
+    k->alaw_encode(t1.data(), (int16_t*)d1.data(), n);
+    k->ulaw2alaw(t2.data(), &codes[off], n);
+    if (t1 != t2) return 1;
+  }
+  return 0;
+}
+
+static void bench_g711(void* h_dl, unsigned int seconds)
+{
+  const char* variants[] = {
+    "g711_kernels_scalar", "g711_kernels_sse2", "g711_kernels_avx2"
+  };
+
+  g711_kernels_fn get_ref = (g711_kernels_fn)dlsym(h_dl, "g711_kernels_scalar");
+  if (!get_ref) {
+    printf("wav plug-in without G.711 kernels\n");
+    return;
+  }
+  const g711_kernels* ref = get_ref();
+
+  vector<short> pcm = make_signal(8000, seconds);
+  size_t frames = pcm.size() / 160;
+  vector<unsigned char> alaw(pcm.size()), ulaw(pcm.size());
+  vector<short> out(160);
+
+  printf("\nG.711 kernels, %u s of audio in 20 ms frames, best of %d runs:\n",
+	 seconds, G711_RUNS);
+  for (const char* v : variants) {
+    g711_kernels_fn fn = (g711_kernels_fn)dlsym(h_dl, v);
+    const g711_kernels* k = fn ? fn() : NULL;
+    if (!k) {
+      printf("%-7s not supported\n", v + strlen("g711_kernels_"));
+      continue;
+    }
+    if (check_g711(k, ref)) {
+      printf("%-7s self-check FAILED\n", k->name);
+      continue;
+    }
+
+    double t[4];
+    t[0] = best_ms([&]() {
+	for (size_t f = 0; f < frames; f++)
+	  k->alaw_encode(&alaw[f * 160], (int16_t*)&pcm[f * 160], 160);
+      });
+    t[1] = best_ms([&]() {
+	for (size_t f = 0; f < frames; f++)
+	  k->ulaw_encode(&ulaw[f * 160], (int16_t*)&pcm[f * 160], 160);
+      });
+    t[2] = best_ms([&]() {
+	for (size_t f = 0; f < frames; f++)
+	  k->alaw_decode((int16_t*)out.data(), &alaw[f * 160], 160);
+      });
+    t[3] = best_ms([&]() {
+	for (size_t f = 0; f < frames; f++)
+	  k->ulaw_decode((int16_t*)out.data(), &ulaw[f * 160], 160);
+      });
+
+    printf("%-7s self-check passed  ns/sample: alaw enc %5.2f dec %5.2f"
+	   "  ulaw enc %5.2f dec %5.2f\n", k->name,
+	   t[0] * 1e6 / pcm.size(), t[2] * 1e6 / pcm.size(),
+	   t[1] * 1e6 / pcm.size(), t[3] * 1e6 / pcm.size());
+  }
+
+  // A-law -> u-law, as done by a transcoding B2BUA leg
+  g711_kernels_fn get_best = (g711_kernels_fn)dlsym(h_dl, "g711_kernels_get");
+  const g711_kernels* k = get_best ? get_best() : ref;
+  vector<unsigned char> frame(160);
+
+  double via_pcm = best_ms([&]() {
+      for (size_t f = 0; f < frames; f++) {
+	k->alaw_decode((int16_t*)out.data(), &alaw[f * 160], 160);
+	k->ulaw_encode(frame.data(), (int16_t*)out.data(), 160);
+      }
+    });
+  double direct = best_ms([&]() {
+      for (size_t f = 0; f < frames; f++)
+	k->alaw2ulaw(frame.data(), &alaw[f * 160], 160);
+    });
+
+  printf("alaw->ulaw via PCM16 (%s) %5.2f ns/sample, direct %5.2f ns/sample\n",
+	 k->name, via_pcm * 1e6 / pcm.size(), direct * 1e6 / pcm.size());
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned int seconds = argc > 1 ? atoi(argv[1]) : 60;
+  string dir = argc > 2 ? argv[2] : "../lib";
+  if (!seconds)
+    seconds = 1;
+
+  printf("%u s of audio per codec, plug-ins from %s\n", seconds, dir.c_str());
+
+  void* h_wav = NULL;
+  for (const char* name : plugins) {
+    string file = dir + "/" + name + ".so";
+    void* h_dl = dlopen(file.c_str(), RTLD_NOW);
+    if (!h_dl) {
+      printf("%-8s not built\n", name);
+      continue;
+    }
+
+    amci_exports_t* exports = (amci_exports_t*)dlsym(h_dl, "amci_exports");
+    if (!exports) {
+      printf("%-8s is not an audio plug-in\n", name);
+      continue;
+    }
+    if (exports->module_load && exports->module_load("") < 0) {
+      printf("%-8s failed to initialize\n", name);
+      continue;
+    }
+
+    for (amci_codec_t* c = exports->codecs; c->id >= 0; c++)
+      bench_codec(exports, c, seconds);
+
+    if (!strcmp(name, "wav"))
+      h_wav = h_dl;
+  }
+
+  if (h_wav)
+    bench_g711(h_wav, seconds);
+
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,247 @@
+/*
+ * DSM engine benchmark: loads a small IVR-like chart (PIN entry by
+ * DTMF: variables, event parameters, string templates, arithmetic
+ * and tests) and runs 'events' key press events through it on a
+ * session that only keeps the variables, i.e. measures the state
+ * engine, the core actions and conditions and the variable
+ * resolution, without media or signaling.
+ *
+ * Then it times resolving some typical action parameters with their
+ * compiled form (as read from a chart) against parsing the parameter
+ * string each time.
+ *
+ * usage: bench_dsm [events] [chart.dsm]
+ *        (default: 1000000, built-in chart)
+ */
+
+#include "AmUtils.h"
+#include "log.h"
+
+#include "../../apps/dsm/DSMCoreModule.h"
+#include "../../apps/dsm/DSMSession.h"
+#include "../../apps/dsm/DSMStateEngine.h"
+#include "../../apps/dsm/DSMStateDiagramCollection.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <string>
+
+using std::string;
+
+static const char* ivr_chart =
+  "initial state start;\n"
+  "transition \"init\" start - start() / {\n"
+  "    set($digits=0);\n"
+  "    set($lang=en);\n"
+  "    sets($prompt_dir=/usr/share/sems/prompts/$lang);\n"
+  "  } -> menu;\n"
+  "\n"
+  "state menu;\n"
+  "\n"
+  "transition \"pin complete\" menu - keyTest(#key < 10); test($digits == 3) / {\n"
+  "    append($pin, #key);\n"
+  "    sets($msg=PIN $pin entered, last key #key after #duration ms);\n"
+  "    set($result=$pin);\n"
+  "    clear($pin);\n"
+  "    set($digits=0);\n"
+  "    playPrompt(pin_accepted);\n"
+  "  } -> menu;\n"
+  "\n"
+  "transition \"digit\" menu - keyTest(#key < 10) / {\n"
+  "    append($pin, #key);\n"
+  "    inc($digits);\n"
+  "    set($last_key=#key);\n"
+  "    sets($prompt=$(prompt_dir)/digit_#(key).wav);\n"
+  "    eval($remaining=4 - $digits);\n"
+  "    playPrompt($prompt);\n"
+  "  } -> menu;\n"
+  "\n"
+  "transition \"star\" menu - keyTest(#key == 10) / {\n"
+  "    clear($pin);\n"
+  "    set($digits=0);\n"
+  "  } -> menu;\n"
+  "\n"
+  "transition \"hangup\" menu - hangup() / stop(false) -> end;\n"
+  "\n"
+  "state end;\n";
+
+/** session that only keeps the variables */
+class BenchDSMSession : public DSMSession {
+ public:
+  unsigned long prompts;
+  string last_prompt;
+
+  BenchDSMSession() : prompts(0) { }
+
+  void playPrompt(const string& name, bool loop, bool front) {
+    prompts++;
+    last_prompt = name;
+  }
+  void playFile(const string& name, bool loop, bool front) { }
+  void playSilence(unsigned int length, bool front) { }
+  void playRingtone(int length, int on, int off, int f, int f2, bool front) { }
+  void recordFile(const string& name) { }
+  unsigned int getRecordLength() { return 0; }
+  unsigned int getRecordDataSize() { return 0; }
+  void stopRecord() { }
+  void setInOutPlaylist() { }
+  void setInputPlaylist() { }
+  void setOutputPlaylist() { }
+  void addToPlaylist(AmPlaylistItem* item, bool front) { }
+  void flushPlaylist() { }
+  void setPromptSet(const string& name) { }
+  void addSeparator(const string& name, bool front) { }
+  void connectMedia() { }
+  void disconnectMedia() { }
+  void mute() { }
+  void unmute() { }
+  void B2BconnectCallee(const string& remote_party, const string& remote_uri,
+			bool relayed_invite) { }
+  void B2BterminateOtherLeg() { }
+  void B2BaddReceivedRequest(const AmSipRequest& req) { }
+  void B2BsetRelayEarlyMediaSDP(bool enabled) { }
+  void replaceHdrsCRLF(string& hdrs) { }
+  void B2BsetHeaders(const string& hdr, bool replaceCRLF) { }
+  void B2BclearHeaders() { }
+  void B2BaddHeader(const string& hdr) { }
+  void B2BremoveHeader(const string& hdr) { }
+  void transferOwnership(DSMDisposable* d) { }
+  void releaseOwnership(DSMDisposable* d) { }
+  void B2BgetHeaderRequest(const string& hdr, string& out) { }
+  void B2BgetHeaderReply(const string& hdr, string& out) { }
+  void B2BgetHeaderParamRequest(const string& hdr, const string& param,
+				string& out) { }
+  void B2BgetHeaderParamReply(const string& hdr, const string& param,
+			      string& out) { }
+};
+
+static unsigned long long now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (unsigned long long)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+#define PARAM_RUNS 1000000
+
+static void bench_params(BenchDSMSession& sc_sess, map<string, string>& params)
+{
+  struct {
+    const char* param;
+    const char* how;
+  } tests[] = {
+    { "$prompt_dir", "resolveVars" },
+    { "#key", "resolveVars" },
+    { "/usr/share/sems/prompts/welcome.wav", "resolveVars" },
+    { "4 - $digits", "eval" },
+    { "$(prompt_dir)/digit_#(key).wav", "replaceParams" },
+    { "PIN $pin entered, last key #key after #duration ms", "replaceParams" },
+  };
+
+  printf("\nparameter resolution, %d runs: parsed / compiled\n", PARAM_RUNS);
+  for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+    string raw = tests[t].param;
+    DSMParam compiled(raw);
+    compiled.compile();
+    bool eval = !strcmp(tests[t].how, "eval");
+    bool repl = !strcmp(tests[t].how, "replaceParams");
+
+    string r1, r2;
+    size_t len = 0;
+    unsigned long long start = now_us();
+    for (int i = 0; i < PARAM_RUNS; i++) {
+      r1 = repl ? replaceParams(raw, NULL, &sc_sess, &params) :
+	resolveVars(raw, NULL, &sc_sess, &params, eval);
+      len += r1.length();
+    }
+    unsigned long long parsed_us = now_us() - start;
+
+    start = now_us();
+    for (int i = 0; i < PARAM_RUNS; i++) {
+      r2 = repl ? replaceParams(compiled, NULL, &sc_sess, &params) :
+	resolveVars(compiled, NULL, &sc_sess, &params, eval);
+      len += r2.length();
+    }
+    unsigned long long compiled_us = now_us() - start;
+
+    printf("%-14s %-52s %6.1f / %6.1f ns%s\n", tests[t].how,
+	   ("'" + raw + "'").c_str(),
+	   parsed_us * 1000.0 / PARAM_RUNS, compiled_us * 1000.0 / PARAM_RUNS,
+	   r1 == r2 ? "" : "  MISMATCH");
+  }
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned long events = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  string chart_file = argc > 2 ? argv[2] : "";
+  if (!events)
+    events = 1;
+
+  char tmp_name[] = "/tmp/bench_dsm_XXXXXX";
+  if (chart_file.empty()) {
+    int fd = mkstemp(tmp_name);
+    if (fd < 0 || write(fd, ivr_chart, strlen(ivr_chart)) < 0) {
+      perror("writing chart");
+      return 1;
+    }
+    close(fd);
+    chart_file = tmp_name;
+  }
+
+  DSMStateDiagramCollection diags;
+  unsigned long long start = now_us();
+  bool loaded = diags.loadFile(chart_file, "bench", "/tmp", "/tmp", false, true);
+  unsigned long long load_us = now_us() - start;
+  if (chart_file == tmp_name)
+    unlink(tmp_name);
+  if (!loaded) {
+    fprintf(stderr, "loading chart '%s' failed\n", chart_file.c_str());
+    return 1;
+  }
+
+  DSMStateEngine engine;
+  BenchDSMSession sc_sess;
+  diags.addToEngine(&engine);
+  if (!engine.init(NULL, &sc_sess, "bench", DSMCondition::Start)) {
+    fprintf(stderr, "initializing the chart failed\n");
+    return 1;
+  }
+
+  // the key press events of a caller entering PINs, with a '*' now
+  // and then
+  map<string, string> params;
+  params["key"] = "0";
+  params["duration"] = "120";
+
+  start = now_us();
+  for (unsigned long i = 0; i < events; i++) {
+    unsigned int key = (i % 13 == 12) ? 10 : (i * 7) % 10;
+    params["key"] = int2str(key);
+    engine.runEvent(NULL, &sc_sess, DSMCondition::Key, &params);
+  }
+  unsigned long long run_us = now_us() - start;
+
+  printf("chart loaded in %llu us\n", load_us);
+  printf("%lu events in %.3f s: %.0f ns/event, %.0f events/s\n",
+	 events, run_us / 1e6, run_us * 1000.0 / events,
+	 events * 1e6 / (run_us ? run_us : 1));
+  printf("%lu prompts played, last '%s'\n",
+	 sc_sess.prompts, sc_sess.last_prompt.c_str());
+  printf("last PIN '%s', last message '%s'\n",
+	 sc_sess.var["result"].c_str(), sc_sess.var["msg"].c_str());
+
+  bench_params(sc_sess, params);
+
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
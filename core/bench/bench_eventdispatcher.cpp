@@ -0,0 +1,230 @@
+/*
+ * AmEventDispatcher micro-benchmark: post() throughput from several
+ * threads, comparing the former std::map buckets behind a mutex with
+ * AmStringHashTable buckets behind a shared lock, at different bucket
+ * counts. Also measures the real AmEventDispatcher (compile-time
+ * EVENT_DISPATCHER_BUCKETS) and checks AmStringHashTable against
+ * std::map with random inserts/erases.
+ *
+ * usage: bench_eventdispatcher [n_sessions] [threads] [posts_per_thread]
+ *        (default: 100000 4 250000)
+ */
+
+#include "AmEventDispatcher.h"
+#include "AmStringHashTable.h"
+#include "AmThread.h"
+#include "AmUtils.h"
+#include "sip/hash.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+struct null_queue : public AmEventQueueInterface
+{
+  std::atomic<uint64_t> n;
+  null_queue() : n(0) {}
+  void postEvent(AmEvent* ev) { n.fetch_add(1, std::memory_order_relaxed); delete ev; }
+};
+
+static null_queue the_queue;
+
+/* former layout: std::map per bucket, mutex, bucket = hash & (n-1) */
+struct map_buckets
+{
+  unsigned int n;
+  std::vector<std::map<string, AmEventQueueInterface*> > maps;
+  std::vector<AmMutex> muts;
+
+  map_buckets(unsigned int n) : n(n), maps(n), muts(n) {}
+
+  void add(const string& k) {
+    unsigned int b = hashlittle(k.c_str(), k.length(), 0) & (n - 1);
+    maps[b][k] = &the_queue;
+  }
+
+  bool post(const string& k, AmEvent* ev) {
+    unsigned int b = hashlittle(k.c_str(), k.length(), 0) & (n - 1);
+    std::lock_guard<AmMutex> l(muts[b]);
+    auto it = maps[b].find(k);
+    if (it == maps[b].end()) return false;
+    it->second->postEvent(ev);
+    return true;
+  }
+};
+
+/* new layout: open addressing table per bucket, shared lock */
+struct table_buckets
+{
+  unsigned int shift;
+  std::vector<std::unique_ptr<AmStringHashTable<AmEventQueueInterface*> > > tables;
+  std::vector<std::shared_mutex> muts;
+
+  table_buckets(unsigned int n) : muts(n) {
+    shift = 32;
+    for (unsigned int i = n; i > 1; i >>= 1) shift--;
+    for (unsigned int i = 0; i < n; i++)
+      tables.emplace_back(new AmStringHashTable<AmEventQueueInterface*>());
+  }
+
+  unsigned int bucket(uint32_t h) { return shift < 32 ? h >> shift : 0; }
+
+  void add(const string& k) {
+    uint32_t h = hashlittle(k.c_str(), k.length(), 0);
+    tables[bucket(h)]->insert(k, h, &the_queue);
+  }
+
+  bool post(const string& k, AmEvent* ev) {
+    uint32_t h = hashlittle(k.c_str(), k.length(), 0);
+    unsigned int b = bucket(h);
+    std::shared_lock<std::shared_mutex> l(muts[b]);
+    AmEventQueueInterface** q = tables[b]->find(k, h);
+    if (!q) return false;
+    (*q)->postEvent(ev);
+    return true;
+  }
+};
+
+// local tags shaped like AmSession::getNewId()
+static std::vector<string> make_tags(size_t n)
+{
+  std::mt19937 rnd(1);
+  std::vector<string> tags;
+  for (size_t i = 0; i < n; i++) {
+    tags.push_back(int2hex(rnd()) + "-" + int2hex(i) + int2hex(rnd()) +
+		   "-" + int2hex(rnd()));
+  }
+  return tags;
+}
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+template<class F>
+static double run_threads(unsigned int threads, uint64_t per_thread,
+			  const std::vector<string>& tags, F post)
+{
+  double t0 = now_ms();
+  std::vector<std::thread> th;
+  for (unsigned int t = 0; t < threads; t++) {
+    th.emplace_back([&, t]() {
+	std::mt19937 rnd(t);
+	for (uint64_t i = 0; i < per_thread; i++)
+	  post(tags[rnd() % tags.size()]);
+      });
+  }
+  for (auto& t : th)
+    t.join();
+  return now_ms() - t0;
+}
+
+static int check_table()
+{
+  std::mt19937 rnd(7);
+  AmStringHashTable<int> table;
+  std::map<string, int> ref;
+
+  for (int i = 0; i < 200000; i++) {
+    string k = "key-" + std::to_string(rnd() % 5000);
+    if (rnd() % 80 == 0) k += string(60, 'x'); // out-of-line keys
+    uint32_t h = hashlittle(k.c_str(), k.length(), 0);
+
+    switch (rnd() % 3) {
+    case 0:
+      if (table.insert(k, h, i) != ref.emplace(k, i).second) return 1;
+      break;
+    case 1: {
+      int v = -1;
+      bool found = table.erase(k, h, &v);
+      auto it = ref.find(k);
+      if (found != (it != ref.end())) return 1;
+      if (found && v != it->second) return 1;
+      if (found) ref.erase(it);
+    } break;
+    default: {
+      int* v = table.find(k, h);
+      auto it = ref.find(k);
+      if ((v != NULL) != (it != ref.end())) return 1;
+      if (v && *v != it->second) return 1;
+    } break;
+    }
+  }
+
+  return table.size() == ref.size() ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  size_t n_sessions = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+  unsigned int threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+  uint64_t per_thread = argc > 3 ? strtoull(argv[3], NULL, 10) : 250000;
+
+  if (check_table()) {
+    fprintf(stderr, "error: AmStringHashTable differs from std::map\n");
+    return 1;
+  }
+
+  std::vector<string> tags = make_tags(n_sessions);
+  uint64_t total = per_thread * threads;
+
+  printf("%zu sessions, %u threads, %" PRIu64 " posts\n",
+	 n_sessions, threads, total);
+
+  const unsigned int buckets[] = { 1, 16, 256, 1024, 4096 };
+  for (unsigned int n : buckets) {
+    map_buckets mb(n);
+    table_buckets tb(n);
+    for (const string& t : tags) {
+      mb.add(t);
+      tb.add(t);
+    }
+
+    double ms_map = run_threads(threads, per_thread, tags,
+				[&](const string& t) { mb.post(t, new AmEvent(0)); });
+    double ms_tbl = run_threads(threads, per_thread, tags,
+				[&](const string& t) { tb.post(t, new AmEvent(0)); });
+
+    printf("%5u buckets: map+mutex %8.1f ms (%6.1f ns/post)"
+	   "  table+shared %8.1f ms (%6.1f ns/post)\n",
+	   n, ms_map, ms_map * 1e6 / total, ms_tbl, ms_tbl * 1e6 / total);
+  }
+
+  AmEventDispatcher* d = AmEventDispatcher::instance();
+  for (const string& t : tags)
+    d->addEventQueue(t, &the_queue);
+
+  double ms = run_threads(threads, per_thread, tags,
+			  [&](const string& t) { d->post(t, new AmEvent(0)); });
+  printf("AmEventDispatcher (%d buckets): %8.1f ms (%6.1f ns/post)\n",
+	 EVENT_DISPATCHER_BUCKETS, ms, ms * 1e6 / total);
+
+  for (const string& t : tags)
+    d->delEventQueue(t);
+
+  if (!d->empty()) {
+    fprintf(stderr, "error: dispatcher not empty\n");
+    return 1;
+  }
+
+  return 0;
+}
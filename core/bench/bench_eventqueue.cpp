@@ -0,0 +1,91 @@
+/*
+ * Event queue fan-in micro-benchmark: N producer threads post events
+ * into a single queue drained by one consumer thread, comparing the
+ * Locked and LockFree AmEventQueue implementations.
+ *
+ * usage: bench_eventqueue [events_per_producer]   (default: 1000000)
+ */
+
+#include "AmEventQueue.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct counting_handler : public AmEventHandler
+{
+  std::atomic<uint64_t> processed;
+  counting_handler() : processed(0) {}
+  void process(AmEvent*) { processed.fetch_add(1, std::memory_order_relaxed); }
+};
+
+static double run(AmEventQueueBase::QueueType type, unsigned int producers,
+		  uint64_t per_producer)
+{
+  counting_handler h;
+  AmEventQueue q(&h, type);
+  uint64_t total = per_producer * producers;
+
+  struct timeval t0, t1;
+  gettimeofday(&t0, NULL);
+
+  std::thread consumer([&]() {
+      while (h.processed.load(std::memory_order_relaxed) < total) {
+	q.waitForEventTimed(100);
+	q.processEvents();
+      }
+    });
+
+  std::vector<std::thread> threads;
+  for (unsigned int p = 0; p < producers; p++) {
+    threads.emplace_back([&]() {
+	for (uint64_t i = 0; i < per_producer; i++)
+	  q.postEvent(new AmEvent(0));
+      });
+  }
+
+  for (auto& t : threads)
+    t.join();
+  consumer.join();
+
+  gettimeofday(&t1, NULL);
+  double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_usec - t0.tv_usec) / 1000.0;
+
+  if (h.processed != total) {
+    fprintf(stderr, "error: processed %" PRIu64 " of %" PRIu64 " events\n",
+	    h.processed.load(), total);
+    exit(1);
+  }
+
+  return ms;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  uint64_t per_producer = 1000000;
+  if (argc > 1)
+    per_producer = strtoull(argv[1], NULL, 10);
+
+  const unsigned int producers[] = { 1, 2, 4, 8 };
+
+  for (unsigned int p : producers) {
+    double locked = run(AmEventQueueBase::Locked, p, per_producer);
+    double lockfree = run(AmEventQueueBase::LockFree, p, per_producer);
+    uint64_t n = per_producer * p;
+
+    printf("%u producers, %9" PRIu64 " events: locked %8.1f ms (%6.1f ns/ev)"
+	   "  lockfree %8.1f ms (%6.1f ns/ev)\n",
+	   p, n, locked, locked * 1e6 / n, lockfree, lockfree * 1e6 / n);
+  }
+
+  return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * SIP header access micro-benchmark: the lookups, removals and
+ * additions a B2BUA typically does on the 'hdrs' of a realistic
+ * 30-header INVITE, done with the former getHeader()/removeHeader()
+ * (strdup() and a case-folding scan per lookup), with the current free
+ * functions, and through the per-message header index (including
+ * building the index once per message, as done at parse time).
+ * Also checks that the three give the same results.
+ *
+ * usage: bench_headers [messages] (default: 200000)
+ */
+
+#include "AmSipMsg.h"
+#include "AmSipHeaders.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* former implementation */
+static bool legacy_findHeader(const string& hdrs,const string& hdr_name,
+			      const size_t skip, size_t& pos1, size_t& pos2,
+			      size_t& hdr_start)
+{
+  unsigned int p;
+  if(skip >= hdrs.length()) return false;
+  char* hdr = strdup(hdr_name.c_str());
+  const char* hdrs_c = hdrs.c_str() + skip;
+  char* hdr_c = hdr;
+  const char* hdrs_end = hdrs.c_str() + hdrs.length();
+  const char* hdr_end = hdr_c + hdr_name.length();
+
+  while(hdr_c != hdr_end){
+    if('A' <= *hdr_c && *hdr_c <= 'Z')
+      *hdr_c -= 'A' - 'a';
+    hdr_c++;
+  }
+
+  while(hdrs_c != hdrs_end){
+    hdr_c = hdr;
+    while((hdrs_c != hdrs_end) && (hdr_c != hdr_end)){
+      char c = *hdrs_c;
+      if('A' <= *hdrs_c && *hdrs_c <= 'Z')
+	c -= 'A' - 'a';
+      if(c != *hdr_c)
+	break;
+      hdr_c++;
+      hdrs_c++;
+    }
+    if(hdr_c == hdr_end) {
+      const char* srccol = hdrs_c;
+      while (*srccol==' ' || *srccol=='\t')
+	srccol++;
+      if (*srccol == ':')
+	break;
+    }
+    while((hdrs_c != hdrs_end) && (*hdrs_c != '\n'))
+      hdrs_c++;
+    if(hdrs_c != hdrs_end)
+      hdrs_c++;
+  }
+
+  if(hdr_c == hdr_end){
+    hdr_start = hdrs_c - hdrs.c_str();;
+    while((hdrs_c != hdrs_end) && (*hdrs_c == ' '))
+      hdrs_c++;
+    if((hdrs_c != hdrs_end) && (*hdrs_c == ':')){
+      hdrs_c++;
+      while((hdrs_c != hdrs_end) && (*hdrs_c == ' '))
+	hdrs_c++;
+      p = hdrs_c - hdrs.c_str();
+      string::size_type p_end = p;
+      while (p_end < hdrs.size() &&
+	     hdrs[p_end] != '\r' &&
+	     hdrs[p_end] != '\n')
+	p_end++;
+      free(hdr);
+      pos1 = p;
+      pos2 = p_end;
+      return true;
+    }
+  }
+
+  free(hdr);
+  return false;
+}
+
+static string legacy_getHeader(const string& hdrs,const string& hdr_name,
+			       bool single = false)
+{
+  if (hdr_name.empty())
+    return "";
+  size_t pos1, pos2, pos_s, skip = 0;
+  string ret = "";
+  while(legacy_findHeader(hdrs, hdr_name, skip, pos1, pos2, pos_s)) {
+    if(skip)
+      ret.append(", ");
+    else
+      if(single) return hdrs.substr(pos1,pos2-pos1);
+    ret.append(hdrs.substr(pos1,pos2-pos1));
+    skip = pos2+1;
+  }
+  return ret;
+}
+
+static bool legacy_removeHeader(string& hdrs, const string& hdr_name)
+{
+  size_t pos1, pos2, hdr_start;
+  bool found = false;
+  while (legacy_findHeader(hdrs, hdr_name, 0, pos1, pos2, hdr_start)) {
+    while (pos2 < hdrs.length() &&
+	   (hdrs[pos2]=='\r' || hdrs[pos2]=='\n'))
+      pos2++;
+    hdr_start -= hdr_name.length();
+    hdrs.erase(hdr_start, pos2 - hdr_start);
+    found = true;
+  }
+  return found;
+}
+
+/* a realistic INVITE, minus the headers the stack keeps apart */
+static string make_invite_hdrs(unsigned int variant)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%u", variant);
+  string v(buf);
+
+  return
+    "Max-Forwards: 69" CRLF
+    "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO, UPDATE, PRACK" CRLF
+    "Supported: replaces, timer, path" CRLF
+    "k: 100rel" CRLF
+    "User-Agent: Acme Phone 5.2." + v + CRLF
+    "Session-Expires: 1800;refresher=uac" CRLF
+    "Min-SE: 90" CRLF
+    "P-Asserted-Identity: <sip:+4930" + v + "@example.com;user=phone>" CRLF
+    "P-Preferred-Identity: \"Alice\" <sip:alice@example.com>" CRLF
+    "Privacy: none" CRLF
+    "Accept: application/sdp, application/isup, multipart/mixed" CRLF
+    "Accept-Language: en, de" CRLF
+    "Allow-Events: talk, hold, conference, refer" CRLF
+    "Date: Sat, 13 Nov 2010 23:29:00 GMT" CRLF
+    "Organization: Example Inc." CRLF
+    "P-Access-Network-Info: 3GPP-UTRAN-TDD; utran-cell-id-3gpp=23456789ABCDE" CRLF
+    "P-Charging-Vector: icid-value=AyretyU0dm+6O2IrT5tAFrbHLso=" + v + ";orig-ioi=home1.net" CRLF
+    "P-Visited-Network-ID: \"Visited network number 1\"" CRLF
+    "P-Early-Media: supported" CRLF
+    "X-Account-Id: " + v + CRLF
+    "X-Customer-Tag: gold" CRLF
+    "Call-Info: <http://www.example.com/alice/photo.jpg>;purpose=icon" CRLF
+    "Alert-Info: <http://www.example.com/sounds/moo.wav>" CRLF
+    "Subject: Project X" CRLF
+    "Priority: normal" CRLF
+    "History-Info: <sip:bob@example.com>;index=1" CRLF
+    "History-Info: <sip:bob@192.0.2.4>;index=1.1" CRLF
+    "Reason: Q.850;cause=16" CRLF
+    "Recv-Info: " CRLF
+    "P-App-Param: u=user" + v + ";d=example.com" CRLF;
+}
+
+/* header names looked up per message, some of them not present */
+static const char* lookups[] = {
+  SIP_HDR_P_DSM_APP, "P-App-Param", SIP_HDR_P_FORCE_491, SIP_HDR_REQUIRE,
+  SIP_HDR_SESSION_EXPIRES, SIP_HDR_MIN_SE, SIP_HDR_SUPPORTED,
+  SIP_HDR_SUPPORTED_COMPACT, SIP_HDR_P_ASSERTED_IDENTITY, "User-Agent",
+  SIP_HDR_REPLACES, "History-Info", "X-Account-Id", "P-MsgFlags"
+};
+static const size_t n_lookups = sizeof(lookups) / sizeof(lookups[0]);
+
+static unsigned long long now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (unsigned long long)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static volatile size_t sink;
+
+static void report(const char* what, unsigned int n, unsigned long long us)
+{
+  printf("%-12s %8.1f ns/msg  %6.1f ns/op  %10.0f msg/s\n", what,
+	 us * 1000.0 / n, us * 1000.0 / n / (n_lookups + 3),
+	 us ? n * 1000000.0 / us : 0.0);
+}
+
+static bool check(unsigned int variants)
+{
+  bool ok = true;
+  for (unsigned int v = 0; v < variants; v++) {
+    string hdrs = make_invite_hdrs(v);
+    AmSipRequest req;
+    req.hdrs = hdrs;
+    req.indexHeaders();
+
+    for (size_t i = 0; i < n_lookups; i++) {
+      for (int single = 0; single < 2; single++) {
+	string l = legacy_getHeader(hdrs, lookups[i], single);
+	if (getHeader(hdrs, lookups[i], single) != l ||
+	    req.getHeader(lookups[i], single) != l) {
+	  fprintf(stderr, "getHeader('%s', %d) mismatch\n", lookups[i], single);
+	  ok = false;
+	}
+      }
+    }
+
+    string lh = hdrs, fh = hdrs;
+    const char* rm[] = { "History-Info", SIP_HDR_SESSION_EXPIRES, "x-account-id",
+			 "Not-There" };
+    for (size_t i = 0; i < sizeof(rm) / sizeof(rm[0]); i++) {
+      bool lr = legacy_removeHeader(lh, rm[i]);
+      if (removeHeader(fh, rm[i]) != lr || req.removeHeader(rm[i]) != lr) {
+	fprintf(stderr, "removeHeader('%s') mismatch\n", rm[i]);
+	ok = false;
+      }
+    }
+    req.addHeader(SIP_HDR_MIN_SE, "120");
+    lh += SIP_HDR_MIN_SE COLSP "120" CRLF;
+    if (fh + SIP_HDR_MIN_SE COLSP "120" CRLF != lh || req.hdrs != lh ||
+	req.getHeader(SIP_HDR_MIN_SE) != "90, 120") {
+      fprintf(stderr, "hdrs mismatch after remove/add\n");
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned int n = argc > 1 ? atoi(argv[1]) : 200000;
+  const unsigned int variants = 64;
+
+  if (!check(variants)) {
+    printf("self-check FAILED\n");
+    return 1;
+  }
+  printf("self-check passed\n");
+
+  vector<string> msgs;
+  for (unsigned int v = 0; v < variants; v++)
+    msgs.push_back(make_invite_hdrs(v));
+  printf("%u messages, %zu bytes of hdrs, %zu lookups + 2 removes + 1 add each\n",
+	 n, msgs[0].length(), n_lookups);
+
+  size_t acc = 0;
+  unsigned long long start = now_us();
+  for (unsigned int i = 0; i < n; i++) {
+    string hdrs = msgs[i % variants];
+    for (size_t l = 0; l < n_lookups; l++)
+      acc += legacy_getHeader(hdrs, lookups[l], true).length();
+    legacy_removeHeader(hdrs, SIP_HDR_SESSION_EXPIRES);
+    legacy_removeHeader(hdrs, SIP_HDR_MIN_SE);
+    hdrs += SIP_HDR_MIN_SE COLSP "120" CRLF;
+    acc += hdrs.length();
+  }
+  report("former", n, now_us() - start);
+
+  start = now_us();
+  for (unsigned int i = 0; i < n; i++) {
+    string hdrs = msgs[i % variants];
+    for (size_t l = 0; l < n_lookups; l++)
+      acc += getHeader(hdrs, lookups[l], true).length();
+    removeHeader(hdrs, SIP_HDR_SESSION_EXPIRES);
+    removeHeader(hdrs, SIP_HDR_MIN_SE);
+    hdrs += SIP_HDR_MIN_SE COLSP "120" CRLF;
+    acc += hdrs.length();
+  }
+  report("free", n, now_us() - start);
+
+  AmSipRequest req;
+  start = now_us();
+  for (unsigned int i = 0; i < n; i++) {
+    req.hdrs = msgs[i % variants];
+    req.indexHeaders();
+    for (size_t l = 0; l < n_lookups; l++)
+      acc += req.getHeader(lookups[l], true).length();
+    req.removeHeader(SIP_HDR_SESSION_EXPIRES);
+    req.removeHeader(SIP_HDR_MIN_SE);
+    req.addHeader(SIP_HDR_MIN_SE, "120");
+    acc += req.hdrs.length();
+  }
+  report("indexed", n, now_us() - start);
+
+  sink = acc;
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,123 @@
+/*
+ * JSON serializer/parser benchmark: a monitoring-like dump ('calls'
+ * calls, each a struct of string, int and double attributes plus a
+ * small array, as the monitoring module returns them over JSON-RPC)
+ * is serialized with arg2json, once returning a new string every time
+ * and once appending to a reused buffer, and parsed back with
+ * json2arg from a string and from a sized buffer.
+ *
+ * The parsed dump is compared with the serialized one.
+ *
+ * usage: bench_jsonarg [calls] [rounds]
+ *        (default: 10000 20)
+ */
+
+#include "AmArg.h"
+#include "AmUtils.h"
+#include "jsonArg.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+
+using std::string;
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static void make_dump(AmArg& dump, unsigned int calls)
+{
+  srandom(1);
+  for (unsigned int i = 0; i < calls; i++) {
+    string ltag = int2hex(random()) + "-" + int2hex(random());
+    AmArg& c = dump[ltag];
+    c["app"] = "sbc";
+    c["from"] = "\"Caller " + int2str(i) + "\" <sip:+4930" + int2str(random() % 10000000) +
+      "@example.com>;tag=" + int2hex(random());
+    c["to"] = "<sip:+4989" + int2str(random() % 10000000) + "@example.net>";
+    c["ruri"] = "sip:+4989" + int2str(random() % 10000000) + "@10.0.0.1:5060;transport=udp";
+    c["callid"] = int2hex(random()) + int2hex(random()) + "@10.0.0.2";
+    c["dir"] = "out";
+    c["state"] = (i % 3) ? "connected" : "ringing";
+    c["start_ts"] = (long long int)(1700000000LL + random() % 100000);
+    c["duration"] = (int)(random() % 3600);
+    c["mos"] = 3.0 + (random() % 150) / 100.0;
+    c["packets"] = (long long int)(random() % 1000000);
+    AmArg& codecs = c["codecs"];
+    codecs.push("PCMA");
+    codecs.push("telephone-event");
+  }
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int calls = argc > 1 ? atoi(argv[1]) : 10000;
+  unsigned int rounds = argc > 2 ? atoi(argv[2]) : 20;
+  if (!calls)
+    calls = 1;
+  if (!rounds)
+    rounds = 1;
+
+  log_level = L_ERR;
+
+  AmArg dump;
+  make_dump(dump, calls);
+
+  string json = arg2json(dump);
+  double mb = json.length() * (double)rounds / (1024.0 * 1024.0);
+  printf("%u calls, %zu bytes of JSON, %u rounds\n", calls, json.length(), rounds);
+
+  size_t len = 0;
+  double start = now_ms();
+  for (unsigned int r = 0; r < rounds; r++)
+    len += arg2json(dump).length();
+  double ret_ms = now_ms() - start;
+
+  string buf;
+  start = now_ms();
+  for (unsigned int r = 0; r < rounds; r++) {
+    buf.clear();
+    arg2json(dump, buf);
+    len += buf.length();
+  }
+  double reuse_ms = now_ms() - start;
+
+  printf("serialize  new string    %8.1f ms %8.1f MB/s\n", ret_ms, mb * 1000.0 / ret_ms);
+  printf("serialize  reused buffer %8.1f ms %8.1f MB/s\n", reuse_ms, mb * 1000.0 / reuse_ms);
+
+  bool ok = true;
+  start = now_ms();
+  for (unsigned int r = 0; r < rounds; r++) {
+    AmArg parsed;
+    ok &= json2arg(json, parsed);
+  }
+  double str_ms = now_ms() - start;
+
+  AmArg parsed;
+  start = now_ms();
+  for (unsigned int r = 0; r < rounds; r++) {
+    parsed.clear();
+    ok &= json2arg(json.data(), json.length(), parsed);
+  }
+  double sized_ms = now_ms() - start;
+
+  printf("parse      string        %8.1f ms %8.1f MB/s\n", str_ms, mb * 1000.0 / str_ms);
+  printf("parse      sized buffer  %8.1f ms %8.1f MB/s\n", sized_ms, mb * 1000.0 / sized_ms);
+
+  if (!ok || arg2json(parsed) != json) {
+    printf("PARSED DUMP MISMATCH\n");
+    return 1;
+  }
+  return len ? 0 : 1;
+}
+
+// Local Variables:
+// mode:C++
+// End:
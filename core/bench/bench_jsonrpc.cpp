@@ -0,0 +1,298 @@
+/*
+ * JSON-RPC server load generator: the jsonrpc module's server loop
+ * and threads are started in the process, and 'connections' clients
+ * send requests to a DI method that sleeps 'usec' per request (as a
+ * database-backed provisioning call would), in four ways:
+ *
+ *   sequential  one request after the other on each connection
+ *   pipelined   up to 'depth' requests in flight on each connection
+ *   batched     batches of 'depth' requests, one after the other
+ *   both        up to 4 batches of 'depth' requests in flight
+ *
+ * Every reply is matched to its request by id.
+ *
+ * usage: bench_jsonrpc [connections] [requests per connection] [usec]
+ *                      [server threads] [depth] [port]
+ *        (default: 4 2000 200 8 16 17080)
+ */
+
+#include "AmApi.h"
+#include "AmArg.h"
+#include "AmPlugIn.h"
+#include "AmUtils.h"
+#include "jsonArg.h"
+#include "log.h"
+
+#include "../../apps/jsonrpc/JsonRPC.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+static double now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/* the DI method called: bench.sleep(usec) */
+class BenchDI
+  : public AmDynInvokeFactory, public AmDynInvoke
+{
+ public:
+  std::atomic<unsigned long> calls;
+
+  BenchDI() : AmDynInvokeFactory("bench"), calls(0) { }
+  int onLoad() { return 0; }
+  AmDynInvoke* getInstance() { return this; }
+
+  void invoke(const string& method, const AmArg& args, AmArg& ret) {
+    if (method != "sleep")
+      throw AmDynInvoke::NotImplemented(method);
+    calls++;
+    usleep(args.get(0).asInt());
+    ret.push(200);
+  }
+};
+
+struct Client {
+  int fd;
+  string rcvbuf;
+
+  Client() : fd(-1) { }
+  ~Client() { if (fd >= 0) close(fd); }
+
+  bool connect(int port) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0)
+      return false;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+  }
+
+  bool send(const string& msg) {
+    string ns = int2str((unsigned int)msg.length()) + ":" + msg + ",";
+    size_t pos = 0;
+    while (pos < ns.length()) {
+      ssize_t w = ::send(fd, ns.data() + pos, ns.length() - pos, MSG_NOSIGNAL);
+      if (w <= 0)
+	return false;
+      pos += w;
+    }
+    return true;
+  }
+
+  bool recv(string& msg) {
+    while (true) {
+      size_t colon = rcvbuf.find(':');
+      if (colon != string::npos) {
+	size_t len = atol(rcvbuf.c_str());
+	if (rcvbuf.length() >= colon + len + 2) {
+	  msg = rcvbuf.substr(colon + 1, len);
+	  rcvbuf.erase(0, colon + len + 2);
+	  return true;
+	}
+      }
+      char buf[65536];
+      ssize_t r = read(fd, buf, sizeof(buf));
+      if (r <= 0)
+	return false;
+      rcvbuf.append(buf, r);
+    }
+  }
+};
+
+static string request(unsigned int id, int usec)
+{
+  return "{\"jsonrpc\": \"2.0\", \"method\": \"bench.sleep\", \"params\": [" +
+    int2str(usec) + "], \"id\": " + int2str(id) + "}";
+}
+
+struct Result {
+  unsigned long requests;
+  unsigned long errors;
+  vector<double> latency_us;
+};
+
+/* one connection: 'requests' in messages of 'batch', 'depth' messages in flight */
+static void run_client(int port, unsigned int requests, unsigned int batch,
+		       unsigned int depth, int usec, Result& res)
+{
+  res.requests = res.errors = 0;
+
+  Client c;
+  if (!c.connect(port)) {
+    res.errors = requests;
+    return;
+  }
+
+  std::map<unsigned int, double> in_flight; // id of first request -> sent
+  unsigned int next_id = 1;
+  unsigned int sent = 0;
+
+  while (sent < requests || !in_flight.empty()) {
+    while (sent < requests && in_flight.size() < depth) {
+      unsigned int n = std::min(batch, requests - sent);
+      string msg;
+      if (batch == 1) {
+	msg = request(next_id, usec);
+      } else {
+	msg = "[";
+	for (unsigned int i = 0; i < n; i++)
+	  msg += (i ? ", " : "") + request(next_id + i, usec);
+	msg += "]";
+      }
+      in_flight[next_id] = now_us();
+      next_id += n;
+      sent += n;
+      if (!c.send(msg)) {
+	res.errors += requests - res.requests;
+	return;
+      }
+    }
+
+    string reply;
+    if (!c.recv(reply)) {
+      res.errors += requests - res.requests;
+      return;
+    }
+
+    AmArg r;
+    if (!json2arg(reply, r)) {
+      res.errors++;
+      continue;
+    }
+
+    // the batch reply is matched by its first id
+    unsigned int n = isArgArray(r) ? r.size() : 1;
+    AmArg& first = isArgArray(r) ? r.get(0) : r;
+    if (!first.hasMember("id") || !isArgInt(first["id"]) ||
+	in_flight.find(first["id"].asInt()) == in_flight.end()) {
+      res.errors++;
+      continue;
+    }
+
+    std::map<unsigned int, double>::iterator it = in_flight.find(first["id"].asInt());
+    res.latency_us.push_back(now_us() - it->second);
+    in_flight.erase(it);
+
+    for (unsigned int i = 0; i < n; i++) {
+      AmArg& e = isArgArray(r) ? r.get(i) : r;
+      if (e.hasMember("result"))
+	res.requests++;
+      else
+	res.errors++;
+    }
+  }
+}
+
+static void run(const char* name, int port, unsigned int connections,
+		unsigned int requests, unsigned int batch, unsigned int depth, int usec)
+{
+  vector<Result> results(connections);
+  vector<std::thread> th;
+
+  double start = now_us();
+  for (unsigned int i = 0; i < connections; i++)
+    th.emplace_back(run_client, port, requests, batch, depth, usec, std::ref(results[i]));
+  for (std::thread& t : th)
+    t.join();
+  double us = now_us() - start;
+
+  unsigned long total = 0, errors = 0;
+  vector<double> latency;
+  for (Result& r : results) {
+    total += r.requests;
+    errors += r.errors;
+    latency.insert(latency.end(), r.latency_us.begin(), r.latency_us.end());
+  }
+  std::sort(latency.begin(), latency.end());
+  double avg = 0.0;
+  for (double l : latency)
+    avg += l;
+  if (!latency.empty())
+    avg /= latency.size();
+
+  printf("%-11s batch %3u depth %3u  %9.0f req/s  message latency avg %8.0f us"
+	 "  p99 %8.0f us%s\n", name, batch, depth, total * 1e6 / us, avg,
+	 latency.empty() ? 0.0 : latency[latency.size() * 99 / 100],
+	 errors ? "  ERRORS" : "");
+  if (errors)
+    printf("            %lu requests failed\n", errors);
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int connections = argc > 1 ? atoi(argv[1]) : 4;
+  unsigned int requests = argc > 2 ? atoi(argv[2]) : 2000;
+  int usec = argc > 3 ? atoi(argv[3]) : 200;
+  int threads = argc > 4 ? atoi(argv[4]) : 8;
+  unsigned int depth = argc > 5 ? atoi(argv[5]) : 16;
+  int port = argc > 6 ? atoi(argv[6]) : 17080;
+  if (!connections)
+    connections = 1;
+  if (!requests)
+    requests = 1;
+  if (!depth)
+    depth = 1;
+
+  log_level = L_ERR;
+
+  BenchDI* di = new BenchDI();
+  AmPlugIn::registerDIInterface("bench", di);
+
+  // as JsonRPCServerModule::load() does, without jsonrpc.conf
+  JsonRPCServerModule::port = port;
+  JsonRPCServerModule::threads = threads;
+  JsonRPCServerModule::pipeline_depth = depth;
+  (new JsonRPCServerLoop())->start();
+
+  // wait for the server to listen
+  for (int i = 0; i < 100; i++) {
+    Client c;
+    if (c.connect(port))
+      break;
+    usleep(10000);
+  }
+
+  printf("%u connections, %u requests each, %d us per request, %d server threads\n",
+	 connections, requests, usec, threads);
+
+  run("sequential", port, connections, requests, 1, 1, usec);
+  run("pipelined", port, connections, requests, 1, depth, usec);
+  run("batched", port, connections, requests, depth, 1, usec);
+  run("both", port, connections, requests, depth, 4, usec);
+
+  printf("%lu DI calls\n", di->calls.load());
+
+  // the server loop is not stopped
+  fflush(stdout);
+  _exit(0);
+}
+
+// Local Variables:
+// mode:C++
+// End:
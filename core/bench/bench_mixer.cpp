@@ -0,0 +1,168 @@
+/*
+ * Conference mixer micro-benchmark: compares the scalar, SSE2 and
+ * AVX2 mixing kernels for rooms of 3..100 participants and measures
+ * the complete AmMultiPartyMixer put/get cycle with the kernels
+ * selected at runtime. Also checks that all kernels produce the same
+ * output as the scalar ones.
+ *
+ * usage: bench_mixer [ticks]   (default: 2000 ticks of 20ms, 16kHz)
+ */
+
+#include "AmMultiPartyMixer.h"
+#include "AmMixerKernels.h"
+#include "AmAudio.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <random>
+#include <vector>
+
+#define SAMPLE_RATE 16000
+#define TICK_SAMPLES (SAMPLE_RATE / 50)
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static int check_kernels(const AmMixerKernels& k)
+{
+  const AmMixerKernels& ref = AmMixerKernels::scalar();
+  std::mt19937 rnd(3);
+
+  for (unsigned int size : { 1u, 7u, 160u, 321u, 961u }) {
+    std::vector<int> src1(size), d1(size), d2(size);
+    std::vector<short> src2(size), o1(size), o2(size);
+
+    for (unsigned int i = 0; i < size; i++) {
+      src1[i] = (int)(rnd() % 400000) - 200000;
+      src2[i] = (short)rnd();
+    }
+
+    ref.mix_add(d1.data(), src1.data(), src2.data(), size);
+    k.mix_add(d2.data(), src1.data(), src2.data(), size);
+    if (d1 != d2) return 1;
+
+    ref.mix_sub(d1.data(), src1.data(), src2.data(), size);
+    k.mix_sub(d2.data(), src1.data(), src2.data(), size);
+    if (d1 != d2) return 1;
+
+    // quiet and loud (clipping) input
+    for (int loud = 0; loud < 2; loud++) {
+      for (unsigned int i = 0; i < size; i++)
+	d1[i] = loud ? src1[i] : src1[i] / 64;
+      int f1 = 64, f2 = 64;
+      ref.scale(o1.data(), d1.data(), size, f1);
+      k.scale(o2.data(), d1.data(), size, f2);
+      if (o1 != o2 || f1 != f2) return 1;
+    }
+  }
+
+  return 0;
+}
+
+// one tick of a room: every participant's frame is added to the
+// mixed signal, then every participant gets mixed minus own, scaled
+static double run_room(const AmMixerKernels& k, unsigned int participants,
+		       unsigned int ticks)
+{
+  std::vector<std::vector<short> > in(participants, std::vector<short>(TICK_SAMPLES));
+  std::vector<short> out(TICK_SAMPLES);
+  std::vector<int> mixed(TICK_SAMPLES), tmp(TICK_SAMPLES);
+  std::mt19937 rnd(5);
+
+  for (auto& frame : in)
+    for (auto& s : frame)
+      s = (short)(rnd() % 8000) - 4000;
+
+  int factor = 16;
+  double t0 = now_ms();
+
+  for (unsigned int t = 0; t < ticks; t++) {
+    memset(mixed.data(), 0, TICK_SAMPLES * sizeof(int));
+    for (auto& frame : in)
+      k.mix_add(mixed.data(), mixed.data(), frame.data(), TICK_SAMPLES);
+
+    for (auto& frame : in) {
+      k.mix_sub(tmp.data(), mixed.data(), frame.data(), TICK_SAMPLES);
+      if (factor < 64) factor++;
+      k.scale(out.data(), tmp.data(), TICK_SAMPLES, factor);
+    }
+  }
+
+  return now_ms() - t0;
+}
+
+static double run_mixer(unsigned int participants, unsigned int ticks)
+{
+  AmMultiPartyMixer mixer;
+  std::vector<unsigned int> channels;
+  for (unsigned int i = 0; i < participants; i++)
+    channels.push_back(mixer.addChannel(SAMPLE_RATE));
+
+  std::vector<short> frame(TICK_SAMPLES);
+  for (unsigned int i = 0; i < TICK_SAMPLES; i++)
+    frame[i] = (short)((i * 37) % 8000) - 4000;
+
+  unsigned char out[AUDIO_BUFFER_SIZE];
+  unsigned long long ts = 0;
+  const unsigned long long tick_ts = WALLCLOCK_RATE / 50;
+
+  double t0 = now_ms();
+  for (unsigned int t = 0; t < ticks; t++, ts += tick_ts) {
+    for (unsigned int c : channels)
+      mixer.PutChannelPacket(c, ts, (unsigned char*)frame.data(),
+			     TICK_SAMPLES * sizeof(short));
+    for (unsigned int c : channels) {
+      unsigned int size = TICK_SAMPLES * sizeof(short);
+      unsigned int rate = 0;
+      mixer.GetChannelPacket(c, ts, out, size, rate);
+    }
+  }
+  return now_ms() - t0;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned int ticks = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;
+
+  std::vector<const AmMixerKernels*> kernels = { &AmMixerKernels::scalar() };
+  if (AmMixerKernels::sse2()) kernels.push_back(AmMixerKernels::sse2());
+  if (AmMixerKernels::avx2()) kernels.push_back(AmMixerKernels::avx2());
+
+  for (auto* k : kernels) {
+    if (check_kernels(*k)) {
+      fprintf(stderr, "error: %s kernels differ from scalar\n", k->name);
+      return 1;
+    }
+  }
+
+  printf("%u ticks at %d Hz, ns per participant and tick; "
+	 "runtime selection: %s\n", ticks, SAMPLE_RATE,
+	 AmMixerKernels::get().name);
+
+  printf("participants");
+  for (auto* k : kernels)
+    printf(" %9s", k->name);
+  printf(" %9s\n", "mixer");
+
+  for (unsigned int p : { 3u, 5u, 10u, 20u, 50u, 100u }) {
+    printf("%12u", p);
+    for (auto* k : kernels) {
+      double ms = run_room(*k, p, ticks);
+      printf(" %9.1f", ms * 1e6 / ((double)ticks * p));
+    }
+    double ms = run_mixer(p, ticks);
+    printf(" %9.1f\n", ms * 1e6 / ((double)ticks * p));
+  }
+
+  return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Prompt playback benchmark: 'calls' calls play the same cached
+ * prompt (a generated 8 kHz wav file, as loaded by AmPromptCollection)
+ * frame by frame, like AmSession::writeStreams does for every media
+ * processor tick, once encoding it for every call (AmCachedAudioFile
+ * samples, encoded with the call's own codec instance as in
+ * AmRtpAudio::put) and once sending the frames of the
+ * AmEncodedPromptCache.
+ *
+ * Every codec of the audio plug-ins found in the plug-in directory is
+ * timed, the payloads of both ways are compared for the stateless
+ * codecs.
+ *
+ * usage: bench_prompts [calls] [seconds of prompt] [plug-in dir]
+ *        (default: 200 10 ../lib)
+ */
+
+#include "AmCachedAudioFile.h"
+#include "AmConfig.h"
+#include "AmEncodedPromptCache.h"
+#include "AmPlugIn.h"
+#include "AmRtpAudio.h"
+#include "amci/codecs.h"
+#include "log.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+static const char* plugins[] = {
+  "wav", "adpcm", "gsm", "ilbc", "speex", "opus", "g729", "g722"
+};
+
+static struct {
+  const char* name;
+  int codec_id;
+  unsigned int rate;
+  unsigned int ts_rate;
+  bool stateless;
+} codecs[] = {
+  { "PCMU",    CODEC_ULAW,     8000,  8000,  true },
+  { "G726-32", CODEC_G726_32,  8000,  8000,  false },
+  { "GSM",     CODEC_GSM0610,  8000,  8000,  false },
+  { "iLBC",    CODEC_ILBC,     8000,  8000,  false },
+  { "speex",   CODEC_SPEEX_NB, 8000,  8000,  false },
+  { "G729",    CODEC_G729,     8000,  8000,  false },
+  { "G722",    CODEC_G722_NB,  16000, 8000,  false },
+  { "opus",    CODEC_OPUS,     48000, 48000, false },
+};
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static void le16(FILE* f, uint16_t v) { fputc(v & 0xff, f); fputc(v >> 8, f); }
+static void le32(FILE* f, uint32_t v) { le16(f, v & 0xffff); le16(f, v >> 16); }
+
+/* 8 kHz PCM16 wav of a voiced-speech-like signal */
+static int write_prompt(const char* name, unsigned int seconds)
+{
+  FILE* f = fopen(name, "w");
+  if (!f)
+    return -1;
+
+  unsigned int n = 8000 * seconds;
+  fwrite("RIFF", 1, 4, f); le32(f, 36 + 2 * n);
+  fwrite("WAVEfmt ", 1, 8, f); le32(f, 16);
+  le16(f, 1); le16(f, 1); le32(f, 8000); le32(f, 16000); le16(f, 2); le16(f, 16);
+  fwrite("data", 1, 4, f); le32(f, 2 * n);
+
+  double phase = 0.0;
+  for (unsigned int i = 0; i < n; i++) {
+    double t = i / 8000.0;
+    phase += 2 * M_PI * (140.0 + 40.0 * sin(2 * M_PI * 0.7 * t)) / 8000.0;
+    double v = 0.0;
+    for (int h = 1; h <= 8; h++)
+      v += sin(h * phase) / h;
+    le16(f, (uint16_t)(int16_t)(9000.0 * (0.5 + 0.5 * sin(2 * M_PI * 3.0 * t)) * v));
+  }
+
+  fclose(f);
+  return 0;
+}
+
+static AmAudioRtpFormat* rtp_format(int c)
+{
+  Payload pl;
+  pl.pt = 96;
+  pl.name = codecs[c].name;
+  pl.clock_rate = codecs[c].rate;
+  pl.advertised_clock_rate = codecs[c].ts_rate;
+  pl.codec_id = codecs[c].codec_id;
+
+  AmAudioRtpFormat* fmt = new AmAudioRtpFormat();
+  fmt->setCurrentPayload(pl);
+  if (!fmt->getCodec() || fmt->getHCodec() == -1) {
+    delete fmt;
+    return NULL;
+  }
+  return fmt;
+}
+
+struct Call {
+  unique_ptr<AmCachedAudioFile> prompt;
+  unique_ptr<AmAudioRtpFormat> fmt;
+  bool done;
+};
+
+/* @return ms for playing the prompt to all calls, payload bytes in sent */
+static double play(AmFileCache& file, int c, unsigned int calls, bool cached,
+		   unsigned long long& sent, vector<vector<unsigned char> >* first)
+{
+  vector<Call> call(calls);
+  for (Call& cl : call) {
+    cl.prompt.reset(new AmCachedAudioFile(&file));
+    cl.fmt.reset(rtp_format(c));
+    cl.done = false;
+  }
+
+  unsigned char buffer[AUDIO_BUFFER_SIZE];
+  unsigned char payload[AUDIO_BUFFER_SIZE];
+  unsigned int frame_size = call[0].fmt->getFrameSize();
+  unsigned int rate = call[0].fmt->getRate();
+  unsigned int left = calls;
+  sent = 0;
+
+  double start = now_ms();
+  for (unsigned long long ts = 0; left; ts += frame_size) {
+    for (unsigned int i = 0; i < calls; i++) {
+      Call& cl = call[i];
+      if (cl.done)
+	continue;
+
+      int s;
+      if (cached) {
+	s = cl.prompt->getEncoded(ts, cl.fmt.get(), payload);
+      }
+      else {
+	s = cl.prompt->get(ts, buffer, rate, frame_size);
+	if (s > 0) {
+	  amci_codec_t* codec = cl.fmt->getCodec();
+	  if (codec->encode)
+	    s = (*codec->encode)(payload, buffer, s, 1, rate, cl.fmt->getHCodec());
+	  else
+	    memcpy(payload, buffer, s);
+	}
+      }
+
+      if (s <= 0) {
+	cl.done = true;
+	left--;
+	continue;
+      }
+      sent += s;
+      if (first && !i)
+	first->push_back(vector<unsigned char>(payload, payload + s));
+    }
+  }
+  return now_ms() - start;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int calls = argc > 1 ? atoi(argv[1]) : 200;
+  unsigned int seconds = argc > 2 ? atoi(argv[2]) : 10;
+  string dir = argc > 3 ? argv[3] : "../lib";
+  if (!calls)
+    calls = 1;
+  if (!seconds)
+    seconds = 1;
+
+  log_level = L_ERR;
+
+  // the built-in codecs (PCM16) first, the wav plug-in needs them
+  AmPlugIn::instance()->init();
+  for (const char* p : plugins) {
+    if (access((dir + "/" + p + ".so").c_str(), R_OK) ||
+	AmPlugIn::instance()->load(dir, p))
+      printf("%-8s not built\n", p);
+  }
+
+  char name[] = "/tmp/bench_prompts_XXXXXX.wav";
+  int fd = mkstemps(name, 4);
+  if (fd < 0 || (close(fd), write_prompt(name, seconds))) {
+    perror("writing prompt");
+    return 1;
+  }
+
+  AmFileCache file;
+  if (file.load(name)) {
+    unlink(name);
+    return 1;
+  }
+
+  AmConfig::EncodedPromptCacheSize = 64 * 1024;
+
+  printf("%u calls playing a %u s prompt\n", calls, seconds);
+  for (unsigned int c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+    unique_ptr<AmAudioRtpFormat> fmt(rtp_format(c));
+    if (!fmt.get()) {
+      printf("%-8s not available\n", codecs[c].name);
+      continue;
+    }
+
+    unsigned long long enc_bytes, cache_bytes;
+    vector<vector<unsigned char> > enc_frames, cache_frames;
+    double enc_ms = play(file, c, calls, false, enc_bytes, &enc_frames);
+    double cache_ms = play(file, c, calls, true, cache_bytes, &cache_frames);
+    unsigned long long frames = (unsigned long long)calls * enc_frames.size();
+
+    const char* check = "";
+    if (enc_frames.size() != cache_frames.size())
+      check = "  FRAME COUNT MISMATCH";
+    else if (codecs[c].stateless && enc_frames != cache_frames)
+      check = "  PAYLOAD MISMATCH";
+
+    printf("%-8s %4u smp/frame  encoding per call %8.0f ns/frame %7.2f%% CPU"
+	   "  cached %6.0f ns/frame %7.2f%% CPU%s\n", codecs[c].name,
+	   fmt->getFrameSize(), enc_ms * 1e6 / frames,
+	   enc_ms / (seconds * 10.0), cache_ms * 1e6 / frames,
+	   cache_ms / (seconds * 10.0), check);
+  }
+
+  AmArg stats;
+  AmEncodedPromptCache::instance()->getStats(stats);
+  printf("prompt cache: %s\n", AmArg::print(stats).c_str());
+
+  unlink(name);
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
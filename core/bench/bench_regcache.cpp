@@ -0,0 +1,200 @@
+/*
+ * SBC register cache snapshot benchmark: fills the cache with
+ * 'bindings' REGISTER bindings (2 per AoR), saves them into a snapshot
+ * while another thread keeps looking up bindings (as the REGISTER
+ * processing does), clears the cache and measures how long restoring
+ * it from the snapshot takes (warm restart).
+ *
+ * usage: bench_regcache [bindings] [snapshot file]
+ *        (default: 100000 /tmp/bench_regcache.snapshot)
+ */
+
+#include "AmAppTimer.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include "../../apps/sbc/RegisterCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using std::string;
+
+static unsigned long long now_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (unsigned long long)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static string aor_of(unsigned int i)
+{
+  return "sip:+4930" + int2str(i / 2) + "@example.com";
+}
+
+static AliasEntry make_binding(unsigned int i, long int now)
+{
+  AliasEntry ae;
+  ae.aor = aor_of(i);
+  ae.contact_uri = "sip:+4930" + int2str(i / 2) + "@10." +
+    int2str((i >> 16) & 0xff) + "." + int2str((i >> 8) & 0xff) + "." +
+    int2str(i & 0xff) + ":5060;transport=udp";
+  ae.source_ip = "192.0." + int2str((i >> 8) & 0xff) + "." + int2str(i & 0xff);
+  ae.source_port = 1024 + (i % 60000);
+  ae.trsp = "udp";
+  ae.local_if = 0;
+  ae.remote_ua = "Acme Phone 5.2." + int2str(i % 100);
+  ae.ua_expire = now + 60 + (i % 300);
+  return ae;
+}
+
+#define GBC_CYCLE 10  /* REG_CACHE_CYCLE */
+#define GBC_CHUNK 256 /* REG_CACHE_GBC_CHUNK */
+
+static void bench_expiry(unsigned int n)
+{
+  AorHash ht;
+  long int now = time(NULL);
+
+  unsigned long long start = now_us();
+  for (unsigned int i = 0; i < n; i++) {
+    auto aor_it = ht.insert(make_pair(aor_of(i), AorEntry())).first;
+    auto b_it = aor_it->second.insert(make_pair("sip:" + int2str(i) + "@10.0.0.1/192.0.2.1",
+						RegBinding())).first;
+    b_it->second.alias = "a" + int2hex(i);
+    ht.set_expire(aor_it, b_it, now + 1 + (i * 7919ULL) % 3600);
+  }
+  unsigned long long insert_us = now_us() - start;
+
+  // re-registrations
+  start = now_us();
+  for (unsigned int i = 0; i < n; i += 2) {
+    auto aor_it = ht.find(aor_of(i));
+    ht.set_expire(aor_it, aor_it->second.begin(),
+		  aor_it->second.begin()->second.get_expire() + 1800);
+  }
+  unsigned long long refresh_us = now_us() - start;
+
+  unsigned long long total_us = 0, max_us = 0, max_lock_us = 0;
+  unsigned int runs = 0, max_expired = 0;
+  size_t expired = 0;
+  for (long int t = now; t <= now + 3600 + 1800 + GBC_CYCLE; t += GBC_CYCLE) {
+    unsigned long long run_start = now_us();
+    unsigned int run_expired = 0;
+    bool done = false;
+    while (!done) {
+      list<string> alias_list;
+      unsigned long long lock_start = now_us();
+      done = ht.gbc(t, alias_list, GBC_CHUNK);
+      unsigned long long lock_us = now_us() - lock_start;
+      if (lock_us > max_lock_us) max_lock_us = lock_us;
+      run_expired += alias_list.size();
+    }
+    unsigned long long run_us = now_us() - run_start;
+    total_us += run_us;
+    if (run_us > max_us) max_us = run_us;
+    if (run_expired > max_expired) max_expired = run_expired;
+    expired += run_expired;
+    runs++;
+  }
+
+  printf("expiry: %u bindings inserted in %.1f ms, %u refreshed in %.1f ms\n",
+	 n, insert_us / 1000.0, (n + 1) / 2, refresh_us / 1000.0);
+  printf("        %u runs: %zu expired (max. %u per run), "
+	 "%.1f us/run avg., %.1f ms max., longest lock %.1f ms%s\n",
+	 runs, expired, max_expired, (double)total_us / runs, max_us / 1000.0,
+	 max_lock_us / 1000.0, ht.empty() ? "" : " - NOT EMPTY");
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned int n = argc > 1 ? atoi(argv[1]) : 100000;
+  string file = argc > 2 ? argv[2] : "/tmp/bench_regcache.snapshot";
+
+  RegisterCache* rc = RegisterCache::instance();
+  long int now = AmAppTimer::instance()->unix_clock.get();
+
+  unsigned long long start = now_us();
+  for (unsigned int i = 0; i < n; i++) {
+    AliasEntry ae = make_binding(i, now);
+    rc->update("a" + int2hex(i), now + 3600, ae);
+  }
+  printf("%u bindings: filled in %.1f ms\n", rc->getActiveRegs(),
+	 (now_us() - start) / 1000.0);
+
+  // lookups running concurrently to the snapshot
+  std::atomic<bool> done(false);
+  unsigned long long max_lookup_us = 0, lookups = 0;
+  std::thread reader([&]() {
+      unsigned int i = 0;
+      while (!done) {
+	AliasEntry ae = make_binding(i, now);
+	RegBinding b;
+	unsigned long long t = now_us();
+	rc->getAlias(ae.aor, ae.contact_uri, ae.source_ip, b);
+	t = now_us() - t;
+	if (t > max_lookup_us) max_lookup_us = t;
+	lookups++;
+	i = (i + 7919) % n;
+      }
+    });
+
+  start = now_us();
+  long saved = rc->saveSnapshot(file);
+  unsigned long long save_us = now_us() - start;
+  done = true;
+  reader.join();
+
+  struct stat st;
+  if (saved < 0 || stat(file.c_str(), &st) < 0) {
+    printf("snapshot FAILED\n");
+    return 1;
+  }
+  printf("save:  %ld bindings, %.1f MB in %.1f ms "
+	 "(concurrent lookups: %llu, max. latency %.1f ms)\n",
+	 saved, st.st_size / 1048576.0, save_us / 1000.0,
+	 lookups, max_lookup_us / 1000.0);
+
+  for (unsigned int i = 0; i < n; i += 2)
+    rc->remove(aor_of(i));
+  if (rc->getActiveRegs()) {
+    printf("could not clear the cache\n");
+    return 1;
+  }
+
+  start = now_us();
+  long loaded = rc->loadSnapshot(file);
+  unsigned long long load_us = now_us() - start;
+  printf("load:  %ld bindings in %.1f ms (%.0f bindings/s)\n",
+	 loaded, load_us / 1000.0, load_us ? loaded * 1000000.0 / load_us : 0.0);
+
+  // check a few restored bindings
+  for (unsigned int i = 0; i < n; i += 1 + n / 100) {
+    AliasEntry ae = make_binding(i, now), found;
+    if (!rc->findAEByContact(ae.contact_uri, ae.source_ip, ae.source_port, found) ||
+	found.alias != "a" + int2hex(i) || found.ua_expire != ae.ua_expire) {
+      printf("binding %u not restored\n", i);
+      return 1;
+    }
+  }
+
+  unlink(file.c_str());
+  if (loaded != (long)n)
+    return 1;
+
+  bench_expiry(n);
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
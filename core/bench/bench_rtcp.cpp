@@ -0,0 +1,191 @@
+/*
+ * RTCP report check: a plain AmSession answers a PCMU offer of a local
+ * UDP peer, completes the SDP (as the session does on ACK) and sends a
+ * frame every 20 ms, like the media processor. Nobody resumes the
+ * stream of a session, the reports must start with the stream; the
+ * peer counts the SR/RR it receives and the time between them.
+ *
+ * usage: bench_rtcp [report interval ms] [seconds] [plug-in dir]
+ *        (default: 500 5 ../lib)
+ *
+ * Exits with 1 if no SR has been received.
+ */
+
+#include "AmAppTimer.h"
+#include "AmConfig.h"
+#include "AmPlugIn.h"
+#include "AmRtpAudio.h"
+#include "AmRtpReceiver.h"
+#include "AmSdp.h"
+#include "AmSession.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <string>
+
+using std::string;
+
+#define CRLF "\r\n"
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* a session as created by a plain application (no B2B media) */
+class RtcpSession : public AmSession
+{
+public:
+  RtcpSession() { rtp_interface = 0; }
+};
+
+static int bind_udp(unsigned short port)
+{
+  int sd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sd < 0)
+    return -1;
+
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(sd, (struct sockaddr*)&sa, sizeof(sa))) {
+    close(sd);
+    return -1;
+  }
+
+  struct timeval tv = { 0, 1000 };
+  setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return sd;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int interval = argc > 1 ? atoi(argv[1]) : 500;
+  unsigned int seconds = argc > 2 ? atoi(argv[2]) : 5;
+  string dir = argc > 3 ? argv[3] : "../lib";
+  if (interval < 100)
+    interval = 100;
+  if (!seconds)
+    seconds = 1;
+
+  log_level = L_ERR;
+
+  AmPlugIn::instance()->init();
+  if (access((dir + "/wav.so").c_str(), R_OK) ||
+      AmPlugIn::instance()->load(dir, "wav")) {
+    printf("wav plug-in not built (PCMU)\n");
+    return 1;
+  }
+
+  AmConfig::RTP_interface intf;
+  intf.LocalIP = "127.0.0.1";
+  AmConfig::RTP_Ifs.push_back(std::move(intf));
+  AmConfig::RtcpReportInterval = interval;
+
+  AmAppTimer::instance()->start();
+  AmRtpReceiver::instance()->start();
+
+  // peer RTP/RTCP ports
+  int rtp_sd = -1, rtcp_sd = -1;
+  unsigned short port;
+  for (port = 50000; port < 50100; port += 2) {
+    if ((rtp_sd = bind_udp(port)) < 0)
+      continue;
+    if ((rtcp_sd = bind_udp(port + 1)) >= 0)
+      break;
+    close(rtp_sd);
+  }
+  if (rtcp_sd < 0) {
+    perror("binding the peer");
+    return 1;
+  }
+
+  string body =
+    "v=0" CRLF
+    "o=peer 1 1 IN IP4 127.0.0.1" CRLF
+    "s=-" CRLF
+    "c=IN IP4 127.0.0.1" CRLF
+    "t=0 0" CRLF
+    "m=audio " + int2str(port) + " RTP/AVP 0" CRLF
+    "a=rtpmap:0 PCMU/8000" CRLF;
+
+  AmSdp offer, answer;
+  if (!offer.parse(body)) {
+    printf("could not parse the offer\n");
+    return 1;
+  }
+
+  RtcpSession* s = new RtcpSession();
+  if (!s->getSdpAnswer(offer, answer) || s->onSdpCompleted(answer, offer)) {
+    printf("could not set up the session stream\n");
+    return 1;
+  }
+
+  AmRtpAudio* stream = s->RTPStream();
+  unsigned char frame[160];
+  memset(frame, 0xff, sizeof(frame));
+
+  unsigned char buf[1500];
+  unsigned int sr = 0, rr = 0, rtp = 0;
+  double first = 0, last = 0;
+  unsigned int ts = 0;
+  double start = now_ms(), next_frame = start;
+
+  while (now_ms() - start < seconds * 1000.0) {
+    if (now_ms() >= next_frame) {
+      stream->send(ts, frame, sizeof(frame));
+      ts += 160;
+      next_frame += 20;
+    }
+
+    while (recv(rtp_sd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+      rtp++;
+
+    ssize_t len = recv(rtcp_sd, buf, sizeof(buf), 0);
+    if (len < 8)
+      continue;
+
+    if (buf[1] == 200)
+      sr++;
+    else if (buf[1] == 201)
+      rr++;
+    else
+      continue;
+
+    last = now_ms();
+    if (!first)
+      first = last;
+  }
+
+  unsigned int reports = sr + rr;
+  printf("%u RTP packets, %u SR, %u RR in %u s (interval %u ms)",
+	 rtp, sr, rr, seconds, interval);
+  if (reports > 1)
+    printf(", %.0f ms between reports", (last - first) / (reports - 1));
+  printf("\n");
+
+  if (!sr)
+    printf("NO SR RECEIVED\n");
+
+  // the stream goes with the session
+  s->RTPStream()->stopReceiving();
+  close(rtp_sd);
+  close(rtcp_sd);
+  return sr ? 0 : 1;
+}
+
+// Local Variables:
+// mode:C++
+// End:
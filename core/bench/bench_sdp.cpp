@@ -0,0 +1,284 @@
+/*
+ * SDP micro-benchmark: parses and prints a WebRTC-sized offer (bundled
+ * audio, video and data channel, many codecs with rtcp-fb, fmtp and
+ * RTX, extmaps, SSRCs, ICE candidates and fingerprints) the way the
+ * SBC relays an SDP body: parse, touch the origin as a re-INVITE does,
+ * print. Compares regenerating the whole body with keeping the body
+ * (AmSdp::parse(body, true)) and re-emitting the unchanged sections,
+ * counting time and heap allocations per operation.
+ *
+ * usage: bench_sdp [iterations] (default: 20000)
+ */
+
+#include "AmSdp.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <new>
+#include <string>
+
+using std::string;
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t size)
+{
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static double now_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+#define CRLF "\r\n"
+
+static void add_candidates(string& sdp, int base_port)
+{
+  const char* addrs[] = { "192.168.1.23", "10.0.3.7", "2001:db8::1f", "203.0.113.45" };
+  for (int i = 0; i < 4; i++) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+	     "a=candidate:%u 1 udp %u %s %d typ %s generation 0 network-id %d" CRLF,
+	     842163049u + i, 2122260223u - i * 1000, addrs[i], base_port + i,
+	     i < 3 ? "host" : "srflx raddr 192.168.1.23 rport 9", i + 1);
+    sdp += buf;
+    snprintf(buf, sizeof(buf),
+	     "a=candidate:%u 1 tcp %u %s 9 typ host tcptype active generation 0"
+	     " network-id %d" CRLF,
+	     1306516089u + i, 1518280447u - i * 1000, addrs[i % 3], i + 1);
+    sdp += buf;
+  }
+}
+
+static void add_common(string& sdp, const char* mid)
+{
+  sdp +=
+    "a=ice-ufrag:Wm2J" CRLF
+    "a=ice-pwd:Lq3PAN9w4HJZ0fKp0lPt2yQa" CRLF
+    "a=ice-options:trickle" CRLF
+    "a=fingerprint:sha-256 5B:0F:2A:8C:D4:1E:77:93:AB:CD:EF:01:23:45:67:89:"
+    "9A:BC:DE:F0:12:34:56:78:9A:BC:DE:F0:12:34:56:78" CRLF
+    "a=setup:actpass" CRLF;
+  sdp += "a=mid:";
+  sdp += mid;
+  sdp += CRLF;
+}
+
+static string webrtc_offer()
+{
+  string sdp =
+    "v=0" CRLF
+    "o=- 4611731400430051336 2 IN IP4 127.0.0.1" CRLF
+    "s=-" CRLF
+    "t=0 0" CRLF
+    "a=group:BUNDLE 0 1 2" CRLF
+    "a=extmap-allow-mixed" CRLF
+    "a=msid-semantic: WMS 3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP" CRLF;
+
+  // audio
+  sdp +=
+    "m=audio 50000 UDP/TLS/RTP/SAVPF 111 63 9 0 8 13 110 126 105 106 112 113 102" CRLF
+    "c=IN IP4 203.0.113.45" CRLF
+    "a=rtcp:9 IN IP4 0.0.0.0" CRLF;
+  add_candidates(sdp, 50000);
+  add_common(sdp, "0");
+  sdp +=
+    "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level" CRLF
+    "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time" CRLF
+    "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01" CRLF
+    "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid" CRLF
+    "a=sendrecv" CRLF
+    "a=msid:3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP 7c3a0f8c-3f84-4a5b-9a58-1c2a8d7e2f11" CRLF
+    "a=rtcp-mux" CRLF
+    "a=rtpmap:111 opus/48000/2" CRLF
+    "a=rtcp-fb:111 transport-cc" CRLF
+    "a=fmtp:111 minptime=10;useinbandfec=1;stereo=0;sprop-stereo=0" CRLF
+    "a=rtpmap:63 red/48000/2" CRLF
+    "a=fmtp:63 111/111" CRLF
+    "a=rtpmap:9 G722/8000" CRLF
+    "a=rtpmap:0 PCMU/8000" CRLF
+    "a=rtpmap:8 PCMA/8000" CRLF
+    "a=rtpmap:13 CN/8000" CRLF
+    "a=rtpmap:110 telephone-event/48000" CRLF
+    "a=rtpmap:126 telephone-event/8000" CRLF
+    "a=rtpmap:105 CN/16000" CRLF
+    "a=rtpmap:106 CN/32000" CRLF
+    "a=rtpmap:112 telephone-event/32000" CRLF
+    "a=rtpmap:113 telephone-event/16000" CRLF
+    "a=rtpmap:102 ILBC/8000" CRLF
+    "a=ssrc:1473920231 cname:Zr2kq1Ln5T7vWc3x" CRLF
+    "a=ssrc:1473920231 msid:3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP 7c3a0f8c-3f84-4a5b-9a58-1c2a8d7e2f11" CRLF;
+
+  // video
+  sdp +=
+    "m=video 50000 UDP/TLS/RTP/SAVPF 96 97 98 99 100 101 35 36 37 38 102 103 104 107 108 109 127 125 39 40 45 46 114 115 116" CRLF
+    "c=IN IP4 203.0.113.45" CRLF
+    "a=rtcp:9 IN IP4 0.0.0.0" CRLF;
+  add_candidates(sdp, 50000);
+  add_common(sdp, "1");
+  sdp +=
+    "a=extmap:14 urn:ietf:params:rtp-hdrext:toffset" CRLF
+    "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time" CRLF
+    "a=extmap:13 urn:3gpp:video-orientation" CRLF
+    "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01" CRLF
+    "a=extmap:5 http://www.webrtc.org/experiments/rtp-hdrext/playout-delay" CRLF
+    "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid" CRLF
+    "a=sendrecv" CRLF
+    "a=msid:3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP 0e4e0a2b-5c1d-4f7a-8d33-6b9c2f1e0a77" CRLF
+    "a=rtcp-mux" CRLF
+    "a=rtcp-rsize" CRLF;
+  struct { int pt; const char* codec; const char* fmtp; } video[] = {
+    { 96, "VP8", NULL },
+    { 98, "VP9", "profile-id=0" },
+    { 100, "VP9", "profile-id=2" },
+    { 35, "AV1", "level-idx=5;profile=0;tier=0" },
+    { 102, "H264", "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42001f" },
+    { 104, "H264", "level-asymmetry-allowed=1;packetization-mode=0;profile-level-id=42001f" },
+    { 108, "H264", "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f" },
+    { 127, "H264", "level-asymmetry-allowed=1;packetization-mode=0;profile-level-id=42e01f" },
+    { 39, "H264", "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=4d001f" },
+    { 45, "AV1", "level-idx=5;profile=1;tier=0" },
+    { 114, "H264", "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=64001f" },
+  };
+  int rtx[] = { 97, 99, 101, 36, 103, 107, 109, 125, 40, 46, 115 };
+  for (size_t i = 0; i < sizeof(video) / sizeof(video[0]); i++) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+	     "a=rtpmap:%d %s/90000" CRLF
+	     "a=rtcp-fb:%d goog-remb" CRLF
+	     "a=rtcp-fb:%d transport-cc" CRLF
+	     "a=rtcp-fb:%d ccm fir" CRLF
+	     "a=rtcp-fb:%d nack" CRLF
+	     "a=rtcp-fb:%d nack pli" CRLF,
+	     video[i].pt, video[i].codec, video[i].pt, video[i].pt,
+	     video[i].pt, video[i].pt, video[i].pt);
+    sdp += buf;
+    if (video[i].fmtp) {
+      snprintf(buf, sizeof(buf), "a=fmtp:%d %s" CRLF, video[i].pt, video[i].fmtp);
+      sdp += buf;
+    }
+    snprintf(buf, sizeof(buf),
+	     "a=rtpmap:%d rtx/90000" CRLF
+	     "a=fmtp:%d apt=%d" CRLF, rtx[i], rtx[i], video[i].pt);
+    sdp += buf;
+  }
+  sdp +=
+    "a=rtpmap:37 red/90000" CRLF
+    "a=rtpmap:38 rtx/90000" CRLF
+    "a=fmtp:38 apt=37" CRLF
+    "a=rtpmap:116 ulpfec/90000" CRLF
+    "a=ssrc-group:FID 2231627014 632943048" CRLF
+    "a=ssrc:2231627014 cname:Zr2kq1Ln5T7vWc3x" CRLF
+    "a=ssrc:2231627014 msid:3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP 0e4e0a2b-5c1d-4f7a-8d33-6b9c2f1e0a77" CRLF
+    "a=ssrc:632943048 cname:Zr2kq1Ln5T7vWc3x" CRLF
+    "a=ssrc:632943048 msid:3bSQtIbzZYiIhGH9g3bJ6aVrLSq7VLZ4VLmP 0e4e0a2b-5c1d-4f7a-8d33-6b9c2f1e0a77" CRLF;
+
+  // data channel
+  sdp +=
+    "m=application 50000 UDP/DTLS/SCTP webrtc-datachannel" CRLF
+    "c=IN IP4 203.0.113.45" CRLF;
+  add_candidates(sdp, 50000);
+  add_common(sdp, "2");
+  sdp +=
+    "a=sctp-port:5000" CRLF
+    "a=max-message-size:262144" CRLF;
+
+  return sdp;
+}
+
+struct Result {
+  double ns;
+  double allocs;
+};
+
+/* parse (+ origin update + print if relay) n times */
+static Result run(const string& body, bool keep_body, bool relay, unsigned int n)
+{
+  string out;
+  unsigned long a = allocations;
+  double start = now_ms();
+  for (unsigned int i = 0; i < n; i++) {
+    AmSdp sdp;
+    if (!sdp.parse(body, keep_body)) {
+      fprintf(stderr, "parsing failed\n");
+      exit(1);
+    }
+    if (relay) {
+      sdp.origin.sessV++; // as updateLocalSdpOrigin() on a re-INVITE
+      sdp.print(out);
+    }
+  }
+  Result r;
+  r.ns = (now_ms() - start) * 1e6 / n;
+  r.allocs = (double)(allocations - a) / n;
+  return r;
+}
+
+/* print an already parsed SDP n times */
+static Result run_print(const string& body, bool keep_body, unsigned int n)
+{
+  AmSdp sdp;
+  sdp.parse(body, keep_body);
+  string out;
+  unsigned long a = allocations;
+  double start = now_ms();
+  for (unsigned int i = 0; i < n; i++)
+    sdp.print(out);
+  Result r;
+  r.ns = (now_ms() - start) * 1e6 / n;
+  r.allocs = (double)(allocations - a) / n;
+  return r;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  unsigned int n = argc > 1 ? atoi(argv[1]) : 20000;
+  if (!n)
+    n = 1;
+
+  string body = webrtc_offer();
+
+  AmSdp sdp;
+  sdp.parse(body, true);
+  string out;
+  sdp.print(out);
+  printf("SDP: %zu bytes, %zu media, %zu payloads, %u iterations\n",
+	 body.size(), sdp.media.size(),
+	 sdp.media[0].payloads.size() + sdp.media[1].payloads.size(), n);
+  if (out != body) {
+    printf("unchanged SDP not printed as received\n");
+    return 1;
+  }
+
+  const char* modes[] = { "regenerate", "verbatim" };
+  printf("%-11s %22s %22s %22s\n", "", "parse", "print",
+	 "parse+origin+print");
+  for (int keep = 0; keep < 2; keep++) {
+    Result p = run(body, keep, false, n);
+    Result pr = run_print(body, keep, n);
+    Result r = run(body, keep, true, n);
+    printf("%-11s %8.0f ns %5.0f allocs %8.0f ns %5.0f allocs %8.0f ns %5.0f allocs\n",
+	   modes[keep], p.ns, p.allocs, pr.ns, pr.allocs, r.ns, r.allocs);
+  }
+
+  return 0;
+}
+
+// Local Variables:
+// mode:C++
+// End:
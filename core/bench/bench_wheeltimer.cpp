@@ -0,0 +1,207 @@
+/*
+ * Timer wheel micro-benchmark: compares the hierarchical timing wheel
+ * in sip/wheeltimer against the former std::map<bucket, std::list>
+ * implementation (reproduced below as map_timer_ref).
+ *
+ * Timers are spread uniformly over 64s (transaction-like timers)
+ * and over one hour (registration / session timers).
+ *
+ * usage: bench_wheeltimer [n_timers ...]   (default: 100000 1000000)
+ */
+
+#include "sip/wheeltimer.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+#define RESOLUTION   20000        // 20ms
+
+static uint64_t fired_wheel = 0;
+static uint64_t fired_ref = 0;
+
+/* ---- former implementation, for reference ---- */
+
+struct ref_timer;
+typedef std::list<ref_timer*> ref_list;
+
+struct ref_timer
+{
+  uint64_t expires;
+  std::optional<std::pair<ref_list*, ref_list::iterator> > link;
+
+  ref_timer() : expires(0) {}
+  void fire() { fired_ref++; }
+};
+
+class map_timer_ref
+{
+  std::mutex mut;
+  std::map<uint64_t, ref_list> buckets;
+
+public:
+  void insert_abs(ref_timer* t, uint64_t us)
+  {
+    std::lock_guard<std::mutex> l(mut);
+    t->expires = us;
+    uint64_t b = ((us / RESOLUTION) + 1) * RESOLUTION;
+    ref_list& lst = buckets[b];
+    lst.push_front(t);
+    t->link.emplace(&lst, lst.begin());
+  }
+
+  void remove(ref_timer* t)
+  {
+    std::lock_guard<std::mutex> l(mut);
+    if (!t->link) return;
+    t->link->first->erase(t->link->second);
+    t->link.reset();
+  }
+
+  void run_due(uint64_t now)
+  {
+    std::unique_lock<std::mutex> l(mut);
+    while (!buckets.empty() && buckets.begin()->first <= now) {
+      auto beg = buckets.begin();
+      while (!beg->second.empty()) {
+	ref_timer* t = beg->second.front();
+	beg->second.pop_front();
+	t->link.reset();
+	l.unlock();
+	t->fire();
+	l.lock();
+      }
+      buckets.erase(beg);
+    }
+  }
+};
+
+/* ---- timing wheel ---- */
+
+struct bench_timer : public timer
+{
+  void fire() { fired_wheel++; }
+};
+
+struct bench_wheel : public _wheeltimer
+{
+  bench_wheel() : _wheeltimer(RESOLUTION) {}
+  ~bench_wheel() {}
+};
+
+static double elapsed_ms(const struct timeval& a)
+{
+  struct timeval b;
+  gettimeofday(&b, NULL);
+  return (b.tv_sec - a.tv_sec) * 1000.0 + (b.tv_usec - a.tv_usec) / 1000.0;
+}
+
+static void report(const char* impl, const char* phase, size_t n, double ms)
+{
+  printf("%-6s %-8s %9zu timers %10.2f ms %8.1f ns/op\n",
+	 impl, phase, n, ms, ms * 1e6 / n);
+}
+
+static int run(size_t n, uint64_t spread)
+{
+  std::mt19937_64 rnd(42);
+  std::vector<uint64_t> expiry(n);
+  std::vector<size_t> removed;
+
+  uint64_t base = gettimeofday_us() + 1000000;
+  for (size_t i = 0; i < n; i++)
+    expiry[i] = base + rnd() % spread;
+  for (size_t i = 0; i < n; i += 2)
+    removed.push_back(rnd() % n);
+
+  uint64_t end = base + spread + 2 * RESOLUTION;
+  struct timeval t0;
+
+  // reference
+  {
+    std::vector<ref_timer> timers(n);
+    map_timer_ref ref;
+
+    gettimeofday(&t0, NULL);
+    for (size_t i = 0; i < n; i++)
+      ref.insert_abs(&timers[i], expiry[i]);
+    report("map", "insert", n, elapsed_ms(t0));
+
+    gettimeofday(&t0, NULL);
+    for (size_t i : removed)
+      ref.remove(&timers[i]);
+    report("map", "remove", removed.size(), elapsed_ms(t0));
+
+    gettimeofday(&t0, NULL);
+    for (uint64_t now = base; now <= end; now += RESOLUTION)
+      ref.run_due(now);
+    report("map", "expire", fired_ref, elapsed_ms(t0));
+  }
+
+  // wheel
+  {
+    std::vector<bench_timer> timers(n);
+    bench_wheel wheel;
+
+    gettimeofday(&t0, NULL);
+    for (size_t i = 0; i < n; i++)
+      wheel.insert_timer_abs(&timers[i], expiry[i]);
+    report("wheel", "insert", n, elapsed_ms(t0));
+
+    gettimeofday(&t0, NULL);
+    for (size_t i : removed)
+      wheel.remove_timer(&timers[i], false);
+    report("wheel", "remove", removed.size(), elapsed_ms(t0));
+
+    gettimeofday(&t0, NULL);
+    for (uint64_t now = base; now <= end; now += RESOLUTION)
+      wheel.run_due(now);
+    report("wheel", "expire", fired_wheel, elapsed_ms(t0));
+
+    if (wheel.size()) {
+      fprintf(stderr, "error: %zu timers left in wheel\n", wheel.size());
+      return 1;
+    }
+  }
+
+  if (fired_wheel != fired_ref) {
+    fprintf(stderr, "error: fired %" PRIu64 " (wheel) != %" PRIu64 " (map)\n",
+	    fired_wheel, fired_ref);
+    return 1;
+  }
+
+  fired_wheel = fired_ref = 0;
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  log_level = L_ERR;
+
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back(strtoul(argv[i], NULL, 10));
+  if (sizes.empty())
+    sizes = { 100000, 1000000 };
+
+  const uint64_t spreads[] = { 64000000ULL, 3600000000ULL };
+
+  for (uint64_t spread : spreads) {
+    for (size_t n : sizes) {
+      printf("-- %zu timers over %" PRIu64 "s\n", n, spread / 1000000);
+      if (run(n, spread))
+	return 1;
+    }
+  }
+
+  return 0;
+}
@@ -295,6 +295,12 @@ public:
     const_iterator find(const Key& k) const { return elems.find(k); }
     std::pair<iterator, bool> insert(const std::pair<const Key&, const Value &>& value) { return elems.insert(value); }
 
+    // bucket interface (unordered containers only)
+    size_t bucket_count() const { return elems.bucket_count(); }
+    void reserve(size_t n) { elems.reserve(n); }
+    typename parent::local_iterator begin(size_t n) { return elems.begin(n); }
+    typename parent::local_iterator end(size_t n) { return elems.end(n); }
+
 private:
     Container elems;
 };
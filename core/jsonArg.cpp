@@ -34,12 +34,16 @@
 #include "jsonArg.h"
 using std::string;
 
-#include "jsonxx.h"
-using namespace jsonxx;
+#include <charconv>
+#include <iterator>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
 
-#include <sstream>
+/** nesting limit of the parser (it recurses) */
+#define JSONARG_MAX_DEPTH 512
 
-const char *hex_chars = "0123456789abcdef";
+static const char *hex_chars = "0123456789abcdef";
 
 string str2json(const char* str)
 {
@@ -53,226 +57,430 @@ string str2json(const string& str)
 
 string str2json(const char* str, size_t len)
 {
-    // borrowed from jsoncpp
-    // Not sure how to handle unicode...
-    if (strpbrk(str, "\"\\\b\f\n\r\t") == NULL)
-      return string("\"") + str + "\"";
-    // We have to walk value and escape any special characters.
-    // Appending to std::string is not efficient, but this should be rare.
-    // (Note: forward slashes are *not* rare, but I am not escaping them.)
-    unsigned maxsize = len*2 + 3; // allescaped+quotes+NULL
-    std::string result;
-    result.reserve(maxsize); // to avoid lots of mallocs
-    result += "\"";
-    const char* end = str + len;
-    for (const char* c = str; (c != end) && (*c != 0); ++c){
-      switch(*c){
-      case '\"':
-	result += "\\\"";
-	break;
-      case '\\':
-	result += "\\\\";
-	break;
-      case '\b':
-	result += "\\b";
-	break;
-      case '\f':
-	 result += "\\f";
-	 break;
-      case '\n':
-	result += "\\n";
-	break;
-      case '\r':
-	result += "\\r";
-	break;
-      case '\t':
-	result += "\\t";
-	break;
-      case '/':
-	// Even though \/ is considered a legal escape in JSON, a bare
-	// slash is also legal, so I see no reason to escape it.
-	// (I hope I am not misunderstanding something.)
-      default:{
-	if (*c < ' ') 
-	  result += "\\u00" + hex_chars[*c >> 4] + hex_chars[*c & 0xf];
-	else 
-	  result += *c;
-      } break;
-      }
+  string result;
+  str2json(str, len, result);
+  return result;
+}
+
+void str2json(const char* str, size_t len, string& out)
+{
+  out += '"';
+
+  // copy the runs without special characters at once
+  const char* end = str + len;
+  const char* run = str;
+  const char* c = str;
+  for (; (c != end) && (*c != 0); ++c) {
+    unsigned char ch = *c;
+    if (ch >= ' ' && ch != '"' && ch != '\\')
+      continue;
+
+    out.append(run, c - run);
+    run = c + 1;
+
+    switch (ch) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\b': out += "\\b"; break;
+    case '\f': out += "\\f"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default: {
+      // forward slashes are legal unescaped, only control characters left
+      char u[6] = { '\\', 'u', '0', '0', hex_chars[ch >> 4], hex_chars[ch & 0xf] };
+      out.append(u, sizeof(u));
+    } break;
     }
-    result += "\"";
-    return result;
+  }
+  out.append(run, c - run);
+
+  out += '"';
 }
 
-string arg2json(const AmArg &a) {
-  // TODO: optimize to avoid lots of mallocs
-  // TODO: how to get a bool? 
-  string s;
+template<class T>
+static void num2json(T val, string& out)
+{
+  char buf[32];
+  std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), val);
+  out.append(buf, r.ptr - buf);
+}
+
+void arg2json(const AmArg &a, string& out)
+{
   switch (a.getType()) {
   case AmArg::Undef:
-    return "null";
+    out += "null";
+    return;
 
   case AmArg::Int:
-    return a.asInt()<0?"-"+int2str(abs(a.asInt())):int2str(abs(a.asInt()));
+    num2json(a.asLong(), out);
+    return;
 
   case AmArg::LongLong:
-    return int2str(a.asLongLong());
+    num2json(a.asLongLong(), out);
+    return;
 
   case AmArg::Bool:
-    return a.asBool()?"true":"false";
+    out += a.asBool()?"true":"false";
+    return;
 
-  case AmArg::Double: 
-    return double2str(a.asDouble());
+  case AmArg::Double:
+    out += double2str(a.asDouble());
+    return;
 
   case AmArg::CStr:
-    return str2json(a.asCStr());
+    str2json(a.asCStr(), strlen(a.asCStr()), out);
+    return;
 
   case AmArg::Array:
-    s = "[";
-    for (size_t i = 0; i < a.size(); i ++)
-      s += arg2json(a[i]) + ", ";
-    if (1 < s.size()) 
-      s.resize(s.size() - 2); // strip last ", "
-    s += "]";
-    return s;
+    out += '[';
+    for (size_t i = 0; i < a.size(); i ++) {
+      if (i)
+	out += ", ";
+      arg2json(a.get(i), out);
+    }
+    out += ']';
+    return;
 
   case AmArg::Struct:
-    s = "{";
+    out += '{';
     for (AmArg::ValueStruct::const_iterator it = a.asStruct().begin();
 	 it != a.asStruct().end(); it ++) {
-      s += '"'+it->first + "\": ";
-      s += arg2json(it->second);
-      s += ", ";
+      if (it != a.asStruct().begin())
+	out += ", ";
+      str2json(it->first.c_str(), it->first.length(), out);
+      out += ": ";
+      arg2json(it->second, out);
     }
-    if (1 < s.size())
-      s.resize(s.size() - 2); // strip last ", "
-    s += "}";
-    return s;
+    out += '}';
+    return;
+
   default: break;
   }
 
-  return "{}";
+  out += "{}";
 }
 
-// based on jsonxx
-bool array_parse(std::istream& input, AmArg& res) {
-  if (!match("[", input)) {
-    return false;
-  }
+string arg2json(const AmArg &a)
+{
+  string s;
+  arg2json(a, s);
+  return s;
+}
 
-  res.assertArray();
+/**
+ * Single pass JSON parser over a buffer, building the AmArg values
+ * in place. Accepts what the former jsonxx based parser accepted:
+ * '\u' escapes are kept as they are, a ',' may follow the last
+ * member of an object, integers with positive exponent are Int,
+ * numbers with '.' or negative exponent Double.
+ */
+class JsonArgReader
+{
+  const char* p;
+  const char* end;
+  unsigned int depth;
+
+  void skipWs() {
+    while (p != end && (*p == ' ' || (*p >= '\t' && *p <= '\r')))
+      p++;
+  }
 
-  if (match("]", input)) {
+  bool matchWord(const char* w, size_t len) {
+    if ((size_t)(end - p) < len || memcmp(p, w, len))
+      return false;
+    p += len;
     return true;
   }
 
-  do {
-    res.push(AmArg());
-    AmArg v;
-    if (!json2arg(input, res.get(res.size()-1))) {
-      res.clear();
+  bool parseString(string& s);
+  bool parseNumber(AmArg& res);
+  bool parseArray(AmArg& res);
+  bool parseObject(AmArg& res);
+
+public:
+  JsonArgReader(const char* input, size_t len)
+    : p(input), end(input + len), depth(0) { }
+
+  /** res is Undef */
+  bool parseValue(AmArg& res);
+};
+
+bool JsonArgReader::parseString(string& s)
+{
+  // at the opening quote
+  const char* run = ++p;
+  while (p != end) {
+    char ch = *p;
+    if (ch == '"') {
+      s.append(run, p - run);
+      p++;
+      return true;
+    }
+
+    if (ch != '\\') {
+      p++;
+      continue;
+    }
+
+    s.append(run, p - run);
+    if (++p == end)
       return false;
-      res.pop_back();
-      break; // TODO: return false????
+
+    switch (*p) {
+    case '"':
+    case '\\':
+    case '/': s += *p; break;
+    case 'b': s += '\b'; break;
+    case 'f': s += '\f'; break;
+    case 'n': s += '\n'; break;
+    case 'r': s += '\r'; break;
+    case 't': s += '\t'; break;
+    case 'u': s += "\\u"; break;
+    default: return false;
     }
-  } while (match(",", input));
-  
-  if (!match("]", input)) {
-    res.clear();
+    run = ++p;
+  }
+
+  // not terminated
+  return false;
+}
+
+bool JsonArgReader::parseNumber(AmArg& res)
+{
+  const char* start = p;
+  bool neg = false;
+  if (*p == '-' || *p == '+') {
+    neg = *p == '-';
+    p++;
+  }
+
+  unsigned long long mantissa = 0;
+  bool overflow = false;
+  bool has_digits = false;
+  bool has_dot = false;
+  for (; p != end; p++) {
+    if (*p == '.') {
+      if (has_dot)
+	return false;
+      has_dot = true;
+      continue;
+    }
+    if (*p < '0' || *p > '9')
+      break;
+
+    has_digits = true;
+    if (!has_dot) {
+      if (mantissa > (ULLONG_MAX - 9) / 10)
+	overflow = true;
+      else
+	mantissa = mantissa * 10 + (*p - '0');
+    }
+  }
+  if (!has_digits)
     return false;
+
+  bool exp_neg = false;
+  unsigned int exp = 0;
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    if (++p != end && (*p == '-' || *p == '+')) {
+      exp_neg = *p == '-';
+      p++;
+    }
+    const char* exp_start = p;
+    for (; p != end && *p >= '0' && *p <= '9'; p++) {
+      if (exp < 100000)
+	exp = exp * 10 + (*p - '0');
+    }
+    if (p == exp_start)
+      return false;
+  }
+
+  if (has_dot || exp_neg) {
+    // from_chars: no locale, no copy; it takes no '+'
+    if (*start == '+')
+      start++;
+    double d;
+    std::from_chars_result r = std::from_chars(start, p, d);
+    if (r.ec == std::errc::result_out_of_range)
+      d = exp_neg ? (neg ? -0.0 : 0.0) : (neg ? -HUGE_VAL : HUGE_VAL);
+    else if (r.ec != std::errc() || r.ptr != p)
+      return false;
+    res = d;
+    return true;
   }
+
+  double v = neg ? -(double)mantissa : (double)mantissa;
+  if (exp)
+    v *= pow(10, exp);
+
+  if (overflow || v >= (double)LONG_MAX || v <= (double)LONG_MIN)
+    res = v < 0 ? LONG_MIN : LONG_MAX;
+  else if (exp)
+    res = (long)v;
+  else
+    res = neg ? -(long)mantissa : (long)mantissa;
+
   return true;
 }
 
-bool object_parse(std::istream& input, AmArg& res) {
-  if (!match("{", input)) {
-    return false;
+bool JsonArgReader::parseArray(AmArg& res)
+{
+  // at '['
+  p++;
+  res.type = AmArg::Array;
+  res.value = AmArg::ValueArray();
+  AmArg::ValueArray& v = std::get<AmArg::ValueArray>(res.value);
+
+  skipWs();
+  if (p != end && *p == ']') {
+    p++;
+    return true;
   }
 
-  res.assertStruct();
+  while (true) {
+    v.emplace_back();
+    if (!parseValue(v.back()))
+      return false;
+
+    skipWs();
+    if (p == end)
+      return false;
+    if (*p == ']') {
+      p++;
+      return true;
+    }
+    if (*p != ',')
+      return false;
+    p++;
+  }
+}
 
-  if (match("}", input)) {
+bool JsonArgReader::parseObject(AmArg& res)
+{
+  // at '{'
+  p++;
+  res.type = AmArg::Struct;
+  res.value = AmArg::ValueStruct();
+  AmArg::ValueStruct& v = std::get<AmArg::ValueStruct>(res.value);
+
+  skipWs();
+  if (p != end && *p == '}') {
+    p++;
     return true;
   }
 
-  do {
-    std::string key;
-    if (!parse_string(input, &key)) {
-      if (match("}",input,true)) {          
+  string key;
+  while (true) {
+    skipWs();
+    if (p == end)
+      return false;
+    if (*p != '"') {
+      // trailing ','
+      if (*p == '}') {
+	p++;
 	return true;
       }
-      res.clear();
-      return false;
-    }
-    if (!match(":", input)) {
-      res.clear();
       return false;
     }
-    res[key] = AmArg(); // using the reference
-    if (!json2arg(input, res[std::move(key)])) {
-      res.clear();
+
+    key.clear();
+    if (!parseString(key))
       return false;
-    }
-  } while (match(",", input));
-  
-  if (!match("}", input)) {
-    res.clear();
-    return false;
-  }
 
-  return true;
-}
+    skipWs();
+    if (p == end || *p != ':')
+      return false;
+    p++;
 
-bool json2arg(const std::string& input, AmArg& res) {
-  std::istringstream iss(input);
-  return json2arg(iss, res);
-}
+    AmArg& member = v.try_emplace(std::move(key)).first->second;
+    member.clear();
+    if (!parseValue(member))
+      return false;
 
-bool json2arg(const char* input, AmArg& res) {
-  std::istringstream iss(input);
-  return json2arg(iss, res);
+    skipWs();
+    if (p == end)
+      return false;
+    if (*p == '}') {
+      p++;
+      return true;
+    }
+    if (*p != ',')
+      return false;
+    p++;
+  }
 }
 
-bool json2arg(std::istream& input, AmArg& res) {
+bool JsonArgReader::parseValue(AmArg& res)
+{
+  skipWs();
+  if (p == end)
+    return false;
 
-  res.clear();
+  switch (*p) {
+  case '"':
+    res.type = AmArg::CStr;
+    res.value = string();
+    return parseString(std::get<string>(res.value));
 
-  std::string string_value;
-  if (parse_string(input, &string_value)) {
-    res = string_value; // todo: unnecessary value copy here
-    return true;
+  case '[':
+  case '{': {
+    if (depth >= JSONARG_MAX_DEPTH) {
+      DBG("JSON nested deeper than %d\n", JSONARG_MAX_DEPTH);
+      return false;
+    }
+    depth++;
+    bool ok = *p == '[' ? parseArray(res) : parseObject(res);
+    depth--;
+    return ok;
   }
 
-  double d;
-  if (parse_float(input, &d)) {
-    res = d;
+  case 't':
+    if (!matchWord("true", 4))
+      return false;
+    res = true;
     return true;
-  }
 
-  long l;
-  if (parse_number(input, &l)) {
-    res = l;
+  case 'f':
+    if (!matchWord("false", 5))
+      return false;
+    res = false;
     return true;
-  }
 
-  bool b;
-  if (parse_bool(input, &b)) {
-    res = b;
-    return true;
-  }
+  case 'n':
+    // AmArg::Undef
+    return matchWord("null", 4);
 
-  if (parse_null(input)) { // AmArg::Undef
-    return true;
+  default:
+    return parseNumber(res);
   }
+}
 
-  if (array_parse(input, res)) {
-    return true;
-  }
+bool json2arg(const char* input, size_t len, AmArg& res)
+{
+  res.clear();
 
-  if (object_parse(input, res)) {
-     return true;
+  JsonArgReader reader(input, len);
+  if (!reader.parseValue(res)) {
+    res.clear();
+    return false;
   }
+  return true;
+}
 
-  res.clear();
-  return false;
+bool json2arg(const std::string& input, AmArg& res)
+{
+  return json2arg(input.data(), input.length(), res);
+}
+
+bool json2arg(const char* input, AmArg& res)
+{
+  return json2arg(input, strlen(input), res);
+}
+
+bool json2arg(std::istream& input, AmArg& res)
+{
+  string s((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  return json2arg(s, res);
 }
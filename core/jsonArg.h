@@ -37,9 +37,25 @@ std::string str2json(const char* str);
 std::string str2json(const std::string& str);
 std::string str2json(const char* str, size_t len);
 
+/** append str as JSON string to out */
+void str2json(const char* str, size_t len, std::string& out);
+
 string arg2json(const AmArg &a);
 
-/** @return true on success */
+/**
+ * append the JSON of a to out; out can be kept and clear()ed
+ * between messages to reuse its buffer
+ */
+void arg2json(const AmArg &a, std::string& out);
+
+/**
+ * parse JSON from input[0..len); leading whitespace is skipped,
+ * anything after the first value is ignored
+ * @return true on success
+ */
+bool json2arg(const char* input, size_t len, AmArg& res);
+
+/** reads the rest of input, @return true on success */
 bool json2arg(std::istream& input, AmArg& res);
 
 /** @return true on success */
@@ -34,6 +34,14 @@
 # include <syslog.h>
 #endif
 
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -180,11 +188,340 @@ void init_logging()
   INFO("Logging initialized\n");
 }
 
+
+/*
+ * Asynchronous logging
+ *
+ * Every logging thread gets a ring buffer that only it writes to
+ * (head) and only the writer thread reads from (tail), so logging a
+ * message is a copy into the ring without any lock. The writer thread
+ * collects the messages of all rings, orders them by time and runs the
+ * log hooks on the whole batch, taking log_hooks_mutex once.
+ */
+
+/** how often the writer thread drains the rings if not woken up */
+#define ASYNC_LOG_INTERVAL 10 /* ms */
+
+/** longest function and file name kept in a log record */
+#define ASYNC_LOG_MAX_NAME 255
+
+/**
+ * Header of a message in a log ring, followed by the 0-terminated
+ * function name, file name and message. A record with level < 0 only
+ * pads the ring up to its end.
+ */
+struct LogRecord {
+  uint32_t  size;	/**< of the whole record, multiple of 8 */
+  int       level;
+  int       line;
+  pid_t     pid;
+  pthread_t tid;
+  uint64_t  stamp;	/**< CLOCK_MONOTONIC, ns */
+  uint16_t  func_len;
+  uint16_t  file_len;
+  uint32_t  msg_len;
+
+  char* func() { return (char*)(this + 1); }
+  char* file() { return func() + func_len + 1; }
+  char* msg()  { return file() + file_len + 1; }
+};
+
+/** single producer/single consumer ring of log records */
+class LogRing {
+  char*    buf;
+  uint64_t mask;
+
+  alignas(64) std::atomic<uint64_t> head;	/**< written by the owning thread */
+  alignas(64) std::atomic<uint64_t> tail;	/**< written by the writer thread */
+
+ public:
+  /** set when the owning thread has exited */
+  std::atomic<bool> orphaned;
+  /** set by the owning thread while pushing (see stop_async_logging) */
+  std::atomic<bool> pushing;
+
+  LogRing(unsigned int size)
+    : buf(new char[size]), mask(size - 1), head(0), tail(0), orphaned(false),
+      pushing(false) { }
+  ~LogRing() { delete [] buf; }
+
+  /** @return ring bytes in use after the push, 0 if it did not fit */
+  uint64_t push(int level, pid_t pid, pthread_t tid, const char* func,
+		const char* file, int line, const char* msg, uint64_t stamp);
+
+  /** add the pending records to batch, @return the tail to release */
+  uint64_t collect(vector<LogRecord*>& batch);
+  void release(uint64_t t) { tail.store(t, std::memory_order_release); }
+};
+
+uint64_t LogRing::push(int level, pid_t pid, pthread_t tid, const char* func,
+		       const char* file, int line, const char* msg, uint64_t stamp)
+{
+  size_t func_len = std::min(strlen(func), (size_t)ASYNC_LOG_MAX_NAME);
+  size_t file_len = std::min(strlen(file), (size_t)ASYNC_LOG_MAX_NAME);
+  size_t msg_len = strnlen(msg, LOG_BUFFER_LEN - 1);
+  uint64_t need = (sizeof(LogRecord) + func_len + file_len + msg_len + 3 + 7) & ~7ULL;
+
+  uint64_t h = head.load(std::memory_order_relaxed);
+  uint64_t t = tail.load(std::memory_order_acquire);
+  uint64_t pos = h & mask;
+  uint64_t to_end = mask + 1 - pos;
+
+  // a record never wraps around: pad up to the end of the ring first
+  if (mask + 1 - (h - t) < (to_end < need ? to_end + need : need))
+    return 0;
+
+  if (to_end < need) {
+    LogRecord* pad = (LogRecord*)(buf + pos);
+    pad->size = to_end;
+    pad->level = -1;
+    h += to_end;
+    pos = 0;
+  }
+
+  LogRecord* r = (LogRecord*)(buf + pos);
+  r->size = need;
+  r->level = level;
+  r->line = line;
+  r->pid = pid;
+  r->tid = tid;
+  r->stamp = stamp;
+  r->func_len = func_len;
+  r->file_len = file_len;
+  r->msg_len = msg_len;
+  memcpy(r->func(), func, func_len);
+  r->func()[func_len] = '\0';
+  memcpy(r->file(), file, file_len);
+  r->file()[file_len] = '\0';
+  memcpy(r->msg(), msg, msg_len);
+  r->msg()[msg_len] = '\0';
+
+  head.store(h + need, std::memory_order_release);
+  return h + need - t;
+}
+
+uint64_t LogRing::collect(vector<LogRecord*>& batch)
+{
+  uint64_t h = head.load(std::memory_order_acquire);
+  for (uint64_t t = tail.load(std::memory_order_relaxed); t != h;) {
+    LogRecord* r = (LogRecord*)(buf + (t & mask));
+    if (r->level >= 0)
+      batch.push_back(r);
+    t += r->size;
+  }
+  return h;
+}
+
+/** all threads' log rings, new rings are added by their threads */
+static vector<LogRing*> log_rings;
+static std::mutex log_rings_mutex;
+static unsigned int log_ring_size = LOG_RING_SIZE;
+
+static std::atomic<unsigned long long> async_log_written(0);
+static std::atomic<unsigned long long> async_log_dropped(0);
+
+/** marks the ring of a thread that is exiting */
+#define LOG_RING_GONE ((LogRing*)1)
+
+static thread_local LogRing* thread_log_ring = NULL;
+
+/** hands the ring of an exiting thread to the writer for disposal */
+struct LogRingOwner {
+  ~LogRingOwner() {
+    if (thread_log_ring && thread_log_ring != LOG_RING_GONE)
+      thread_log_ring->orphaned.store(true, std::memory_order_release);
+    // late messages of this thread are logged synchronously
+    thread_log_ring = LOG_RING_GONE;
+  }
+};
+
+static thread_local LogRingOwner thread_log_ring_owner;
+
+/** @return this thread's log ring, NULL if it can not have one */
+static LogRing* get_log_ring()
+{
+  LogRing* r = thread_log_ring;
+  if (r == LOG_RING_GONE)
+    return NULL;
+
+  if (!r) {
+    (void)&thread_log_ring_owner;
+    r = new LogRing(log_ring_size);
+    std::lock_guard<std::mutex> l(log_rings_mutex);
+    log_rings.push_back(r);
+    thread_log_ring = r;
+  }
+  return r;
+}
+
+class AsyncLogWriter : public AmThread {
+  vector<LogRing*> rings;
+  vector<LogRecord*> batch;
+  unsigned long long dropped_reported;
+
+ protected:
+  void run();
+
+ public:
+  AsyncLogWriter() : dropped_reported(0) { }
+
+  /** run the log hooks on everything in the rings */
+  void drain();
+  void wake() { run_cond.notify_one(); }
+};
+
+/** the writer thread, if logging asynchronously; never deleted, as
+    logging threads may still hold it when logging is stopped */
+static std::atomic<AsyncLogWriter*> async_log_writer(NULL);
+
+void AsyncLogWriter::run()
+{
+  std::unique_lock<std::mutex> l(run_mut);
+  while (!stop_requested_unlocked()) {
+    run_cond.wait_for(l, std::chrono::milliseconds(ASYNC_LOG_INTERVAL));
+    l.unlock();
+    drain();
+    l.lock();
+  }
+}
+
+void AsyncLogWriter::drain()
+{
+  {
+    std::lock_guard<std::mutex> l(log_rings_mutex);
+    rings = log_rings;
+  }
+
+  // an orphaned ring does not get new records, once collected it is done
+  vector<bool> orphaned(rings.size());
+  vector<uint64_t> tails(rings.size());
+  batch.clear();
+  for (size_t i = 0; i < rings.size(); i++) {
+    orphaned[i] = rings[i]->orphaned.load(std::memory_order_acquire);
+    tails[i] = rings[i]->collect(batch);
+  }
+
+  // messages of one thread are in order already
+  std::stable_sort(batch.begin(), batch.end(),
+		   [](const LogRecord* a, const LogRecord* b) {
+		     return a->stamp < b->stamp;
+		   });
+
+  unsigned long long dropped = async_log_dropped.load(std::memory_order_relaxed);
+
+  if (!batch.empty() || dropped != dropped_reported) {
+    lock_guard<AmMutex> lock(log_hooks_mutex);
+
+    for (LogRecord* r : batch) {
+      for (AmLoggingFacility* fac : log_hooks)
+	fac->log(r->level, r->pid, r->tid, r->func(), r->file(), r->line, r->msg());
+    }
+
+    if (dropped != dropped_reported && L_WARN <= log_level) {
+      char msg[128];
+      snprintf(msg, sizeof(msg),
+	       "%llu log messages dropped, log rings full (%llu in total)",
+	       dropped - dropped_reported, dropped);
+      for (AmLoggingFacility* fac : log_hooks)
+	fac->log(L_WARN, GET_PID(), GET_TID(), FUNC_NAME, __FILE__, __LINE__, msg);
+    }
+  }
+
+  dropped_reported = dropped;
+  async_log_written.fetch_add(batch.size(), std::memory_order_relaxed);
+
+  for (size_t i = 0; i < rings.size(); i++)
+    rings[i]->release(tails[i]);
+
+  for (size_t i = 0; i < rings.size(); i++) {
+    if (!orphaned[i])
+      continue;
+    {
+      std::lock_guard<std::mutex> l(log_rings_mutex);
+      log_rings.erase(std::find(log_rings.begin(), log_rings.end(), rings[i]));
+    }
+    delete rings[i];
+  }
+}
+
+void start_async_logging(unsigned int ring_size)
+{
+  if (async_log_writer.load())
+    return;
+
+  log_ring_size = LOG_RING_MIN_SIZE;
+  while (log_ring_size < ring_size)
+    log_ring_size <<= 1;
+
+  AsyncLogWriter* w = new AsyncLogWriter();
+  w->start();
+  async_log_writer.store(w, std::memory_order_release);
+
+  INFO("Asynchronous logging started, %u bytes log ring per thread\n",
+       log_ring_size);
+}
+
+void stop_async_logging()
+{
+  AsyncLogWriter* w = async_log_writer.exchange(NULL);
+  if (!w)
+    return;
+
+  w->stop();
+  w->join();
+
+  // threads which still saw the writer may be pushing their message
+  {
+    std::lock_guard<std::mutex> l(log_rings_mutex);
+    for (LogRing* r : log_rings) {
+      while (r->pushing.load())
+	std::this_thread::yield();
+    }
+  }
+
+  // whatever came in while stopping
+  w->drain();
+
+  INFO("Asynchronous logging stopped, %llu messages written, %llu dropped\n",
+       async_log_written.load(), async_log_dropped.load());
+}
+
+void get_async_log_stats(unsigned long long* written,
+			 unsigned long long* dropped)
+{
+  *written = async_log_written.load(std::memory_order_relaxed);
+  *dropped = async_log_dropped.load(std::memory_order_relaxed);
+}
+
 /**
  * Run log hooks
  */
 void run_log_hooks(int level, pid_t pid, pthread_t tid, const char* func, const char* file, int line, char* msg)
 {
+  AsyncLogWriter* w = async_log_writer.load(std::memory_order_acquire);
+  if (w) {
+    LogRing* r = get_log_ring();
+    if (r) {
+      // checked again once flagged: either stop_async_logging() waits
+      // for this push before its last drain, or it is logged below
+      r->pushing.store(true);
+      w = async_log_writer.load();
+      if (w) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t used = r->push(level, pid, tid, func, file, line, msg,
+				(uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+	r->pushing.store(false, std::memory_order_release);
+	if (!used)
+	  async_log_dropped.fetch_add(1, std::memory_order_relaxed);
+	if (!used || used > log_ring_size / 2)
+	  w->wake();
+	return;
+      }
+      r->pushing.store(false, std::memory_order_release);
+    }
+  }
+
   log_hooks_mutex.lock();
 
   if (!log_hooks.empty()) {
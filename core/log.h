@@ -108,6 +108,12 @@ enum Log_Level {
 #define LOG_BUFFER_LEN 4096
 #endif
 
+/** default size of the per-thread rings of the asynchronous logging */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 65536
+#endif
+#define LOG_RING_MIN_SIZE (4 * LOG_BUFFER_LEN)
+
 /* The underscores in parameter and local variable names are there to
    avoid collisions. */
 #define _LOG(level__, fmt, args...)					\
@@ -218,6 +224,19 @@ extern const char* log_level2str[];
 void init_logging(void);
 void run_log_hooks(int, pid_t, pthread_t, const char*, const char*, int, char*);
 
+/**
+ * Asynchronous logging: the log hooks are run by a writer thread,
+ * the logging threads only copy their messages into a per-thread
+ * ring buffer (ring_size bytes). Messages that do not fit into the
+ * ring are dropped and counted.
+ */
+void start_async_logging(unsigned int ring_size);
+/** flush the rings, stop the writer thread and log synchronously again */
+void stop_async_logging(void);
+/** messages written and dropped by the asynchronous logging so far */
+void get_async_log_stats(unsigned long long* written,
+			 unsigned long long* dropped);
+
 #ifndef DISABLE_SYSLOG_LOG
 int set_syslog_facility(const char*);
 #endif
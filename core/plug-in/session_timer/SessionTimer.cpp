@@ -107,7 +107,7 @@ bool SessionTimer::onSipReply(const AmSipRequest& req, const AmSipReply& reply,
 
     // get Min-SE
     unsigned int i_minse;
-    string min_se_hdr = getHeader(reply.hdrs, SIP_HDR_MIN_SE, true);
+    string min_se_hdr = reply.getHeader(SIP_HDR_MIN_SE, true);
     if (!min_se_hdr.empty()) {
       if (str2int(strip_header_params(min_se_hdr), i_minse)) {
 	WARN("error while parsing " SIP_HDR_MIN_SE " header value '%s'\n",
@@ -158,19 +158,19 @@ bool SessionTimer::onSendRequest(AmSipRequest& req, int& flags)
 
   if (!session_timer_conf.getEnableSessionTimer()) {
     /* clean SST headers and `timer` option tag from all the related headers */
-    removeOptionTag(req.hdrs, SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
-    removeOptionTag(req.hdrs, SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
-    removeSSTHeaders(req.hdrs);
+    removeOptionTag(req.hdrs.modify(), SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
+    removeOptionTag(req.hdrs.modify(), SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
+    removeSSTHeaders(req.hdrs.modify());
     DBG("SST timers are disabled for this leg, not adding SST related headers and sip option tags.\n");
     return false;
   }
 
-  addOptionTag(req.hdrs, SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
+  addOptionTag(req.hdrs.modify(), SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
   if  ((req.method != SIP_METH_INVITE) && (req.method != SIP_METH_UPDATE))
     return false; // session-expires / min-se only in INV/UPD
 
   /* clean timers related headers given by incoming request */
-  removeSSTHeaders(req.hdrs);
+  removeSSTHeaders(req.hdrs.modify());
 
   /* now build up new if this leg actually support it */
   req.hdrs += SIP_HDR_COLSP(SIP_HDR_SESSION_EXPIRES) + int2str(session_interval) + CRLF
@@ -192,24 +192,24 @@ bool SessionTimer::onSendReply(const AmSipRequest& req,
 
   if (!session_timer_conf.getEnableSessionTimer()) {
     /* clean SST headers and `timer` option tag from all the related headers */
-    removeOptionTag(reply.hdrs, SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
-    removeOptionTag(reply.hdrs, SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
-    removeSSTHeaders(reply.hdrs);
+    removeOptionTag(reply.hdrs.modify(), SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
+    removeOptionTag(reply.hdrs.modify(), SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
+    removeSSTHeaders(reply.hdrs.modify());
     DBG("SST timers are disabled for this leg, not adding SST related headers and sip option tags.\n");
     return false;
   }
 
-  addOptionTag(reply.hdrs, SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
+  addOptionTag(reply.hdrs.modify(), SIP_HDR_SUPPORTED, TIMER_OPTION_TAG);
 
   if (((session_refresher_role==UAC) && (session_refresher==refresh_remote))
       || ((session_refresher_role==UAS) && remote_timer_aware)) {
-    addOptionTag(reply.hdrs, SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
+    addOptionTag(reply.hdrs.modify(), SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
   } else {
-    removeOptionTag(reply.hdrs, SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
+    removeOptionTag(reply.hdrs.modify(), SIP_HDR_REQUIRE, TIMER_OPTION_TAG);
   }
 
   /* clean timers related headers given by incoming reply */
-  removeSSTHeaders(reply.hdrs);
+  removeSSTHeaders(reply.hdrs.modify());
 
   /* now build up new if this leg actually support it */
   reply.hdrs += SIP_HDR_COLSP(SIP_HDR_SESSION_EXPIRES) +
@@ -270,7 +270,7 @@ bool SessionTimerFactory::checkSessionExpires(const AmSipRequest& req, AmConfigR
     return false;
   }
 
-  string session_expires = getHeader(req.hdrs, SIP_HDR_SESSION_EXPIRES,
+  string session_expires = req.getHeader(SIP_HDR_SESSION_EXPIRES,
 				     SIP_HDR_SESSION_EXPIRES_COMPACT, true);
 
   if (session_expires.length()) {
@@ -302,7 +302,7 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipRequest& req)
 
     DBG("Update session timer (request).");
 
-    remote_timer_aware = key_in_list(getHeader(req.hdrs, SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
+    remote_timer_aware = key_in_list(req.getHeader(SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
                                       TIMER_OPTION_TAG);
     /* give a second chance with Require header instead.
      * for the requests, this fallback is still questionable because
@@ -310,7 +310,7 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipRequest& req)
      * in requests, even if the `Require: timer` is also present. */
     if (!remote_timer_aware)
       /* but do not override to false, in case Supported already declared `timer` */
-      remote_timer_aware = key_in_list(getHeader(req.hdrs, SIP_HDR_REQUIRE), TIMER_OPTION_TAG);
+      remote_timer_aware = key_in_list(req.getHeader(SIP_HDR_REQUIRE), TIMER_OPTION_TAG);
 
     /* disable timers for this leg if not declare explicitly */
     if (session_timer_conf.getStrictMode() && !remote_timer_aware) {
@@ -322,8 +322,7 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipRequest& req)
     }
 
     // determine session interval
-    string sess_expires_hdr = getHeader(req.hdrs,
-                                        SIP_HDR_SESSION_EXPIRES,
+    string sess_expires_hdr = req.getHeader(SIP_HDR_SESSION_EXPIRES,
                                         SIP_HDR_SESSION_EXPIRES_COMPACT,
                                         true);
 
@@ -342,7 +341,7 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipRequest& req)
 
     /* get Min-SE */
     unsigned int i_minse = min_se;
-    string min_se_hdr = getHeader(req.hdrs, SIP_HDR_MIN_SE, true);
+    string min_se_hdr = req.getHeader(SIP_HDR_MIN_SE, true);
     if (!min_se_hdr.empty()) {
       if (str2int(strip_header_params(min_se_hdr), i_minse)) {
         WARN("error while parsing " SIP_HDR_MIN_SE " header value '%s'\n",
@@ -413,12 +412,12 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipReply& reply)
   }
 
   /* verify if B leg supports Session Timers */
-  remote_timer_aware = key_in_list(getHeader(reply.hdrs, SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
+  remote_timer_aware = key_in_list(reply.getHeader(SIP_HDR_SUPPORTED, SIP_HDR_SUPPORTED_COMPACT),
                                     TIMER_OPTION_TAG);
   /* give a second chance with Require header instead */
   if (!remote_timer_aware)
     /* but do not override to false, in case Supported already declared `timer` */
-    remote_timer_aware = key_in_list(getHeader(reply.hdrs, SIP_HDR_REQUIRE), TIMER_OPTION_TAG);
+    remote_timer_aware = key_in_list(reply.getHeader(SIP_HDR_REQUIRE), TIMER_OPTION_TAG);
 
   if (session_timer_conf.getStrictMode() && !remote_timer_aware) {
     /* timer is not supported by responder's leg */
@@ -430,8 +429,7 @@ bool SessionTimer::updateTimer(AmSession* s, const AmSipReply& reply)
 
   /* timer supported by B leg
    * determine session interval */
-  string sess_expires_hdr = getHeader(reply.hdrs,
-                                      SIP_HDR_SESSION_EXPIRES,
+  string sess_expires_hdr = reply.getHeader(SIP_HDR_SESSION_EXPIRES,
                                       SIP_HDR_SESSION_EXPIRES_COMPACT,
                                       true);
 
@@ -35,6 +35,10 @@
 #include "log.h"
 #include "AmPlugIn.h"
 #include "AmApi.h"
+#include "AmRtpPacketPool.h"
+#include "AmRtpReceiver.h"
+#include "AmMediaProcessor.h"
+#include "AmSessionProcessor.h"
 
 #include "sip/trans_table.h"
 
@@ -312,6 +316,10 @@ int StatsUDPServer::execute(char* msg_buf, string& reply,
       "get_callsmax                       -  get maximum of active calls since the last query\n"
       "get_cpsavg                         -  get calls per second (5 sec average)\n"
       "get_cpsmax                         -  get maximum of CPS since the last query\n"
+      "get_rtppool                        -  get RTP packet pool occupancy\n"
+      "get_rtpreceiver                    -  get RTP packets read per socket wakeup\n"
+      "get_mediaprocessor                 -  get media processor thread statistics\n"
+      "get_sessionprocessor               -  get session processor thread statistics\n"
 
       "dump_transactions                  -  dump transaction table to log (loglevel debug)\n"
 
@@ -384,6 +392,30 @@ int StatsUDPServer::execute(char* msg_buf, string& reply,
       reply = "Average calls per second: " + int2str(sc->getAvgCPS()) + "\n";
     else if(cmd_str.substr(4, 6) == "cpsmax")
       reply = "Maximum calls per second: " + int2str(sc->getMaxCPS()) + "\n";
+    else if(cmd_str.substr(4, 7) == "rtppool") {
+      AmArg info;
+      AmRtpPacketPool::instance()->getInfo(info);
+      reply = "RTP packet pool: " + AmArg::print(info) + "\n";
+    }
+    else if(cmd_str.substr(4, 11) == "rtpreceiver") {
+      AmArg info;
+      AmRtpReceiver::instance()->getInfo(info);
+      reply = "RTP receiver: " + AmArg::print(info) + "\n";
+    }
+    else if(cmd_str.substr(4, 14) == "mediaprocessor") {
+      AmArg info;
+      AmMediaProcessor::instance()->getInfo(info);
+      reply = "Media processor: " + AmArg::print(info) + "\n";
+    }
+    else if(cmd_str.substr(4, 16) == "sessionprocessor") {
+#ifdef SESSION_THREADPOOL
+      AmArg info;
+      AmSessionProcessor::getInfo(info);
+      reply = "Session processor: " + AmArg::print(info) + "\n";
+#else
+      reply = "Session processor: not compiled with USE_THREADPOOL\n";
+#endif
+    }
     else if(cmd_str.substr(4, 8) == "cpslimit")
       reply = "CPS hard limit: " + int2str(sc->getCPSLimit().first) + ", CPS limit: " +
         int2str(sc->getCPSLimit().second) + "\n";
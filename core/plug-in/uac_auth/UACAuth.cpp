@@ -190,8 +190,8 @@ bool UACAuth::onSipReply(const AmSipRequest& req, const AmSipReply& reply,
 	  nonce_reuse = false;
 
 	  string auth_hdr = (reply.code==407) ? 
-	    getHeader(reply.hdrs, SIP_HDR_PROXY_AUTHENTICATE, true) : 
-	    getHeader(reply.hdrs, SIP_HDR_WWW_AUTHENTICATE, true);
+	    reply.getHeader(SIP_HDR_PROXY_AUTHENTICATE, true) : 
+	    reply.getHeader(SIP_HDR_WWW_AUTHENTICATE, true);
 	  string result; 
 
 	  string auth_uri = !ri->second.r_uri.empty() ? ri->second.r_uri : dlg->getRemoteUri();
@@ -18,7 +18,7 @@
 #ifdef FAST_ALAW_CONVERSION
 extern uint8_t _st_13linear2alaw[0x2000];
 extern int16_t _st_alaw2linear16[256];
-#define st_13linear2alaw(sw) (_st_13linear2alaw[(sw + 0x1000)])
+#define st_13linear2alaw(sw) (_st_13linear2alaw[((sw) + 0x1000)])
 #define st_alaw2linear16(uc) (_st_alaw2linear16[uc])
 #else
 unsigned char st_13linear2alaw(int16_t pcm_val); /*  REGPARM(1); */
@@ -28,11 +28,16 @@ int16_t st_alaw2linear16(unsigned char); /*  REGPARM(1); */
 #ifdef FAST_ULAW_CONVERSION
 extern uint8_t _st_14linear2ulaw[0x4000];
 extern int16_t _st_ulaw2linear16[256];
-#define st_14linear2ulaw(sw) (_st_14linear2ulaw[(sw + 0x2000)])
+#define st_14linear2ulaw(sw) (_st_14linear2ulaw[((sw) + 0x2000)])
 #define st_ulaw2linear16(uc) (_st_ulaw2linear16[uc])
 #else
 unsigned char st_14linear2ulaw(int16_t pcm_val); /*  REGPARM(1); */
 int16_t st_ulaw2linear16(unsigned char); /*  REGPARM(1); */
 #endif
 
+/* direct A-law <-> u-law conversion (same as via linear PCM) */
+extern uint8_t _st_alaw2ulaw[256];
+extern uint8_t _st_ulaw2alaw[256];
+#define st_alaw2ulaw(uc) (_st_alaw2ulaw[uc])
+#define st_ulaw2alaw(uc) (_st_ulaw2alaw[uc])
 
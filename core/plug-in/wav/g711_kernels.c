@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "g711_kernels.h"
+#include "g711.h"
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define G711_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* scalar: lookup tables */
+
+static void alaw_decode_scalar(int16_t* out, const uint8_t* in, unsigned int n)
+{
+  const uint8_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_alaw2linear16(*(in++));
+}
+
+static void ulaw_decode_scalar(int16_t* out, const uint8_t* in, unsigned int n)
+{
+  const uint8_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_ulaw2linear16(*(in++));
+}
+
+static void alaw_encode_scalar(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  const int16_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_13linear2alaw(*(in++) >> 3);
+}
+
+static void ulaw_encode_scalar(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  const int16_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_14linear2ulaw(*(in++) >> 2);
+}
+
+static void alaw2ulaw_scalar(uint8_t* out, const uint8_t* in, unsigned int n)
+{
+  const uint8_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_alaw2ulaw(*(in++));
+}
+
+static void ulaw2alaw_scalar(uint8_t* out, const uint8_t* in, unsigned int n)
+{
+  const uint8_t* end = in + n;
+
+  while(in != end)
+    *(out++) = st_ulaw2alaw(*(in++));
+}
+
+static const struct g711_kernels scalar_kernels = {
+  "scalar",
+  alaw_decode_scalar, ulaw_decode_scalar,
+  alaw_encode_scalar, ulaw_encode_scalar,
+  alaw2ulaw_scalar, ulaw2alaw_scalar
+};
+
+#ifdef G711_KERNELS_X86
+
+/*
+ * The SIMD variants work on 32 bit lanes. Encoding takes the segment
+ * from the exponent of the (biased) magnitude converted to float: the
+ * segment is the position of the leading one, and the four bits below
+ * it, which make the quantization field, are the top of the float
+ * mantissa. Decoding shifts by the segment. All conversions are exact.
+ *
+ * A-law <-> u-law conversion stays table driven; AVX2 looks up 32
+ * bytes at a time with the byte shuffle, 16 table entries per row.
+ */
+
+#define ALAW_EXP_BIAS ((127 + 4) << 4)
+#define ULAW_EXP_BIAS ((127 + 5) << 4)
+
+/* SSE2: 16 samples per step; decoding is not faster than the table */
+
+__attribute__((target("sse2")))
+static inline __m128i alaw_encode4_sse2(__m128i s)
+{
+  __m128i v   = _mm_srai_epi32(s, 3);
+  __m128i neg = _mm_srai_epi32(v, 31);
+  v = _mm_xor_si128(v, neg); // -v - 1 if negative
+
+  // segment 0 is coded like segment 1, minus the segment bit
+  __m128i seg0 = _mm_cmplt_epi32(v, _mm_set1_epi32(0x20));
+  v = _mm_add_epi32(v, _mm_and_si128(seg0, _mm_set1_epi32(0x20)));
+
+  __m128i a = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(_mm_cvtepi32_ps(v)), 19),
+			    _mm_set1_epi32(ALAW_EXP_BIAS));
+  a = _mm_sub_epi32(a, _mm_and_si128(seg0, _mm_set1_epi32(0x10)));
+
+  return _mm_xor_si128(a, _mm_xor_si128(_mm_set1_epi32(0xD5),
+					_mm_and_si128(neg, _mm_set1_epi32(0x80))));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i ulaw_encode4_sse2(__m128i s)
+{
+  __m128i v   = _mm_srai_epi32(s, 2);
+  __m128i neg = _mm_srai_epi32(v, 31);
+  v = _mm_sub_epi32(_mm_xor_si128(v, neg), neg);
+
+  // bias, clip to the top of segment 7
+  v = _mm_add_epi32(v, _mm_set1_epi32(0x84 >> 2));
+  __m128i clip = _mm_cmpgt_epi32(v, _mm_set1_epi32(0x1FFF));
+  v = _mm_or_si128(_mm_andnot_si128(clip, v), _mm_and_si128(clip, _mm_set1_epi32(0x1FFF)));
+
+  __m128i u = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(_mm_cvtepi32_ps(v)), 19),
+			    _mm_set1_epi32(ULAW_EXP_BIAS));
+
+  return _mm_xor_si128(u, _mm_xor_si128(_mm_set1_epi32(0xFF),
+					_mm_and_si128(neg, _mm_set1_epi32(0x80))));
+}
+
+__attribute__((target("sse2")))
+static inline void encode_sse2(uint8_t* out, const int16_t* in, unsigned int n, int alaw)
+{
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i s0 = _mm_loadu_si128((const __m128i*)(in + i));
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(in + i + 8));
+    // sign extension without SSE4.1 pmovsxwd
+    __m128i e[4] = {
+      _mm_srai_epi32(_mm_unpacklo_epi16(s0, s0), 16), _mm_srai_epi32(_mm_unpackhi_epi16(s0, s0), 16),
+      _mm_srai_epi32(_mm_unpacklo_epi16(s1, s1), 16), _mm_srai_epi32(_mm_unpackhi_epi16(s1, s1), 16)
+    };
+    int k;
+    for (k = 0; k < 4; k++)
+      e[k] = alaw ? alaw_encode4_sse2(e[k]) : ulaw_encode4_sse2(e[k]);
+
+    _mm_storeu_si128((__m128i*)(out + i),
+		     _mm_packus_epi16(_mm_packs_epi32(e[0], e[1]), _mm_packs_epi32(e[2], e[3])));
+  }
+
+  if (alaw)
+    alaw_encode_scalar(out + i, in + i, n - i);
+  else
+    ulaw_encode_scalar(out + i, in + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void alaw_encode_sse2(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  encode_sse2(out, in, n, 1);
+}
+
+__attribute__((target("sse2")))
+static void ulaw_encode_sse2(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  encode_sse2(out, in, n, 0);
+}
+
+static const struct g711_kernels sse2_kernels = {
+  "sse2",
+  alaw_decode_scalar, ulaw_decode_scalar,
+  alaw_encode_sse2, ulaw_encode_sse2,
+  alaw2ulaw_scalar, ulaw2alaw_scalar
+};
+
+/* AVX2: 16 samples per step, in 8 x 32 bit lanes */
+
+__attribute__((target("avx2")))
+static inline __m256i alaw_decode8_avx2(__m256i a)
+{
+  a = _mm256_xor_si256(a, _mm256_set1_epi32(0x55));
+
+  __m256i seg  = _mm256_and_si256(_mm256_srli_epi32(a, 4), _mm256_set1_epi32(7));
+  __m256i seg0 = _mm256_cmpeq_epi32(seg, _mm256_setzero_si256());
+
+  __m256i t = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0xF)), 4),
+			       _mm256_add_epi32(_mm256_set1_epi32(0x108),
+						_mm256_and_si256(seg0, _mm256_set1_epi32(8 - 0x108))));
+
+  __m256i shift = _mm256_sub_epi32(_mm256_sub_epi32(seg, _mm256_set1_epi32(1)), seg0);
+  t = _mm256_sllv_epi32(t, shift);
+
+  __m256i neg = _mm256_cmpeq_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0x80)),
+				   _mm256_setzero_si256());
+  return _mm256_sub_epi32(_mm256_xor_si256(t, neg), neg);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ulaw_decode8_avx2(__m256i u)
+{
+  u = _mm256_xor_si256(u, _mm256_set1_epi32(0xFF));
+
+  __m256i seg = _mm256_and_si256(_mm256_srli_epi32(u, 4), _mm256_set1_epi32(7));
+  __m256i t = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(u, _mm256_set1_epi32(0xF)), 3),
+			       _mm256_set1_epi32(0x84));
+  t = _mm256_sub_epi32(_mm256_sllv_epi32(t, seg), _mm256_set1_epi32(0x84));
+
+  __m256i neg = _mm256_cmpeq_epi32(_mm256_and_si256(u, _mm256_set1_epi32(0x80)),
+				   _mm256_set1_epi32(0x80));
+  return _mm256_sub_epi32(_mm256_xor_si256(t, neg), neg);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alaw_encode8_avx2(__m256i s)
+{
+  __m256i v   = _mm256_srai_epi32(s, 3);
+  __m256i neg = _mm256_srai_epi32(v, 31);
+  v = _mm256_xor_si256(v, neg);
+
+  __m256i seg0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x20), v);
+  v = _mm256_add_epi32(v, _mm256_and_si256(seg0, _mm256_set1_epi32(0x20)));
+
+  __m256i a = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(v)), 19),
+			       _mm256_set1_epi32(ALAW_EXP_BIAS));
+  a = _mm256_sub_epi32(a, _mm256_and_si256(seg0, _mm256_set1_epi32(0x10)));
+
+  return _mm256_xor_si256(a, _mm256_xor_si256(_mm256_set1_epi32(0xD5),
+					      _mm256_and_si256(neg, _mm256_set1_epi32(0x80))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ulaw_encode8_avx2(__m256i s)
+{
+  __m256i v   = _mm256_srai_epi32(s, 2);
+  __m256i neg = _mm256_srai_epi32(v, 31);
+  v = _mm256_abs_epi32(v);
+
+  v = _mm256_min_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(0x84 >> 2)),
+		       _mm256_set1_epi32(0x1FFF));
+
+  __m256i u = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(v)), 19),
+			       _mm256_set1_epi32(ULAW_EXP_BIAS));
+
+  return _mm256_xor_si256(u, _mm256_xor_si256(_mm256_set1_epi32(0xFF),
+					      _mm256_and_si256(neg, _mm256_set1_epi32(0x80))));
+}
+
+__attribute__((target("avx2")))
+static inline void decode_avx2(int16_t* out, const uint8_t* in, unsigned int n, int alaw)
+{
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+    __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i + 8)));
+    if (alaw) {
+      a = alaw_decode8_avx2(a);
+      b = alaw_decode8_avx2(b);
+    } else {
+      a = ulaw_decode8_avx2(a);
+      b = ulaw_decode8_avx2(b);
+    }
+    // packs works per 128 bit lane: restore sample order
+    _mm256_storeu_si256((__m256i*)(out + i),
+			_mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3,1,2,0)));
+  }
+
+  if (alaw)
+    alaw_decode_scalar(out + i, in + i, n - i);
+  else
+    ulaw_decode_scalar(out + i, in + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline void encode_avx2(uint8_t* out, const int16_t* in, unsigned int n, int alaw)
+{
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+    __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+    if (alaw) {
+      a = alaw_encode8_avx2(a);
+      b = alaw_encode8_avx2(b);
+    } else {
+      a = ulaw_encode8_avx2(a);
+      b = ulaw_encode8_avx2(b);
+    }
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3,1,2,0));
+    _mm_storeu_si128((__m128i*)(out + i),
+		     _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1)));
+  }
+
+  if (alaw)
+    alaw_encode_scalar(out + i, in + i, n - i);
+  else
+    ulaw_encode_scalar(out + i, in + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void alaw_decode_avx2(int16_t* out, const uint8_t* in, unsigned int n)
+{
+  decode_avx2(out, in, n, 1);
+}
+
+__attribute__((target("avx2")))
+static void ulaw_decode_avx2(int16_t* out, const uint8_t* in, unsigned int n)
+{
+  decode_avx2(out, in, n, 0);
+}
+
+__attribute__((target("avx2")))
+static void alaw_encode_avx2(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  encode_avx2(out, in, n, 1);
+}
+
+__attribute__((target("avx2")))
+static void ulaw_encode_avx2(uint8_t* out, const int16_t* in, unsigned int n)
+{
+  encode_avx2(out, in, n, 0);
+}
+
+__attribute__((target("avx2")))
+static inline void lookup_avx2(uint8_t* out, const uint8_t* in, unsigned int n,
+			       const uint8_t* table)
+{
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i rows[16];
+  int k;
+
+  for (k = 0; k < 16; k++)
+    rows[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(table + 16 * k)));
+
+  unsigned int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x  = _mm256_loadu_si256((const __m256i*)(in + i));
+    __m256i lo = _mm256_and_si256(x, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+    __m256i r  = _mm256_setzero_si256();
+
+    for (k = 0; k < 16; k++) {
+      __m256i row = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(k));
+      r = _mm256_or_si256(r, _mm256_and_si256(row, _mm256_shuffle_epi8(rows[k], lo)));
+    }
+    _mm256_storeu_si256((__m256i*)(out + i), r);
+  }
+
+  for (; i < n; i++)
+    out[i] = table[in[i]];
+}
+
+__attribute__((target("avx2")))
+static void alaw2ulaw_avx2(uint8_t* out, const uint8_t* in, unsigned int n)
+{
+  lookup_avx2(out, in, n, _st_alaw2ulaw);
+}
+
+__attribute__((target("avx2")))
+static void ulaw2alaw_avx2(uint8_t* out, const uint8_t* in, unsigned int n)
+{
+  lookup_avx2(out, in, n, _st_ulaw2alaw);
+}
+
+static const struct g711_kernels avx2_kernels = {
+  "avx2",
+  alaw_decode_avx2, ulaw_decode_avx2,
+  alaw_encode_avx2, ulaw_encode_avx2,
+  alaw2ulaw_avx2, ulaw2alaw_avx2
+};
+
+#endif /* G711_KERNELS_X86 */
+
+const struct g711_kernels* g711_kernels_scalar(void)
+{
+  return &scalar_kernels;
+}
+
+const struct g711_kernels* g711_kernels_sse2(void)
+{
+#ifdef G711_KERNELS_X86
+  if (__builtin_cpu_supports("sse2"))
+    return &sse2_kernels;
+#endif
+  return NULL;
+}
+
+const struct g711_kernels* g711_kernels_avx2(void)
+{
+#ifdef G711_KERNELS_X86
+  if (__builtin_cpu_supports("avx2"))
+    return &avx2_kernels;
+#endif
+  return NULL;
+}
+
+const struct g711_kernels* g711_kernels_get(void)
+{
+  static const struct g711_kernels* kernels = NULL;
+
+  if (!kernels) {
+    const struct g711_kernels* k = g711_kernels_avx2();
+    if (!k)
+      k = g711_kernels_sse2();
+    if (!k)
+      k = g711_kernels_scalar();
+    kernels = k;
+  }
+  return kernels;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/** @file g711_kernels.h */
+#ifndef _g711_kernels_h_
+#define _g711_kernels_h_
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief buffer conversion kernels of the G.711 codecs
+ *
+ * Scalar (lookup table), SSE2 and AVX2 variants. The best variant
+ * supported by the CPU is selected at runtime (g711_kernels_get());
+ * all variants produce the same output as the tables in g711.c.
+ */
+struct g711_kernels
+{
+  const char* name;
+
+  /** n A-law / u-law bytes -> n PCM16 samples */
+  void (*alaw_decode)(int16_t* out, const uint8_t* in, unsigned int n);
+  void (*ulaw_decode)(int16_t* out, const uint8_t* in, unsigned int n);
+
+  /** n PCM16 samples -> n A-law / u-law bytes */
+  void (*alaw_encode)(uint8_t* out, const int16_t* in, unsigned int n);
+  void (*ulaw_encode)(uint8_t* out, const int16_t* in, unsigned int n);
+
+  /** direct A-law <-> u-law, same as decoding and encoding again */
+  void (*alaw2ulaw)(uint8_t* out, const uint8_t* in, unsigned int n);
+  void (*ulaw2alaw)(uint8_t* out, const uint8_t* in, unsigned int n);
+};
+
+/** @return the best kernels for this CPU */
+const struct g711_kernels* g711_kernels_get(void);
+
+const struct g711_kernels* g711_kernels_scalar(void);
+/** @return NULL if not supported by CPU or build */
+const struct g711_kernels* g711_kernels_sse2(void);
+const struct g711_kernels* g711_kernels_avx2(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
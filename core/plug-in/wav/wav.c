@@ -28,6 +28,7 @@
 #include "amci.h"
 #include "codecs.h"
 #include "g711.h"
+#include "g711_kernels.h"
 #include "wav_hdr.h"
 #include "../../log.h"
 
@@ -92,7 +93,9 @@ static int Pcm16_2_ALaw( unsigned char* out_buf, unsigned char* in_buf, unsigned
 static unsigned int g711_bytes2samples(long, unsigned int);
 static unsigned int g711_samples2bytes(long, unsigned int);
 
-BEGIN_EXPORTS( "wav" , AMCI_NO_MODULEINIT, AMCI_NO_MODULEDESTROY )
+static int wav_load(const char* ModConfigPath);
+
+BEGIN_EXPORTS( "wav" , wav_load, AMCI_NO_MODULEDESTROY )
 
      BEGIN_CODECS
       CODEC( CODEC_ULAW, Pcm16_2_ULaw, ULaw_2_Pcm16,
@@ -120,6 +123,16 @@ BEGIN_EXPORTS( "wav" , AMCI_NO_MODULEINIT, AMCI_NO_MODULEDESTROY )
 
 END_EXPORTS
 
+/** G.711 conversion kernels for this CPU */
+static const struct g711_kernels* g711 = NULL;
+
+static int wav_load(const char* ModConfigPath)
+{
+  g711 = g711_kernels_get();
+  DBG("using %s G.711 kernels\n", g711->name);
+  return 0;
+}
+
 static unsigned int g711_bytes2samples(long h_codec, unsigned int num_bytes)
 {
   /* ALAW and ULAW formats has one sample per byte */
@@ -135,59 +148,28 @@ static unsigned int g711_samples2bytes(long h_codec, unsigned int num_samples)
 static int ULaw_2_Pcm16( unsigned char* out_buf, unsigned char* in_buf, unsigned int size,
 			 unsigned int channels, unsigned int rate, long h_codec )
 {
-  unsigned short* out_b = (unsigned short*)out_buf;
-  unsigned char*  in_b  = in_buf;
-  unsigned char*  end   = in_b + size;
-
-  while(in_b != end){
-    //	int i = st_ulaw2linear16(*(in_b++));
-    //	*(out_b++) = i;
-    *(out_b++) = st_ulaw2linear16(*(in_b++));
-  }
+  g711->ulaw_decode((int16_t*)out_buf, in_buf, size);
   return size*2;
 }
 
 static int ALaw_2_Pcm16( unsigned char* out_buf, unsigned char* in_buf, unsigned int size,
 			 unsigned int channels, unsigned int rate, long h_codec )
 {
-  unsigned short* out_b = (unsigned short*)out_buf;
-  unsigned char*  in_b  = in_buf;
-  unsigned char*  end   = in_b + size;
-
-  while(in_b != end){
-    //	int i = st_alaw2linear16(*(in_b++));
-    //	*(out_b++) = i;
-    *(out_b++) = st_alaw2linear16(*(in_b++));
-  }
+  g711->alaw_decode((int16_t*)out_buf, in_buf, size);
   return size*2;
 }
 
 int Pcm16_2_ULaw( unsigned char* out_buf, unsigned char* in_buf, unsigned int size,
 		  unsigned int channels, unsigned int rate, long h_codec )
 {
-  unsigned char* out_b = out_buf;
-  short* in_b          = (short*)(in_buf);
-  short* end           = (short*)((unsigned char*)in_buf + size);
-
-  while(in_b != end){
-    short s = *(in_b++) >> 2;
-    *(out_b++) = st_14linear2ulaw(s);
-  }
+  g711->ulaw_encode(out_buf, (int16_t*)in_buf, size/2);
   return size/2;
 }
 
 int Pcm16_2_ALaw( unsigned char* out_buf, unsigned char* in_buf, unsigned int size,
 		  unsigned int channels, unsigned int rate, long h_codec )
 {
-  unsigned char* out_b = out_buf;
-  short* in_b          = (short*)(in_buf);
-  short* end           = (short*)((unsigned char*)in_buf + size);
-
-  while(in_b != end){
-    short s = (*(in_b++)) >> 3;
-    *(out_b++) = st_13linear2alaw(s);
-  }
-
+  g711->alaw_encode(out_buf, (int16_t*)in_buf, size/2);
   return size/2;
 }
 
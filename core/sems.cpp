@@ -33,6 +33,7 @@
 #include "AmMediaProcessor.h"
 #include "AmRtpReceiver.h"
 #include "AmEventDispatcher.h"
+#include "AmEncodedPromptCache.h"
 #include "AmSessionProcessor.h"
 #include "AmAppTimer.h"
 #include "SdNotify.h"
@@ -580,6 +581,10 @@ int main(int argc, char* argv[])
 
 #endif /* DISABLE_DAEMON_MODE */
 
+  // the writer thread has to be started after forking
+  if (AmConfig::LogAsync)
+    start_async_logging(AmConfig::LogRingSize);
+
   main_pid = getpid();
 
   init_random();
@@ -608,6 +613,9 @@ int main(int argc, char* argv[])
   INFO("Starting media processor\n");
   AmMediaProcessor::instance()->init();
 
+  // before any call plays a prompt
+  AmEncodedPromptCache::instance();
+
   // init thread usage with libevent
   // before it's too late
   if(evthread_use_pthreads() != 0) {
@@ -676,6 +684,9 @@ int main(int argc, char* argv[])
   INFO("Disposing event dispatcher\n");
   AmEventDispatcher::dispose();
 
+  // before the codecs are unloaded
+  AmEncodedPromptCache::dispose();
+
  error:
 
   sd.stopping();
@@ -685,6 +696,9 @@ int main(int argc, char* argv[])
   AmSessionProcessor::stopThreads();
 #endif
 
+  // logging facilities may come from plug-ins
+  stop_async_logging();
+
   INFO("Disposing plug-ins\n");
   AmPlugIn::dispose();
 
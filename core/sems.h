@@ -63,6 +63,8 @@
 #define NUM_MEDIA_PROCESSORS 1
 // number of RTP receiver threads
 #define NUM_RTP_RECEIVERS 1
+// free RTP packets kept per size class by the packet pool
+#define RTP_PACKET_POOL_SPILL 4096
 // number of SIP servers to start
 #define NUM_SIP_SERVERS 4
 
@@ -0,0 +1,573 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "dns_client.h"
+#include "ip_util.h"
+
+#include "AmUtils.h"
+#include "log.h"
+
+#include <netdb.h>
+#include <resolv.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* DNS header: id, flags, 4 section counts */
+#define DNS_HDR_LEN     12
+#define DNS_FLAG_QR     0x80 /* in byte 2 */
+#define DNS_FLAG_TC     0x02 /* in byte 2 */
+#define DNS_FLAG_RD     0x01 /* in byte 2 */
+
+/* largest answer over UDP (without EDNS0, it should be 512) */
+#define DNS_UDP_BUF     4096
+
+static int dns_build_query(string& pkt, uint16_t id,
+			   const string& name, dns_rr_type t)
+{
+    pkt.clear();
+    pkt.reserve(DNS_HDR_LEN + name.length() + 6);
+
+    const char hdr[DNS_HDR_LEN] = {
+	(char)(id >> 8), (char)(id & 0xff),
+	DNS_FLAG_RD, 0,
+	0, 1, // QDCOUNT
+	0, 0, 0, 0, 0, 0
+    };
+    pkt.append(hdr, DNS_HDR_LEN);
+
+    size_t b = 0;
+    while(b < name.length()) {
+	size_t e = name.find('.', b);
+	if(e == string::npos) e = name.length();
+
+	size_t l = e - b;
+	if(!l || (l > 63)) return -1;
+
+	pkt += (char)l;
+	pkt.append(name, b, l);
+	b = e + 1;
+    }
+    pkt += '\0';
+
+    if(pkt.length() - DNS_HDR_LEN > NS_MAXCDNAME)
+	return -1;
+
+    pkt += (char)(t >> 8);
+    pkt += (char)(t & 0xff);
+    pkt += (char)0;
+    pkt += (char)ns_c_in;
+
+    return 0;
+}
+
+static bool sa_equal(const sockaddr_storage* a, const sockaddr_storage* b)
+{
+    if(a->ss_family != b->ss_family)
+	return false;
+
+    if(a->ss_family == AF_INET) {
+	return (SAv4(a)->sin_addr.s_addr == SAv4(b)->sin_addr.s_addr) &&
+	    (SAv4(a)->sin_port == SAv4(b)->sin_port);
+    }
+
+    return !memcmp(&SAv6(a)->sin6_addr, &SAv6(b)->sin6_addr,
+		   sizeof(in6_addr)) &&
+	(SAv6(a)->sin6_port == SAv6(b)->sin6_port);
+}
+
+dns_client::dns_query::dns_query()
+    : cl(NULL), id(0), type(dns_r_a), attempt(0),
+      timer(NULL), tcp_sd(-1), tcp_ev(NULL)
+{}
+
+dns_client::dns_query::~dns_query()
+{
+    if(timer) event_free(timer);
+    if(tcp_ev) event_free(tcp_ev);
+    if(tcp_sd >= 0) close(tcp_sd);
+}
+
+dns_client::dns_client()
+    : evbase(NULL), timeout(2000), attempts(2),
+      sd4(-1), sd6(-1), ev4(NULL), ev6(NULL),
+      rnd(std::random_device()())
+{}
+
+dns_client::~dns_client()
+{
+    for(map<uint16_t, dns_query*>::iterator it = queries.begin();
+	it != queries.end(); ++it) {
+	delete it->second;
+    }
+
+    if(ev4) event_free(ev4);
+    if(ev6) event_free(ev6);
+    if(sd4 >= 0) close(sd4);
+    if(sd6 >= 0) close(sd6);
+}
+
+int dns_client::init(struct event_base* evbase,
+		     const vector<sockaddr_storage>& servers,
+		     unsigned int timeout, unsigned int attempts)
+{
+    this->evbase = evbase;
+    this->servers = servers;
+    this->timeout = timeout ? timeout : 1;
+    this->attempts = attempts ? attempts : 1;
+
+    if(this->servers.empty()) {
+	sockaddr_storage sa;
+	memset(&sa, 0, sizeof(sa));
+	am_inet_pton("127.0.0.1", &sa);
+	am_set_port(&sa, NS_DEFAULTPORT);
+	this->servers.push_back(sa);
+    }
+
+    for(vector<sockaddr_storage>::iterator it = this->servers.begin();
+	it != this->servers.end(); ++it) {
+
+	int err = (it->ss_family == AF_INET) ?
+	    open_socket(AF_INET, sd4, ev4) :
+	    open_socket(AF_INET6, sd6, ev6);
+
+	if(err < 0) return -1;
+	DBG("DNS server: %s:%u\n", am_inet_ntop(&(*it)).c_str(),
+	    am_get_port(&(*it)));
+    }
+
+    return 0;
+}
+
+int dns_client::open_socket(int family, int& sd, struct event*& ev)
+{
+    if(sd >= 0)
+	return 0;
+
+    sd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(sd < 0) {
+	ERROR("socket(): %s\n", strerror(errno));
+	return -1;
+    }
+
+    ev = event_new(evbase, sd, EV_READ | EV_PERSIST, udp_read_cb, this);
+    event_add(ev, NULL);
+
+    return 0;
+}
+
+unsigned int dns_client::max_duration() const
+{
+    return timeout * attempts * servers.size();
+}
+
+const sockaddr_storage& dns_client::server(const dns_query* q) const
+{
+    return servers[q->attempt % servers.size()];
+}
+
+void dns_client::query(const string& name, dns_rr_type t, const reply_cb& cb)
+{
+    string qname = name;
+    if(!qname.empty() && (qname[qname.length()-1] == '.'))
+	qname.resize(qname.length()-1);
+
+    uint16_t id;
+    do {
+	id = rnd() & 0xffff;
+    } while(queries.find(id) != queries.end());
+
+    dns_query* q = new dns_query();
+    if(dns_build_query(q->pkt, id, qname, t) < 0) {
+	DBG("invalid DNS name '%s'\n", name.c_str());
+	delete q;
+	cb(NO_RECOVERY, NULL, 0);
+	return;
+    }
+
+    q->cl = this;
+    q->id = id;
+    q->name = qname;
+    q->type = t;
+    q->cb = cb;
+    q->timer = evtimer_new(evbase, timer_cb, q);
+
+    queries[id] = q;
+    send_udp(q);
+}
+
+void dns_client::send_udp(dns_query* q)
+{
+    const sockaddr_storage& sa = server(q);
+    int sd = (sa.ss_family == AF_INET) ? sd4 : sd6;
+
+    DBG("sending DNS query #%u for '%s' (%s) to %s:%u (attempt %u)\n",
+	q->id, q->name.c_str(), dns_rr_type_str(q->type),
+	am_inet_ntop(&sa).c_str(), am_get_port(&sa), q->attempt + 1);
+
+    if(sendto(sd, q->pkt.data(), q->pkt.length(), 0,
+	      (const sockaddr*)&sa, SA_len(&sa)) < 0) {
+	DBG("sendto(): %s\n", strerror(errno));
+	next_attempt(q);
+	return;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    evtimer_add(q->timer, &tv);
+}
+
+void dns_client::next_attempt(dns_query* q)
+{
+    if(q->tcp_ev) {
+	event_free(q->tcp_ev);
+	q->tcp_ev = NULL;
+    }
+    if(q->tcp_sd >= 0) {
+	close(q->tcp_sd);
+	q->tcp_sd = -1;
+    }
+
+    if(++q->attempt >= attempts * servers.size()) {
+	DBG("no answer for '%s' (%s)\n", q->name.c_str(),
+	    dns_rr_type_str(q->type));
+	finish(q, TRY_AGAIN, NULL, 0);
+	return;
+    }
+
+    send_udp(q);
+}
+
+void dns_client::finish(dns_query* q, int err, u_char* msg, int len)
+{
+    // msg may point into q (TCP)
+    queries.erase(q->id);
+    evtimer_del(q->timer);
+    q->cb(err, msg, len);
+    delete q;
+}
+
+bool dns_client::matches(const dns_query* q, u_char* msg, int len)
+{
+    if(len < DNS_HDR_LEN)
+	return false;
+
+    if(!(msg[2] & DNS_FLAG_QR) || (dns_get_16(msg) != q->id))
+	return false;
+
+    // question section must be the one we sent
+    if(dns_get_16(msg + 4) != 1)
+	return false;
+
+    u_char name[NS_MAXDNAME];
+    u_char* p = msg + DNS_HDR_LEN;
+    u_char* end = msg + len;
+    if(dns_expand_name(&p, msg, end, name, NS_MAXDNAME) < 0)
+	return false;
+
+    if((p + 4 > end) || (dns_get_16(p) != q->type) ||
+       strcasecmp((const char*)name, q->name.c_str()))
+	return false;
+
+    return true;
+}
+
+void dns_client::handle_answer(dns_query* q, u_char* msg, int len, bool tcp)
+{
+    evtimer_del(q->timer);
+
+    switch(msg[3] & 0x0f) {
+    case ns_r_noerror:
+	if(!tcp && (msg[2] & DNS_FLAG_TC)) {
+	    DBG("truncated answer for '%s', retrying over TCP\n",
+		q->name.c_str());
+	    start_tcp(q);
+	    return;
+	}
+	if(!dns_get_16(msg + 6)) {
+	    finish(q, NO_DATA, NULL, 0);
+	    return;
+	}
+	finish(q, 0, msg, len);
+	return;
+
+    case ns_r_nxdomain:
+	finish(q, HOST_NOT_FOUND, NULL, 0);
+	return;
+
+    case ns_r_servfail:
+    case ns_r_refused:
+	DBG("DNS server failure (rcode=%i) for '%s'\n",
+	    msg[3] & 0x0f, q->name.c_str());
+	next_attempt(q);
+	return;
+
+    default:
+	finish(q, NO_RECOVERY, NULL, 0);
+	return;
+    }
+}
+
+void dns_client::on_udp_read(int sd)
+{
+    u_char buf[DNS_UDP_BUF];
+    sockaddr_storage from;
+
+    for(;;) {
+	socklen_t from_len = sizeof(from);
+	int len = recvfrom(sd, buf, sizeof(buf), 0,
+			   (sockaddr*)&from, &from_len);
+	if(len < 0) {
+	    if((errno != EAGAIN) && (errno != EWOULDBLOCK))
+		DBG("recvfrom(): %s\n", strerror(errno));
+	    return;
+	}
+
+	if(len < DNS_HDR_LEN)
+	    continue;
+
+	map<uint16_t, dns_query*>::iterator it = queries.find(dns_get_16(buf));
+	if(it == queries.end())
+	    continue;
+
+	dns_query* q = it->second;
+	if(q->tcp_sd >= 0)
+	    continue;
+
+	bool known = false;
+	for(vector<sockaddr_storage>::const_iterator s_it = servers.begin();
+	    s_it != servers.end(); ++s_it) {
+	    if(sa_equal(&(*s_it), &from)) {
+		known = true;
+		break;
+	    }
+	}
+
+	if(!known || !matches(q, buf, len)) {
+	    DBG("dropping unexpected DNS answer from %s:%u\n",
+		am_inet_ntop(&from).c_str(), am_get_port(&from));
+	    continue;
+	}
+
+	handle_answer(q, buf, len, false);
+    }
+}
+
+void dns_client::start_tcp(dns_query* q)
+{
+    const sockaddr_storage& sa = server(q);
+
+    q->tcp_sd = socket(sa.ss_family,
+		       SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(q->tcp_sd < 0) {
+	ERROR("socket(): %s\n", strerror(errno));
+	next_attempt(q);
+	return;
+    }
+
+    if((connect(q->tcp_sd, (const sockaddr*)&sa, SA_len(&sa)) < 0) &&
+       (errno != EINPROGRESS)) {
+	DBG("connect(): %s\n", strerror(errno));
+	next_attempt(q);
+	return;
+    }
+
+    q->tcp_buf.clear();
+    q->tcp_ev = event_new(evbase, q->tcp_sd, EV_WRITE, tcp_cb, q);
+    event_add(q->tcp_ev, NULL);
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    evtimer_add(q->timer, &tv);
+}
+
+void dns_client::on_tcp_event(dns_query* q, short what)
+{
+    if(what & EV_WRITE) {
+	// connected (or not)
+	int err = 0;
+	socklen_t err_len = sizeof(err);
+	getsockopt(q->tcp_sd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+
+	string out;
+	out += (char)(q->pkt.length() >> 8);
+	out += (char)(q->pkt.length() & 0xff);
+	out += q->pkt;
+
+	if(err || (send(q->tcp_sd, out.data(), out.length(), MSG_NOSIGNAL)
+		   != (ssize_t)out.length())) {
+	    DBG("DNS over TCP failed: %s\n", strerror(err ? err : errno));
+	    next_attempt(q);
+	    return;
+	}
+
+	event_free(q->tcp_ev);
+	q->tcp_ev = event_new(evbase, q->tcp_sd, EV_READ | EV_PERSIST, tcp_cb, q);
+	event_add(q->tcp_ev, NULL);
+	return;
+    }
+
+    char buf[DNS_UDP_BUF];
+    ssize_t len = recv(q->tcp_sd, buf, sizeof(buf), 0);
+    if(len < 0) {
+	if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+	    return;
+	DBG("recv(): %s\n", strerror(errno));
+	next_attempt(q);
+	return;
+    }
+    if(len == 0) {
+	DBG("DNS server closed the TCP connection\n");
+	next_attempt(q);
+	return;
+    }
+
+    q->tcp_buf.append(buf, len);
+    if(q->tcp_buf.length() < 2)
+	return;
+
+    size_t msg_len = dns_get_16((const u_char*)q->tcp_buf.data());
+    if(q->tcp_buf.length() < msg_len + 2)
+	return;
+
+    u_char* msg = (u_char*)&q->tcp_buf[2];
+    if(!matches(q, msg, msg_len)) {
+	DBG("unexpected DNS answer over TCP\n");
+	next_attempt(q);
+	return;
+    }
+
+    handle_answer(q, msg, msg_len, true);
+}
+
+void dns_client::udp_read_cb(evutil_socket_t sd, short what, void* arg)
+{
+    ((dns_client*)arg)->on_udp_read(sd);
+}
+
+void dns_client::timer_cb(evutil_socket_t sd, short what, void* arg)
+{
+    dns_query* q = (dns_query*)arg;
+    DBG("DNS query #%u for '%s' timed out\n", q->id, q->name.c_str());
+    q->cl->next_attempt(q);
+}
+
+void dns_client::tcp_cb(evutil_socket_t sd, short what, void* arg)
+{
+    dns_query* q = (dns_query*)arg;
+    q->cl->on_tcp_event(q, what);
+}
+
+int dns_client::parse_servers(const string& list,
+			      vector<sockaddr_storage>& servers)
+{
+    servers.clear();
+
+    if(list.empty()) {
+	struct __res_state res;
+	memset(&res, 0, sizeof(res));
+	if(res_ninit(&res) < 0) {
+	    ERROR("could not read the resolver configuration\n");
+	    return -1;
+	}
+
+	for(int i = 0; i < res.nscount; i++) {
+	    sockaddr_storage sa;
+	    memset(&sa, 0, sizeof(sa));
+#ifdef __GLIBC__
+	    if(res._u._ext.nsaddrs[i]) {
+		memcpy(&sa, res._u._ext.nsaddrs[i], sizeof(sockaddr_in6));
+		servers.push_back(sa);
+		continue;
+	    }
+#endif
+	    if(res.nsaddr_list[i].sin_family != AF_INET)
+		continue;
+	    memcpy(&sa, &res.nsaddr_list[i], sizeof(sockaddr_in));
+	    servers.push_back(sa);
+	}
+
+	res_nclose(&res);
+	return 0;
+    }
+
+    vector<string> items = explode(list, ",");
+    for(vector<string>::iterator it = items.begin(); it != items.end(); ++it) {
+
+	string s = trim(*it, " \t");
+	if(s.empty()) continue;
+
+	string ip = s;
+	unsigned int port = NS_DEFAULTPORT;
+
+	size_t c;
+	if(s[0] == '[') {
+	    c = s.find(']');
+	    if(c == string::npos) {
+		ERROR("invalid DNS server '%s'\n", s.c_str());
+		return -1;
+	    }
+	    ip = s.substr(0, c+1);
+	    c = (c + 1 < s.length() && s[c+1] == ':') ? c + 1 : string::npos;
+	}
+	else {
+	    c = s.find(':');
+	    if(c != s.rfind(':')) // IPv6 without brackets
+		c = string::npos;
+	    if(c != string::npos)
+		ip = s.substr(0, c);
+	}
+
+	if((c != string::npos) &&
+	   (str2int(s.substr(c+1), port) || !port || (port > 65535))) {
+	    ERROR("invalid port in DNS server '%s'\n", s.c_str());
+	    return -1;
+	}
+
+	sockaddr_storage sa;
+	memset(&sa, 0, sizeof(sa));
+	if(am_inet_pton(ip.c_str(), &sa) != 1) {
+	    ERROR("invalid DNS server address '%s'\n", s.c_str());
+	    return -1;
+	}
+	am_set_port(&sa, port);
+	servers.push_back(sa);
+    }
+
+    return 0;
+}
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 Sipwise GmbH
+ *
+ * This file is part of SEMS, a free SIP media server.
+ *
+ * SEMS is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version. This program is released under
+ * the GPL with the additional exemption that compiling, linking,
+ * and/or using OpenSSL is allowed.
+ *
+ * For a license to use the SEMS software under conditions
+ * other than those described here, or to purchase support for this
+ * software, please contact iptel.org by e-mail at the following addresses:
+ *    info@iptel.org
+ *
+ * SEMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef _dns_client_h_
+#define _dns_client_h_
+
+#include "parse_dns.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <event2/event.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <random>
+using std::string;
+using std::vector;
+using std::map;
+
+/**
+ * Non-blocking DNS stub client: sends the queries over UDP to the
+ * configured name servers (TCP if the answer was truncated), retries
+ * on the next server on timeout or SERVFAIL and hands the raw answer
+ * to a callback.
+ *
+ * It runs on the event_base given to init(); all methods must be
+ * called from the thread dispatching that event_base.
+ */
+class dns_client
+{
+public:
+    /**
+     * @param err 0 on success, else HOST_NOT_FOUND, NO_DATA,
+     *            TRY_AGAIN or NO_RECOVERY (see netdb.h)
+     * @param msg answer (valid for the duration of the call only)
+     */
+    typedef std::function<void(int err, u_char* msg, int len)> reply_cb;
+
+    dns_client();
+    ~dns_client();
+
+    /**
+     * @param servers name servers, tried in turn
+     * @param timeout per attempt, in ms
+     * @param attempts number of times each server is tried
+     * @return 0 on success
+     */
+    int init(struct event_base* evbase,
+	     const vector<sockaddr_storage>& servers,
+	     unsigned int timeout, unsigned int attempts);
+
+    void query(const string& name, dns_rr_type t, const reply_cb& cb);
+
+    /** @return number of queries waiting for an answer */
+    size_t pending() const { return queries.size(); }
+
+    /** @return longest time a query can take, in ms */
+    unsigned int max_duration() const;
+
+    /**
+     * Parse a list of name servers ("ip[:port],...").
+     * An empty list means the name servers of /etc/resolv.conf.
+     */
+    static int parse_servers(const string& list,
+			     vector<sockaddr_storage>& servers);
+
+private:
+    struct dns_query
+    {
+	dns_client*   cl;
+	uint16_t      id;
+	string        name;
+	dns_rr_type   type;
+	string        pkt;
+	unsigned int  attempt;
+	reply_cb      cb;
+
+	struct event* timer;
+
+	// TCP fallback
+	int           tcp_sd;
+	struct event* tcp_ev;
+	string        tcp_buf;
+
+	dns_query();
+	~dns_query();
+    };
+
+    struct event_base*        evbase;
+    vector<sockaddr_storage>  servers;
+    unsigned int              timeout;
+    unsigned int              attempts;
+
+    int                       sd4;
+    int                       sd6;
+    struct event*             ev4;
+    struct event*             ev6;
+
+    map<uint16_t, dns_query*> queries;
+    std::mt19937              rnd;
+
+    const sockaddr_storage& server(const dns_query* q) const;
+
+    int open_socket(int family, int& sd, struct event*& ev);
+    void send_udp(dns_query* q);
+    void start_tcp(dns_query* q);
+    void next_attempt(dns_query* q);
+    void finish(dns_query* q, int err, u_char* msg, int len);
+
+    /** @return whether msg is an answer to q (id + question) */
+    bool matches(const dns_query* q, u_char* msg, int len);
+    void handle_answer(dns_query* q, u_char* msg, int len, bool tcp);
+
+    void on_udp_read(int sd);
+    void on_tcp_event(dns_query* q, short what);
+
+    static void udp_read_cb(evutil_socket_t sd, short what, void* arg);
+    static void timer_cb(evutil_socket_t sd, short what, void* arg);
+    static void tcp_cb(evutil_socket_t sd, short what, void* arg);
+};
+
+#endif
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-basic-offset: 4
+ * End:
+ */
@@ -28,6 +28,7 @@
  */
 
 #include "resolver.h"
+#include "dns_client.h"
 #include "hash.h"
 
 #include "parse_dns.h"
@@ -46,10 +47,17 @@
 #include <resolv.h>
 #include <arpa/inet.h>
 #include <arpa/nameser.h> 
+#include <unistd.h>
+#include <fcntl.h>
+#include <event2/event.h>
 
 #include <list>
 #include <utility>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 using std::pair;
 using std::make_pair;
@@ -70,6 +78,9 @@ using std::list;
 #define DNS_CACHE_SINGLE_CYCLE \
   ((DNS_CACHE_CYCLE*1000000L)/DNS_CACHE_SIZE)
 
+/* max. number of CNAMEs followed */
+#define DNS_MAX_CNAME_CHAIN 8
+
 struct srv_entry
     : public dns_base_entry
 {
@@ -287,7 +298,8 @@ public:
 };
 
 dns_entry::dns_entry()
-    : dns_base_entry()
+    : dns_base_entry(),
+      type(dns_r_a), created(0), hits(0)
 {
 }
 
@@ -303,17 +315,24 @@ dns_entry::~dns_entry()
 
 dns_entry* dns_entry::make_entry(dns_rr_type t)
 {
+    dns_entry* e;
     switch(t){
     case dns_r_srv:
-	return new dns_srv_entry();
+	e = new dns_srv_entry();
+	break;
     case dns_r_a:
-    //case dns_r_aaaa:
-	return new dns_ip_entry();
+    case dns_r_aaaa:
+	e = new dns_ip_entry();
+	break;
     case dns_r_naptr:
-	return new dns_naptr_entry();
+	e = new dns_naptr_entry();
+	break;
     default:
 	return NULL;
     }
+
+    e->type = t;
+    return e;
 }
 
 void dns_entry::add_rr(dns_record* rr, u_char* begin, u_char* end, long now)
@@ -366,6 +385,55 @@ bool dns_bucket::insert(const string& name, dns_entry* e)
     return true;
 }
 
+void dns_bucket::replace(const string& name, dns_entry* e)
+{
+    if(!e) return;
+
+    inc_ref(e);
+    lock();
+    value_map::iterator it = elmts.find(name);
+    if(it != elmts.end()){
+	dns_entry* old_e = it->second;
+	it->second = e;
+	unlock();
+	dec_ref(old_e);
+	return;
+    }
+
+    elmts.insert(std::make_pair(name,e));
+    unlock();
+}
+
+bool dns_bucket::remove_expired(const string& name)
+{
+    lock();
+    value_map::iterator it = elmts.find(name);
+    if(it != elmts.end()){
+
+	dns_entry* e = it->second;
+	u_int64_t now = wheeltimer::instance()->unix_clock.get();
+	if(now >= e->expire) {
+	    elmts.erase(it);
+	    unlock();
+	    dec_ref(e);
+	    return true;
+	}
+    }
+
+    unlock();
+    return false;
+}
+
+bool dns_bucket::contains(const string& name)
+{
+    lock();
+    value_map::iterator it = elmts.find(name);
+    bool res = (it != elmts.end()) &&
+	((u_int64_t)wheeltimer::instance()->unix_clock.get() < it->second->expire);
+    unlock();
+    return res;
+}
+
 bool dns_bucket::remove(const string& name)
 {
     lock();
@@ -386,7 +454,7 @@ bool dns_bucket::remove(const string& name)
 }
 
 
-dns_entry* dns_bucket::find(const string& name)
+dns_entry* dns_bucket::find(const string& name, bool* stale)
 {
     lock();
     value_map::iterator it = elmts.find(name);
@@ -399,12 +467,18 @@ dns_entry* dns_bucket::find(const string& name)
 
     u_int64_t now = wheeltimer::instance()->unix_clock.get();
     if(now >= e->expire){
-	elmts.erase(it);
-	dec_ref(e);
-	unlock();
-	return NULL;
+	if(stale && (now < e->expire + resolver::dns_serve_stale)) {
+	    *stale = true;
+	}
+	else {
+	    elmts.erase(it);
+	    dec_ref(e);
+	    unlock();
+	    return NULL;
+	}
     }
 
+    e->hits++;
     inc_ref(e);
     unlock();
     return e;
@@ -458,8 +532,10 @@ string ip_entry::to_str()
 	    "." + int2str(cp[3]);
     }
     else {
-	// not supported yet...
-	return "[IPv6]";
+	char buf[INET6_ADDRSTRLEN];
+	if(!inet_ntop(AF_INET6, &addr6, buf, sizeof(buf)))
+	    return "[IPv6]";
+	return string("[") + buf + "]";
     }
 }
 
@@ -498,7 +574,20 @@ string ip_port_entry::to_str()
 
 dns_base_entry* dns_ip_entry::get_rr(dns_record* rr, u_char* begin, u_char* end)
 {
-    if(rr->type != dns_r_a)
+    if(rr->type == dns_r_aaaa) {
+	if(rr->rdata_len != sizeof(in6_addr))
+	    return NULL;
+
+	ip_entry* new_ip = new ip_entry();
+	new_ip->type = IPv6;
+	memcpy(&(new_ip->addr6), ns_rr_rdata(*rr), sizeof(in6_addr));
+
+	DBG("AAAA:\tTTL=%i\t%s\t%s\n", ns_rr_ttl(*rr), ns_rr_name(*rr),
+	    new_ip->to_str().c_str());
+	return new_ip;
+    }
+
+    if(rr->type != dns_r_a || rr->rdata_len != sizeof(in_addr))
 	return NULL;
 
     DBG("A:\tTTL=%i\t%s\t%i.%i.%i.%i\n",
@@ -561,8 +650,9 @@ string srv_entry::to_str()
 
 struct dns_search_h
 {
-    dns_entry_map entry_map;
-    uint64_t      now;
+    dns_entry_map      entry_map;
+    map<string,string> cnames;
+    uint64_t           now;
 
     dns_search_h() {
 	now = wheeltimer::instance()->unix_clock.get();
@@ -579,6 +669,14 @@ int rr_to_dns_entry(dns_record* rr, dns_section_type t,
     dns_search_h* h = (dns_search_h*)data;
     string name = ns_rr_name(*rr);
 
+    if(rr->type == dns_r_cname) {
+	u_char target[NS_MAXDNAME];
+	u_char* p = (u_char*)ns_rr_rdata(*rr);
+	if(dns_expand_name(&p,begin,end,target,NS_MAXDNAME) >= 0)
+	    h->cnames[name] = (const char*)target;
+	return 0;
+    }
+
     dns_entry* dns_e = NULL;
     dns_entry_map::iterator it = h->entry_map.find(name);
 
@@ -599,7 +697,7 @@ int rr_to_dns_entry(dns_record* rr, dns_section_type t,
 }
 
 dns_handle::dns_handle() 
-  : srv_e(0), srv_n(0), ip_e(0), ip_n(0) 
+  : srv_e(0), srv_n(0), ip_e(0), ip_n(0), cache_only(false)
 {}
 
 dns_handle::dns_handle(const dns_handle& h)
@@ -827,11 +925,79 @@ dns_entry* dns_entry_map::fetch(const key_type& key)
     return NULL;
 }
 
-bool resolver::disable_srv = false;
+bool         resolver::disable_srv = false;
+string       resolver::dns_servers;
+unsigned int resolver::dns_timeout = 2000;
+unsigned int resolver::dns_attempts = 2;
+unsigned int resolver::dns_serve_stale = 300;
+bool         resolver::dns_prefetch = true;
+
+/** lookup in progress */
+struct resolver::dns_lookup
+{
+    string          key;
+    string          name;
+    dns_rr_type     type;
+    list<lookup_cb> cbs;
+};
+
+/** SRV answer waiting for the addresses of its targets */
+struct resolver::srv_chain
+{
+    dns_entry_map   entries;
+    list<lookup_cb> cbs;
+    unsigned int    pending;
+};
+
+/** query_dns() waiting for the resolver thread */
+struct dns_sync_query
+{
+    std::mutex              m;
+    std::condition_variable cond;
+    bool                    done;
+    int                     err;
+    dns_entry_map           entries;
+
+    dns_sync_query() : done(false), err(TRY_AGAIN) {}
+};
 
 resolver::resolver()
-    : cache(DNS_CACHE_SIZE)
+    : cache(DNS_CACHE_SIZE),
+      evbase(NULL), client(NULL), max_wait(0),
+      wake_ev(NULL), sweep_ev(NULL), sweep_bucket(0)
 {
+    evbase = event_base_new();
+
+    if(pipe2(wake_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+	ERROR("pipe2(): %s\n", strerror(errno));
+	wake_fds[0] = wake_fds[1] = -1;
+    }
+    else {
+	wake_ev = event_new(evbase, wake_fds[0], EV_READ | EV_PERSIST,
+			    wake_cb, this);
+	event_add(wake_ev, NULL);
+    }
+
+    struct timeval tv;
+    tv.tv_sec  = DNS_CACHE_SINGLE_CYCLE / 1000000L;
+    tv.tv_usec = DNS_CACHE_SINGLE_CYCLE % 1000000L;
+    sweep_ev = event_new(evbase, -1, EV_PERSIST, sweep_cb, this);
+    event_add(sweep_ev, &tv);
+
+    vector<sockaddr_storage> servers;
+    if(dns_client::parse_servers(dns_servers, servers) < 0) {
+	ERROR("invalid dns_servers '%s', using /etc/resolv.conf\n",
+	      dns_servers.c_str());
+	dns_client::parse_servers("", servers);
+    }
+
+    client = new dns_client();
+    if(client->init(evbase, servers, dns_timeout, dns_attempts) < 0)
+	ERROR("could not initialize the DNS client\n");
+
+    // SRV lookups take two rounds
+    max_wait = 2 * client->max_duration() + 100;
+
     start();
 }
 
@@ -840,39 +1006,231 @@ resolver::~resolver()
     
 }
 
-int resolver::query_dns(const char* name, dns_entry_map& entry_map, dns_rr_type t)
+void resolver::on_stop()
 {
-    u_char dns_res[NS_PACKETSZ];
+    struct event_base* b = evbase;
+    post([b]() { event_base_loopbreak(b); });
+}
 
-    if(!name) return -1;
+void resolver::post(const std::function<void()>& f)
+{
+    {
+	std::lock_guard<AmMutex> _l(cmds_mut);
+	cmds.push_back(f);
+    }
 
-    DBG("Querying '%s' (%s)...",name,dns_rr_type_str(t));
+    char c = 0;
+    if(write(wake_fds[1], &c, 1) < 0 && (errno != EAGAIN))
+	ERROR("could not wake up the resolver: %s\n", strerror(errno));
+}
 
-    int dns_res_len = res_search(name,ns_c_in,(ns_type)t,
-				 dns_res,NS_PACKETSZ);
-    if(dns_res_len < 0){
-	dns_error(h_errno,name);
-	return -1;
+void resolver::wake_cb(int sd, short what, void* arg)
+{
+    resolver* r = (resolver*)arg;
+
+    char buf[64];
+    while(read(sd, buf, sizeof(buf)) > 0);
+
+    std::deque<std::function<void()> > todo;
+    {
+	std::lock_guard<AmMutex> _l(r->cmds_mut);
+	todo.swap(r->cmds);
+    }
+
+    for(std::deque<std::function<void()> >::iterator it = todo.begin();
+	it != todo.end(); ++it) {
+	(*it)();
+    }
+}
+
+void resolver::refresh(const string& name, dns_rr_type t)
+{
+    post([this, name, t]() { lookup(name, t, lookup_cb()); });
+}
+
+void resolver::query_dns_async(const string& name, dns_rr_type t,
+			       const lookup_cb& cb)
+{
+    post([this, name, t, cb]() { lookup(name, t, cb); });
+}
+
+void resolver::lookup(const string& name, dns_rr_type t, const lookup_cb& cb)
+{
+    string key = string(dns_rr_type_str(t)) + ":" + name;
+
+    map<string, dns_lookup*>::iterator it = lookups.find(key);
+    if(it != lookups.end()) {
+	// already in progress
+	if(cb) it->second->cbs.push_back(cb);
+	return;
     }
 
-    /*
-     * Initialize a handle to this response.  The handle will
-     * be used later to extract information from the response.
-     */
+    DBG("Querying '%s' (%s)...", name.c_str(), dns_rr_type_str(t));
+
+    dns_lookup* l = new dns_lookup();
+    l->key = key;
+    l->name = name;
+    l->type = t;
+    if(cb) l->cbs.push_back(cb);
+    lookups[key] = l;
+
+    client->query(name, t, [this, l](int err, u_char* msg, int len) {
+	    on_answer(l, err, msg, len);
+	});
+}
+
+void resolver::on_answer(dns_lookup* l, int err, u_char* msg, int len)
+{
+    lookups.erase(l->key);
+
     dns_search_h h;
-    if (dns_msg_parse(dns_res, dns_res_len, rr_to_dns_entry, &h) < 0) {
+    if(!err && (dns_msg_parse(msg, len, rr_to_dns_entry, &h) < 0)) {
 	DBG("Could not parse DNS reply");
+	err = NO_RECOVERY;
+    }
+
+    dns_entry_map entries;
+    if(!err) {
+	for(dns_entry_map::iterator it = h.entry_map.begin();
+	    it != h.entry_map.end(); it++) {
+
+	    dns_entry* e = it->second;
+	    if(!e || e->ip_vec.empty()) continue;
+
+	    e->init();
+	    e->created = h.now;
+	    entries.insert(it->first, e);
+	}
+
+	// follow CNAMEs
+	string n = l->name;
+	for(int i = 0; !entries.fetch(l->name) && (i < DNS_MAX_CNAME_CHAIN); i++) {
+	    map<string,string>::iterator c_it = h.cnames.find(n);
+	    if(c_it == h.cnames.end()) break;
+
+	    n = c_it->second;
+	    dns_entry* e = entries.fetch(n);
+	    if(e) entries.insert(l->name, e);
+	}
+
+	if(!entries.fetch(l->name))
+	    err = NO_DATA;
+
+	for(dns_entry_map::iterator it = entries.begin();
+	    it != entries.end(); it++) {
+
+	    dns_bucket* b = cache.get_bucket(hashlittle(it->first.c_str(),
+							it->first.length(),0));
+	    b->replace(it->first, it->second);
+	    DBG("new DNS cache entry: '%s' -> %s",
+		it->first.c_str(), it->second->to_str().c_str());
+	}
+    }
+    else if((err == HOST_NOT_FOUND) || (err == NO_DATA)) {
+	// the name is gone: do not serve it stale anymore
+	cache.get_bucket(hashlittle(l->name.c_str(),l->name.length(),0))
+	    ->remove_expired(l->name);
+    }
+
+    dns_entry* srv_e = NULL;
+    if(!err && (l->type == dns_r_srv) && !l->cbs.empty())
+	srv_e = entries.fetch(l->name);
+
+    if(srv_e) {
+	// make sure the targets' addresses are known as well
+	list<string> targets;
+	for(vector<dns_base_entry*>::iterator it = srv_e->ip_vec.begin();
+	    it != srv_e->ip_vec.end(); ++it) {
+
+	    const string& target = ((srv_entry*)*it)->target;
+	    if(entries.fetch(target) ||
+	       (std::find(targets.begin(), targets.end(), target) != targets.end()))
+		continue;
+
+	    sockaddr_storage sa;
+	    if(am_inet_pton(target.c_str(), &sa) == 1)
+		continue;
+
+	    if(cache.get_bucket(hashlittle(target.c_str(),target.length(),0))
+	       ->contains(target))
+		continue;
+
+	    targets.push_back(target);
+	}
+
+	if(!targets.empty()) {
+	    std::shared_ptr<srv_chain> c(new srv_chain());
+	    for(dns_entry_map::iterator it = entries.begin();
+		it != entries.end(); it++) {
+		c->entries.insert(it->first, it->second);
+	    }
+	    c->cbs.swap(l->cbs);
+	    c->pending = targets.size();
+	    delete l;
+
+	    for(list<string>::iterator it = targets.begin();
+		it != targets.end(); ++it) {
+
+		lookup(*it, dns_r_a, [c](int err, dns_entry_map& t_entries) {
+			for(dns_entry_map::iterator e_it = t_entries.begin();
+			    e_it != t_entries.end(); e_it++) {
+			    c->entries.insert(e_it->first, e_it->second);
+			}
+			if(--c->pending) return;
+			for(list<lookup_cb>::iterator cb_it = c->cbs.begin();
+			    cb_it != c->cbs.end(); ++cb_it) {
+			    (*cb_it)(0, c->entries);
+			}
+		    });
+	    }
+	    return;
+	}
+    }
+
+    for(list<lookup_cb>::iterator it = l->cbs.begin();
+	it != l->cbs.end(); ++it) {
+	(*it)(err, entries);
+    }
+    delete l;
+}
+
+int resolver::query_dns(const char* name, dns_entry_map& entry_map, dns_rr_type t)
+{
+    if(!name) return -1;
+
+    if(std::this_thread::get_id() == loop_tid) {
+	ERROR("blocking DNS query for '%s' from the resolver thread\n", name);
 	return -1;
     }
 
-    for(dns_entry_map::iterator it = h.entry_map.begin();
-	it != h.entry_map.end(); it++) {
+    std::shared_ptr<dns_sync_query> q(new dns_sync_query());
+    query_dns_async(name, t, [q](int err, dns_entry_map& entries) {
+	    std::lock_guard<std::mutex> _l(q->m);
+	    q->err = err;
+	    for(dns_entry_map::iterator it = entries.begin();
+		it != entries.end(); it++) {
+		q->entries.insert(it->first, it->second);
+	    }
+	    q->done = true;
+	    q->cond.notify_all();
+	});
+
+    std::unique_lock<std::mutex> _l(q->m);
+    if(!q->cond.wait_for(_l, std::chrono::milliseconds(max_wait),
+			 [&q]() { return q->done; })) {
+	DBG("no DNS answer for '%s' within %u ms\n", name, max_wait);
+	dns_error(TRY_AGAIN, name);
+	return -1;
+    }
 
-	dns_entry* e = it->second;
-	if(!e || e->ip_vec.empty()) continue;
+    if(q->err) {
+	dns_error(q->err, name);
+	return -1;
+    }
 
-	e->init();
-	entry_map.insert(it->first,e);
+    for(dns_entry_map::iterator it = q->entries.begin();
+	it != q->entries.end(); it++) {
+	entry_map.insert(it->first, it->second);
     }
 
     return 0;
@@ -906,37 +1264,31 @@ int resolver::resolve_name(const char* name,
     
     // name is NOT an IP address -> try a cache look up
     dns_bucket* b = cache.get_bucket(hashlittle(name,strlen(name),0));
-    dns_entry* e = b->find(name);
+    bool stale = false;
+    dns_entry* e = b->find(name, &stale);
 
     // first attempt to get a valid IP
     // (from the cache)
     if(e){
+	if(stale) {
+	    DBG("serving stale DNS record for '%s' while refreshing", name);
+	    refresh(name, t);
+	}
 	int ret = e->next_ip(h,sa);
 	dec_ref(e);
 	return ret;
     }
 
+    if(h->cache_only)
+	return -1;
+
     // no valid IP, query the DNS
+    // (the answer gets cached by the resolver thread)
     dns_entry_map entry_map;
     if(query_dns(name,entry_map,t) < 0) {
 	return -1;
     }
 
-    for(dns_entry_map::iterator it = entry_map.begin();
-	it != entry_map.end(); it++) {
-
-	if(!it->second) continue;
-
-	b = cache.get_bucket(hashlittle(it->first.c_str(),
-					it->first.length(),0));
-	// cache the new record
-	if(b->insert(it->first,it->second)) {
-	    // cache insert successful
-	    DBG("new DNS cache entry: '%s' -> %s",
-		it->first.c_str(), it->second->to_str().c_str());
-	}
-    }
-
     e = entry_map.fetch(name);
     if(e) {
 	// now we should have a valid IP
@@ -979,6 +1331,24 @@ int resolver::str2ip(const char* name,
     return 0;
 }
 
+static bool sip_srv_name(const string& nh, const cstring& next_trsp,
+			 string& srv_name)
+{
+    srv_name = "_sip._";
+    if(!next_trsp.len || !lower_cmp_n(next_trsp,"udp")){
+	srv_name += "udp";
+    }
+    else if(!lower_cmp_n(next_trsp,"tcp")) {
+	srv_name += "tcp";
+    }
+    else {
+	return false;
+    }
+
+    srv_name += "." + nh;
+    return true;
+}
+
 int resolver::set_destination_ip(const cstring& next_hop,
 				  unsigned short next_port,
 				  const cstring& next_trsp,
@@ -999,20 +1369,12 @@ int resolver::set_destination_ip(const cstring& next_hop,
 	    if (disable_srv) {
 		DBG("no port specified, but DNS SRV disabled (skipping).\n");
 	    } else {
-		string srv_name = "_sip._";
-		if(!next_trsp.len || !lower_cmp_n(next_trsp,"udp")){
-		    srv_name += "udp";
-		}
-		else if(!lower_cmp_n(next_trsp,"tcp")) {
-		    srv_name += "tcp";
-		}
-		else {
+		string srv_name;
+		if(!sip_srv_name(nh, next_trsp, srv_name)) {
 		    DBG("unsupported transport: skip SRV lookup");
 		    goto no_SRV;
 		}
 
-		srv_name += "." + nh;
-
 		DBG("no port specified, looking up SRV '%s'...\n",
 		    srv_name.c_str());
 
@@ -1032,7 +1394,7 @@ int resolver::set_destination_ip(const cstring& next_hop,
 						     h_dns,remote_ip,
 						     IPv4);
 	if(err < 0){
-	    ERROR("Unresolvable Request URI domain\n");
+	    DBG("Unresolvable Request URI domain\n");
 	    return -478;
 	}
     }
@@ -1051,14 +1413,77 @@ int resolver::set_destination_ip(const cstring& next_hop,
     return 0;
 }
 
+bool resolver::in_cache(const string& name)
+{
+    dns_bucket* b = cache.get_bucket(hashlittle(name.c_str(),name.length(),0));
+    bool stale = false;
+    dns_entry* e = b->find(name, &stale);
+    if(!e) return false;
+
+    dec_ref(e);
+    return true;
+}
+
+/** names set_destination_ip() would need, but which are not cached */
+void resolver::get_missing(const sip_destination& dest,
+			    list<std::pair<string, dns_rr_type> >& names)
+{
+    sockaddr_storage sa;
+    if(am_inet_pton(dest.host.c_str(), &sa) == 1)
+	return;
+
+    string srv_name;
+    if(!dest.port && !disable_srv &&
+       sip_srv_name(dest.host, stl2cstr(dest.trsp), srv_name)) {
+
+	if(in_cache(srv_name))
+	    return;
+
+	// also ask for the A record in case there is no SRV record,
+	// to avoid a second round
+	names.push_back(std::make_pair(srv_name, dns_r_srv));
+    }
+
+    if(!in_cache(dest.host))
+	names.push_back(std::make_pair(dest.host, dns_r_a));
+}
+
 int resolver::resolve_targets(const list<sip_destination>& dest_list,
-			       sip_target_set* targets)
+			       sip_target_set* targets,
+			       const targets_cb& cb)
 {
+    if(cb) {
+	list<std::pair<string, dns_rr_type> > names;
+	for(list<sip_destination>::const_iterator it = dest_list.begin();
+	    it != dest_list.end(); it++) {
+	    get_missing(*it, names);
+	}
+
+	if(!names.empty()) {
+	    // only touched by the resolver thread
+	    std::shared_ptr<unsigned int> pending(new unsigned int(names.size()));
+
+	    for(list<std::pair<string, dns_rr_type> >::iterator n_it = names.begin();
+		n_it != names.end(); ++n_it) {
+
+		DBG("looking up '%s' (%s) before sending",
+		    n_it->first.c_str(), dns_rr_type_str(n_it->second));
+
+		query_dns_async(n_it->first, n_it->second,
+				[pending, cb](int err, dns_entry_map& entries) {
+				    if(!--(*pending)) cb();
+				});
+	    }
+	    return 1;
+	}
+    }
+
     for(list<sip_destination>::const_iterator it = dest_list.begin();
 	it != dest_list.end(); it++) {
 	
 	sip_target t;
 	dns_handle h_dns;
+	h_dns.cache_only = true;
 
 	DBG("sip_destination: %s:%u/%s",
 	    it->host.c_str(),
@@ -1066,7 +1491,7 @@ int resolver::resolve_targets(const list<sip_destination>& dest_list,
 	    it->trsp.c_str());
 
 	if(set_destination_ip(stl2cstr(it->host), it->port, stl2cstr(it->trsp), &t.ss, &h_dns) != 0) {
-	    ERROR("Unresolvable destination");
+	    DBG("Unresolvable destination");
 	    return -478;
 	}
 	t.trsp = it->trsp;
@@ -1082,44 +1507,62 @@ int resolver::resolve_targets(const list<sip_destination>& dest_list,
 
 void resolver::run()
 {
-    struct timespec tick,rem;
-    tick.tv_sec  = (DNS_CACHE_SINGLE_CYCLE/1000000L);
-    tick.tv_nsec = (DNS_CACHE_SINGLE_CYCLE - (tick.tv_sec)*1000000L) * 1000L;
+    loop_tid = std::this_thread::get_id();
 
-    unsigned long i = 0;
-    for(;;) {
-	nanosleep(&tick,&rem);
+    /* Start the event loop. */
+    event_base_dispatch(evbase);
+}
 
-	u_int64_t now = wheeltimer::instance()->unix_clock.get();
-	dns_bucket* bucket = cache.get_bucket(i);
+void resolver::sweep_cb(int sd, short what, void* arg)
+{
+    ((resolver*)arg)->sweep();
+}
 
-	bucket->lock();
-	    
-	for(dns_bucket::value_map::iterator it = bucket->elmts.begin();
-	    it != bucket->elmts.end(); ++it){
+void resolver::sweep()
+{
+    u_int64_t now = wheeltimer::instance()->unix_clock.get();
+    dns_bucket* bucket = cache.get_bucket(sweep_bucket);
 
-	    dns_entry* dns_e = (dns_entry*)it->second;
-	    if(now >= it->second->expire){
+    list<std::pair<string, dns_rr_type> > prefetch;
 
-		dns_bucket::value_map::iterator tmp_it = it;
-		bool end_of_bucket = (++it == bucket->elmts.end());
+    bucket->lock();
 
-		DBG("DNS record expired (%p)",dns_e);
-		bucket->elmts.erase(tmp_it);
-		dec_ref(dns_e);
+    dns_bucket::value_map::iterator it = bucket->elmts.begin();
+    while(it != bucket->elmts.end()) {
 
-		if(end_of_bucket) break;
-	    }
-	    else {
-		//DBG("######### record %p expires in %li seconds ##########",
-		//    dns_e,it->second->expire-tv_now.tv_sec);
-	    }
+	dns_entry* dns_e = (dns_entry*)it->second;
+	if(now >= dns_e->expire + dns_serve_stale){
+
+	    DBG("DNS record expired (%p)",dns_e);
+	    bucket->elmts.erase(it++);
+	    dec_ref(dns_e);
+	    continue;
+	}
+
+	// refresh records in use which would expire
+	// before this bucket is visited again
+	u_int64_t ttl = dns_e->expire - dns_e->created;
+	u_int64_t ahead = std::max<u_int64_t>(2 * DNS_CACHE_CYCLE, ttl / 10);
+	if(dns_prefetch && dns_e->hits &&
+	   (now + ahead >= dns_e->expire)) {
+
+	    DBG("prefetching DNS record '%s' (%u hits)",
+		it->first.c_str(), dns_e->hits);
+	    dns_e->hits = 0;
+	    prefetch.push_back(std::make_pair(it->first, dns_e->type));
 	}
 
-	bucket->unlock();
+	++it;
+    }
+
+    bucket->unlock();
 
-	if(++i >= cache.get_size()) i = 0;
+    for(list<std::pair<string, dns_rr_type> >::iterator p_it = prefetch.begin();
+	p_it != prefetch.end(); ++p_it) {
+	lookup(p_it->first, p_it->second, lookup_cb());
     }
+
+    if(++sweep_bucket >= cache.get_size()) sweep_bucket = 0;
 }
 
 
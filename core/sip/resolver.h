@@ -39,12 +39,19 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <functional>
+#include <thread>
 using std::string;
 using std::vector;
 using std::map;
 
 #include <netinet/in.h>
 
+struct event_base;
+struct event;
+class dns_client;
+
 #define DNS_CACHE_SIZE 128
 
 enum address_type {
@@ -83,6 +90,13 @@ class dns_entry
 public:
     vector<dns_base_entry*> ip_vec;
 
+    dns_rr_type type;
+
+    // when the answer was received
+    u_int64_t    created;
+    // cache hits since then (or since the last prefetch)
+    unsigned int hits;
+
     static dns_entry* make_entry(dns_rr_type t);
 
     dns_entry();
@@ -103,8 +117,20 @@ class dns_bucket
 public:
     dns_bucket(unsigned long id);
     bool insert(const string& name, dns_entry* e);
+    /** insert or replace the entry for name */
+    void replace(const string& name, dns_entry* e);
     bool remove(const string& name);
-    dns_entry* find(const string& name);
+    /** remove the entry for name if it has expired */
+    bool remove_expired(const string& name);
+
+    /**
+     * @param stale if not NULL, expired entries are returned for
+     *        resolver::dns_serve_stale more seconds, flagged with *stale
+     */
+    dns_entry* find(const string& name, bool* stale = NULL);
+
+    /** @return whether there is a valid entry for name */
+    bool contains(const string& name);
 };
 
 typedef hash_table<dns_bucket> dns_cache;
@@ -174,6 +200,9 @@ private:
 
     dns_ip_entry*  ip_e;
     int            ip_n;
+
+    // do not query the DNS on a cache miss
+    bool           cache_only;
 };
 
 struct naptr_record
@@ -263,6 +292,25 @@ public:
     // disable SRV lookups
     static bool disable_srv;
 
+    // name servers ("ip[:port],..."); empty: from /etc/resolv.conf
+    static string       dns_servers;
+    // time to wait for an answer before trying again (ms)
+    static unsigned int dns_timeout;
+    // how many times each server is tried
+    static unsigned int dns_attempts;
+    // how long expired records may still be used while refreshing (s)
+    static unsigned int dns_serve_stale;
+    // refresh records in use before they expire
+    static bool         dns_prefetch;
+
+    /**
+     * Called from the resolver thread once a lookup is done.
+     * @param err 0 or HOST_NOT_FOUND, NO_DATA, TRY_AGAIN, NO_RECOVERY
+     * @param entries the records received, by name (including those
+     *        of the targets of an SRV lookup)
+     */
+    typedef std::function<void(int err, dns_entry_map& entries)> lookup_cb;
+
     int resolve_name(const char* name, 
 		     dns_handle* h,
 		     sockaddr_storage* sa,
@@ -273,15 +321,38 @@ public:
 	       sockaddr_storage* sa,
 	       const address_type types);
 
+    /**
+     * Query the DNS (not the cache) and wait for the answer.
+     * Concurrent queries for the same name are sent only once.
+     */
     int query_dns(const char* name, dns_entry_map& entry_map, dns_rr_type t);
 
+    /**
+     * Asynchronous version of query_dns(); the answer is put into
+     * the cache before cb is called (from the resolver thread, which
+     * must not be blocked). For SRV lookups, cb is called once the
+     * addresses of the targets are known as well.
+     */
+    void query_dns_async(const string& name, dns_rr_type t,
+			 const lookup_cb& cb);
+
+    typedef std::function<void()> targets_cb;
+
     /**
      * Transforms all elements of a destination list into
      * a target set, thus resolving all DNS names and
      * converting IPs into a sockaddr_storage.
+     *
+     * Only the cache is used, this never waits for the DNS:
+     * if names are missing and cb is set, they are looked up
+     * and 1 is returned; cb is then called from the resolver
+     * thread once the answers are cached, and the caller is
+     * expected to call again (without cb).
+     * @return 0 on success, 1 if pending, <0 if unresolvable
      */
     int resolve_targets(const list<sip_destination>& dest_list,
-			sip_target_set* targets);
+			sip_target_set* targets,
+			const targets_cb& cb = targets_cb());
 
 protected:
     resolver();
@@ -294,10 +365,46 @@ protected:
 			   dns_handle* h_dns);
 
     void run();
-    void on_stop() {}
+    void on_stop();
 
 private:
+    struct dns_lookup;
+    struct srv_chain;
+
     dns_cache cache;
+
+    struct event_base* evbase;
+    dns_client*        client;
+    std::thread::id    loop_tid;
+    // max. time query_dns() waits (ms)
+    unsigned int       max_wait;
+
+    // commands posted to the resolver thread
+    int                wake_fds[2];
+    struct event*      wake_ev;
+    AmMutex            cmds_mut;
+    std::deque<std::function<void()> > cmds;
+
+    struct event*      sweep_ev;
+    unsigned long      sweep_bucket;
+
+    // lookups in progress, by type+name (resolver thread only)
+    map<string, dns_lookup*> lookups;
+
+    void post(const std::function<void()>& f);
+    void refresh(const string& name, dns_rr_type t);
+
+    bool in_cache(const string& name);
+    void get_missing(const sip_destination& dest,
+		     list<std::pair<string, dns_rr_type> >& names);
+
+    // resolver thread only
+    void lookup(const string& name, dns_rr_type t, const lookup_cb& cb);
+    void on_answer(dns_lookup* l, int err, u_char* msg, int len);
+    void sweep();
+
+    static void wake_cb(int sd, short what, void* arg);
+    static void sweep_cb(int sd, short what, void* arg);
 };
 
 #endif
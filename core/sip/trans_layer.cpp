@@ -1071,6 +1071,60 @@ static int generate_and_parse_new_msg(sip_msg* msg, sip_msg*& p_msg)
     return 0;
 }
 
+/** request waiting for the resolver, with its own copy of the message */
+struct trans_layer::pending_send
+{
+    // buffers referenced by msg
+    string method;
+    string ruri;
+    string hdrs;
+
+    sip_msg msg;
+
+    list<sip_destination>  dest_list;
+    string                 dialog_id;
+    int                    out_interface;
+    unsigned int           flags;
+    shared_ptr<msg_logger> logger;
+
+    trans_bucket* bucket;
+    string        key;
+    bool          registered;
+    bool          canceled;
+
+    pending_send(const sip_msg& req, const list<sip_destination>& dest_list,
+		 const string& dialog_id, int out_interface,
+		 unsigned int flags, const shared_ptr<msg_logger>& logger)
+	: method(c2stlstr(req.u.request->method_str)),
+	  ruri(c2stlstr(req.u.request->ruri_str)),
+	  dest_list(dest_list), dialog_id(dialog_id),
+	  out_interface(out_interface), flags(flags), logger(logger),
+	  bucket(NULL), registered(false), canceled(false)
+    {
+	msg.type = SIP_REQUEST;
+	msg.u.request = new sip_request();
+	msg.u.request->method_str = stl2cstr(method);
+	msg.u.request->ruri_str = stl2cstr(ruri);
+
+	copy_hdrs_wr(hdrs, req.vias);
+	copy_hdrs_wr_no_via_contact(hdrs, req.hdrs);
+	copy_hdrs_wr(hdrs, req.contacts);
+
+	const char* c = hdrs.c_str();
+	if(parse_headers(msg, &c, c + hdrs.length()) ||
+	   !msg.cseq || !msg.callid)
+	    return;
+	msg.body = req.body;
+
+	sip_cseq cseq;
+	parse_cseq(&cseq, msg.cseq->value.s, msg.cseq->value.len);
+	bucket = get_trans_bucket(msg.callid->value, cseq.num_str);
+	// only an INVITE can be canceled
+	if(!dialog_id.empty() && (cseq.method == sip_request::INVITE))
+	    key = dialog_id + ":" + c2stlstr(cseq.num_str);
+    }
+};
+
 int trans_layer::send_request(sip_msg& msg, trans_ticket& tt,
 			       const string& dialog_id,
 			       const cstring& _next_hop, 
@@ -1108,13 +1162,109 @@ int trans_layer::send_request(sip_msg& msg, trans_ticket& tt,
 	dest_list.push_back(dest);
     }
 
+    tt._bucket = 0;
+    tt._t = 0;
+
     unique_ptr<sip_target_set> targets(new sip_target_set());
     res = resolver::instance()->resolve_targets(dest_list,targets.get());
-    if(res < 0){
-	DBG("resolve_targets failed\n");
-	return res;
+    if(res < 0) {
+	// not in the cache: do not wait for the DNS,
+	// send a copy of the request once the answer is there
+	unique_ptr<pending_send> ps(new pending_send(msg, dest_list, dialog_id,
+						      out_interface, flags, logger));
+	if(!ps->bucket) {
+	    ERROR("could not copy the request\n");
+	    return -1;
+	}
+
+	pending_send* p = ps.get();
+	trans_bucket* bucket = p->bucket;
+	if(!p->key.empty()) {
+	    std::lock_guard<AmMutex> _l(pending_mut);
+	    pending_sends[p->key] = p;
+	    p->registered = true;
+	}
+
+	targets.reset(new sip_target_set());
+	res = resolver::instance()->resolve_targets(dest_list,targets.get(),
+						    [this, p]() { resume_send(p); });
+	if(res > 0) {
+	    // resume_send() takes it over
+	    DBG("waiting for the DNS before sending to <%.*s>\n",
+		msg.u.request->ruri_str.len, msg.u.request->ruri_str.s);
+	    ps.release();
+	    tt._bucket = bucket;
+	    return 0;
+	}
+
+	bucket->lock();
+	unregister_pending(p);
+	bucket->unlock();
+
+	if(res < 0){
+	    DBG("resolve_targets failed\n");
+	    return res;
+	}
     }
 
+    return send_to_targets(msg, tt, dialog_id, targets,
+			   out_interface, flags, logger, NULL);
+}
+
+void trans_layer::resume_send(pending_send* ps)
+{
+    unique_ptr<pending_send> _ps(ps);
+
+    unique_ptr<sip_target_set> targets(new sip_target_set());
+    int res = resolver::instance()->resolve_targets(ps->dest_list,
+						    targets.get());
+    if(res == 0) {
+	trans_ticket tt;
+	res = send_to_targets(ps->msg, tt, ps->dialog_id, targets,
+			      ps->out_interface, ps->flags, ps->logger, ps);
+    }
+
+    ps->bucket->lock();
+    bool canceled = unregister_pending(ps);
+    ps->bucket->unlock();
+
+    if(res >= 0)
+	return;
+
+    if(ps->dialog_id.empty()) {
+	ERROR("could not send %.*s to <%.*s> (%i)\n",
+	      ps->msg.u.request->method_str.len, ps->msg.u.request->method_str.s,
+	      ps->msg.u.request->ruri_str.len, ps->msg.u.request->ruri_str.s, res);
+	return;
+    }
+
+    // the caller has already been told the request was sent
+    sip_msg err;
+    if(canceled)
+	set_err_reply_from_req(&err, &ps->msg, 487, "Request Terminated");
+    else
+	set_err_reply_from_req(&err, &ps->msg, 500, "Unresolvable destination");
+    ua->handle_sip_reply(ps->dialog_id, &err);
+}
+
+bool trans_layer::unregister_pending(pending_send* ps)
+{
+    std::lock_guard<AmMutex> _l(pending_mut);
+    if(!ps->registered)
+	return false;
+
+    pending_sends.erase(ps->key);
+    ps->registered = false;
+    return ps->canceled;
+}
+
+int trans_layer::send_to_targets(sip_msg& msg, trans_ticket& tt,
+				  const string& dialog_id,
+				  unique_ptr<sip_target_set>& targets,
+				  int out_interface, unsigned int flags,
+				  const shared_ptr<msg_logger>& logger,
+				  pending_send* ps)
+{
     targets->debug();
     targets->reset_iterator();
 
@@ -1138,9 +1288,6 @@ int trans_layer::send_request(sip_msg& msg, trans_ticket& tt,
     string next_trsp;
     sip_msg* p_msg=NULL;
 
-    tt._bucket = 0;
-    tt._t = 0;
-
  try_next_dest:
     if(targets->get_next(msg.remote_ip, next_trsp, flags) < 0) {
 	DBG("next_ip(): no more destinations! reply 500");
@@ -1172,6 +1319,17 @@ int trans_layer::send_request(sip_msg& msg, trans_ticket& tt,
 				   get_cseq(p_msg)->num_str);
     tt._bucket->lock();
 
+    if(ps && unregister_pending(ps)) {
+	DBG("request canceled while resolving the destination\n");
+	tt._bucket->unlock();
+	delete p_msg;
+
+	sip_msg reply;
+	set_err_reply_from_req(&reply, &msg, 487, "Request Terminated");
+	ua->handle_sip_reply(dialog_id, &reply);
+	return 0;
+    }
+
     err = p_msg->send(flags);
     if(err < 0){
 	ERROR("Error from transport layer\n");
@@ -1260,7 +1418,8 @@ int trans_layer::cancel(trans_ticket* tt, const string& dialog_id,
 			 unsigned int inv_cseq, const cstring& hdrs)
 {
     assert(tt);
-    assert(tt->_bucket && tt->_t);
+    // no transaction yet while waiting for the resolver
+    assert(tt->_bucket);
 
     trans_bucket* bucket = tt->_bucket;
     sip_trans*    t = tt->_t;
@@ -1274,8 +1433,22 @@ int trans_layer::cancel(trans_ticket* tt, const string& dialog_id,
     }
 
     if(!t){
+	bool pending = false;
+	if (!dialog_id.empty()) {
+	    std::lock_guard<AmMutex> _l(pending_mut);
+	    map<string, pending_send*>::iterator it =
+		pending_sends.find(dialog_id + ":" + int2str(inv_cseq));
+	    if(it != pending_sends.end()) {
+		// 487 is generated once the resolver is done
+		it->second->canceled = true;
+		pending = true;
+	    }
+	}
 	bucket->unlock();
-	DBG("No transaction to cancel: wrong key or finally replied\n");
+	if(pending)
+	    DBG("Request canceled while resolving its destination\n");
+	else
+	    DBG("No transaction to cancel: wrong key or finally replied\n");
 	return 0;
     }
 
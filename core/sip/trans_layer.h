@@ -32,6 +32,7 @@
 #include "cstring.h"
 #include "singleton.h"
 #include "atomic_types.h"
+#include "AmThread.h"
 
 #include "parse_next_hop.h"
 
@@ -49,6 +50,7 @@ using std::map;
 
 #include <memory>
 using std::shared_ptr;
+using std::unique_ptr;
 
 struct sip_msg;
 struct sip_uri;
@@ -132,6 +134,11 @@ private:
 
     vector<prot_collection> transports;
 
+    // requests waiting for DNS answers, by dialog_id + CSeq
+    struct pending_send;
+    AmMutex                    pending_mut;
+    map<string, pending_send*> pending_sends;
+
 public:
 
     /**
@@ -177,6 +184,9 @@ public:
      * Sends a UAC request.
      * Caution: Route headers should not be added to the
      * general header list (msg->hdrs).
+     * If the destination is not in the DNS cache, a copy of the
+     * request is sent once the resolver has the answer; tt then
+     * has no transaction yet, but can be used for CANCEL.
      * @param [in]  msg Pre-built message.
      * @param [out] tt transaction ticket (needed for replies & CANCEL)
      */
@@ -270,6 +280,27 @@ protected:
 
     sip_trans* copy_uac_trans(sip_trans* tr);
 
+    /**
+     * Sends the request to the first target which works
+     * and creates the UAC transaction.
+     * @param ps pending send being resumed (or NULL)
+     */
+    int send_to_targets(sip_msg& msg, trans_ticket& tt,
+			const string& dialog_id,
+			unique_ptr<sip_target_set>& targets,
+			int out_interface, unsigned int flags,
+			const shared_ptr<msg_logger>& logger,
+			pending_send* ps);
+
+    /** Called from the resolver thread once the targets are cached */
+    void resume_send(pending_send* ps);
+
+    /**
+     * Removes ps from the pending sends (bucket locked).
+     * @return true if it has been canceled meanwhile.
+     */
+    bool unregister_pending(pending_send* ps);
+
     /**
      * If the destination has multiple IPs (SRV records),
      * try the next destination IP.
@@ -49,7 +49,8 @@ public:
 	force_via_address       = (1 << 0),
 	force_outbound_if       = (1 << 1),
 	use_raw_sockets         = (1 << 2),
-	no_transport_in_contact = (1 << 3)
+	no_transport_in_contact = (1 << 3),
+	reuse_port              = (1 << 4)
     };
 
     static int log_level_raw_msgs;
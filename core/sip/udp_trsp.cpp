@@ -47,6 +47,10 @@
 #include <errno.h>
 #include <string.h>
 
+#ifdef __linux__
+# include <linux/filter.h>
+#endif
+
 
 /** @see trsp_socket */
 int udp_trsp_socket::bind(const string& bind_ip, unsigned short bind_port)
@@ -79,6 +83,21 @@ int udp_trsp_socket::bind(const string& bind_ip, unsigned short bind_port)
 	return -1;
     }
 
+    if(socket_options & reuse_port) {
+#ifdef SO_REUSEPORT
+	int reuse_opt = 1;
+	if(setsockopt(sd, SOL_SOCKET, SO_REUSEPORT,
+		      (void*)&reuse_opt, sizeof(reuse_opt)) == -1) {
+
+	    ERROR("setsockopt(SO_REUSEPORT): %s\n",strerror(errno));
+	    return -1;
+	}
+#else
+	ERROR("SO_REUSEPORT is not supported on this platform\n");
+	return -1;
+#endif
+    }
+
     if(::bind(sd,(const struct sockaddr*)&addr,SA_len(&addr))) {
 
 	ERROR("bind: %s\n",strerror(errno));
@@ -140,6 +159,35 @@ int udp_trsp_socket::set_recvbuf_size(int rcvbuf_size)
     return 0;
 }
 
+int udp_trsp_socket::attach_cpu_steering(unsigned int n_sockets)
+{
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU)
+    // A = cpu; A = A % n_sockets; return A
+    struct sock_filter code[] = {
+	{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, (__u32)(SKF_AD_OFF + SKF_AD_CPU) },
+	{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, n_sockets },
+	{ BPF_RET | BPF_A, 0, 0, 0 }
+    };
+    struct sock_fprog prog = { sizeof(code)/sizeof(code[0]), code };
+
+    if(!n_sockets)
+	return -1;
+
+    if(setsockopt(sd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+		  (void*)&prog, sizeof(prog)) == -1) {
+	ERROR("setsockopt(SO_ATTACH_REUSEPORT_CBPF): %s\n",strerror(errno));
+	return -1;
+    }
+
+    DBG("attached CPU steering program to UDP socket group on %s/%i"
+	" (%u sockets)\n",ip.c_str(),port,n_sockets);
+    return 0;
+#else
+    WARN("reuseport CPU steering not supported on this platform\n");
+    return -1;
+#endif
+}
+
 int udp_trsp_socket::sendto(const sockaddr_storage* sa,
 			    const char* msg,
 			    const int msg_len)
@@ -248,7 +296,19 @@ int udp_trsp_socket::send(const sockaddr_storage* sa,
 /** @see trsp_socket */
 
 udp_trsp::udp_trsp(const shared_ptr<udp_trsp_socket>& sock)
-    : transport(sock, true)
+    : transport(sock, true), recv_sock(sock)
+{
+    init_msg();
+}
+
+udp_trsp::udp_trsp(const shared_ptr<udp_trsp_socket>& sock,
+		   const shared_ptr<udp_trsp_socket>& recv_sock)
+    : transport(sock, true), recv_sock(recv_sock)
+{
+    init_msg();
+}
+
+void udp_trsp::init_msg()
 {
   iov[0].iov_base = buf;
   iov[0].iov_len  = MAX_UDP_MSGLEN;
@@ -274,18 +334,18 @@ void udp_trsp::run()
 {
     int buf_len;
 
-    if(sock->get_sd() == -1){
+    if(recv_sock->get_sd() == -1){
 	ERROR("Transport instance not bound\n");
 	return;
     }
 
-    INFO("Started SIP server UDP transport on %s:%i\n",
-	 sock->get_ip(),sock->get_port());
+    INFO("Started SIP server UDP transport on %s:%i (sd=%i)\n",
+	 sock->get_ip(),sock->get_port(),recv_sock->get_sd());
 
     ready();
 
     while (!stop_requested()){
-	buf_len = recvmsg(sock->get_sd(),&msg,0);
+	buf_len = recvmsg(recv_sock->get_sd(),&msg,0);
 	if(buf_len <= 0){
 	    if(!buf_len) continue;
 	    ERROR("recvfrom returned %d: %s\n",buf_len,strerror(errno));
@@ -359,8 +419,8 @@ void udp_trsp::run()
 void udp_trsp::on_stop()
 {
     // wake up thread blocked in recv()
-    if (sock->get_sd() != -1)
-	shutdown(sock->get_sd(), SHUT_RD);
+    if (recv_sock->get_sd() != -1)
+	shutdown(recv_sock->get_sd(), SHUT_RD);
 }
 
 
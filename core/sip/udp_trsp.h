@@ -87,6 +87,14 @@ public:
 
     int set_recvbuf_size(int rcvbuf_size);
 
+    /**
+     * Attaches a classic BPF program to the SO_REUSEPORT group
+     * this socket belongs to, steering each datagram to the socket
+     * with index (receiving CPU % n_sockets).
+     * @return -1 if error(s) occured or not supported.
+     */
+    int attach_cpu_steering(unsigned int n_sockets);
+
     /**
      * Sends a message.
      * @return -1 if error(s) occured.
@@ -104,6 +112,15 @@ class udp_trsp: public transport
     sockaddr_storage from_addr;
     iovec            iov[1];
 
+    /**
+     * Socket this thread receives from. With SO_REUSEPORT listeners
+     * this is one of the group's sockets, while received messages are
+     * still bound to the registered (sending) socket.
+     */
+    shared_ptr<udp_trsp_socket> recv_sock;
+
+    void init_msg();
+
 protected:
     /** @see AmThread */
     void run();
@@ -113,6 +130,8 @@ protected:
 public:
     /** @see transport */
     udp_trsp(const shared_ptr<udp_trsp_socket>& sock);
+    udp_trsp(const shared_ptr<udp_trsp_socket>& sock,
+	     const shared_ptr<udp_trsp_socket>& recv_sock);
     ~udp_trsp();
 };
 
@@ -32,6 +32,7 @@
 #include <sys/time.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <string.h>
 
 #include "AmThread.h"
 #include "AmUtils.h"
@@ -45,6 +46,13 @@ timer::~timer()
     // DBG("timer::~timer(this=%p)\n",this);
 }
 
+void _wheeltimer::init_wheel()
+{
+    memset(l0_used, 0, sizeof(l0_used));
+    n_timers = 0;
+    cur_tick = get_timer_bucket(gettimeofday_us()) / resolution;
+}
+
 void _wheeltimer::insert_timer(timer* t, uint64_t relative_us, uint64_t latest_expiry)
 {
     uint64_t now = gettimeofday_us();
@@ -72,6 +80,12 @@ void _wheeltimer::remove_timer(timer* t, bool del_timer)
     // sleep again
 }
 
+size_t _wheeltimer::size()
+{
+    std::lock_guard<std::mutex> lock(buckets_mut);
+    return n_timers;
+}
+
 void _wheeltimer::run()
 {
   while (!stop_requested()) {
@@ -82,15 +96,15 @@ void _wheeltimer::run()
 
     std::unique_lock<std::mutex> lock(buckets_mut);
 
-    auto beg = buckets.begin();
-
-    if (beg == buckets.end()) {
-	// nothing to wait for - sleep the fixed maximum allowed
+    if (!n_timers) {
+	// nothing to wait for - resync the wheel with the clock
+	// and sleep the fixed maximum allowed
+	cur_tick = get_timer_bucket(now) / resolution;
 	buckets_cond.wait_for(lock, std::chrono::microseconds(max_sleep_time));
 	continue;
     }
 
-    auto next = beg->first;
+    auto next = next_due_tick() * resolution;
 
     if (next > now) {
       uint64_t diff = next - now;
@@ -104,33 +118,172 @@ void _wheeltimer::run()
 	    buckets_cond.wait_for(lock, std::chrono::microseconds(max_sleep_time));
 	  continue;
       }
+      now = next;
     }
 
-    // this slot needs to run now
-    process_current_timers(beg->second, lock);
-
-    // all done, remove bucket
-    buckets.erase(beg);
+    fire_due(now, lock);
   }
 }
 
-void _wheeltimer::process_current_timers(timer_list& list, std::unique_lock<std::mutex>& lock)
+size_t _wheeltimer::run_due(uint64_t now)
 {
-    DBG("firing %zd timers\n", list.size());
+    std::unique_lock<std::mutex> lock(buckets_mut);
+    return fire_due(now, lock);
+}
+
+// requires buckets_mut mutex to be held
+size_t _wheeltimer::fire_due(uint64_t now, std::unique_lock<std::mutex>& lock)
+{
+    size_t fired = 0;
+
+    while (cur_tick * resolution <= now) {
+
+	if (!n_timers) {
+	    // skip over empty ticks (e.g. after a clock jump)
+	    cur_tick = get_timer_bucket(now) / resolution;
+	    break;
+	}
+
+	timer_slot& due = current_slot();
+	if (!due.empty())
+	    fired += process_current_timers(due, lock);
 
+	cur_tick++;
+    }
+
+    return fired;
+}
+
+size_t _wheeltimer::process_current_timers(timer_slot& list, std::unique_lock<std::mutex>& lock)
+{
+    size_t fired = 0;
+
+    DBG("firing %zd timers\n", list.count);
+
+    // The slot is processed in place: timers inserted into this very
+    // bucket while the lock is released are fired in the same run.
     while (!list.empty()) {
-	auto* t = list.front();
+	auto* t = list.head;
 
 	t->disarm(); // removes it from list
+	n_timers--;
 
 	// safe to unlock now
 	lock.unlock();
 
 	DBG("firing timer [%p]\n", t);
 	t->fire();
+	fired++;
 
 	lock.lock();
     }
+
+    return fired;
+}
+
+// requires buckets_mut mutex to be held
+timer_slot& _wheeltimer::current_slot()
+{
+    unsigned int idx = cur_tick & WHEEL_L0_MASK;
+
+    if (!idx) {
+	// a full turn of level 0 is done: pull the next slot of the
+	// upper levels down, as long as those complete a turn as well
+	for (int lvl = 0; lvl < WHEEL_LEVELS - 1; lvl++) {
+	    unsigned int lidx =
+		(cur_tick >> (WHEEL_L0_BITS + lvl * WHEEL_LN_BITS)) & WHEEL_LN_MASK;
+	    cascade(wheel_ln[lvl][lidx]);
+	    if (lidx)
+		break;
+	}
+    }
+
+    l0_used[idx >> 6] &= ~((uint64_t)1 << (idx & 63));
+    return wheel_l0[idx];
+}
+
+// requires buckets_mut mutex to be held
+void _wheeltimer::cascade(timer_slot& s)
+{
+    timer* t = s.head;
+
+    s.head  = NULL;
+    s.count = 0;
+
+    while (t) {
+	timer* next = t->next;
+	t->next = t->prev = NULL;
+	t->slot = NULL;
+	link_tick(t);
+	t = next;
+    }
+}
+
+// requires buckets_mut mutex to be held
+void _wheeltimer::link_tick(timer* t)
+{
+    uint64_t tick = t->tick;
+    if (tick < cur_tick)
+	tick = cur_tick;
+
+    uint64_t delta = tick - cur_tick;
+
+    if (delta < WHEEL_L0_SIZE) {
+	unsigned int idx = tick & WHEEL_L0_MASK;
+	t->link(wheel_l0[idx]);
+	l0_used[idx >> 6] |= (uint64_t)1 << (idx & 63);
+	return;
+    }
+
+    if (delta >= WHEEL_MAX_TICKS) {
+	// beyond the horizon: park in the farthest slot,
+	// it gets re-cascaded until it is due.
+	tick = cur_tick + WHEEL_MAX_TICKS - 1;
+	delta = WHEEL_MAX_TICKS - 1;
+    }
+
+    for (int lvl = 0; lvl < WHEEL_LEVELS - 1; lvl++) {
+	unsigned int shift = WHEEL_L0_BITS + lvl * WHEEL_LN_BITS;
+	if (delta < ((uint64_t)1 << (shift + WHEEL_LN_BITS))) {
+	    t->link(wheel_ln[lvl][(tick >> shift) & WHEEL_LN_MASK]);
+	    return;
+	}
+    }
+}
+
+// requires buckets_mut mutex to be held
+uint64_t _wheeltimer::next_due_tick()
+{
+    // next level 0 turn, where upper levels might cascade timers down
+    uint64_t next = (cur_tick + WHEEL_L0_MASK) & ~(uint64_t)WHEEL_L0_MASK;
+
+    unsigned int offset = 0;
+    while (offset < WHEEL_L0_SIZE && cur_tick + offset < next) {
+
+	unsigned int idx = (cur_tick + offset) & WHEEL_L0_MASK;
+	uint64_t word = l0_used[idx >> 6] >> (idx & 63);
+
+	if (!word) {
+	    offset += 64 - (idx & 63);
+	    continue;
+	}
+
+	unsigned int skip = __builtin_ctzll(word);
+	offset += skip;
+	idx += skip;
+
+	if (offset >= WHEEL_L0_SIZE || cur_tick + offset >= next)
+	    break;
+
+	if (!wheel_l0[idx].empty())
+	    return cur_tick + offset;
+
+	// slot emptied by remove_timer(): clear lazily
+	l0_used[idx >> 6] &= ~((uint64_t)1 << (idx & 63));
+	offset++;
+    }
+
+    return next;
 }
 
 uint64_t _wheeltimer::get_timer_bucket(uint64_t exp)
@@ -164,9 +317,17 @@ void _wheeltimer::place_timer(timer* t, uint64_t us, uint64_t latest)
 	// consider up to which bucket?
 	uint64_t end = get_timer_bucket(latest);
 
+	// only level 0 keeps per-bucket counts, so the search
+	// is limited to the next WHEEL_L0_SIZE buckets
+	uint64_t horizon = (cur_tick + WHEEL_L0_SIZE) * resolution;
+	if (end > horizon)
+	    end = horizon;
+
 	size_t least = SIZE_MAX;
 	for (uint64_t candidate = bucket; candidate < end; candidate += resolution) {
-	    size_t current = buckets[candidate].size();
+	    uint64_t tick = candidate / resolution;
+	    size_t current = (tick < cur_tick) ? SIZE_MAX :
+		wheel_l0[tick & WHEEL_L0_MASK].count;
 	    if (current < least) {
 		least = current;
 		bucket = candidate;
@@ -185,9 +346,11 @@ void _wheeltimer::place_timer(timer* t, uint64_t us, uint64_t latest)
 // requires buckets_mut mutex to be held
 void _wheeltimer::add_timer_to_bucket(timer* t, uint64_t bucket)
 {
-    t->link(buckets[bucket]);
+    t->tick = bucket / resolution;
+    link_tick(t);
+    n_timers++;
     DBG("inserted timer [%p] in bucket %" PRIu64 " (now sized %zd)\n",
-	t, bucket, buckets[bucket].size());
+	t, bucket, t->slot->count);
 }
 
 // requires buckets_mut mutex to be held
@@ -198,6 +361,8 @@ void _wheeltimer::delete_timer(timer* t, bool del_timer)
         return;
     }
 
+    n_timers--;
+
     DBG("successfully removed timer [%p]\n", t);
 
     if (del_timer) {
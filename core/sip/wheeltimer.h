@@ -35,38 +35,67 @@
 #include <sys/types.h>
 #include <inttypes.h>
 #include <time.h>
-#include <deque>
-#include <list>
-#include <map>
+#include <stdexcept>
 
 #include "log.h"
 
+/**
+ * Wheel geometry: level 0 has 2^WHEEL_L0_BITS slots of one tick
+ * (resolution) each, every following level has 2^WHEEL_LN_BITS slots
+ * covering a full turn of the level below.
+ *
+ * With 20ms resolution: level 0 spans ~82s, so that SIP transaction
+ * timers (64*T1 = 32s at most) never need to be cascaded. Level 1
+ * spans ~87min, level 2 ~3.9days, level 3 ~248days. Timers further
+ * in the future are parked in the last slot and re-cascaded until due.
+ */
+#define WHEEL_L0_BITS  12
+#define WHEEL_LN_BITS  6
+#define WHEEL_LEVELS   4
+
+#define WHEEL_L0_SIZE  (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE  (1 << WHEEL_LN_BITS)
+#define WHEEL_L0_MASK  (WHEEL_L0_SIZE - 1)
+#define WHEEL_LN_MASK  (WHEEL_LN_SIZE - 1)
+
+#define WHEEL_MAX_TICKS \
+    ((uint64_t)1 << (WHEEL_L0_BITS + (WHEEL_LEVELS - 1) * WHEEL_LN_BITS))
+
 class timer;
 
-typedef std::list<timer*> timer_list;
-typedef std::map<uint64_t, timer_list> timer_buckets;
+/** intrusive, doubly linked timer list (one per wheel slot) */
+struct timer_slot
+{
+    timer* head;
+    size_t count;
+
+    timer_slot() : head(NULL), count(0) {}
+
+    bool empty() const { return head == NULL; }
+
+    // slot must be locked
+    void push_front(timer* t);
+    void erase(timer* t);
+};
 
 class timer
 {
-    struct timer_link {
-        // for fast removal:
-        timer_list::iterator pos;
-        timer_list& list;
-
-        timer_link(timer_list& _list, const timer_list::iterator& _pos)
-            : pos(_pos), list(_list)
-        {}
-    };
+    // intrusive links, owned by the wheel (buckets_mut)
+    timer*      next;
+    timer*      prev;
+    timer_slot* slot;
 
-    std::optional<timer_link> _link;
+    uint64_t    tick; // scheduled wheel tick (bucket / resolution)
 
 public:
     timer()
-	: expires(0)
+	: next(NULL), prev(NULL), slot(NULL),
+	  tick(0), expires(0)
     {}
 
     timer(const timer &t)
-        : expires(t.expires)
+        : next(NULL), prev(NULL), slot(NULL),
+	  tick(0), expires(t.expires)
     {}
 
     virtual ~timer();
@@ -87,35 +116,59 @@ private:
 	expires = us;
     }
 
-    // list must be locked
-    void link(timer_list& list)
+    // slot must be locked
+    void link(timer_slot& s)
     {
-        if (_link)
+        if (slot)
             throw std::runtime_error("attempting to link already-linked timer");
 
-	list.push_front(this);
-        _link.emplace(list, list.begin());
+	s.push_front(this);
     }
 
     bool disarm()
     {
 	expires = 0;
 
-        if (!_link)
+        if (!slot)
             return false;
 
-        _link->list.erase(_link->pos);
-
-        _link.reset();
+        slot->erase(this);
 
         return true;
     }
 
     uint64_t    expires; // absolute, microseconds, set after arming timer
 
+    friend struct timer_slot;
     friend class _wheeltimer;
 };
 
+inline void timer_slot::push_front(timer* t)
+{
+    t->prev = NULL;
+    t->next = head;
+    if (head)
+	head->prev = t;
+    head = t;
+    t->slot = this;
+    count++;
+}
+
+inline void timer_slot::erase(timer* t)
+{
+    if (t->prev)
+	t->prev->next = t->next;
+    else
+	head = t->next;
+
+    if (t->next)
+	t->next->prev = t->prev;
+
+    t->next = t->prev = NULL;
+    t->slot = NULL;
+    count--;
+}
+
 #include "singleton.h"
 
 class _wheeltimer:
@@ -123,7 +176,19 @@ class _wheeltimer:
 {
     std::mutex buckets_mut;
     std::condition_variable buckets_cond;
-    timer_buckets buckets;
+
+    // level 0: one slot per tick
+    timer_slot wheel_l0[WHEEL_L0_SIZE];
+    // levels 1..WHEEL_LEVELS-1
+    timer_slot wheel_ln[WHEEL_LEVELS - 1][WHEEL_LN_SIZE];
+
+    // occupancy bitmap of level 0, to find the next due slot quickly
+    uint64_t l0_used[WHEEL_L0_SIZE / 64];
+
+    // next tick to be processed
+    uint64_t cur_tick;
+    // total number of armed timers
+    size_t   n_timers;
 
     uint64_t resolution; // microseconds
 
@@ -136,6 +201,8 @@ class _wheeltimer:
     // future (or if no timers exist). Needed not to miss the shutdown flag being set.
     const uint64_t max_sleep_time = 500000; // half a second
 
+    void init_wheel();
+
     void place_timer(timer* t, uint64_t, uint64_t);
 
     void add_timer_to_bucket(timer* t, uint64_t);
@@ -143,7 +210,14 @@ class _wheeltimer:
     uint64_t get_timer_bucket(timer*);
     void delete_timer(timer* t, bool del_timer = true);
 
-    void process_current_timers(timer_list&, std::unique_lock<std::mutex>&);
+    // wheel internals, buckets_mut must be held
+    void link_tick(timer* t);
+    void cascade(timer_slot& s);
+    uint64_t next_due_tick();
+    timer_slot& current_slot();
+
+    size_t fire_due(uint64_t now, std::unique_lock<std::mutex>&);
+    size_t process_current_timers(timer_slot&, std::unique_lock<std::mutex>&);
 
 protected:
     void run();
@@ -153,11 +227,11 @@ protected:
 
     _wheeltimer()
 	: resolution(20000) // 20 ms == 20000 us
-	  {}
+	  { init_wheel(); }
 
     _wheeltimer(uint64_t _resolution)
 	: resolution(_resolution)
-	  {}
+	  { init_wheel(); }
 
     ~_wheeltimer() {
       stop();
@@ -183,6 +257,16 @@ public:
     void insert_timer(timer* t, uint64_t relative_expiry_us, uint64_t latest_expiry = 0);
     void insert_timer_abs(timer* t, uint64_t expiry_us, uint64_t latest = 0);
     void remove_timer(timer* t, bool del_timer = true);
+
+    /**
+     * Fires all timers due at or before 'now' (absolute, microseconds).
+     * Used by the timer thread; exposed for benchmarks.
+     * @return number of timers fired
+     */
+    size_t run_due(uint64_t now);
+
+    /** number of armed timers */
+    size_t size();
 };
 
 class wheeltimer : public _wheeltimer, public singleton<wheeltimer> {
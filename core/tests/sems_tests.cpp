@@ -28,6 +28,8 @@ FCT_BGN() {
   FCTMF_SUITE_CALL(test_uriparser);
   FCTMF_SUITE_CALL(test_jsonarg);
   FCTMF_SUITE_CALL(test_replaces);
+  FCTMF_SUITE_CALL(test_resolver);
+  FCTMF_SUITE_CALL(test_regcache);
 } FCT_END();
 
 
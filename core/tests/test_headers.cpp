@@ -148,4 +148,49 @@ FCTMF_SUITE_BGN(test_headers) {
       fct_chk(hdrs1 == "Supported: path, replaces" CRLF);
 
     } FCT_TEST_END();
+
+    FCT_TEST_BGN(indexed_getHeader) {
+      AmSipRequest req;
+      req.hdrs =
+	"Allow-Events: telephone-event,refer" CRLF
+	"p-my-test: myval" CRLF
+	"Allow  : INVITE,ACK" CRLF
+	"P-My-Test:myval2" CRLF
+	"k: timer" CRLF;
+      req.indexHeaders();
+
+      fct_chk(req.getHeader("P-My-Test", true) == "myval");
+      fct_chk(req.getHeader("P-My-Test") == "myval, myval2");
+      fct_chk(req.getHeader("Allow") == "INVITE,ACK");
+      fct_chk(req.getHeader("Supported", "k") == "timer");
+      fct_chk(req.hasHeader("allow-events"));
+      fct_chk(!req.hasHeader("Allow-"));
+
+      // changed behind the index' back
+      req.hdrs += "Subject: x" CRLF;
+      fct_chk(req.getHeader("Subject") == "x");
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(indexed_add_removeHeader) {
+      AmSipRequest req;
+      req.hdrs =
+	"Supported: timer" CRLF
+	"Session-Expires: 110;refresher=uas" CRLF
+	"Supported: path" CRLF;
+
+      string hdrs = req.hdrs;
+      fct_chk(req.removeHeader("supported"));
+      fct_chk(removeHeader(hdrs, "supported"));
+      fct_chk(req.hdrs == hdrs);
+      fct_chk(!req.hasHeader("Supported"));
+      fct_chk(req.getHeader("Session-Expires") == "110;refresher=uas");
+      fct_chk(!req.removeHeader("Supported"));
+
+      AmSipRequest copy = req;
+      copy.addHeader("Min-SE", "90");
+      fct_chk(copy.getHeader("Min-SE") == "90");
+      fct_chk(!req.hasHeader("Min-SE"));
+      fct_chk(copy.hdrs == hdrs + "Min-SE: 90" CRLF);
+    } FCT_TEST_END();
+
 } FCTMF_SUITE_END();
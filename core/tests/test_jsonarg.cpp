@@ -3,6 +3,7 @@
 #include "AmSipHeaders.h"
 #include "AmSipMsg.h"
 #include "jsonArg.h"
+#include "AmUtils.h"
 
 
 FCTMF_SUITE_BGN(test_jsonarg) {
@@ -117,4 +118,100 @@ FCTMF_SUITE_BGN(test_jsonarg) {
       // DBG("a1 = '%s', a2 = '%s', \n", AmArg::print(a1).c_str(), AmArg::print(a2).c_str());
     } FCT_TEST_END();
 
+    FCT_TEST_BGN(json_types_parse) {
+      string s = " {\"s\": \"a\\\"b\\\\c\\/d\\n\", \"i\": 42, \"l\": 12345678901234,"
+	" \"d\": 0.25, \"e\": 2e-0, \"t\": true, \"f\": false, \"n\": null,"
+	" \"a\": [1, [], {}], \"o\": {\"x\": \"\"}} trailing";
+      AmArg a;
+      fct_chk(json2arg(s, a));
+      fct_chk(isArgCStr(a["s"]) && a["s"] == "a\"b\\c/d\n");
+      fct_chk(isArgInt(a["i"]) && a["i"].asInt() == 42);
+      fct_chk(isArgInt(a["l"]) && a["l"].asLong() == 12345678901234L);
+      fct_chk(isArgDouble(a["d"]) && a["d"].asDouble() == 0.25);
+      fct_chk(isArgDouble(a["e"]) && a["e"].asDouble() == 2.0);
+      fct_chk(isArgBool(a["t"]) && a["t"].asBool());
+      fct_chk(isArgBool(a["f"]) && !a["f"].asBool());
+      fct_chk(isArgUndef(a["n"]));
+      fct_chk(isArgArray(a["a"]) && a["a"].size() == 3);
+      fct_chk(isArgArray(a["a"][1]) && isArgStruct(a["a"][2]));
+      fct_chk(isArgCStr(a["o"]["x"]) && a["o"]["x"] == "");
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_number_negative_parse) {
+      AmArg a;
+      fct_chk(json2arg("[-1, -2.5, -1E1, -0.5e-1]", a));
+      fct_chk(isArgInt(a[0]) && a[0].asInt() == -1);
+      fct_chk(isArgDouble(a[1]) && a[1].asDouble() == -2.5);
+      fct_chk(isArgInt(a[2]) && a[2].asInt() == -10);
+      fct_chk(isArgDouble(a[3]) && a[3].asDouble() == -0.05);
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_number_toplevel_parse) {
+      AmArg a;
+      fct_chk(json2arg("5", a) && isArgInt(a) && a.asInt() == 5);
+      fct_chk(json2arg("-5.5", a) && isArgDouble(a) && a.asDouble() == -5.5);
+      fct_chk(!json2arg("-", a) && isArgUndef(a));
+      fct_chk(!json2arg("1.2.3", a));
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_trailing_comma_parse) {
+      AmArg a;
+      fct_chk(json2arg("{\"a\": 1, }", a) && a["a"].asInt() == 1);
+      fct_chk(!json2arg("[1, ]", a));
+      fct_chk(!json2arg("{, }", a));
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_string_escapes_parse) {
+      AmArg a;
+      // \u escapes are kept as they are
+      fct_chk(json2arg("\"caf\\u00e9\"", a) && a == "caf\\u00e9");
+      fct_chk(!json2arg("\"a\\q\"", a));
+      fct_chk(!json2arg("\"abc", a));
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_sized_buffer_parse) {
+      const char* s = "[1, 2][3]";
+      AmArg a;
+      fct_chk(json2arg(s, 6, a) && a.size() == 2);
+      fct_chk(!json2arg(s, 5, a));
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_nesting_parse) {
+      AmArg a;
+      fct_chk(json2arg(string(100, '[') + string(100, ']'), a));
+      fct_chk(!json2arg(string(100000, '[') + string(100000, ']'), a));
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_serialize) {
+      AmArg a;
+      a["b"].push(true);
+      a["b"].push(AmArg());
+      a["b"].push(1.5);
+      a["a"] = 5000000000L;
+      a["c\""] = "x\ty\001";
+      a["d"] = AmArg((long long int)-3);
+      a["e"].assertStruct();
+      // doubles as double2str() prints them
+      fct_chk(arg2json(a) == "{\"a\": 5000000000, \"b\": [true, null, " + double2str(1.5) + "], "
+	      "\"c\\\"\": \"x\\ty\\u0001\", \"d\": -3, \"e\": {}}");
+
+      string out = "prefix ";
+      arg2json(AmArg(-7), out);
+      fct_chk(out == "prefix -7");
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(json_tofro_print_equality) {
+      AmArg a1;
+      a1["int"] = -12;
+      a1["str"] = "line\nquote\" back\\ slash/ \xc3\xa9";
+      a1["arr"].push(AmArg(0.125));
+      a1["arr"].push(AmArg(false));
+      a1["arr"].push(AmArg());
+      a1["obj"]["nested"].assertArray();
+
+      AmArg a2;
+      fct_chk(json2arg(arg2json(a1), a2));
+      fct_chk(AmArg::print(a1) == AmArg::print(a2));
+    } FCT_TEST_END();
+
 } FCTMF_SUITE_END();
@@ -0,0 +1,184 @@
+#include "fct.h"
+
+#include "log.h"
+
+#include "AmUtils.h"
+#include "AmAppTimer.h"
+
+#include "../../apps/sbc/RegisterCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static AliasEntry make_alias_entry(const string& aor, const string& contact,
+				   const string& ip, unsigned short port,
+				   long int ua_expire)
+{
+  AliasEntry ae;
+  ae.aor = aor;
+  ae.contact_uri = contact;
+  ae.source_ip = ip;
+  ae.source_port = port;
+  ae.trsp = "udp";
+  ae.local_if = 1;
+  ae.remote_ua = "Test UA/1.0";
+  ae.ua_expire = ua_expire;
+  return ae;
+}
+
+FCTMF_SUITE_BGN(test_regcache) {
+
+    FCT_TEST_BGN(regcache_snapshot_roundtrip) {
+      RegisterCache* rc = RegisterCache::instance();
+      long int now = AmAppTimer::instance()->unix_clock.get();
+
+      char file[] = "/tmp/sems_regcache_XXXXXX";
+      int fd = mkstemp(file);
+      fct_req(fd >= 0);
+      close(fd);
+
+      unsigned int regs = rc->getActiveRegs();
+
+      AliasEntry ae1 = make_alias_entry("sip:alice@example.com",
+					"sip:alice@10.0.0.1:5062", "192.0.2.1", 5062, now + 300);
+      AliasEntry ae2 = make_alias_entry("sip:alice@example.com",
+					"sip:alice@10.0.0.2", "192.0.2.2", 5060, now + 300);
+      AliasEntry ae3 = make_alias_entry("sip:bob@example.com",
+					"sip:bob@10.0.0.3", "192.0.2.3", 5060, now);
+      rc->update("alias1", now + 3600, ae1);
+      rc->update("alias2", now + 3600, ae2);
+      // already expired at the registrar
+      rc->update("alias3", now - 1, ae3);
+      fct_chk(rc->getActiveRegs() == regs + 3);
+
+      fct_chk(rc->saveSnapshot(file) == 3);
+
+      rc->remove("sip:alice@example.com");
+      rc->remove("sip:bob@example.com");
+      fct_chk(rc->getActiveRegs() == regs);
+
+      fct_chk(rc->loadSnapshot(file) == 2);
+      fct_chk(rc->getActiveRegs() == regs + 2);
+
+      AliasEntry ae;
+      fct_chk(rc->findAliasEntry("alias1", ae));
+      fct_chk(ae.aor == ae1.aor);
+      fct_chk(ae.contact_uri == ae1.contact_uri);
+      fct_chk(ae.source_ip == ae1.source_ip);
+      fct_chk(ae.source_port == ae1.source_port);
+      fct_chk(ae.trsp == ae1.trsp);
+      fct_chk(ae.local_if == ae1.local_if);
+      fct_chk(ae.remote_ua == ae1.remote_ua);
+      fct_chk(ae.ua_expire == ae1.ua_expire);
+      fct_chk(!rc->findAliasEntry("alias3", ae));
+
+      fct_chk(rc->findAEByContact("sip:alice@10.0.0.2", "192.0.2.2", 5060, ae));
+      fct_chk(ae.alias == "alias2");
+
+      RegBinding b;
+      fct_chk(rc->getAlias("sip:alice@example.com", "sip:alice@10.0.0.1:5062",
+			   "192.0.2.1", b));
+      fct_chk(b.alias == "alias1");
+      fct_chk(b.get_expire() == now + 3600);
+
+      map<string,string> alias_map;
+      rc->getAorAliasMap("sip:alice@example.com", alias_map);
+      fct_chk(alias_map.size() == 2);
+
+      // bindings already in the cache are kept
+      fct_chk(rc->loadSnapshot(file) == 0);
+      fct_chk(rc->getActiveRegs() == regs + 2);
+
+      rc->remove("sip:alice@example.com");
+      unlink(file);
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(regcache_snapshot_corrupted) {
+      RegisterCache* rc = RegisterCache::instance();
+      long int now = AmAppTimer::instance()->unix_clock.get();
+
+      char file[] = "/tmp/sems_regcache_XXXXXX";
+      int fd = mkstemp(file);
+      fct_req(fd >= 0);
+      close(fd);
+
+      rc->update("alias4", now + 3600,
+		 make_alias_entry("sip:carol@example.com", "sip:carol@10.0.0.4",
+				  "192.0.2.4", 5060, 0));
+      fct_chk(rc->saveSnapshot(file) == 1);
+      rc->remove("sip:carol@example.com");
+
+      FILE* f = fopen(file, "r+");
+      fct_req(f != NULL);
+      fseek(f, 40, SEEK_SET);
+      fputc('X', f);
+      fclose(f);
+
+      unsigned int regs = rc->getActiveRegs();
+      fct_chk(rc->loadSnapshot(file) == -1);
+      fct_chk(rc->getActiveRegs() == regs);
+
+      unlink(file);
+      // no snapshot yet
+      fct_chk(rc->loadSnapshot(file) == 0);
+    } FCT_TEST_END();
+
+    FCT_TEST_BGN(regcache_expiry_wheel) {
+      AorHash ht;
+      long int now = time(NULL);
+
+      const char* aors[] = { "sip:a@example.com", "sip:b@example.com",
+			     "sip:c@example.com", "sip:d@example.com" };
+      long int expires[] = { now - 1, now + 5, now + 10,
+			     now + 2 * REG_CACHE_WHEEL_SLOTS };
+      for (int i = 0; i < 4; i++) {
+	auto aor_it = ht.insert(make_pair(string(aors[i]), AorEntry())).first;
+	auto b_it = aor_it->second.insert(make_pair(string("sip:x@10.0.0.1/192.0.2.1"),
+						    RegBinding())).first;
+	b_it->second.alias = string("alias-") + aors[i];
+	ht.set_expire(aor_it, b_it, expires[i]);
+      }
+
+      list<string> expired;
+      fct_chk(ht.gbc(now, expired, 100));
+      fct_chk(expired.size() == 1);
+      fct_chk(expired.front() == "alias-sip:a@example.com");
+      fct_chk(ht.find("sip:a@example.com") == ht.end());
+
+      // refreshed: does not expire anymore at now + 5
+      auto aor_it = ht.find("sip:b@example.com");
+      ht.set_expire(aor_it, aor_it->second.begin(), now + 20);
+
+      // removed from the cache
+      ht.erase(ht.find("sip:c@example.com"));
+
+      expired.clear();
+      fct_chk(ht.gbc(now + 15, expired, 100));
+      fct_chk(expired.empty());
+
+      // one turn later: only the binding expired
+      expired.clear();
+      fct_chk(ht.gbc(now + REG_CACHE_WHEEL_SLOTS + 30, expired, 100));
+      fct_chk(expired.size() == 1);
+      fct_chk(expired.front() == "alias-sip:b@example.com");
+      fct_chk(ht.find("sip:d@example.com") != ht.end());
+
+      // bounded number of bindings per run
+      for (int i = 0; i < 3; i++) {
+	auto aor_it = ht.insert(make_pair(string("sip:e@example.com"), AorEntry())).first;
+	auto b_it = aor_it->second.insert(make_pair("sip:e" + int2str(i) + "@10.0.0.1/192.0.2.1",
+						    RegBinding())).first;
+	ht.set_expire(aor_it, b_it, now);
+      }
+      expired.clear();
+      fct_chk(!ht.gbc(now + 2 * REG_CACHE_WHEEL_SLOTS, expired, 2));
+      fct_chk(expired.size() == 2);
+      fct_chk(ht.gbc(now + 2 * REG_CACHE_WHEEL_SLOTS, expired, 2));
+      fct_chk(expired.size() == 4);
+      fct_chk(ht.find("sip:d@example.com") == ht.end());
+      fct_chk(ht.find("sip:e@example.com") == ht.end());
+      fct_chk(ht.empty());
+    } FCT_TEST_END();
+
+} FCTMF_SUITE_END();
@@ -0,0 +1,341 @@
+#include "fct.h"
+
+#include "log.h"
+
+#include "sip/resolver.h"
+#include "sip/ip_util.h"
+#include "AmUtils.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+using std::string;
+
+/*
+ * Minimal DNS server answering the resolver on 127.0.0.1:
+ *  a.test          A 192.0.2.1
+ *  slow.test       A 192.0.2.2, after 50ms
+ *  tc.test         truncated over UDP, A 192.0.2.3 over TCP
+ *  nx.test         NXDOMAIN
+ *  stale.test      A 192.0.2.<4 + #queries>, TTL 0
+ *  _sip._udp.srv.test  SRV 0 0 5070 host.srv.test
+ *  host.srv.test   A 192.0.2.10
+ *  dead.test       never answered
+ */
+class stub_dns_server
+{
+  int udp_sd;
+  int tcp_sd;
+  unsigned short port;
+
+  std::mutex m;
+  std::map<string, int> counts;
+
+  static void put16(string& p, unsigned int v) {
+    p += (char)(v >> 8);
+    p += (char)(v & 0xff);
+  }
+
+  static void put32(string& p, unsigned int v) {
+    put16(p, v >> 16);
+    put16(p, v & 0xffff);
+  }
+
+  static void put_name(string& p, const string& name) {
+    size_t b = 0;
+    while(b < name.length()) {
+      size_t e = name.find('.', b);
+      if(e == string::npos) e = name.length();
+      p += (char)(e - b);
+      p += name.substr(b, e - b);
+      b = e + 1;
+    }
+    p += '\0';
+  }
+
+  static void put_a(string& p, const string& name, unsigned int ttl,
+		    const char* ip) {
+    in_addr a;
+    inet_pton(AF_INET, ip, &a);
+    put_name(p, name);
+    put16(p, 1); put16(p, 1); put32(p, ttl);
+    put16(p, 4);
+    p.append((const char*)&a, 4);
+  }
+
+  /* @return false if the query must not be answered */
+  bool answer(const string& q, bool tcp, string& r, int& delay) {
+    if(q.length() < 17) return false;
+
+    string name;
+    size_t i = 12;
+    while(i < q.length() && q[i]) {
+      unsigned int l = (unsigned char)q[i];
+      if(!name.empty()) name += '.';
+      name += q.substr(i + 1, l);
+      i += l + 1;
+    }
+    i += 5; // end of name + type + class
+    if(i > q.length()) return false;
+
+    int n;
+    {
+      std::lock_guard<std::mutex> _l(m);
+      n = ++counts[name];
+    }
+
+    if(name == "dead.test") return false;
+
+    unsigned int flags = 0x8180;
+    string an;
+    int ancount = 0;
+    delay = 0;
+
+    if(name == "a.test") {
+      put_a(an, name, 300, "192.0.2.1"); ancount++;
+    } else if(name == "slow.test") {
+      put_a(an, name, 300, "192.0.2.2"); ancount++;
+      delay = 50;
+    } else if(name == "tc.test") {
+      if(tcp) { put_a(an, name, 300, "192.0.2.3"); ancount++; }
+      else flags |= 0x0200;
+    } else if(name == "stale.test") {
+      char ip[32];
+      snprintf(ip, sizeof(ip), "192.0.2.%d", 3 + n);
+      put_a(an, name, 0, ip); ancount++;
+    } else if(name == "_sip._udp.srv.test") {
+      string rdata;
+      put16(rdata, 0); put16(rdata, 0); put16(rdata, 5070);
+      put_name(rdata, "host.srv.test");
+      put_name(an, name);
+      put16(an, 33); put16(an, 1); put32(an, 300);
+      put16(an, rdata.length());
+      an += rdata;
+      ancount++;
+    } else if(name == "host.srv.test") {
+      put_a(an, name, 300, "192.0.2.10"); ancount++;
+    } else if(name == "targets.test") {
+      put_a(an, name, 300, "192.0.2.20"); ancount++;
+    } else {
+      flags |= 3; // NXDOMAIN
+    }
+
+    r = q.substr(0, 2);
+    put16(r, flags);
+    put16(r, 1); put16(r, ancount); put16(r, 0); put16(r, 0);
+    r += q.substr(12, i - 12);
+    r += an;
+    return true;
+  }
+
+  void serve_tcp(int sd) {
+    string q;
+    char buf[512];
+    int len;
+    while((len = read(sd, buf, sizeof(buf))) > 0) {
+      q.append(buf, len);
+      if(q.length() >= 2 &&
+	 q.length() >= 2 + (((unsigned char)q[0] << 8) | (unsigned char)q[1]))
+	break;
+    }
+    string r;
+    int delay;
+    if(q.length() > 2 && answer(q.substr(2), true, r, delay)) {
+      string out;
+      put16(out, r.length());
+      out += r;
+      if(write(sd, out.data(), out.length()) < 0) {}
+    }
+    close(sd);
+  }
+
+  void run() {
+    struct pollfd fds[2];
+    fds[0].fd = udp_sd; fds[0].events = POLLIN;
+    fds[1].fd = tcp_sd; fds[1].events = POLLIN;
+
+    for(;;) {
+      if(poll(fds, 2, -1) < 0) continue;
+
+      if(fds[0].revents & POLLIN) {
+	char buf[512];
+	sockaddr_storage from;
+	socklen_t from_len = sizeof(from);
+	int len = recvfrom(udp_sd, buf, sizeof(buf), 0,
+			   (sockaddr*)&from, &from_len);
+	string r;
+	int delay;
+	if(len > 0 && answer(string(buf, len), false, r, delay)) {
+	  int sd = udp_sd;
+	  std::thread([sd, r, from, from_len, delay]() {
+	      if(delay)
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+	      sendto(sd, r.data(), r.length(), 0, (sockaddr*)&from, from_len);
+	    }).detach();
+	}
+      }
+
+      if(fds[1].revents & POLLIN) {
+	int sd = accept(tcp_sd, NULL, NULL);
+	if(sd >= 0)
+	  std::thread(&stub_dns_server::serve_tcp, this, sd).detach();
+      }
+    }
+  }
+
+public:
+  stub_dns_server() : port(0) {
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    udp_sd = socket(AF_INET, SOCK_DGRAM, 0);
+    bind(udp_sd, (sockaddr*)&sa, sizeof(sa));
+    socklen_t len = sizeof(sa);
+    getsockname(udp_sd, (sockaddr*)&sa, &len);
+    port = ntohs(sa.sin_port);
+
+    // same port for TCP
+    tcp_sd = socket(AF_INET, SOCK_STREAM, 0);
+    bind(tcp_sd, (sockaddr*)&sa, sizeof(sa));
+    listen(tcp_sd, 16);
+
+    std::thread(&stub_dns_server::run, this).detach();
+  }
+
+  unsigned short getPort() const { return port; }
+
+  int count(const string& name) {
+    std::lock_guard<std::mutex> _l(m);
+    return counts[name];
+  }
+};
+
+static string resolve(const char* name, dns_rr_type t = dns_r_a)
+{
+  dns_handle h;
+  sockaddr_storage sa;
+  memset(&sa, 0, sizeof(sa));
+  if(resolver::instance()->resolve_name(name, &h, &sa, IPv4, t) < 0)
+    return "";
+  return am_inet_ntop(&sa);
+}
+
+static long elapsed_ms(const struct timeval& start)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+}
+
+FCTMF_SUITE_BGN(test_resolver) {
+
+  static stub_dns_server* dns = NULL;
+  if(!dns) {
+    dns = new stub_dns_server();
+    resolver::dns_servers = "127.0.0.1:" + int2str(dns->getPort());
+    resolver::dns_timeout = 100;
+    resolver::dns_attempts = 2;
+    resolver::dns_serve_stale = 300;
+  }
+
+  FCT_TEST_BGN(resolver_a_cached) {
+    fct_chk(resolve("a.test") == "192.0.2.1");
+    fct_chk(resolve("a.test") == "192.0.2.1");
+    fct_chk(dns->count("a.test") == 1);
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_coalesce) {
+    string res[4];
+    std::thread th[4];
+    for(int i = 0; i < 4; i++)
+      th[i] = std::thread([&res, i]() { res[i] = resolve("slow.test"); });
+    for(int i = 0; i < 4; i++)
+      th[i].join();
+    for(int i = 0; i < 4; i++)
+      fct_chk(res[i] == "192.0.2.2");
+    fct_chk(dns->count("slow.test") == 1);
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_tcp_fallback) {
+    fct_chk(resolve("tc.test") == "192.0.2.3");
+    fct_chk(dns->count("tc.test") == 2);
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_nxdomain) {
+    fct_chk(resolve("nx.test") == "");
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_serve_stale) {
+    fct_chk(resolve("stale.test") == "192.0.2.4");
+    // expired at once: served stale while refreshed
+    fct_chk(resolve("stale.test") == "192.0.2.4");
+    for(int i = 0; i < 50 && dns->count("stale.test") < 2; i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    fct_chk(dns->count("stale.test") == 2);
+    fct_chk(resolve("stale.test") == "192.0.2.5");
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_srv_targets) {
+    fct_chk(resolve("_sip._udp.srv.test", dns_r_srv) == "192.0.2.10");
+    fct_chk(dns->count("_sip._udp.srv.test") == 1);
+    fct_chk(dns->count("host.srv.test") == 1);
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_targets_async) {
+    list<sip_destination> dests(1);
+    dests.front().host = "targets.test";
+
+    std::mutex m;
+    std::condition_variable cond;
+    bool done = false;
+
+    sip_target_set targets;
+    fct_chk(resolver::instance()->resolve_targets(dests, &targets, [&]() {
+	  std::lock_guard<std::mutex> _l(m);
+	  done = true;
+	  cond.notify_all();
+	}) == 1);
+    {
+      std::unique_lock<std::mutex> _l(m);
+      fct_chk(cond.wait_for(_l, std::chrono::milliseconds(1000),
+			    [&done]() { return done; }));
+    }
+    // SRV and A asked for at once
+    fct_chk(dns->count("_sip._udp.targets.test") == 1);
+    fct_chk(dns->count("targets.test") == 1);
+
+    // now from the cache only
+    fct_chk(resolver::instance()->resolve_targets(dests, &targets) == 0);
+    fct_chk(targets.dest_list.size() == 1);
+    if(!targets.dest_list.empty())
+      fct_chk(am_inet_ntop(&targets.dest_list.front().ss) == "192.0.2.20");
+
+    sip_target_set missing;
+    dests.front().host = "nx-targets.test";
+    fct_chk(resolver::instance()->resolve_targets(dests, &missing) < 0);
+  } FCT_TEST_END();
+
+  FCT_TEST_BGN(resolver_timeout) {
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    fct_chk(resolve("dead.test") == "");
+    fct_chk(elapsed_ms(start) < 1000);
+    fct_chk(dns->count("dead.test") == 2);
+  } FCT_TEST_END();
+
+} FCTMF_SUITE_END();
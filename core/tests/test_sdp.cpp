@@ -46,6 +46,8 @@ FCTMF_SUITE_BGN(test_sdp) {
       fct_chk(s.media[0].payloads[1].payload_type==101);
       fct_chk(s.media[0].payloads[0].encoding_name=="PCMU");
       fct_chk(s.media[0].payloads[1].encoding_name=="telephone-event");
+      // no a=rtcp: RTP port + 1 (RFC 3550 11)
+      fct_chk(s.media[0].rtcp_address.getPort() == 21965);
     } FCT_TEST_END();
 
     FCT_TEST_BGN(sdp_LF_no_CRLF) {
@@ -87,4 +89,75 @@ FCTMF_SUITE_BGN(test_sdp) {
       fct_chk(s.media[0].payloads[1].encoding_name=="telephone-event");
     } FCT_TEST_END();
 
+    FCT_TEST_BGN(sdp_print) {
+      AmSdp s;
+      string sdp =
+	"v=0" CRLF
+	"o=- 3615077380 3615077398 IN IP4 178.66.14.5" CRLF
+	"s=-" CRLF
+	"c=IN IP4 178.66.14.5" CRLF
+	"b=AS:64" CRLF
+	"t=0 0" CRLF
+	"m=audio 21964 RTP/AVP 0 101" CRLF
+	"a=ptime:20" CRLF
+	"a=rtpmap:0 PCMU/8000" CRLF
+	"a=rtpmap:101 telephone-event/8000" CRLF
+	"a=fmtp:101 0-15" CRLF
+	"m=video 21966 RTP/AVP 96" CRLF
+	"b=AS:512" CRLF
+	"a=rtpmap:96 H264/90000" CRLF
+	"a=sendonly" CRLF;
+
+      string regenerated =
+	"v=0" CRLF
+	"o=- 3615077380 3615077398 IN IP4 178.66.14.5" CRLF
+	"s=-" CRLF
+	"c=IN IP4 178.66.14.5" CRLF
+	"t=0 0" CRLF
+	"m=audio 21964 RTP/AVP 0 101" CRLF
+	"a=rtpmap:0 PCMU/8000" CRLF
+	"a=rtpmap:101 telephone-event/8000" CRLF
+	"a=fmtp:101 0-15" CRLF
+	"a=sendrecv" CRLF
+	"a=ptime:20" CRLF;
+
+      string out;
+      fct_chk(s.parse(sdp));
+      s.media.pop_back();
+      s.print(out);
+      fct_chk(out == regenerated);
+
+      // unchanged: as received
+      AmSdp v;
+      fct_chk(v.parse(sdp, true));
+      v.print(out);
+      fct_chk(out == sdp);
+
+      // copies print the same
+      AmSdp c(v);
+      v.clear();
+      c.print(out);
+      fct_chk(out == sdp);
+
+      // only the changed section is regenerated
+      c.media[1].payloads[0].sdp_format_parameters = "profile-level-id=42e01f";
+      c.print(out);
+      fct_chk(out.find("b=AS:64" CRLF) != string::npos);
+      fct_chk(out.find("m=audio 21964 RTP/AVP 0 101" CRLF "a=ptime:20" CRLF) != string::npos);
+      fct_chk(out.find("b=AS:512") == string::npos);
+      fct_chk(out.find("a=fmtp:96 profile-level-id=42e01f" CRLF) != string::npos);
+
+      c.media[1].payloads[0].sdp_format_parameters.clear();
+      c.origin.sessV++;
+      c.print(out);
+      fct_chk(out.find("b=AS:64") == string::npos);
+      fct_chk(out.find("o=- 3615077380 3615077399 IN IP4") != string::npos);
+      fct_chk(out.find("b=AS:512" CRLF) != string::npos);
+
+      // last line without line break
+      fct_chk(v.parse(sdp.substr(0, sdp.size() - 2), true));
+      v.print(out);
+      fct_chk(out == sdp);
+    } FCT_TEST_END();
+
 } FCTMF_SUITE_END();